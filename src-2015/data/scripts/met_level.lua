@@ -11,7 +11,7 @@ tile(rborder, 'tile_met.png', 0,0, 18,16 )
 tile(color(0,0,255), 'area01_level_tiles.png', 176,0, 32,32 )
 
 -- load tile map
-chosenMap = math.random(0,3)
+chosenMap = map_variant or math.random(0,3)
 tilemap('map'.. chosenMap .. '.png',16,16)
 
 -- automatically add borders
@@ -0,0 +1,709 @@
+/*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Box2D.h>
+#include <Box2D/Collision/b2BroadPhase.h>
+#include <Box2D/Common/b2WorkerPool.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Times the solvers on scenes of the Testbed, the broad-phase pair updates,
+// the broad-phase tree of a tile map and tile collision, without graphics.
+// Also checks that the parallel island solver and broad-phase give the same
+// results for any thread count: the exit code is 1 if they do not.
+// Usage: Benchmark [-steps N] [-threads N]
+
+static int32 s_stepCount = 600;
+static int32 s_threadCount = 4;
+
+typedef void (*SceneBuilder)(b2World* world);
+
+// The Pyramid test.
+static void BuildPyramid(b2World* world)
+{
+	const int32 count = 20;
+
+	{
+		b2BodyDef bd;
+		b2Body* ground = world->CreateBody(&bd);
+
+		b2PolygonShape shape;
+		shape.SetAsEdge(b2Vec2(-40.0f, 0.0f), b2Vec2(40.0f, 0.0f));
+		ground->CreateFixture(&shape, 0.0f);
+	}
+
+	float32 a = 0.5f;
+	b2PolygonShape shape;
+	shape.SetAsBox(a, a);
+
+	b2Vec2 x(-7.0f, 0.75f);
+	b2Vec2 y;
+	b2Vec2 deltaX(0.5625f, 1.25f);
+	b2Vec2 deltaY(1.125f, 0.0f);
+
+	for (int32 i = 0; i < count; ++i)
+	{
+		y = x;
+
+		for (int32 j = i; j < count; ++j)
+		{
+			b2BodyDef bd;
+			bd.type = b2_dynamicBody;
+			bd.position = y;
+			b2Body* body = world->CreateBody(&bd);
+			body->CreateFixture(&shape, 5.0f);
+
+			y += deltaY;
+		}
+
+		x += deltaX;
+	}
+}
+
+// The VerticalStack test.
+static void BuildVerticalStack(b2World* world)
+{
+	const int32 columnCount = 5;
+	const int32 rowCount = 16;
+
+	{
+		b2BodyDef bd;
+		b2Body* ground = world->CreateBody(&bd);
+
+		b2PolygonShape shape;
+		shape.SetAsEdge(b2Vec2(-40.0f, 0.0f), b2Vec2(40.0f, 0.0f));
+		ground->CreateFixture(&shape, 0.0f);
+
+		shape.SetAsEdge(b2Vec2(20.0f, 0.0f), b2Vec2(20.0f, 20.0f));
+		ground->CreateFixture(&shape, 0.0f);
+	}
+
+	float32 xs[5] = {0.0f, -10.0f, -5.0f, 5.0f, 10.0f};
+
+	for (int32 j = 0; j < columnCount; ++j)
+	{
+		b2PolygonShape shape;
+		shape.SetAsBox(0.5f, 0.5f);
+
+		b2FixtureDef fd;
+		fd.shape = &shape;
+		fd.density = 1.0f;
+		fd.friction = 0.3f;
+
+		for (int32 i = 0; i < rowCount; ++i)
+		{
+			b2BodyDef bd;
+			bd.type = b2_dynamicBody;
+			bd.position.Set(xs[j], 0.752f + 1.54f * i);
+			b2Body* body = world->CreateBody(&bd);
+			body->CreateFixture(&fd);
+		}
+	}
+}
+
+// Steps a scene with sleeping off, so that every step solves every contact,
+// and prints the time per step along with how well the stacks held.
+static void RunScene(const char* name, SceneBuilder build, bool simd)
+{
+	b2World world(b2Vec2(0.0f, -10.0f), false);
+	world.SetSimdContacts(simd);
+	build(&world);
+
+	float32 timeStep = 1.0f / 60.0f;
+	int32 velocityIterations = 8;
+	int32 positionIterations = 3;
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	for (int32 i = 0; i < s_stepCount; ++i)
+	{
+		world.Step(timeStep, velocityIterations, positionIterations);
+		world.ClearForces();
+	}
+	std::chrono::high_resolution_clock::time_point stop = std::chrono::high_resolution_clock::now();
+	double ms = std::chrono::duration<double, std::milli>(stop - start).count();
+
+	// A settled stack keeps its height and stays still.
+	float32 top = -b2_maxFloat;
+	float32 maxSpeed = 0.0f;
+	for (b2Body* b = world.GetBodyList(); b; b = b->GetNext())
+	{
+		if (b->GetType() != b2_dynamicBody)
+		{
+			continue;
+		}
+		top = b2Max(top, b->GetPosition().y);
+		maxSpeed = b2Max(maxSpeed, b->GetLinearVelocity().Length());
+	}
+
+	printf("%-14s %-6s %8.4f ms/step   top %7.3f   max speed %8.5f\n",
+		name, simd ? "simd" : "scalar", ms / s_stepCount, top, maxSpeed);
+}
+
+// Stacks of boxes and pendulums, one island each, all sharing the same static
+// ground through contacts and joints.
+static void BuildSharedGround(b2World* world)
+{
+	b2BodyDef bd;
+	b2Body* ground = world->CreateBody(&bd);
+
+	b2PolygonShape shape;
+	shape.SetAsEdge(b2Vec2(-70.0f, 0.0f), b2Vec2(70.0f, 0.0f));
+	ground->CreateFixture(&shape, 0.0f);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+	for (int32 i = 0; i < 32; ++i)
+	{
+		for (int32 j = 0; j < 10; ++j)
+		{
+			b2BodyDef bd;
+			bd.type = b2_dynamicBody;
+			bd.position.Set(-64.0f + 4.0f * i + 0.1f * (j % 3), 0.5f + 1.05f * j);
+			b2Body* body = world->CreateBody(&bd);
+			body->CreateFixture(&box, 1.0f);
+		}
+	}
+
+	b2PolygonShape bob;
+	bob.SetAsBox(0.25f, 0.25f);
+	for (int32 i = 0; i < 16; ++i)
+	{
+		b2BodyDef bd;
+		bd.type = b2_dynamicBody;
+		bd.position.Set(-62.0f + 8.0f * i + 3.0f, 30.0f);
+		b2Body* body = world->CreateBody(&bd);
+		body->CreateFixture(&bob, 1.0f);
+
+		b2RevoluteJointDef jd;
+		jd.Initialize(ground, body, b2Vec2(-62.0f + 8.0f * i, 30.0f));
+		world->CreateJoint(&jd);
+	}
+}
+
+static uint32 Hash(uint32 hash, const void* data, int32 size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (int32 i = 0; i < size; ++i)
+	{
+		hash = (hash ^ bytes[i]) * 16777619u;
+	}
+	return hash;
+}
+
+// Hashes the PostSolve impulses, in the order they are reported.
+class ReportHasher : public b2ContactListener
+{
+public:
+	ReportHasher() : hash(2166136261u) {}
+
+	void PostSolve(b2Contact* contact, const b2ContactImpulse* impulse)
+	{
+		int32 pointCount = contact->GetManifold()->pointCount;
+		hash = Hash(hash, impulse->normalImpulses, pointCount * sizeof(float32));
+		hash = Hash(hash, impulse->tangentImpulses, pointCount * sizeof(float32));
+	}
+
+	uint32 hash;
+};
+
+// Steps a scene with 1, 2 and 4 solver threads and compares the hashes of the
+// body states and of the PostSolve reports, which should not depend on the
+// thread count. Sleeping is on, so the awake bodies are compared as well.
+static bool RunDeterminism(const char* name, SceneBuilder build, bool simd)
+{
+	uint32 stateHash = 0;
+	uint32 reportHash = 0;
+	bool same = true;
+	for (int32 threadCount = 1; threadCount <= 4; threadCount *= 2)
+	{
+		b2World world(b2Vec2(0.0f, -10.0f), true);
+		world.SetSolverThreadCount(threadCount);
+		world.SetSimdContacts(simd);
+		ReportHasher reports;
+		world.SetContactListener(&reports);
+		build(&world);
+
+		for (int32 i = 0; i < s_stepCount; ++i)
+		{
+			world.Step(1.0f / 60.0f, 8, 3);
+			world.ClearForces();
+		}
+
+		uint32 hash = 2166136261u;
+		int32 awakeCount = 0;
+		for (b2Body* b = world.GetBodyList(); b; b = b->GetNext())
+		{
+			b2Vec2 position = b->GetPosition();
+			float32 angle = b->GetAngle();
+			b2Vec2 velocity = b->GetLinearVelocity();
+			hash = Hash(hash, &position, sizeof(position));
+			hash = Hash(hash, &angle, sizeof(angle));
+			hash = Hash(hash, &velocity, sizeof(velocity));
+			awakeCount += b->IsAwake() ? 1 : 0;
+		}
+
+		if (threadCount == 1)
+		{
+			stateHash = hash;
+			reportHash = reports.hash;
+		}
+		bool match = hash == stateHash && reports.hash == reportHash;
+		same = same && match;
+
+		printf("%-14s %-6s %d thread(s)  state %08x  reports %08x  awake %4d  %s\n",
+			name, simd ? "simd" : "scalar", threadCount, hash, reports.hash, awakeCount,
+			match ? "same" : "DIFFERENT");
+	}
+
+	return same;
+}
+
+// Counts the pairs reported by the broad-phase.
+struct PairCounter
+{
+	void AddPair(void* userDataA, void* userDataB)
+	{
+		B2_NOT_USED(userDataA);
+		B2_NOT_USED(userDataB);
+		++count;
+	}
+
+	int32 count;
+};
+
+// Unit boxes spread so that each touches a few others, all moving each update
+// far enough to leave their fat AABB. Only UpdatePairs is timed.
+static void RunBroadPhase(int32 proxyCount, b2WorkerPool* pool)
+{
+	b2BroadPhase broadPhase;
+	broadPhase.SetWorkerPool(pool);
+
+	float32 extent = 1.2f * sqrtf((float32)proxyCount);
+	b2Vec2 halfSize(0.5f, 0.5f);
+	int32* proxies = new int32[proxyCount];
+	b2AABB* boxes = new b2AABB[proxyCount];
+	srand(proxyCount);
+	for (int32 i = 0; i < proxyCount; ++i)
+	{
+		b2Vec2 center(extent * rand() / (float32)RAND_MAX, extent * rand() / (float32)RAND_MAX);
+		boxes[i].lowerBound = center - halfSize;
+		boxes[i].upperBound = center + halfSize;
+		proxies[i] = broadPhase.CreateProxy(boxes[i], NULL);
+	}
+
+	PairCounter counter;
+	counter.count = 0;
+	broadPhase.UpdatePairs(&counter);
+
+	int32 updateCount = b2Max(10, 200000 / proxyCount);
+	double ms = 0.0;
+	counter.count = 0;
+	for (int32 k = 0; k < updateCount; ++k)
+	{
+		b2Vec2 displacement(k % 2 == 0 ? 0.25f : -0.25f, 0.0f);
+		for (int32 i = 0; i < proxyCount; ++i)
+		{
+			boxes[i].lowerBound += displacement;
+			boxes[i].upperBound += displacement;
+			broadPhase.MoveProxy(proxies[i], boxes[i], displacement);
+		}
+
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		broadPhase.UpdatePairs(&counter);
+		std::chrono::high_resolution_clock::time_point stop = std::chrono::high_resolution_clock::now();
+		ms += std::chrono::duration<double, std::milli>(stop - start).count();
+	}
+
+	printf("%6d proxies  %d thread(s)  %8.3f ms/update  %7.2f Mpairs/s  (%d pairs)\n",
+		proxyCount, pool != NULL ? pool->GetWorkerCount() : 1, ms / updateCount,
+		counter.count / (ms * 1000.0), counter.count / updateCount);
+
+	delete [] boxes;
+	delete [] proxies;
+}
+
+// 64 stacks of 20 boxes, each on its own ground: 64 islands, and many moving
+// proxies for the broad-phase.
+static void BuildIslands(b2World* world)
+{
+	b2PolygonShape ground;
+	ground.SetAsBox(4.0f, 0.5f);
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+	for (int32 i = 0; i < 64; ++i)
+	{
+		b2BodyDef gd;
+		gd.position.Set(10.0f * i, 0.0f);
+		world->CreateBody(&gd)->CreateFixture(&ground, 0.0f);
+
+		for (int32 j = 0; j < 20; ++j)
+		{
+			b2BodyDef bd;
+			bd.type = b2_dynamicBody;
+			bd.position.Set(10.0f * i + 0.3f * (j % 3), 1.0f + 1.05f * j);
+			world->CreateBody(&bd)->CreateFixture(&box, 1.0f);
+		}
+	}
+}
+
+// Checks the order of the pairs, which decides the order of the new contacts:
+// the smaller proxy id first, sorted on it then on the larger, each pair once.
+// The user data of a proxy points to its id.
+struct PairOrderChecker
+{
+	void AddPair(void* userDataA, void* userDataB)
+	{
+		int32 idA = *(int32*)userDataA;
+		int32 idB = *(int32*)userDataB;
+		ordered = ordered && idA < idB &&
+			(idA > lastA || (idA == lastA && idB > lastB));
+		lastA = idA;
+		lastB = idB;
+		hash = Hash(hash, &idA, sizeof(int32));
+		hash = Hash(hash, &idB, sizeof(int32));
+		++count;
+	}
+
+	int32 lastA, lastB;
+	int32 count;
+	uint32 hash;
+	bool ordered;
+};
+
+// The pairs of moving boxes, single threaded and on the pool: the same pairs
+// in the same order, the proxy ids being the same in both broad-phases.
+static bool RunPairOrder(int32 proxyCount, b2WorkerPool* pool)
+{
+	b2BroadPhase broadPhases[2];
+	broadPhases[1].SetWorkerPool(pool);
+
+	float32 extent = 1.2f * sqrtf((float32)proxyCount);
+	b2Vec2 halfSize(0.5f, 0.5f);
+	int32* proxies = new int32[2 * proxyCount];
+	b2AABB* boxes = new b2AABB[proxyCount];
+	srand(proxyCount);
+	for (int32 i = 0; i < proxyCount; ++i)
+	{
+		b2Vec2 center(extent * rand() / (float32)RAND_MAX, extent * rand() / (float32)RAND_MAX);
+		boxes[i].lowerBound = center - halfSize;
+		boxes[i].upperBound = center + halfSize;
+		for (int32 k = 0; k < 2; ++k)
+		{
+			proxies[k * proxyCount + i] = broadPhases[k].CreateProxy(boxes[i], proxies + k * proxyCount + i);
+		}
+	}
+
+	bool same = true;
+	int32 pairCounts[2] = {0, 0};
+	for (int32 step = 0; step < 10; ++step)
+	{
+		uint32 hashes[2];
+		for (int32 k = 0; k < 2; ++k)
+		{
+			PairOrderChecker checker;
+			checker.lastA = -1;
+			checker.lastB = -1;
+			checker.count = 0;
+			checker.hash = 2166136261u;
+			checker.ordered = true;
+			broadPhases[k].UpdatePairs(&checker);
+			same = same && checker.ordered;
+			pairCounts[k] += checker.count;
+			hashes[k] = checker.hash;
+		}
+		same = same && hashes[0] == hashes[1];
+
+		b2Vec2 displacement(step % 2 == 0 ? 0.25f : -0.25f, 0.1f * (step % 3));
+		for (int32 i = 0; i < proxyCount; ++i)
+		{
+			boxes[i].lowerBound += displacement;
+			boxes[i].upperBound += displacement;
+			for (int32 k = 0; k < 2; ++k)
+			{
+				broadPhases[k].MoveProxy(proxies[k * proxyCount + i], boxes[i], displacement);
+			}
+		}
+	}
+
+	same = same && pairCounts[0] == pairCounts[1];
+	printf("%6d proxies  %d thread(s)  pairs sorted and deduplicated: %s  (%d pairs)\n",
+		proxyCount, pool != NULL ? pool->GetWorkerCount() : 1, same ? "yes" : "NO", pairCounts[1]);
+
+	delete [] boxes;
+	delete [] proxies;
+	return same;
+}
+
+// Counts the fixtures found by a world query.
+struct FixtureCounter : public b2QueryCallback
+{
+	bool ReportFixture(b2Fixture* fixture)
+	{
+		B2_NOT_USED(fixture);
+		++count;
+		return true;
+	}
+
+	int32 count;
+};
+
+// A static body of one box per tile, as the game binds its levels. Created
+// active, the proxies are inserted one by one; activated afterwards, they are
+// created in bulk by a top-down build.
+static void RunTileTree(bool bulk)
+{
+	const int32 columnCount = 100;
+	const int32 rowCount = 50;
+
+	b2World world(b2Vec2(0.0f, -10.0f), true);
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	b2BodyDef bd;
+	bd.active = bulk == false;
+	b2Body* body = world.CreateBody(&bd);
+	for (int32 j = 0; j < rowCount; ++j)
+	{
+		for (int32 i = 0; i < columnCount; ++i)
+		{
+			b2PolygonShape shape;
+			shape.SetAsBox(0.5f, 0.5f, b2Vec2(i + 0.5f, j + 0.5f), 0.0f);
+			body->CreateFixture(&shape, 0.0f);
+		}
+	}
+	body->SetActive(true);
+	std::chrono::high_resolution_clock::time_point stop = std::chrono::high_resolution_clock::now();
+	double buildMs = std::chrono::duration<double, std::milli>(stop - start).count();
+
+	// Queries the size of a character, all over the map.
+	const int32 queryCount = 20000;
+	FixtureCounter counter;
+	counter.count = 0;
+	srand(0);
+	start = std::chrono::high_resolution_clock::now();
+	for (int32 i = 0; i < queryCount; ++i)
+	{
+		b2AABB aabb;
+		aabb.lowerBound.Set(columnCount * rand() / (float32)RAND_MAX, rowCount * rand() / (float32)RAND_MAX);
+		aabb.upperBound = aabb.lowerBound + b2Vec2(1.0f, 2.0f);
+		world.QueryAABB(&counter, aabb);
+	}
+	stop = std::chrono::high_resolution_clock::now();
+	double queryMs = std::chrono::duration<double, std::milli>(stop - start).count();
+
+	printf("%d tiles  %-11s build %8.3f ms   height %3d   area ratio %7.2f   %7.3f us/query\n",
+		columnCount * rowCount, bulk ? "bulk" : "one by one", buildMs,
+		world.GetTreeHeight(), world.GetTreeAreaRatio(), 1000.0 * queryMs / queryCount);
+}
+
+// A level of 300 by 100 tiles: ground, walls and rows of platforms.
+static bool IsTileSolid(int32 column, int32 row)
+{
+	if (row < 2 || column == 0 || column == 299)
+	{
+		return true;
+	}
+
+	return row % 12 == 0 && column % 40 < 25;
+}
+
+// Builds the level as one box per tile, or as a grid shape.
+static void BuildTileLevel(b2World* world, bool grid)
+{
+	const int32 columnCount = 300;
+	const int32 rowCount = 100;
+
+	b2BodyDef bd;
+	bd.active = false;
+	b2Body* body = world->CreateBody(&bd);
+	if (grid)
+	{
+		b2GridShape shape;
+		shape.Set(columnCount, rowCount, b2Vec2(1.0f, 1.0f));
+		for (int32 j = 0; j < rowCount; ++j)
+		{
+			for (int32 i = 0; i < columnCount; ++i)
+			{
+				shape.SetSolid(i, j, IsTileSolid(i, j));
+			}
+		}
+		body->CreateFixture(&shape, 0.0f);
+	}
+	else
+	{
+		for (int32 j = 0; j < rowCount; ++j)
+		{
+			for (int32 i = 0; i < columnCount; ++i)
+			{
+				if (IsTileSolid(i, j))
+				{
+					b2PolygonShape shape;
+					shape.SetAsBox(0.5f, 0.5f, b2Vec2(i + 0.5f, j + 0.5f), 0.0f);
+					body->CreateFixture(&shape, 0.0f);
+				}
+			}
+		}
+	}
+	body->SetActive(true);
+}
+
+// Boxes and balls falling on the level, sleeping off.
+static void RunTileCollision(bool grid)
+{
+	b2World world(b2Vec2(0.0f, -10.0f), false);
+	BuildTileLevel(&world, grid);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.4f, 0.4f);
+	b2CircleShape ball;
+	ball.m_radius = 0.4f;
+	for (int32 i = 0; i < 500; ++i)
+	{
+		b2BodyDef bd;
+		bd.type = b2_dynamicBody;
+		bd.position.Set(2.0f + (i * 37) % 295 + 0.1f * (i % 5), 4.0f + 12.0f * ((i / 7) % 8));
+		b2Body* body = world.CreateBody(&bd);
+		body->CreateFixture(i % 2 == 0 ? (b2Shape*)&box : (b2Shape*)&ball, 1.0f);
+	}
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	for (int32 i = 0; i < s_stepCount; ++i)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+		world.ClearForces();
+	}
+	std::chrono::high_resolution_clock::time_point stop = std::chrono::high_resolution_clock::now();
+	double ms = std::chrono::duration<double, std::milli>(stop - start).count();
+
+	printf("%-5s %6d proxies  %5d contacts  %8.4f ms/step\n",
+		grid ? "grid" : "tiles", world.GetProxyCount(), world.GetContactCount(), ms / s_stepCount);
+}
+
+// Boxes and balls sliding over the ground without friction, dropped from a
+// little higher each time. Catching on the tile seams slows them down.
+static void RunTileSeams(bool grid, bool balls)
+{
+	b2PolygonShape box;
+	box.SetAsBox(0.4f, 0.4f);
+	b2CircleShape ball;
+	ball.m_radius = 0.4f;
+
+	const int32 dropCount = 16;
+	int32 caughtCount = 0;
+	float32 minSpeed = b2_maxFloat;
+	for (int32 k = 0; k < dropCount; ++k)
+	{
+		b2World world(b2Vec2(0.0f, -10.0f), false);
+		BuildTileLevel(&world, grid);
+		for (b2Fixture* f = world.GetBodyList()->GetFixtureList(); f; f = f->GetNext())
+		{
+			f->SetFriction(0.0f);
+		}
+
+		b2BodyDef bd;
+		bd.type = b2_dynamicBody;
+		bd.position.Set(10.0f, 2.41f + 0.03f * k);
+		bd.linearVelocity.Set(6.0f, 0.0f);
+		b2Body* body = world.CreateBody(&bd);
+		b2FixtureDef fd;
+		fd.shape = balls ? (b2Shape*)&ball : (b2Shape*)&box;
+		fd.density = 1.0f;
+		fd.friction = 0.0f;
+		body->CreateFixture(&fd);
+
+		float32 speed = b2_maxFloat;
+		for (int32 i = 0; i < 240; ++i)
+		{
+			world.Step(1.0f / 60.0f, 8, 3);
+			speed = b2Min(speed, body->GetLinearVelocity().x);
+		}
+
+		minSpeed = b2Min(minSpeed, speed);
+		if (speed < 5.99f)
+		{
+			++caughtCount;
+		}
+	}
+
+	printf("%-5s %-5s sliding at 6 m/s: %2d of %d caught on seams, min speed %.3f\n",
+		grid ? "grid" : "tiles", balls ? "balls" : "boxes", caughtCount, dropCount, minSpeed);
+}
+
+int main(int argc, char** argv)
+{
+	for (int32 i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "-steps") == 0 && i + 1 < argc)
+		{
+			s_stepCount = b2Max(1, atoi(argv[++i]));
+		}
+		else if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+		{
+			s_threadCount = b2Max(1, atoi(argv[++i]));
+		}
+		else
+		{
+			fprintf(stderr, "usage: %s [-steps N] [-threads N]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	printf("contact solver, %d steps\n", s_stepCount);
+	RunScene("Pyramid", BuildPyramid, false);
+	RunScene("Pyramid", BuildPyramid, true);
+	RunScene("VerticalStack", BuildVerticalStack, false);
+	RunScene("VerticalStack", BuildVerticalStack, true);
+
+	printf("\nsolver threads, %d steps\n", s_stepCount);
+	bool deterministic = true;
+	deterministic = RunDeterminism("SharedGround", BuildSharedGround, false) && deterministic;
+	deterministic = RunDeterminism("SharedGround", BuildSharedGround, true) && deterministic;
+
+	printf("\nbroad-phase pairs\n");
+	b2WorkerPool* pool = s_threadCount > 1 ? new b2WorkerPool(s_threadCount) : NULL;
+	int32 proxyCounts[3] = {1000, 10000, 50000};
+	for (int32 i = 0; i < 3; ++i)
+	{
+		RunBroadPhase(proxyCounts[i], NULL);
+		if (pool != NULL)
+		{
+			RunBroadPhase(proxyCounts[i], pool);
+		}
+	}
+	deterministic = RunPairOrder(10000, pool) && deterministic;
+	delete pool;
+
+	// The threads also run the broad-phase queries.
+	printf("\nbroad-phase threads, %d steps\n", s_stepCount);
+	deterministic = RunDeterminism("Islands", BuildIslands, false) && deterministic;
+
+	printf("\nbroad-phase tree\n");
+	RunTileTree(false);
+	RunTileTree(true);
+
+	printf("\ntile collision, %d steps\n", s_stepCount);
+	RunTileCollision(false);
+	RunTileCollision(true);
+	RunTileSeams(false, false);
+	RunTileSeams(true, false);
+	RunTileSeams(false, true);
+	RunTileSeams(true, true);
+
+	return deterministic ? 0 : 1;
+}
@@ -34,6 +34,7 @@ For discussion please visit http://box2d.org/forum
 #include <Box2D/Common/b2Settings.h>
 
 #include <Box2D/Collision/Shapes/b2CircleShape.h>
+#include <Box2D/Collision/Shapes/b2GridShape.h>
 #include <Box2D/Collision/Shapes/b2PolygonShape.h>
 
 #include <Box2D/Collision/b2BroadPhase.h>
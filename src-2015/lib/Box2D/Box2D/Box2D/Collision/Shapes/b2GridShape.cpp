@@ -0,0 +1,399 @@
+/*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Collision/Shapes/b2GridShape.h>
+#include <Box2D/Collision/b2Distance.h>
+#include <Box2D/Collision/b2TimeOfImpact.h>
+#include <new>
+#include <cstring>
+
+b2GridShape::b2GridShape()
+{
+	m_type = e_grid;
+	m_radius = b2_polygonRadius;
+	m_bits = NULL;
+	m_columnCount = 0;
+	m_rowCount = 0;
+	m_cellSize.Set(1.0f, 1.0f);
+}
+
+b2GridShape::~b2GridShape()
+{
+	b2Free(m_bits);
+}
+
+void b2GridShape::Set(int32 columnCount, int32 rowCount, const b2Vec2& cellSize)
+{
+	b2Assert(columnCount >= 0 && rowCount >= 0);
+	b2Assert(columnCount == 0 || rowCount <= b2_maxGridCells / columnCount);
+	b2Assert(cellSize.x > b2_linearSlop && cellSize.y > b2_linearSlop);
+
+	b2Free(m_bits);
+	m_columnCount = columnCount;
+	m_rowCount = rowCount;
+	m_cellSize = cellSize;
+
+	int32 wordCount = (m_columnCount * m_rowCount + 31) >> 5;
+	m_bits = (uint32*)b2Alloc(b2Max(wordCount, 1) * sizeof(uint32));
+	memset(m_bits, 0, b2Max(wordCount, 1) * sizeof(uint32));
+}
+
+void b2GridShape::SetSolid(int32 column, int32 row, bool solid)
+{
+	b2Assert(0 <= column && column < m_columnCount);
+	b2Assert(0 <= row && row < m_rowCount);
+
+	int32 cell = row * m_columnCount + column;
+	if (solid)
+	{
+		m_bits[cell >> 5] |= 1u << (cell & 31);
+	}
+	else
+	{
+		m_bits[cell >> 5] &= ~(1u << (cell & 31));
+	}
+}
+
+b2Shape* b2GridShape::Clone(b2BlockAllocator* allocator) const
+{
+	void* mem = allocator->Allocate(sizeof(b2GridShape));
+	b2GridShape* clone = new (mem) b2GridShape;
+	clone->Set(m_columnCount, m_rowCount, m_cellSize);
+	clone->m_radius = m_radius;
+	memcpy(clone->m_bits, m_bits, ((m_columnCount * m_rowCount + 31) >> 5) * sizeof(uint32));
+	return clone;
+}
+
+bool b2GridShape::TestPoint(const b2Transform& transform, const b2Vec2& p) const
+{
+	b2Vec2 pLocal = b2MulT(transform, p);
+	if (pLocal.x < 0.0f || pLocal.y < 0.0f)
+	{
+		return false;
+	}
+
+	int32 column = GetIndex(pLocal.x, m_cellSize.x, 0, m_columnCount);
+	int32 row = GetIndex(pLocal.y, m_cellSize.y, 0, m_rowCount);
+	return IsSolid(column, row);
+}
+
+// A Fast Voxel Traversal Algorithm for Ray Tracing, by John Amanatides and Andrew Woo.
+bool b2GridShape::RayCast(b2RayCastOutput* output, const b2RayCastInput& input, const b2Transform& transform) const
+{
+	if (m_columnCount == 0 || m_rowCount == 0)
+	{
+		return false;
+	}
+
+	b2Vec2 p1 = b2MulT(transform, input.p1);
+	b2Vec2 d = b2MulT(transform.R, input.p2 - input.p1);
+	b2Vec2 size(m_columnCount * m_cellSize.x, m_rowCount * m_cellSize.y);
+
+	// Clip the ray to the grid, remembering the axis it enters through.
+	float32 lower = 0.0f, upper = input.maxFraction;
+	int32 axis = -1;
+	for (int32 i = 0; i < 2; ++i)
+	{
+		if (b2Abs(d(i)) < b2_epsilon)
+		{
+			if (p1(i) < 0.0f || size(i) < p1(i))
+			{
+				return false;
+			}
+		}
+		else
+		{
+			float32 t1 = -p1(i) / d(i);
+			float32 t2 = (size(i) - p1(i)) / d(i);
+			if (t1 > t2)
+			{
+				b2Swap(t1, t2);
+			}
+
+			if (t1 > lower)
+			{
+				lower = t1;
+				axis = i;
+			}
+
+			upper = b2Min(upper, t2);
+		}
+
+		if (lower > upper)
+		{
+			return false;
+		}
+	}
+
+	b2Vec2 p = p1 + lower * d;
+	int32 cell[2];
+	cell[0] = GetIndex(p.x, m_cellSize.x, 0, m_columnCount - 1);
+	cell[1] = GetIndex(p.y, m_cellSize.y, 0, m_rowCount - 1);
+
+	int32 step[2];
+	float32 tNext[2], tDelta[2];
+	for (int32 i = 0; i < 2; ++i)
+	{
+		if (d(i) > 0.0f)
+		{
+			step[i] = 1;
+			tNext[i] = ((cell[i] + 1) * m_cellSize(i) - p1(i)) / d(i);
+			tDelta[i] = m_cellSize(i) / d(i);
+		}
+		else if (d(i) < 0.0f)
+		{
+			step[i] = -1;
+			tNext[i] = (cell[i] * m_cellSize(i) - p1(i)) / d(i);
+			tDelta[i] = -m_cellSize(i) / d(i);
+		}
+		else
+		{
+			step[i] = 0;
+			tNext[i] = b2_maxFloat;
+			tDelta[i] = b2_maxFloat;
+		}
+	}
+
+	float32 t = lower;
+	for (;;)
+	{
+		if (IsSolid(cell[0], cell[1]))
+		{
+			// Starting inside a solid cell is no hit.
+			if (axis == -1)
+			{
+				return false;
+			}
+
+			b2Vec2 normal(0.0f, 0.0f);
+			normal(axis) = d(axis) > 0.0f ? -1.0f : 1.0f;
+			output->normal = b2Mul(transform.R, normal);
+			output->fraction = t;
+			return true;
+		}
+
+		axis = tNext[0] < tNext[1] ? 0 : 1;
+		t = tNext[axis];
+		if (t > upper)
+		{
+			return false;
+		}
+
+		cell[axis] += step[axis];
+		tNext[axis] += tDelta[axis];
+		if (cell[axis] < 0 || cell[axis] >= (axis == 0 ? m_columnCount : m_rowCount))
+		{
+			return false;
+		}
+	}
+}
+
+void b2GridShape::ComputeAABB(b2AABB* aabb, const b2Transform& transform) const
+{
+	b2Vec2 size(m_columnCount * m_cellSize.x, m_rowCount * m_cellSize.y);
+	b2Vec2 corners[4];
+	corners[0].Set(0.0f, 0.0f);
+	corners[1].Set(size.x, 0.0f);
+	corners[2].Set(size.x, size.y);
+	corners[3].Set(0.0f, size.y);
+
+	b2Vec2 lower = b2Mul(transform, corners[0]);
+	b2Vec2 upper = lower;
+	for (int32 i = 1; i < 4; ++i)
+	{
+		b2Vec2 v = b2Mul(transform, corners[i]);
+		lower = b2Min(lower, v);
+		upper = b2Max(upper, v);
+	}
+
+	b2Vec2 r(m_radius, m_radius);
+	aabb->lowerBound = lower - r;
+	aabb->upperBound = upper + r;
+}
+
+void b2GridShape::ComputeMass(b2MassData* massData, float32 density) const
+{
+	// The sum of the cells, each a box.
+	float32 w = m_cellSize.x;
+	float32 h = m_cellSize.y;
+	float32 cellArea = w * h;
+	float32 cellI = cellArea * (w * w + h * h) / 12.0f;
+
+	float32 area = 0.0f;
+	b2Vec2 center(0.0f, 0.0f);
+	float32 I = 0.0f;
+	for (int32 row = 0; row < m_rowCount; ++row)
+	{
+		for (int32 column = 0; column < m_columnCount; ++column)
+		{
+			if (IsSolid(column, row) == false)
+			{
+				continue;
+			}
+
+			b2Vec2 c((column + 0.5f) * w, (row + 0.5f) * h);
+			area += cellArea;
+			center += cellArea * c;
+			I += cellI + cellArea * b2Dot(c, c);
+		}
+	}
+
+	massData->mass = density * area;
+	if (area > b2_epsilon)
+	{
+		center *= 1.0f / area;
+	}
+	massData->center = center;
+	massData->I = density * I;
+}
+
+// The cells under a shape, in the grid frame.
+static void b2GetCellRange(const b2GridShape* grid, const b2AABB& aabb, const b2Transform& xf,
+						   int32* lowerColumn, int32* lowerRow, int32* upperColumn, int32* upperRow)
+{
+	b2Vec2 corners[4];
+	corners[0] = aabb.lowerBound;
+	corners[1].Set(aabb.upperBound.x, aabb.lowerBound.y);
+	corners[2] = aabb.upperBound;
+	corners[3].Set(aabb.lowerBound.x, aabb.upperBound.y);
+
+	b2Vec2 lower = b2MulT(xf, corners[0]);
+	b2Vec2 upper = lower;
+	for (int32 i = 1; i < 4; ++i)
+	{
+		b2Vec2 v = b2MulT(xf, corners[i]);
+		lower = b2Min(lower, v);
+		upper = b2Max(upper, v);
+	}
+
+	b2Vec2 r(grid->m_radius, grid->m_radius);
+	lower -= r;
+	upper += r;
+
+	const b2Vec2& cellSize = grid->m_cellSize;
+	*lowerColumn = b2Max((int32)floorf(b2Clamp(lower.x / cellSize.x, -1.0f, (float32)grid->m_columnCount)), 0);
+	*lowerRow = b2Max((int32)floorf(b2Clamp(lower.y / cellSize.y, -1.0f, (float32)grid->m_rowCount)), 0);
+	*upperColumn = b2Min((int32)floorf(b2Clamp(upper.x / cellSize.x, -1.0f, (float32)grid->m_columnCount)), grid->m_columnCount - 1);
+	*upperRow = b2Min((int32)floorf(b2Clamp(upper.y / cellSize.y, -1.0f, (float32)grid->m_rowCount)), grid->m_rowCount - 1);
+}
+
+// A cell as a box for b2Distance and b2TimeOfImpact.
+static void b2SetCellProxy(const b2GridShape* grid, int32 column, int32 row, b2Vec2* vertices, b2DistanceProxy* proxy)
+{
+	const b2Vec2& cellSize = grid->m_cellSize;
+	vertices[0].Set(column * cellSize.x, row * cellSize.y);
+	vertices[1].Set((column + 1) * cellSize.x, row * cellSize.y);
+	vertices[2].Set((column + 1) * cellSize.x, (row + 1) * cellSize.y);
+	vertices[3].Set(column * cellSize.x, (row + 1) * cellSize.y);
+	proxy->m_vertices = vertices;
+	proxy->m_count = 4;
+	proxy->m_radius = grid->m_radius;
+}
+
+bool b2GridShape::TestOverlap(const b2Shape* shape, const b2Transform& xf, const b2Transform& shapeXf) const
+{
+	b2AABB aabb;
+	shape->ComputeAABB(&aabb, shapeXf);
+
+	int32 lowerColumn, lowerRow, upperColumn, upperRow;
+	b2GetCellRange(this, aabb, xf, &lowerColumn, &lowerRow, &upperColumn, &upperRow);
+
+	b2DistanceInput input;
+	input.proxyB.Set(shape);
+	input.transformA = xf;
+	input.transformB = shapeXf;
+	input.useRadii = true;
+
+	b2Vec2 vertices[4];
+	for (int32 row = lowerRow; row <= upperRow; ++row)
+	{
+		for (int32 column = lowerColumn; column <= upperColumn; ++column)
+		{
+			if (IsSolid(column, row) == false)
+			{
+				continue;
+			}
+
+			b2SetCellProxy(this, column, row, vertices, &input.proxyA);
+
+			b2SimplexCache cache;
+			cache.count = 0;
+
+			b2DistanceOutput output;
+			b2Distance(&output, &cache, &input);
+
+			if (output.distance < 10.0f * b2_epsilon)
+			{
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+void b2GridShape::TimeOfImpact(b2TOIOutput* output, const b2Sweep& sweep,
+							   const b2Shape* shape, const b2Sweep& shapeSweep, float32 tMax) const
+{
+	output->state = b2TOIOutput::e_separated;
+	output->t = tMax;
+
+	b2Transform xf, shapeXf1, shapeXf2;
+	sweep.GetTransform(&xf, 0.0f);
+	shapeSweep.GetTransform(&shapeXf1, 0.0f);
+	shapeSweep.GetTransform(&shapeXf2, tMax);
+
+	// The cells swept by the shape, as far as its AABB goes.
+	b2AABB aabb1, aabb2, aabb;
+	shape->ComputeAABB(&aabb1, shapeXf1);
+	shape->ComputeAABB(&aabb2, shapeXf2);
+	aabb.Combine(aabb1, aabb2);
+
+	int32 lowerColumn, lowerRow, upperColumn, upperRow;
+	b2GetCellRange(this, aabb, xf, &lowerColumn, &lowerRow, &upperColumn, &upperRow);
+
+	b2TOIInput input;
+	input.proxyB.Set(shape);
+	input.sweepA = sweep;
+	input.sweepB = shapeSweep;
+
+	b2Vec2 vertices[4];
+	for (int32 row = lowerRow; row <= upperRow; ++row)
+	{
+		for (int32 column = lowerColumn; column <= upperColumn; ++column)
+		{
+			// Inner cells are reached through their neighbours.
+			if (IsSolid(column, row) == false ||
+				(IsSolid(column - 1, row) && IsSolid(column + 1, row) &&
+				 IsSolid(column, row - 1) && IsSolid(column, row + 1)))
+			{
+				continue;
+			}
+
+			b2SetCellProxy(this, column, row, vertices, &input.proxyA);
+			input.tMax = output->t;
+
+			b2TOIOutput cellOutput;
+			b2TimeOfImpact(&cellOutput, &input);
+
+			if (cellOutput.state == b2TOIOutput::e_touching &&
+				(output->state != b2TOIOutput::e_touching || cellOutput.t < output->t))
+			{
+				*output = cellOutput;
+			}
+		}
+	}
+}
@@ -0,0 +1,262 @@
+/*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_GRID_SHAPE_H
+#define B2_GRID_SHAPE_H
+
+#include <Box2D/Collision/Shapes/b2Shape.h>
+
+struct b2TOIOutput;
+
+/// The most cells a grid can have. A face key holds a cell index in 21 bits
+/// and takes the high 24 bits of the contact ids, see b2GridContact.
+#define b2_maxGridCells		(1 << 21)
+
+/// A run of exposed cell sides along a row or a column of a grid, that is
+/// sides between a solid cell and an empty one. Internal sides, between two
+/// solid cells, are never reported: shapes sliding over a row of cells do not
+/// catch on the seams.
+struct b2GridFace
+{
+	b2Vec2 vertex1;		///< in the grid frame, the solid cells on the left as for a polygon
+	b2Vec2 vertex2;
+	b2Vec2 normal;		///< outward, towards the empty cells
+	uint32 key;			///< identifies the face from one query to the next, see b2GridShape::QueryFaces, 24 bits
+};
+
+/// A static tile map: a regular grid of solid or empty cells, stored one bit
+/// per cell. The grid frame has the lower corner of cell (0, 0) at the origin,
+/// columns along x and rows along y. The whole grid is a single fixture with a
+/// single broad-phase proxy; the cells near a shape are found by index arithmetic
+/// and collide as the exposed faces around them.
+/// Cells can be changed once the fixture is created: the AABB covers the whole
+/// grid. Bodies resting on a removed cell have to be woken up by the caller.
+class b2GridShape : public b2Shape
+{
+public:
+	b2GridShape();
+	~b2GridShape();
+
+	/// Resize the grid, all cells empty. At most b2_maxGridCells cells.
+	/// @param cellSize the size of a cell, which need not be square.
+	void Set(int32 columnCount, int32 rowCount, const b2Vec2& cellSize);
+
+	/// Set a cell solid or empty.
+	void SetSolid(int32 column, int32 row, bool solid);
+
+	/// Is the cell solid? Cells outside the grid are empty.
+	bool IsSolid(int32 column, int32 row) const;
+
+	int32 GetColumnCount() const { return m_columnCount; }
+	int32 GetRowCount() const { return m_rowCount; }
+	const b2Vec2& GetCellSize() const { return m_cellSize; }
+
+	/// Implement b2Shape.
+	b2Shape* Clone(b2BlockAllocator* allocator) const;
+
+	/// Implement b2Shape. Tests the cell under the point.
+	bool TestPoint(const b2Transform& transform, const b2Vec2& p) const;
+
+	/// Implement b2Shape. Walks the cells along the ray, returns false if it
+	/// starts in a solid cell.
+	bool RayCast(b2RayCastOutput* output, const b2RayCastInput& input, const b2Transform& transform) const;
+
+	/// @see b2Shape::ComputeAABB
+	void ComputeAABB(b2AABB* aabb, const b2Transform& transform) const;
+
+	/// @see b2Shape::ComputeMass
+	void ComputeMass(b2MassData* massData, float32 density) const;
+
+	/// Report the faces of the grid lying in a box of the grid frame to the
+	/// callback, through ReportFace(const b2GridFace& face). The faces are cut
+	/// one cell past the box, along rows (tops then bottoms) then along columns
+	/// (rights then lefts), in a fixed order. A face keeps its key as long as
+	/// its start, or the lack of it, stays in the box.
+	template <typename T>
+	void QueryFaces(T* callback, const b2AABB& aabb) const;
+
+	/// Do the cells overlap a shape? Same tolerance as b2TestOverlap.
+	bool TestOverlap(const b2Shape* shape, const b2Transform& xf, const b2Transform& shapeXf) const;
+
+	/// Compute the time of impact of a shape moving against the grid, the earliest
+	/// over the cells with an exposed side in the swept AABB of the shape. Same
+	/// result as b2TimeOfImpact against a box per cell. The grid is expected to
+	/// be static: its transform is taken at the start of its sweep.
+	void TimeOfImpact(b2TOIOutput* output, const b2Sweep& sweep,
+					  const b2Shape* shape, const b2Sweep& shapeSweep, float32 tMax) const;
+
+	uint32* m_bits;
+	int32 m_columnCount;
+	int32 m_rowCount;
+	b2Vec2 m_cellSize;
+
+private:
+
+	// The bits are owned, see Clone.
+	b2GridShape(const b2GridShape&);
+	b2GridShape& operator=(const b2GridShape&);
+
+	// The index of the cell containing x, clamped to [lower, upper].
+	static int32 GetIndex(float32 x, float32 size, int32 lower, int32 upper);
+
+	bool IsExposed(int32 column, int32 row, int32 side) const;
+};
+
+/// The four sides of a cell, in the order of b2GridShape::QueryFaces.
+enum b2GridSide
+{
+	e_gridTop = 0,
+	e_gridBottom = 1,
+	e_gridRight = 2,
+	e_gridLeft = 3
+};
+
+inline bool b2GridShape::IsSolid(int32 column, int32 row) const
+{
+	if (column < 0 || column >= m_columnCount || row < 0 || row >= m_rowCount)
+	{
+		return false;
+	}
+
+	int32 cell = row * m_columnCount + column;
+	return (m_bits[cell >> 5] & (1u << (cell & 31))) != 0;
+}
+
+inline int32 b2GridShape::GetIndex(float32 x, float32 size, int32 lower, int32 upper)
+{
+	// Clamped as a float first, a far away box must not overflow.
+	float32 index = b2Clamp(x / size, lower - 1.0f, upper + 1.0f);
+	return b2Clamp((int32)floorf(index), lower, upper);
+}
+
+inline bool b2GridShape::IsExposed(int32 column, int32 row, int32 side) const
+{
+	if (IsSolid(column, row) == false)
+	{
+		return false;
+	}
+
+	switch (side)
+	{
+	case e_gridTop:
+		return IsSolid(column, row + 1) == false;
+	case e_gridBottom:
+		return IsSolid(column, row - 1) == false;
+	case e_gridRight:
+		return IsSolid(column + 1, row) == false;
+	default:
+		return IsSolid(column - 1, row) == false;
+	}
+}
+
+template <typename T>
+inline void b2GridShape::QueryFaces(T* callback, const b2AABB& aabb) const
+{
+	if (m_columnCount == 0 || m_rowCount == 0)
+	{
+		return;
+	}
+
+	for (int32 side = e_gridTop; side <= e_gridLeft; ++side)
+	{
+		// Faces along rows for the tops and bottoms, along columns for the sides.
+		bool alongRows = side == e_gridTop || side == e_gridBottom;
+		int32 axis = alongRows ? 1 : 0;
+		int32 lineCount = alongRows ? m_rowCount : m_columnCount;
+		int32 cellCount = alongRows ? m_columnCount : m_rowCount;
+		float32 lineSize = m_cellSize(axis);
+		float32 cellSize = m_cellSize(1 - axis);
+
+		// The lines of cells whose side lies in the box: a top or right side
+		// is one cell past the lower corner of its cell.
+		int32 offset = (side == e_gridTop || side == e_gridRight) ? 1 : 0;
+		float32 lower = aabb.lowerBound(axis) / lineSize - offset;
+		float32 upper = aabb.upperBound(axis) / lineSize - offset;
+		if (upper < 0.0f || lower > lineCount - 1.0f)
+		{
+			continue;
+		}
+		int32 lowerLine = b2Max((int32)ceilf(b2Max(lower, -1.0f)), 0);
+		int32 upperLine = b2Min((int32)floorf(b2Min(upper, (float32)lineCount)), lineCount - 1);
+
+		// The cells along the lines, one more on each end.
+		int32 lowerCell = b2Max(GetIndex(aabb.lowerBound(1 - axis), cellSize, -1, cellCount) - 1, 0);
+		int32 upperCell = b2Min(GetIndex(aabb.upperBound(1 - axis), cellSize, -1, cellCount) + 1, cellCount - 1);
+
+		for (int32 line = lowerLine; line <= upperLine; ++line)
+		{
+			int32 start = -1;
+			for (int32 cell = lowerCell; cell <= upperCell + 1; ++cell)
+			{
+				bool exposed = false;
+				if (cell <= upperCell)
+				{
+					exposed = alongRows ? IsExposed(cell, line, side) : IsExposed(line, cell, side);
+				}
+
+				if (exposed && start == -1)
+				{
+					start = cell;
+				}
+
+				if (exposed || start == -1)
+				{
+					continue;
+				}
+
+				// A run [start, cell - 1], open if it goes on before the box.
+				bool open = start == lowerCell && start > 0 &&
+					(alongRows ? IsExposed(start - 1, line, side) : IsExposed(line, start - 1, side));
+
+				b2GridFace face;
+				uint32 index = alongRows ? line * m_columnCount + start : start * m_columnCount + line;
+				face.key = ((open ? (uint32)line : index) << 3) | ((open ? 1u : 0u) << 2) | (uint32)side;
+
+				float32 level = (line + offset) * lineSize;
+				float32 from = start * cellSize;
+				float32 to = cell * cellSize;
+				switch (side)
+				{
+				case e_gridTop:
+					face.vertex1.Set(to, level);
+					face.vertex2.Set(from, level);
+					face.normal.Set(0.0f, 1.0f);
+					break;
+				case e_gridBottom:
+					face.vertex1.Set(from, level);
+					face.vertex2.Set(to, level);
+					face.normal.Set(0.0f, -1.0f);
+					break;
+				case e_gridRight:
+					face.vertex1.Set(level, from);
+					face.vertex2.Set(level, to);
+					face.normal.Set(1.0f, 0.0f);
+					break;
+				default:
+					face.vertex1.Set(level, to);
+					face.vertex2.Set(level, from);
+					face.normal.Set(-1.0f, 0.0f);
+					break;
+				}
+
+				callback->ReportFace(face);
+				start = -1;
+			}
+		}
+	}
+}
+
+#endif
@@ -17,25 +17,184 @@
 */
 
 #include <Box2D/Collision/b2BroadPhase.h>
+#include <Box2D/Common/b2WorkerPool.h>
 #include <cstring>
 
+// The moving proxies queried per item of a parallel query.
+const int32 b2_pairQueryChunk = 64;
+
+static void b2PushPair(b2PairBuffer* buffer, b2PairKey key)
+{
+	// Grow the pair buffer as needed.
+	if (buffer->count == buffer->capacity)
+	{
+		b2PairKey* oldKeys = buffer->keys;
+		buffer->capacity = b2Max(2 * buffer->capacity, 16);
+		buffer->keys = (b2PairKey*)b2Alloc(buffer->capacity * sizeof(b2PairKey));
+		memcpy(buffer->keys, oldKeys, buffer->count * sizeof(b2PairKey));
+		b2Free(oldKeys);
+	}
+
+	buffer->keys[buffer->count++] = key;
+}
+
+// This is called from b2DynamicTree::Query when we are gathering pairs.
+struct b2PairQuery
+{
+	bool QueryCallback(int32 proxyId)
+	{
+		// A proxy cannot form a pair with itself.
+		if (proxyId == queryProxyId)
+		{
+			return true;
+		}
+
+		b2PushPair(buffer, b2MakePairKey(proxyId, queryProxyId));
+		return true;
+	}
+
+	b2PairBuffer* buffer;
+	int32 queryProxyId;
+};
+
+static void b2QueryMoves(const b2DynamicTree* tree, const int32* moves, int32 moveCount, b2PairBuffer* buffer)
+{
+	b2PairQuery query;
+	query.buffer = buffer;
+	for (int32 i = 0; i < moveCount; ++i)
+	{
+		query.queryProxyId = moves[i];
+		if (query.queryProxyId == b2BroadPhase::e_nullProxy)
+		{
+			continue;
+		}
+
+		// We have to query the tree with the fat AABB so that
+		// we don't fail to create a pair that may touch later.
+		tree->Query(&query, tree->GetFatAABB(query.queryProxyId));
+	}
+}
+
+// Queries a chunk of the move buffer per item, into the buffer of the worker.
+struct b2PairQueryTask : public b2WorkerTask
+{
+	void Execute(int32 item, int32 worker)
+	{
+		int32 begin = item * b2_pairQueryChunk;
+		int32 count = b2Min(b2_pairQueryChunk, moveCount - begin);
+		b2QueryMoves(tree, moves + begin, count, buffers + worker);
+	}
+
+	const b2DynamicTree* tree;
+	const int32* moves;
+	int32 moveCount;
+	b2PairBuffer* buffers;
+};
+
+// Sort the keys by bytes, least significant first. The histograms of all the
+// bytes are gathered in one pass; bytes that all keys share (the high ones,
+// proxy ids being small) cost no pass.
+static void b2RadixSort(b2PairKey* keys, b2PairKey* scratch, int32 count)
+{
+	int32 histograms[sizeof(b2PairKey)][256];
+	memset(histograms, 0, sizeof(histograms));
+	for (int32 i = 0; i < count; ++i)
+	{
+		b2PairKey key = keys[i];
+		for (int32 b = 0; b < (int32)sizeof(b2PairKey); ++b)
+		{
+			++histograms[b][(key >> (8 * b)) & 0xFF];
+		}
+	}
+
+	b2PairKey* source = keys;
+	b2PairKey* target = scratch;
+	for (int32 b = 0; b < (int32)sizeof(b2PairKey); ++b)
+	{
+		int32* histogram = histograms[b];
+		int32 shift = 8 * b;
+		if (histogram[(source[0] >> shift) & 0xFF] == count)
+		{
+			continue;
+		}
+
+		int32 offset = 0;
+		for (int32 d = 0; d < 256; ++d)
+		{
+			int32 n = histogram[d];
+			histogram[d] = offset;
+			offset += n;
+		}
+
+		for (int32 i = 0; i < count; ++i)
+		{
+			b2PairKey key = source[i];
+			target[histogram[(key >> shift) & 0xFF]++] = key;
+		}
+
+		b2Swap(source, target);
+	}
+
+	if (source != keys)
+	{
+		memcpy(keys, source, count * sizeof(b2PairKey));
+	}
+}
+
 b2BroadPhase::b2BroadPhase()
 {
 	m_proxyCount = 0;
 
-	m_pairCapacity = 16;
-	m_pairCount = 0;
-	m_pairBuffer = (b2Pair*)b2Alloc(m_pairCapacity * sizeof(b2Pair));
+	m_pairs.capacity = 16;
+	m_pairs.count = 0;
+	m_pairs.keys = (b2PairKey*)b2Alloc(m_pairs.capacity * sizeof(b2PairKey));
+
+	m_sortCapacity = 0;
+	m_sortBuffer = NULL;
 
 	m_moveCapacity = 16;
 	m_moveCount = 0;
 	m_moveBuffer = (int32*)b2Alloc(m_moveCapacity * sizeof(int32));
+
+	m_workerPool = NULL;
+	m_workerPairs = NULL;
+	m_workerPairCount = 0;
+
+	m_rebuildGrowth = 0.0f;
+	m_rebuildAreaRatio = 0.0f;
+	m_updateCount = 0;
 }
 
 b2BroadPhase::~b2BroadPhase()
 {
+	SetWorkerPool(NULL);
 	b2Free(m_moveBuffer);
-	b2Free(m_pairBuffer);
+	b2Free(m_sortBuffer);
+	b2Free(m_pairs.keys);
+}
+
+void b2BroadPhase::SetWorkerPool(b2WorkerPool* pool)
+{
+	for (int32 i = 0; i < m_workerPairCount; ++i)
+	{
+		b2Free(m_workerPairs[i].keys);
+	}
+	b2Free(m_workerPairs);
+	m_workerPairs = NULL;
+	m_workerPairCount = 0;
+
+	m_workerPool = pool;
+	if (m_workerPool != NULL)
+	{
+		m_workerPairCount = m_workerPool->GetWorkerCount();
+		m_workerPairs = (b2PairBuffer*)b2Alloc(m_workerPairCount * sizeof(b2PairBuffer));
+		for (int32 i = 0; i < m_workerPairCount; ++i)
+		{
+			m_workerPairs[i].keys = NULL;
+			m_workerPairs[i].count = 0;
+			m_workerPairs[i].capacity = 0;
+		}
+	}
 }
 
 int32 b2BroadPhase::CreateProxy(const b2AABB& aabb, void* userData)
@@ -46,6 +205,16 @@ int32 b2BroadPhase::CreateProxy(const b2AABB& aabb, void* userData)
 	return proxyId;
 }
 
+void b2BroadPhase::CreateProxies(const b2AABB* aabbs, void* const* userData, int32 count, int32* proxyIds)
+{
+	m_tree.CreateProxies(aabbs, userData, count, proxyIds);
+	m_proxyCount += count;
+	for (int32 i = 0; i < count; ++i)
+	{
+		BufferMove(proxyIds[i]);
+	}
+}
+
 void b2BroadPhase::DestroyProxy(int32 proxyId)
 {
 	UnBufferMove(proxyId);
@@ -89,28 +258,132 @@ void b2BroadPhase::UnBufferMove(int32 proxyId)
 	}
 }
 
-// This is called from b2DynamicTree::Query when we are gathering pairs.
-bool b2BroadPhase::QueryCallback(int32 proxyId)
+void b2BroadPhase::FindPairs()
 {
-	// A proxy cannot form a pair with itself.
-	if (proxyId == m_queryProxyId)
+	m_pairs.count = 0;
+
+	int32 chunkCount = (m_moveCount + b2_pairQueryChunk - 1) / b2_pairQueryChunk;
+	if (m_workerPool != NULL && chunkCount > 1)
 	{
-		return true;
+		int32* chunks = (int32*)b2Alloc(chunkCount * sizeof(int32));
+		for (int32 i = 0; i < chunkCount; ++i)
+		{
+			chunks[i] = i;
+		}
+
+		for (int32 i = 0; i < m_workerPairCount; ++i)
+		{
+			m_workerPairs[i].count = 0;
+		}
+
+		b2PairQueryTask task;
+		task.tree = &m_tree;
+		task.moves = m_moveBuffer;
+		task.moveCount = m_moveCount;
+		task.buffers = m_workerPairs;
+		m_workerPool->Run(&task, chunks, chunkCount);
+		b2Free(chunks);
+
+		// Gather the pairs of the workers. Which worker found a pair does not
+		// matter once they are sorted.
+		int32 pairCount = 0;
+		for (int32 i = 0; i < m_workerPairCount; ++i)
+		{
+			pairCount += m_workerPairs[i].count;
+		}
+		if (pairCount > m_pairs.capacity)
+		{
+			b2Free(m_pairs.keys);
+			m_pairs.capacity = b2Max(pairCount, 2 * m_pairs.capacity);
+			m_pairs.keys = (b2PairKey*)b2Alloc(m_pairs.capacity * sizeof(b2PairKey));
+		}
+		for (int32 i = 0; i < m_workerPairCount; ++i)
+		{
+			memcpy(m_pairs.keys + m_pairs.count, m_workerPairs[i].keys, m_workerPairs[i].count * sizeof(b2PairKey));
+			m_pairs.count += m_workerPairs[i].count;
+		}
+	}
+	else
+	{
+		b2QueryMoves(&m_tree, m_moveBuffer, m_moveCount, &m_pairs);
 	}
 
-	// Grow the pair buffer as needed.
-	if (m_pairCount == m_pairCapacity)
+	// Reset move buffer
+	m_moveCount = 0;
+
+	// Sort the pair buffer to expose duplicates.
+	SortPairs();
+
+	// Skip any duplicate pairs.
+	int32 uniqueCount = 0;
+	for (int32 i = 0; i < m_pairs.count; ++i)
 	{
-		b2Pair* oldBuffer = m_pairBuffer;
-		m_pairCapacity *= 2;
-		m_pairBuffer = (b2Pair*)b2Alloc(m_pairCapacity * sizeof(b2Pair));
-		memcpy(m_pairBuffer, oldBuffer, m_pairCount * sizeof(b2Pair));
-		b2Free(oldBuffer);
+		if (uniqueCount == 0 || m_pairs.keys[i] != m_pairs.keys[uniqueCount - 1])
+		{
+			m_pairs.keys[uniqueCount++] = m_pairs.keys[i];
+		}
+	}
+	m_pairs.count = uniqueCount;
+}
+
+void b2BroadPhase::SortPairs()
+{
+	// The radix sort does not pay for its histograms on a few pairs.
+	const int32 k_radixThreshold = 256;
+	if (m_pairs.count < k_radixThreshold)
+	{
+		std::sort(m_pairs.keys, m_pairs.keys + m_pairs.count);
+		return;
+	}
+
+	if (m_sortCapacity < m_pairs.count)
+	{
+		b2Free(m_sortBuffer);
+		m_sortCapacity = m_pairs.capacity;
+		m_sortBuffer = (b2PairKey*)b2Alloc(m_sortCapacity * sizeof(b2PairKey));
+	}
+
+	b2RadixSort(m_pairs.keys, m_sortBuffer, m_pairs.count);
+}
+
+void b2BroadPhase::SetRebuildThreshold(float32 growth)
+{
+	m_rebuildGrowth = growth;
+	m_updateCount = 0;
+}
+
+void b2BroadPhase::UpdateTree()
+{
+	// Updates between two checks of the tree quality.
+	const int32 k_checkPeriod = 64;
+
+	// Updates between the start and the end of a rebuild.
+	const int32 k_rebuildLatency = 8;
+
+	if (m_tree.IsRebuilding())
+	{
+		// Waits if the build is late, for the swap to happen at a known update.
+		if (++m_updateCount >= k_rebuildLatency)
+		{
+			if (m_tree.FinishRebuild(true))
+			{
+				m_rebuildAreaRatio = m_tree.GetAreaRatio();
+			}
+			m_updateCount = 0;
+		}
+		return;
 	}
 
-	m_pairBuffer[m_pairCount].proxyIdA = b2Min(proxyId, m_queryProxyId);
-	m_pairBuffer[m_pairCount].proxyIdB = b2Max(proxyId, m_queryProxyId);
-	++m_pairCount;
+	if (m_rebuildGrowth <= 0.0f || ++m_updateCount < k_checkPeriod)
+	{
+		return;
+	}
+	m_updateCount = 0;
 
-	return true;
+	// The first check rebuilds, to know the ratio of a fresh tree.
+	float32 areaRatio = m_tree.GetAreaRatio();
+	if (m_rebuildAreaRatio == 0.0f || areaRatio > m_rebuildGrowth * m_rebuildAreaRatio)
+	{
+		m_tree.StartRebuild();
+	}
 }
@@ -24,11 +24,23 @@
 #include <Box2D/Collision/b2DynamicTree.h>
 #include <algorithm>
 
-struct b2Pair
+class b2WorkerPool;
+
+/// A pair of proxies packed in 64 bits, the smaller id high. Keys sort like
+/// the pairs: by the first proxy, then the second.
+typedef uint64 b2PairKey;
+
+inline b2PairKey b2MakePairKey(int32 proxyIdA, int32 proxyIdB)
 {
-	int32 proxyIdA;
-	int32 proxyIdB;
-	int32 next;
+	return ((b2PairKey)b2Min(proxyIdA, proxyIdB) << 32) | (uint32)b2Max(proxyIdA, proxyIdB);
+}
+
+/// A growing array of pair keys.
+struct b2PairBuffer
+{
+	b2PairKey* keys;
+	int32 count;
+	int32 capacity;
 };
 
 /// The broad-phase is used for computing pairs and performing volume queries and ray casts.
@@ -50,6 +62,11 @@ public:
 	/// UpdatePairs is called.
 	int32 CreateProxy(const b2AABB& aabb, void* userData);
 
+	/// Create proxies in bulk, the tree is rebuilt once for them all. Pairs
+	/// are not reported until UpdatePairs is called.
+	/// @param proxyIds receives the id of each new proxy.
+	void CreateProxies(const b2AABB* aabbs, void* const* userData, int32 count, int32* proxyIds);
+
 	/// Destroy a proxy. It is up to the client to remove any pairs.
 	void DestroyProxy(int32 proxyId);
 
@@ -91,6 +108,21 @@ public:
 	/// Compute the height of the embedded tree.
 	int32 ComputeHeight() const;
 
+	/// Get the area ratio of the embedded tree, see b2DynamicTree::GetAreaRatio.
+	float32 GetAreaRatio() const;
+
+	/// Rebuild the tree in the background when its area ratio grows past
+	/// growth times its value after the last rebuild. The new tree is swapped
+	/// in a fixed number of updates later, so that the tree, and the order of
+	/// the query callbacks, only depend on the simulation.
+	/// @param growth the allowed growth, 0 to never rebuild (the default).
+	void SetRebuildThreshold(float32 growth);
+
+	/// Query the tree for the moving proxies on a pool of threads, each with its
+	/// own pair buffer. The pairs are reported in the same order either way.
+	/// @param pool the pool, NULL to query on the calling thread.
+	void SetWorkerPool(b2WorkerPool* pool);
+
   b2DynamicTree *GetDynamicTree();
 
 private:
@@ -100,7 +132,12 @@ private:
 	void BufferMove(int32 proxyId);
 	void UnBufferMove(int32 proxyId);
 
-	bool QueryCallback(int32 proxyId);
+	// Fill the pair buffer with the sorted and unique pairs of the moving proxies.
+	void FindPairs();
+	void SortPairs();
+
+	// Check the tree quality, start or finish a background rebuild.
+	void UpdateTree();
 
 	b2DynamicTree m_tree;
 
@@ -110,28 +147,22 @@ private:
 	int32 m_moveCapacity;
 	int32 m_moveCount;
 
-	b2Pair* m_pairBuffer;
-	int32 m_pairCapacity;
-	int32 m_pairCount;
+	b2PairBuffer m_pairs;
 
-	int32 m_queryProxyId;
-};
+	// Scratch space of the radix sort.
+	b2PairKey* m_sortBuffer;
+	int32 m_sortCapacity;
 
-/// This is used to sort pairs.
-inline bool b2PairLessThan(const b2Pair& pair1, const b2Pair& pair2)
-{
-	if (pair1.proxyIdA < pair2.proxyIdA)
-	{
-		return true;
-	}
+	// Parallel queries, one pair buffer per worker.
+	b2WorkerPool* m_workerPool;
+	b2PairBuffer* m_workerPairs;
+	int32 m_workerPairCount;
 
-	if (pair1.proxyIdA == pair2.proxyIdA)
-	{
-		return pair1.proxyIdB < pair2.proxyIdB;
-	}
-
-	return false;
-}
+	// Background rebuilds of the tree.
+	float32 m_rebuildGrowth;
+	float32 m_rebuildAreaRatio;
+	int32 m_updateCount;
+};
 
 inline void* b2BroadPhase::GetUserData(int32 proxyId) const
 {
@@ -160,60 +191,30 @@ inline int32 b2BroadPhase::ComputeHeight() const
 	return m_tree.ComputeHeight();
 }
 
+inline float32 b2BroadPhase::GetAreaRatio() const
+{
+	return m_tree.GetAreaRatio();
+}
+
 template <typename T>
 void b2BroadPhase::UpdatePairs(T* callback)
 {
-	// Reset pair buffer
-	m_pairCount = 0;
-
-	// Perform tree queries for all moving proxies.
-	for (int32 i = 0; i < m_moveCount; ++i)
-	{
-		m_queryProxyId = m_moveBuffer[i];
-		if (m_queryProxyId == e_nullProxy)
-		{
-			continue;
-		}
-
-		// We have to query the tree with the fat AABB so that
-		// we don't fail to create a pair that may touch later.
-		const b2AABB& fatAABB = m_tree.GetFatAABB(m_queryProxyId);
-
-		// Query tree, create pairs and add them pair buffer.
-		m_tree.Query(this, fatAABB);
-	}
-
-	// Reset move buffer
-	m_moveCount = 0;
-
-	// Sort the pair buffer to expose duplicates.
-	std::sort(m_pairBuffer, m_pairBuffer + m_pairCount, b2PairLessThan);
+	// Query the tree for all moving proxies, drop the duplicates.
+	FindPairs();
 
 	// Send the pairs back to the client.
-	int32 i = 0;
-	while (i < m_pairCount)
+	for (int32 i = 0; i < m_pairs.count; ++i)
 	{
-		b2Pair* primaryPair = m_pairBuffer + i;
-		void* userDataA = m_tree.GetUserData(primaryPair->proxyIdA);
-		void* userDataB = m_tree.GetUserData(primaryPair->proxyIdB);
+		b2PairKey key = m_pairs.keys[i];
+		void* userDataA = m_tree.GetUserData((int32)(key >> 32));
+		void* userDataB = m_tree.GetUserData((int32)(key & 0xFFFFFFFF));
 
 		callback->AddPair(userDataA, userDataB);
-		++i;
-
-		// Skip any duplicate pairs.
-		while (i < m_pairCount)
-		{
-			b2Pair* pair = m_pairBuffer + i;
-			if (pair->proxyIdA != primaryPair->proxyIdA || pair->proxyIdB != primaryPair->proxyIdB)
-			{
-				break;
-			}
-			++i;
-		}
 	}
 
 	// Try to keep the tree balanced.
 	m_tree.Rebalance(4);
+	UpdateTree();
 }
 
 template <typename T>
@@ -18,6 +18,7 @@
 
 #include <Box2D/Collision/b2Collision.h>
 #include <Box2D/Collision/b2Distance.h>
+#include <Box2D/Collision/Shapes/b2GridShape.h>
 
 void b2WorldManifold::Initialize(const b2Manifold* manifold,
 						  const b2Transform& xfA, float32 radiusA,
@@ -232,6 +233,17 @@ int32 b2ClipSegmentToLine(b2ClipVertex vOut[2], const b2ClipVertex vIn[2],
 bool b2TestOverlap(const b2Shape* shapeA, const b2Shape* shapeB,
 				   const b2Transform& xfA, const b2Transform& xfB)
 {
+	// A grid tests its cells one by one.
+	if (shapeA->GetType() == b2Shape::e_grid)
+	{
+		return ((const b2GridShape*)shapeA)->TestOverlap(shapeB, xfA, xfB);
+	}
+
+	if (shapeB->GetType() == b2Shape::e_grid)
+	{
+		return ((const b2GridShape*)shapeB)->TestOverlap(shapeA, xfB, xfA);
+	}
+
 	b2DistanceInput input;
 	input.proxyA.Set(shapeA);
 	input.proxyB.Set(shapeB);
@@ -165,6 +165,14 @@ struct b2AABB
 		return 0.5f * (upperBound - lowerBound);
 	}
 
+	/// Get the perimeter, the cost of an AABB in a tree.
+	float32 GetPerimeter() const
+	{
+		float32 wx = upperBound.x - lowerBound.x;
+		float32 wy = upperBound.y - lowerBound.y;
+		return 2.0f * (wx + wy);
+	}
+
 	/// Combine two AABBs into this one.
 	void Combine(const b2AABB& aabb1, const b2AABB& aabb2)
 	{
@@ -19,6 +19,208 @@
 #include <Box2D/Collision/b2DynamicTree.h>
 #include <cstring>
 #include <cfloat>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+// A proxy as seen by a top-down build.
+struct b2TreeLeaf
+{
+	b2AABB aabb;
+	b2Vec2 center;
+	int32 proxyId;
+};
+
+// An internal node of a build. A child is the index of another internal node,
+// or -(proxyId + 1) for a leaf.
+struct b2TreeBuildNode
+{
+	int32 child1;
+	int32 child2;
+};
+
+// A top-down build: the nodes are listed children first, the root last. The
+// root is a child as above, unless there are no leaves.
+struct b2TreeBuild
+{
+	b2TreeLeaf* leaves;
+	int32 leafCount;
+	b2TreeBuildNode* nodes;
+	int32 nodeCount;
+	int32 root;
+};
+
+struct b2TreeRebuild
+{
+	std::thread thread;
+	std::atomic<bool> done;
+	b2TreeBuild build;
+	int32 proxyStamp;
+};
+
+// Compares leaves along an axis, for the median split.
+struct b2TreeLeafLess
+{
+	bool operator()(const b2TreeLeaf& leaf1, const b2TreeLeaf& leaf2) const
+	{
+		return axis == 0 ? leaf1.center.x < leaf2.center.x : leaf1.center.y < leaf2.center.y;
+	}
+
+	int32 axis;
+};
+
+// Build the sub-tree of the leaves [begin, end) and return its root. The split
+// is picked among the planes between b2_treeBinCount bins of the centers, the
+// one minimizing count * perimeter on both sides. Past a depth, splitting at the
+// median bounds the height whatever the input.
+static int32 b2BuildRange(b2TreeBuild* build, int32 begin, int32 end, int32 depth)
+{
+	const int32 b2_treeBinCount = 16;
+	const int32 b2_treeMaxSAHDepth = 48;
+
+	b2TreeLeaf* leaves = build->leaves;
+	int32 count = end - begin;
+	if (count == 1)
+	{
+		return -(leaves[begin].proxyId + 1);
+	}
+
+	b2Vec2 lower = leaves[begin].center;
+	b2Vec2 upper = lower;
+	for (int32 i = begin + 1; i < end; ++i)
+	{
+		lower = b2Min(lower, leaves[i].center);
+		upper = b2Max(upper, leaves[i].center);
+	}
+
+	b2Vec2 size = upper - lower;
+	int32 axis = size.x >= size.y ? 0 : 1;
+	float32 axisLower = axis == 0 ? lower.x : lower.y;
+	float32 axisSize = axis == 0 ? size.x : size.y;
+
+	int32 split = begin + count / 2;
+	if (axisSize <= b2_epsilon || depth >= b2_treeMaxSAHDepth)
+	{
+		b2TreeLeafLess less;
+		less.axis = axis;
+		std::nth_element(leaves + begin, leaves + split, leaves + end, less);
+	}
+	else
+	{
+		int32 binCounts[b2_treeBinCount];
+		b2AABB binBoxes[b2_treeBinCount];
+		for (int32 i = 0; i < b2_treeBinCount; ++i)
+		{
+			binCounts[i] = 0;
+		}
+
+		float32 scale = b2_treeBinCount * (1.0f - b2_epsilon) / axisSize;
+		for (int32 i = begin; i < end; ++i)
+		{
+			float32 c = axis == 0 ? leaves[i].center.x : leaves[i].center.y;
+			int32 bin = b2Min((int32)((c - axisLower) * scale), b2_treeBinCount - 1);
+			if (binCounts[bin]++ == 0)
+			{
+				binBoxes[bin] = leaves[i].aabb;
+			}
+			else
+			{
+				binBoxes[bin].Combine(binBoxes[bin], leaves[i].aabb);
+			}
+		}
+
+		// Cost of the right side of each plane, plane i leaving bins [0, i) left.
+		// The boxes grow from an empty box, inverted so that any box combines.
+		b2AABB empty;
+		empty.lowerBound.Set(b2_maxFloat, b2_maxFloat);
+		empty.upperBound.Set(-b2_maxFloat, -b2_maxFloat);
+
+		float32 rightCosts[b2_treeBinCount];
+		b2AABB box = empty;
+		int32 n = 0;
+		for (int32 i = b2_treeBinCount - 1; i > 0; --i)
+		{
+			if (binCounts[i] > 0)
+			{
+				box.Combine(box, binBoxes[i]);
+				n += binCounts[i];
+			}
+			rightCosts[i] = n > 0 ? n * box.GetPerimeter() : 0.0f;
+		}
+
+		float32 bestCost = b2_maxFloat;
+		int32 bestPlane = -1;
+		int32 bestCount = 0;
+		box = empty;
+		n = 0;
+		for (int32 i = 1; i < b2_treeBinCount; ++i)
+		{
+			if (binCounts[i - 1] > 0)
+			{
+				box.Combine(box, binBoxes[i - 1]);
+				n += binCounts[i - 1];
+			}
+
+			if (n == 0 || n == count)
+			{
+				continue;
+			}
+
+			float32 cost = n * box.GetPerimeter() + rightCosts[i];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestPlane = i;
+				bestCount = n;
+			}
+		}
+
+		// The extreme centers land in the first and last bins: there is a plane.
+		b2Assert(bestPlane != -1);
+		int32 i1 = begin;
+		int32 i2 = end - 1;
+		while (i1 <= i2)
+		{
+			float32 c = axis == 0 ? leaves[i1].center.x : leaves[i1].center.y;
+			int32 bin = b2Min((int32)((c - axisLower) * scale), b2_treeBinCount - 1);
+			if (bin < bestPlane)
+			{
+				++i1;
+			}
+			else
+			{
+				b2Swap(leaves[i1], leaves[i2]);
+				--i2;
+			}
+		}
+		split = begin + bestCount;
+		b2Assert(split == i1);
+	}
+
+	int32 child1 = b2BuildRange(build, begin, split, depth + 1);
+	int32 child2 = b2BuildRange(build, split, end, depth + 1);
+
+	int32 index = build->nodeCount++;
+	build->nodes[index].child1 = child1;
+	build->nodes[index].child2 = child2;
+	return index;
+}
+
+static void b2BuildTree(b2TreeBuild* build)
+{
+	build->nodeCount = 0;
+	build->root = 0;
+	if (build->leafCount > 0)
+	{
+		build->root = b2BuildRange(build, 0, build->leafCount, 0);
+	}
+}
+
+static void b2RebuildThread(b2TreeRebuild* rebuild)
+{
+	b2BuildTree(&rebuild->build);
+	rebuild->done = true;
+}
 
 b2DynamicTree::b2DynamicTree()
 {
@@ -40,10 +242,21 @@ b2DynamicTree::b2DynamicTree()
 	m_path = 0;
 
 	m_insertionCount = 0;
+
+	m_proxyStamp = 0;
+	m_rebuild = NULL;
 }
 
 b2DynamicTree::~b2DynamicTree()
 {
+	if (m_rebuild != NULL)
+	{
+		m_rebuild->thread.join();
+		b2Free(m_rebuild->build.leaves);
+		b2Free(m_rebuild->build.nodes);
+		delete m_rebuild;
+	}
+
 	// This frees the entire tree in one shot.
 	b2Free(m_nodes);
 }
@@ -105,6 +318,7 @@ int32 b2DynamicTree::CreateProxy(const b2AABB& aabb, void* userData)
 	m_nodes[proxyId].aabb.lowerBound = aabb.lowerBound - r;
 	m_nodes[proxyId].aabb.upperBound = aabb.upperBound + r;
 	m_nodes[proxyId].userData = userData;
+	++m_proxyStamp;
 
 	InsertLeaf(proxyId);
 
@@ -129,6 +343,7 @@ void b2DynamicTree::DestroyProxy(int32 proxyId)
 
 	RemoveLeaf(proxyId);
 	FreeNode(proxyId);
+	++m_proxyStamp;
 }
 
 bool b2DynamicTree::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement)
@@ -364,6 +579,227 @@ int32 b2DynamicTree::ComputeHeight() const
 	return ComputeHeight(m_root);
 }
 
+float32 b2DynamicTree::GetAreaRatio() const
+{
+	if (m_root == b2_nullNode)
+	{
+		return 0.0f;
+	}
+
+	float32 totalArea = 0.0f;
+	int32* stack = (int32*)b2Alloc(m_nodeCount * sizeof(int32));
+	int32 count = 0;
+	stack[count++] = m_root;
+	while (count > 0)
+	{
+		const b2DynamicTreeNode* node = m_nodes + stack[--count];
+		totalArea += node->aabb.GetPerimeter();
+		if (node->IsLeaf() == false)
+		{
+			stack[count++] = node->child1;
+			stack[count++] = node->child2;
+		}
+	}
+	b2Free(stack);
+
+	float32 rootArea = m_nodes[m_root].aabb.GetPerimeter();
+	return rootArea > 0.0f ? totalArea / rootArea : 0.0f;
+}
+
+// A full binary tree has one more leaf than internal nodes.
+int32 b2DynamicTree::GetLeafCount() const
+{
+	return m_root == b2_nullNode ? 0 : (m_nodeCount + 1) / 2;
+}
+
+void b2DynamicTree::GatherLeaves(b2TreeLeaf* leaves) const
+{
+	if (m_root == b2_nullNode)
+	{
+		return;
+	}
+
+	int32 leafCount = 0;
+	int32* stack = (int32*)b2Alloc(m_nodeCount * sizeof(int32));
+	int32 count = 0;
+	stack[count++] = m_root;
+	while (count > 0)
+	{
+		int32 nodeId = stack[--count];
+		const b2DynamicTreeNode* node = m_nodes + nodeId;
+		if (node->IsLeaf())
+		{
+			b2TreeLeaf* leaf = leaves + leafCount++;
+			leaf->aabb = node->aabb;
+			leaf->center = node->aabb.GetCenter();
+			leaf->proxyId = nodeId;
+		}
+		else
+		{
+			stack[count++] = node->child1;
+			stack[count++] = node->child2;
+		}
+	}
+	b2Free(stack);
+}
+
+void b2DynamicTree::FreeInternalNodes()
+{
+	if (m_root == b2_nullNode)
+	{
+		return;
+	}
+
+	int32* stack = (int32*)b2Alloc(m_nodeCount * sizeof(int32));
+	int32 count = 0;
+	stack[count++] = m_root;
+	while (count > 0)
+	{
+		int32 nodeId = stack[--count];
+		const b2DynamicTreeNode* node = m_nodes + nodeId;
+		if (node->IsLeaf() == false)
+		{
+			stack[count++] = node->child1;
+			stack[count++] = node->child2;
+			FreeNode(nodeId);
+		}
+	}
+	b2Free(stack);
+	m_root = b2_nullNode;
+}
+
+// Link the nodes of a build, fitted to the current fat AABBs of the leaves.
+// The internal nodes of the tree must have been freed.
+void b2DynamicTree::ApplyBuild(const b2TreeBuild* build)
+{
+	int32* nodeIds = (int32*)b2Alloc(b2Max(build->nodeCount, 1) * sizeof(int32));
+	for (int32 i = 0; i < build->nodeCount; ++i)
+	{
+		int32 child1 = build->nodes[i].child1;
+		int32 child2 = build->nodes[i].child2;
+		child1 = child1 < 0 ? -(child1 + 1) : nodeIds[child1];
+		child2 = child2 < 0 ? -(child2 + 1) : nodeIds[child2];
+
+		int32 nodeId = AllocateNode();
+		b2DynamicTreeNode* node = m_nodes + nodeId;
+		node->userData = NULL;
+		node->child1 = child1;
+		node->child2 = child2;
+		node->aabb.Combine(m_nodes[child1].aabb, m_nodes[child2].aabb);
+		m_nodes[child1].parent = nodeId;
+		m_nodes[child2].parent = nodeId;
+		nodeIds[i] = nodeId;
+	}
+
+	if (build->leafCount > 0)
+	{
+		m_root = build->root < 0 ? -(build->root + 1) : nodeIds[build->root];
+		m_nodes[m_root].parent = b2_nullNode;
+	}
+	b2Free(nodeIds);
+}
+
+void b2DynamicTree::Rebuild()
+{
+	b2TreeBuild build;
+	build.leafCount = GetLeafCount();
+	build.leaves = (b2TreeLeaf*)b2Alloc(b2Max(build.leafCount, 1) * sizeof(b2TreeLeaf));
+	build.nodes = (b2TreeBuildNode*)b2Alloc(b2Max(build.leafCount, 1) * sizeof(b2TreeBuildNode));
+	GatherLeaves(build.leaves);
+
+	b2BuildTree(&build);
+	FreeInternalNodes();
+	ApplyBuild(&build);
+
+	b2Free(build.nodes);
+	b2Free(build.leaves);
+}
+
+void b2DynamicTree::CreateProxies(const b2AABB* aabbs, void* const* userData, int32 count, int32* proxyIds)
+{
+	int32 oldCount = GetLeafCount();
+
+	b2TreeBuild build;
+	build.leafCount = oldCount + count;
+	build.leaves = (b2TreeLeaf*)b2Alloc(b2Max(build.leafCount, 1) * sizeof(b2TreeLeaf));
+	build.nodes = (b2TreeBuildNode*)b2Alloc(b2Max(build.leafCount, 1) * sizeof(b2TreeBuildNode));
+	GatherLeaves(build.leaves);
+
+	// The new leaves are not linked until the build is applied.
+	b2Vec2 r(b2_aabbExtension, b2_aabbExtension);
+	for (int32 i = 0; i < count; ++i)
+	{
+		int32 proxyId = AllocateNode();
+		b2DynamicTreeNode* node = m_nodes + proxyId;
+		node->aabb.lowerBound = aabbs[i].lowerBound - r;
+		node->aabb.upperBound = aabbs[i].upperBound + r;
+		node->userData = userData[i];
+		proxyIds[i] = proxyId;
+
+		b2TreeLeaf* leaf = build.leaves + oldCount + i;
+		leaf->aabb = node->aabb;
+		leaf->center = node->aabb.GetCenter();
+		leaf->proxyId = proxyId;
+	}
+	m_insertionCount += count;
+	++m_proxyStamp;
+
+	b2BuildTree(&build);
+	FreeInternalNodes();
+	ApplyBuild(&build);
+
+	b2Free(build.nodes);
+	b2Free(build.leaves);
+}
+
+void b2DynamicTree::StartRebuild()
+{
+	if (m_rebuild != NULL)
+	{
+		return;
+	}
+
+	m_rebuild = new b2TreeRebuild;
+	m_rebuild->done = false;
+	m_rebuild->proxyStamp = m_proxyStamp;
+
+	b2TreeBuild* build = &m_rebuild->build;
+	build->leafCount = GetLeafCount();
+	build->leaves = (b2TreeLeaf*)b2Alloc(b2Max(build->leafCount, 1) * sizeof(b2TreeLeaf));
+	build->nodes = (b2TreeBuildNode*)b2Alloc(b2Max(build->leafCount, 1) * sizeof(b2TreeBuildNode));
+	GatherLeaves(build->leaves);
+
+	m_rebuild->thread = std::thread(b2RebuildThread, m_rebuild);
+}
+
+bool b2DynamicTree::FinishRebuild(bool wait)
+{
+	if (m_rebuild == NULL || (wait == false && m_rebuild->done == false))
+	{
+		return false;
+	}
+
+	m_rebuild->thread.join();
+
+	bool replace = m_rebuild->proxyStamp == m_proxyStamp;
+	if (replace)
+	{
+		FreeInternalNodes();
+		ApplyBuild(&m_rebuild->build);
+	}
+
+	b2Free(m_rebuild->build.leaves);
+	b2Free(m_rebuild->build.nodes);
+	delete m_rebuild;
+	m_rebuild = NULL;
+	return replace;
+}
+
+bool b2DynamicTree::IsRebuilding() const
+{
+	return m_rebuild != NULL;
+}
+
 b2DynamicTree *b2DynamicTree::Clone()
 {
   b2DynamicTree *cloned = new b2DynamicTree();
@@ -379,6 +815,7 @@ b2DynamicTree *b2DynamicTree::Clone()
 
   cloned->m_freeList = m_freeList;
   cloned->m_insertionCount = m_insertionCount;
+  cloned->m_proxyStamp = m_proxyStamp;
 
   return cloned;
 }
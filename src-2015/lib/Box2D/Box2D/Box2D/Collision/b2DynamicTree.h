@@ -25,6 +25,10 @@
 
 #define b2_nullNode (-1)
 
+struct b2TreeLeaf;
+struct b2TreeBuild;
+struct b2TreeRebuild;
+
 /// A node in the dynamic tree. The client does not interact with this directly.
 struct b2DynamicTreeNode
 {
@@ -84,6 +88,29 @@ public:
 	/// Perform some iterations to re-balance the tree.
 	void Rebalance(int32 iterations);
 
+	/// Create proxies in bulk, then rebuild the whole tree at once, see Rebuild.
+	/// Faster, and a better tree, than creating many proxies one by one.
+	/// @param proxyIds receives the id of each new proxy.
+	void CreateProxies(const b2AABB* aabbs, void* const* userData, int32 count, int32* proxyIds);
+
+	/// Rebuild the tree top-down, splitting the proxies with the surface area
+	/// heuristic. Proxy ids and fat AABBs are kept.
+	void Rebuild();
+
+	/// Start a Rebuild on a background thread from a copy of the proxies. The
+	/// tree can be used and changed meanwhile, see FinishRebuild.
+	void StartRebuild();
+
+	/// Replace the tree by the result of StartRebuild, fitted to the proxies as
+	/// they are now. The result is dropped if proxies were created or destroyed
+	/// since the start.
+	/// @param wait wait for the build to be done, else give up if it is not.
+	/// @return true if the tree was replaced.
+	bool FinishRebuild(bool wait);
+
+	/// Is a background rebuild started and not finished?
+	bool IsRebuilding() const;
+
 	/// Get proxy user data.
 	/// @return the proxy user data or 0 if the id is invalid.
 	void* GetUserData(int32 proxyId) const;
@@ -94,6 +121,10 @@ public:
 	/// Compute the height of the tree.
 	int32 ComputeHeight() const;
 
+	/// Get the ratio of the sum of the node perimeters to the root perimeter.
+	/// This is the cost of a query, the lower the better.
+	float32 GetAreaRatio() const;
+
 	/// Query an AABB for overlapping proxies. The callback class
 	/// is called for each proxy that overlaps the supplied AABB.
 	template <typename T>
@@ -119,6 +150,11 @@ private:
 
 	int32 ComputeHeight(int32 nodeId) const;
 
+	int32 GetLeafCount() const;
+	void GatherLeaves(b2TreeLeaf* leaves) const;
+	void FreeInternalNodes();
+	void ApplyBuild(const b2TreeBuild* build);
+
 	int32 m_root;
 
 	b2DynamicTreeNode* m_nodes;
@@ -131,6 +167,11 @@ private:
 	uint32 m_path;
 
 	int32 m_insertionCount;
+
+	// Changes when proxies are created or destroyed, to drop stale rebuilds.
+	int32 m_proxyStamp;
+
+	b2TreeRebuild* m_rebuild;
 };
 
 inline void* b2DynamicTree::GetUserData(int32 proxyId) const
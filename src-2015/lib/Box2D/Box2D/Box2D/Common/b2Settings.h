@@ -31,6 +31,7 @@ typedef signed int int32;
 typedef unsigned char uint8;
 typedef unsigned short uint16;
 typedef unsigned int uint32;
+typedef unsigned long long uint64;
 typedef float float32;
 
 #define	b2_maxFloat		FLT_MAX
@@ -46,6 +47,10 @@ typedef float float32;
 /// The maximum number of contact points between two convex shapes.
 #define b2_maxManifoldPoints	2
 
+/// The maximum number of manifolds of a contact: a grid shape has one per
+/// exposed face touching the other shape.
+#define b2_maxContactManifolds	4
+
 /// The maximum number of vertices on a convex polygon.
 #define b2_maxPolygonVertices	8
 
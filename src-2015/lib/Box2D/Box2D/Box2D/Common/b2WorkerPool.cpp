@@ -0,0 +1,212 @@
+/*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Common/b2WorkerPool.h>
+#include <Box2D/Common/b2StackAllocator.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// The items of a worker: it pops from the head, thieves from the tail.
+// Items are coarse (e.g. islands), a lock per queue is cheap enough.
+struct b2WorkerQueue
+{
+	std::mutex mutex;
+	int32* items;
+	int32 capacity;
+	int32 head;
+	int32 tail;
+};
+
+struct b2WorkerPoolImpl
+{
+	std::thread* threads;
+	b2WorkerQueue* queues;
+	b2StackAllocator* allocators;
+
+	std::mutex mutex;
+	std::condition_variable wakeUp;
+	std::condition_variable done;
+	b2WorkerTask* task;
+	int32 generation;
+	int32 busy;
+	bool quit;
+};
+
+b2WorkerPool::b2WorkerPool(int32 workerCount)
+{
+	b2Assert(workerCount > 0);
+	m_workerCount = workerCount;
+
+	m_impl = new b2WorkerPoolImpl;
+	m_impl->task = NULL;
+	m_impl->generation = 0;
+	m_impl->busy = 0;
+	m_impl->quit = false;
+
+	m_impl->queues = new b2WorkerQueue[m_workerCount];
+	m_impl->allocators = new b2StackAllocator[m_workerCount];
+	for (int32 i = 0; i < m_workerCount; ++i)
+	{
+		m_impl->queues[i].items = NULL;
+		m_impl->queues[i].capacity = 0;
+		m_impl->queues[i].head = 0;
+		m_impl->queues[i].tail = 0;
+	}
+
+	// Worker 0 is the thread calling Run.
+	m_impl->threads = new std::thread[m_workerCount];
+	for (int32 i = 1; i < m_workerCount; ++i)
+	{
+		m_impl->threads[i] = std::thread(&b2WorkerPool::Loop, this, i);
+	}
+}
+
+b2WorkerPool::~b2WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_impl->mutex);
+		m_impl->quit = true;
+	}
+	m_impl->wakeUp.notify_all();
+	for (int32 i = 1; i < m_workerCount; ++i)
+	{
+		m_impl->threads[i].join();
+	}
+
+	for (int32 i = 0; i < m_workerCount; ++i)
+	{
+		b2Free(m_impl->queues[i].items);
+	}
+	delete [] m_impl->threads;
+	delete [] m_impl->allocators;
+	delete [] m_impl->queues;
+	delete m_impl;
+}
+
+b2StackAllocator* b2WorkerPool::GetAllocator(int32 worker)
+{
+	b2Assert(0 <= worker && worker < m_workerCount);
+	return m_impl->allocators + worker;
+}
+
+void b2WorkerPool::Run(b2WorkerTask* task, const int32* items, int32 count)
+{
+	// Deal the items. The workers are asleep, no locking needed yet.
+	for (int32 i = 0; i < m_workerCount; ++i)
+	{
+		b2WorkerQueue* queue = m_impl->queues + i;
+		int32 share = (count + m_workerCount - 1) / m_workerCount;
+		if (queue->capacity < share)
+		{
+			b2Free(queue->items);
+			queue->capacity = share;
+			queue->items = (int32*)b2Alloc(queue->capacity * sizeof(int32));
+		}
+		queue->head = 0;
+		queue->tail = 0;
+	}
+	for (int32 i = 0; i < count; ++i)
+	{
+		b2WorkerQueue* queue = m_impl->queues + (i % m_workerCount);
+		queue->items[queue->tail++] = items[i];
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_impl->mutex);
+		m_impl->task = task;
+		m_impl->busy = m_workerCount - 1;
+		++m_impl->generation;
+	}
+	m_impl->wakeUp.notify_all();
+
+	Work(0);
+
+	// The queues are empty, wait for the items still being processed.
+	std::unique_lock<std::mutex> lock(m_impl->mutex);
+	while (m_impl->busy > 0)
+	{
+		m_impl->done.wait(lock);
+	}
+	m_impl->task = NULL;
+}
+
+bool b2WorkerPool::Pop(int32 worker, int32* item)
+{
+	// Own queue first, from the head.
+	{
+		b2WorkerQueue* queue = m_impl->queues + worker;
+		std::lock_guard<std::mutex> lock(queue->mutex);
+		if (queue->head < queue->tail)
+		{
+			*item = queue->items[queue->head++];
+			return true;
+		}
+	}
+
+	// Then steal from the tail of the others.
+	for (int32 i = 1; i < m_workerCount; ++i)
+	{
+		b2WorkerQueue* queue = m_impl->queues + (worker + i) % m_workerCount;
+		std::lock_guard<std::mutex> lock(queue->mutex);
+		if (queue->head < queue->tail)
+		{
+			*item = queue->items[--queue->tail];
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void b2WorkerPool::Work(int32 worker)
+{
+	int32 item;
+	while (Pop(worker, &item))
+	{
+		m_impl->task->Execute(item, worker);
+	}
+}
+
+void b2WorkerPool::Loop(int32 worker)
+{
+	int32 generation = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_impl->mutex);
+			while (m_impl->quit == false && m_impl->generation == generation)
+			{
+				m_impl->wakeUp.wait(lock);
+			}
+			if (m_impl->quit)
+			{
+				return;
+			}
+			generation = m_impl->generation;
+		}
+
+		Work(worker);
+
+		{
+			std::lock_guard<std::mutex> lock(m_impl->mutex);
+			if (--m_impl->busy == 0)
+			{
+				m_impl->done.notify_one();
+			}
+		}
+	}
+}
@@ -0,0 +1,71 @@
+/*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_WORKER_POOL_H
+#define B2_WORKER_POOL_H
+
+#include <Box2D/Common/b2Settings.h>
+
+class b2StackAllocator;
+struct b2WorkerPoolImpl;
+
+/// Work spread over the threads of a b2WorkerPool.
+class b2WorkerTask
+{
+public:
+	virtual ~b2WorkerTask() {}
+
+	/// Process one item. Called once per item, on any worker.
+	/// @param worker the index of the calling worker, 0 is the thread that called Run.
+	virtual void Execute(int32 item, int32 worker) = 0;
+};
+
+/// A fixed set of threads processing the items of a task. The items are dealt
+/// to the workers in turn; a worker done with its own items steals from the
+/// end of the others' queues. The thread calling Run is worker 0. Each worker
+/// has its own stack allocator for per item allocations.
+class b2WorkerPool
+{
+public:
+	/// @param workerCount the number of workers, including the calling thread.
+	b2WorkerPool(int32 workerCount);
+	~b2WorkerPool();
+
+	/// Process the items, returns once all of them are done.
+	/// @param items the items, best listed from the most to the least expensive.
+	void Run(b2WorkerTask* task, const int32* items, int32 count);
+
+	int32 GetWorkerCount() const;
+
+	/// The stack allocator of a worker, only to be used from that worker.
+	b2StackAllocator* GetAllocator(int32 worker);
+
+private:
+
+	void Work(int32 worker);
+	bool Pop(int32 worker, int32* item);
+	void Loop(int32 worker);
+
+	b2WorkerPoolImpl* m_impl;
+	int32 m_workerCount;
+};
+
+inline int32 b2WorkerPool::GetWorkerCount() const
+{
+	return m_workerCount;
+}
+
+#endif
@@ -20,6 +20,7 @@
 #include <Box2D/Dynamics/Contacts/b2CircleContact.h>
 #include <Box2D/Dynamics/Contacts/b2PolygonAndCircleContact.h>
 #include <Box2D/Dynamics/Contacts/b2PolygonContact.h>
+#include <Box2D/Dynamics/Contacts/b2GridContact.h>
 #include <Box2D/Dynamics/Contacts/b2ContactSolver.h>
 
 #include <Box2D/Collision/b2Collision.h>
@@ -38,6 +39,8 @@ void b2Contact::InitializeRegisters()
 	AddType(b2CircleContact::Create, b2CircleContact::Destroy, b2Shape::e_circle, b2Shape::e_circle);
 	AddType(b2PolygonAndCircleContact::Create, b2PolygonAndCircleContact::Destroy, b2Shape::e_polygon, b2Shape::e_circle);
 	AddType(b2PolygonContact::Create, b2PolygonContact::Destroy, b2Shape::e_polygon, b2Shape::e_polygon);
+	AddType(b2GridContact::Create, b2GridContact::Destroy, b2Shape::e_grid, b2Shape::e_circle);
+	AddType(b2GridContact::Create, b2GridContact::Destroy, b2Shape::e_grid, b2Shape::e_polygon);
 }
 
 void b2Contact::AddType(b2ContactCreateFcn* createFcn, b2ContactDestroyFcn* destoryFcn,
@@ -94,7 +97,7 @@ void b2Contact::Destroy(b2Contact* contact, b2BlockAllocator* allocator)
 {
 	b2Assert(s_initialized == true);
 
-	if (contact->m_manifold.pointCount > 0)
+	if (contact->m_manifolds[0].pointCount > 0)
 	{
 		contact->GetFixtureA()->GetBody()->SetAwake(true);
 		contact->GetFixtureB()->GetBody()->SetAwake(true);
@@ -118,6 +121,8 @@ b2Contact::b2Contact(b2Fixture* fA, b2Fixture* fB)
 	m_fixtureB = fB;
 
 	m_manifold.pointCount = 0;
+	m_manifolds = &m_manifold;
+	m_manifoldCount = 1;
 
 	m_prev = NULL;
 	m_next = NULL;
@@ -139,7 +144,12 @@ b2Contact::b2Contact(b2Fixture* fA, b2Fixture* fB)
 // Note: do not assume the fixture AABBs are overlapping or are valid.
 void b2Contact::Update(b2ContactListener* listener)
 {
-	b2Manifold oldManifold = m_manifold;
+	b2Manifold oldManifolds[b2_maxContactManifolds];
+	int32 oldManifoldCount = m_manifoldCount;
+	for (int32 i = 0; i < oldManifoldCount; ++i)
+	{
+		oldManifolds[i] = m_manifolds[i];
+	}
 
 	// Re-enable this contact.
 	m_flags |= e_enabledFlag;
@@ -164,31 +174,43 @@ void b2Contact::Update(b2ContactListener* listener)
 		touching = b2TestOverlap(shapeA, shapeB, xfA, xfB);
 
 		// Sensors don't generate manifolds.
-		m_manifold.pointCount = 0;
+		m_manifolds[0].pointCount = 0;
+		m_manifoldCount = 1;
 	}
 	else
 	{
-		Evaluate(&m_manifold, xfA, xfB);
-		touching = m_manifold.pointCount > 0;
+		m_manifoldCount = EvaluateManifolds(m_manifolds, xfA, xfB);
+		touching = m_manifolds[0].pointCount > 0;
 
 		// Match old contact ids to new contact ids and copy the
-		// stored impulses to warm start the solver.
-		for (int32 i = 0; i < m_manifold.pointCount; ++i)
+		// stored impulses to warm start the solver. The ids of a
+		// grid contact tell its faces apart.
+		for (int32 k = 0; k < m_manifoldCount; ++k)
 		{
-			b2ManifoldPoint* mp2 = m_manifold.points + i;
-			mp2->normalImpulse = 0.0f;
-			mp2->tangentImpulse = 0.0f;
-			b2ContactID id2 = mp2->id;
-
-			for (int32 j = 0; j < oldManifold.pointCount; ++j)
+			b2Manifold* manifold = m_manifolds + k;
+			for (int32 i = 0; i < manifold->pointCount; ++i)
 			{
-				b2ManifoldPoint* mp1 = oldManifold.points + j;
+				b2ManifoldPoint* mp2 = manifold->points + i;
+				mp2->normalImpulse = 0.0f;
+				mp2->tangentImpulse = 0.0f;
+				b2ContactID id2 = mp2->id;
 
-				if (mp1->id.key == id2.key)
+				bool found = false;
+				for (int32 l = 0; l < oldManifoldCount && found == false; ++l)
 				{
-					mp2->normalImpulse = mp1->normalImpulse;
-					mp2->tangentImpulse = mp1->tangentImpulse;
-					break;
+					const b2Manifold* oldManifold = oldManifolds + l;
+					for (int32 j = 0; j < oldManifold->pointCount; ++j)
+					{
+						const b2ManifoldPoint* mp1 = oldManifold->points + j;
+
+						if (mp1->id.key == id2.key)
+						{
+							mp2->normalImpulse = mp1->normalImpulse;
+							mp2->tangentImpulse = mp1->tangentImpulse;
+							found = true;
+							break;
+						}
+					}
 				}
 			}
 		}
@@ -221,6 +243,12 @@ void b2Contact::Update(b2ContactListener* listener)
 
 	if (sensor == false && touching && listener)
 	{
-		listener->PreSolve(this, &oldManifold);
+		listener->PreSolve(this, oldManifolds);
 	}
 }
+
+int32 b2Contact::EvaluateManifolds(b2Manifold* manifolds, const b2Transform& xfA, const b2Transform& xfB)
+{
+	Evaluate(manifolds, xfA, xfB);
+	return 1;
+}
@@ -68,6 +68,15 @@ public:
 	b2Manifold* GetManifold();
 	const b2Manifold* GetManifold() const;
 
+	/// Get the number of contact manifolds. This is one, except for a grid shape
+	/// touching the other shape on several faces: one manifold per face, each
+	/// with points.
+	int32 GetManifoldCount() const;
+
+	/// Get the contact manifolds, the first being GetManifold().
+	b2Manifold* GetManifolds();
+	const b2Manifold* GetManifolds() const;
+
 	/// Get the world manifold.
 	void GetWorldManifold(b2WorldManifold* worldManifold) const;
 
@@ -140,6 +149,10 @@ protected:
 
 	void Update(b2ContactListener* listener);
 
+	/// Evaluate all the manifolds of this contact, at least one.
+	/// @return the number of manifolds.
+	virtual int32 EvaluateManifolds(b2Manifold* manifolds, const b2Transform& xfA, const b2Transform& xfB);
+
 	static b2ContactRegister s_registers[b2Shape::e_typeCount][b2Shape::e_typeCount];
 	static bool s_initialized;
 
@@ -158,18 +171,37 @@ protected:
 
 	b2Manifold m_manifold;
 
+	// m_manifold, or the manifolds of a grid contact.
+	b2Manifold* m_manifolds;
+	int32 m_manifoldCount;
+
 	int32 m_toiCount;
 //	float32 m_toi;
 };
 
 inline b2Manifold* b2Contact::GetManifold()
 {
-	return &m_manifold;
+	return m_manifolds;
 }
 
 inline const b2Manifold* b2Contact::GetManifold() const
 {
-	return &m_manifold;
+	return m_manifolds;
+}
+
+inline int32 b2Contact::GetManifoldCount() const
+{
+	return m_manifoldCount;
+}
+
+inline b2Manifold* b2Contact::GetManifolds()
+{
+	return m_manifolds;
+}
+
+inline const b2Manifold* b2Contact::GetManifolds() const
+{
+	return m_manifolds;
 }
 
 inline void b2Contact::GetWorldManifold(b2WorldManifold* worldManifold) const
@@ -179,7 +211,7 @@ inline void b2Contact::GetWorldManifold(b2WorldManifold* worldManifold) const
 	const b2Shape* shapeA = m_fixtureA->GetShape();
 	const b2Shape* shapeB = m_fixtureB->GetShape();
 
-	worldManifold->Initialize(&m_manifold, bodyA->GetTransform(), shapeA->m_radius, bodyB->GetTransform(), shapeB->m_radius);
+	worldManifold->Initialize(m_manifolds, bodyA->GetTransform(), shapeA->m_radius, bodyB->GetTransform(), shapeB->m_radius);
 }
 
 inline void b2Contact::SetEnabled(bool flag)
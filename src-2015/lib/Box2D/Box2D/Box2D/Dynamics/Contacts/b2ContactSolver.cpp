@@ -30,12 +30,25 @@ b2ContactSolver::b2ContactSolver(b2Contact** contacts, int32 contactCount,
 {
 	m_allocator = allocator;
 
-	m_constraintCount = contactCount;
+	// One constraint per manifold, in the order of the contacts.
+	m_constraintCount = 0;
+	for (int32 i = 0; i < contactCount; ++i)
+	{
+		m_constraintCount += contacts[i]->m_manifoldCount;
+	}
 	m_constraints = (b2ContactConstraint*)m_allocator->Allocate(m_constraintCount * sizeof(b2ContactConstraint));
 
+	int32 contactIndex = 0;
+	int32 manifoldIndex = 0;
 	for (int32 i = 0; i < m_constraintCount; ++i)
 	{
-		b2Contact* contact = contacts[i];
+		b2Contact* contact = contacts[contactIndex];
+		b2Manifold* manifold = contact->m_manifolds + manifoldIndex;
+		if (++manifoldIndex == contact->m_manifoldCount)
+		{
+			++contactIndex;
+			manifoldIndex = 0;
+		}
 
 		b2Fixture* fixtureA = contact->m_fixtureA;
 		b2Fixture* fixtureB = contact->m_fixtureB;
@@ -45,7 +58,6 @@ b2ContactSolver::b2ContactSolver(b2Contact** contacts, int32 contactCount,
 		float32 radiusB = shapeB->m_radius;
 		b2Body* bodyA = fixtureA->GetBody();
 		b2Body* bodyB = fixtureB->GetBody();
-		b2Manifold* manifold = contact->GetManifold();
 
 		float32 friction = b2MixFriction(fixtureA->GetFriction(), fixtureB->GetFriction());
 		float32 restitution = b2MixRestitution(fixtureA->GetRestitution(), fixtureB->GetRestitution());
@@ -181,10 +193,16 @@ void b2ContactSolver::WarmStart()
 		{
 			b2ContactConstraintPoint* ccp = c->points + j;
 			b2Vec2 P = ccp->normalImpulse * normal + ccp->tangentImpulse * tangent;
-			bodyA->m_angularVelocity -= invIA * b2Cross(ccp->rA, P);
-			bodyA->m_linearVelocity -= invMassA * P;
-			bodyB->m_angularVelocity += invIB * b2Cross(ccp->rB, P);
-			bodyB->m_linearVelocity += invMassB * P;
+			if (bodyA->GetType() == b2_dynamicBody)
+			{
+				bodyA->m_angularVelocity -= invIA * b2Cross(ccp->rA, P);
+				bodyA->m_linearVelocity -= invMassA * P;
+			}
+			if (bodyB->GetType() == b2_dynamicBody)
+			{
+				bodyB->m_angularVelocity += invIB * b2Cross(ccp->rB, P);
+				bodyB->m_linearVelocity += invMassB * P;
+			}
 		}
 	}
 }
@@ -481,10 +499,18 @@ void b2ContactSolver::SolveVelocityConstraints()
 			}
 		}
 
-		bodyA->m_linearVelocity = vA;
-		bodyA->m_angularVelocity = wA;
-		bodyB->m_linearVelocity = vB;
-		bodyB->m_angularVelocity = wB;
+		// Only the dynamic bodies are written back. The others did not change,
+		// and static bodies may be shared with islands solved on other threads.
+		if (bodyA->GetType() == b2_dynamicBody)
+		{
+			bodyA->m_linearVelocity = vA;
+			bodyA->m_angularVelocity = wA;
+		}
+		if (bodyB->GetType() == b2_dynamicBody)
+		{
+			bodyB->m_linearVelocity = vB;
+			bodyB->m_angularVelocity = wB;
+		}
 	}
 }
 
@@ -607,13 +633,19 @@ bool b2ContactSolver::SolvePositionConstraints(float32 baumgarte)
 
 			b2Vec2 P = impulse * normal;
 
-			bodyA->m_sweep.c -= invMassA * P;
-			bodyA->m_sweep.a -= invIA * b2Cross(rA, P);
-			bodyA->SynchronizeTransform();
+			if (bodyA->GetType() == b2_dynamicBody)
+			{
+				bodyA->m_sweep.c -= invMassA * P;
+				bodyA->m_sweep.a -= invIA * b2Cross(rA, P);
+				bodyA->SynchronizeTransform();
+			}
 
-			bodyB->m_sweep.c += invMassB * P;
-			bodyB->m_sweep.a += invIB * b2Cross(rB, P);
-			bodyB->SynchronizeTransform();
+			if (bodyB->GetType() == b2_dynamicBody)
+			{
+				bodyB->m_sweep.c += invMassB * P;
+				bodyB->m_sweep.a += invIB * b2Cross(rB, P);
+				bodyB->SynchronizeTransform();
+			}
 		}
 	}
 
@@ -0,0 +1,157 @@
+/*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include <Box2D/Dynamics/Contacts/b2GridContact.h>
+#include <Box2D/Collision/Shapes/b2CircleShape.h>
+#include <Box2D/Collision/Shapes/b2GridShape.h>
+#include <Box2D/Collision/Shapes/b2PolygonShape.h>
+#include <Box2D/Common/b2BlockAllocator.h>
+#include <Box2D/Dynamics/b2Body.h>
+#include <Box2D/Dynamics/b2Fixture.h>
+
+#include <new>
+
+b2Contact* b2GridContact::Create(b2Fixture* fixtureA, b2Fixture* fixtureB, b2BlockAllocator* allocator)
+{
+	void* mem = allocator->Allocate(sizeof(b2GridContact));
+	return new (mem) b2GridContact(fixtureA, fixtureB);
+}
+
+void b2GridContact::Destroy(b2Contact* contact, b2BlockAllocator* allocator)
+{
+	((b2GridContact*)contact)->~b2GridContact();
+	allocator->Free(contact, sizeof(b2GridContact));
+}
+
+b2GridContact::b2GridContact(b2Fixture* fixtureA, b2Fixture* fixtureB)
+	: b2Contact(fixtureA, fixtureB)
+{
+	b2Assert(m_fixtureA->GetType() == b2Shape::e_grid);
+	b2Assert(m_fixtureB->GetType() == b2Shape::e_polygon || m_fixtureB->GetType() == b2Shape::e_circle);
+
+	m_gridManifolds[0].pointCount = 0;
+	m_manifolds = m_gridManifolds;
+}
+
+// Collides the shape with each face reported by the grid.
+struct b2GridFaceCollider
+{
+	void ReportFace(const b2GridFace& face)
+	{
+		if (count == b2_maxContactManifolds)
+		{
+			return;
+		}
+
+		b2PolygonShape edge;
+		edge.SetAsEdge(face.vertex1, face.vertex2);
+
+		b2Manifold* manifold = manifolds + count;
+		if (shape->GetType() == b2Shape::e_polygon)
+		{
+			b2CollidePolygons(manifold, &edge, xfA, (const b2PolygonShape*)shape, xfB);
+		}
+		else
+		{
+			b2CollidePolygonAndCircle(manifold, &edge, xfA, (const b2CircleShape*)shape, xfB);
+		}
+
+		if (manifold->pointCount == 0)
+		{
+			return;
+		}
+
+		// One-sided: a shape found behind a face, in the cells, is pushed out
+		// by the other faces.
+		b2WorldManifold worldManifold;
+		worldManifold.Initialize(manifold, xfA, edge.m_radius, xfB, shape->m_radius);
+		if (b2Dot(worldManifold.normal, b2Mul(xfA.R, face.normal)) <= 0.0f)
+		{
+			manifold->pointCount = 0;
+			return;
+		}
+
+		// The features of an edge and a polygon fit in a byte, the face key in the
+		// other 24 bits as long as the grid has at most b2_maxGridCells cells.
+		for (int32 i = 0; i < manifold->pointCount; ++i)
+		{
+			b2ContactID* id = &manifold->points[i].id;
+			uint32 features = (id->features.referenceEdge & 7) | ((id->features.incidentEdge & 7) << 3) |
+				((id->features.incidentVertex & 1) << 6) | ((id->features.flip & 1) << 7);
+			id->key = (face.key << 8) | features;
+		}
+
+		++count;
+	}
+
+	const b2Shape* shape;
+	b2Transform xfA;
+	b2Transform xfB;
+	b2Manifold* manifolds;
+	int32 count;
+};
+
+int32 b2GridContact::EvaluateManifolds(b2Manifold* manifolds, const b2Transform& xfA, const b2Transform& xfB)
+{
+	const b2GridShape* grid = (b2GridShape*)m_fixtureA->GetShape();
+	const b2Shape* shape = m_fixtureB->GetShape();
+
+	// The box of the shape in the grid frame, with room for the skins.
+	b2AABB aabb;
+	shape->ComputeAABB(&aabb, xfB);
+	b2Vec2 corners[4];
+	corners[0] = aabb.lowerBound;
+	corners[1].Set(aabb.upperBound.x, aabb.lowerBound.y);
+	corners[2] = aabb.upperBound;
+	corners[3].Set(aabb.lowerBound.x, aabb.upperBound.y);
+
+	b2AABB box;
+	box.lowerBound = b2MulT(xfA, corners[0]);
+	box.upperBound = box.lowerBound;
+	for (int32 i = 1; i < 4; ++i)
+	{
+		b2Vec2 v = b2MulT(xfA, corners[i]);
+		box.lowerBound = b2Min(box.lowerBound, v);
+		box.upperBound = b2Max(box.upperBound, v);
+	}
+	b2Vec2 r(grid->m_radius, grid->m_radius);
+	box.lowerBound -= r;
+	box.upperBound += r;
+
+	b2GridFaceCollider collider;
+	collider.shape = shape;
+	collider.xfA = xfA;
+	collider.xfB = xfB;
+	collider.manifolds = manifolds;
+	collider.count = 0;
+	grid->QueryFaces(&collider, box);
+
+	if (collider.count == 0)
+	{
+		manifolds[0].pointCount = 0;
+		return 1;
+	}
+
+	return collider.count;
+}
+
+void b2GridContact::Evaluate(b2Manifold* manifold, const b2Transform& xfA, const b2Transform& xfB)
+{
+	b2Manifold manifolds[b2_maxContactManifolds];
+	EvaluateManifolds(manifolds, xfA, xfB);
+	*manifold = manifolds[0];
+}
@@ -0,0 +1,48 @@
+/*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef B2_GRID_CONTACT_H
+#define B2_GRID_CONTACT_H
+
+#include <Box2D/Dynamics/Contacts/b2Contact.h>
+
+class b2BlockAllocator;
+
+/// A grid shape against a polygon or a circle. The shape collides with the
+/// exposed faces of the grid around it, as one-sided edges, each giving its
+/// own manifold: up to b2_maxContactManifolds faces are kept, floors and
+/// ceilings first. The point ids hold the face keys of b2GridShape::QueryFaces,
+/// so that warm starting follows each face.
+class b2GridContact : public b2Contact
+{
+public:
+	static b2Contact* Create(b2Fixture* fixtureA, b2Fixture* fixtureB, b2BlockAllocator* allocator);
+	static void Destroy(b2Contact* contact, b2BlockAllocator* allocator);
+
+	b2GridContact(b2Fixture* fixtureA, b2Fixture* fixtureB);
+	~b2GridContact() {}
+
+	/// Evaluate the first manifold only.
+	void Evaluate(b2Manifold* manifold, const b2Transform& xfA, const b2Transform& xfB);
+
+protected:
+	int32 EvaluateManifolds(b2Manifold* manifolds, const b2Transform& xfA, const b2Transform& xfB);
+
+	b2Manifold m_gridManifolds[b2_maxContactManifolds];
+};
+
+#endif
@@ -0,0 +1,438 @@
+/*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Dynamics/Contacts/b2SimdContactSolver.h>
+#include <Box2D/Dynamics/Contacts/b2ContactSolver.h>
+#include <Box2D/Dynamics/b2Body.h>
+#include <Box2D/Common/b2StackAllocator.h>
+#include <cstring>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define B2_SIMD_SSE 1
+#include <xmmintrin.h>
+#else
+#define B2_SIMD_SSE 0
+#endif
+
+// Four wide floats: SSE when available, plain arrays otherwise.
+#if B2_SIMD_SSE
+
+typedef __m128 b2FloatW;
+
+inline b2FloatW b2LoadW(const float32* a) { return _mm_loadu_ps(a); }
+inline void b2StoreW(float32* a, b2FloatW b) { _mm_storeu_ps(a, b); }
+inline b2FloatW b2SplatW(float32 a) { return _mm_set1_ps(a); }
+inline b2FloatW b2AddW(b2FloatW a, b2FloatW b) { return _mm_add_ps(a, b); }
+inline b2FloatW b2SubW(b2FloatW a, b2FloatW b) { return _mm_sub_ps(a, b); }
+inline b2FloatW b2MulW(b2FloatW a, b2FloatW b) { return _mm_mul_ps(a, b); }
+inline b2FloatW b2MinW(b2FloatW a, b2FloatW b) { return _mm_min_ps(a, b); }
+inline b2FloatW b2MaxW(b2FloatW a, b2FloatW b) { return _mm_max_ps(a, b); }
+
+// Lane masks: a >= b, and a where the mask is set, b elsewhere.
+inline b2FloatW b2GreaterEqualW(b2FloatW a, b2FloatW b) { return _mm_cmpge_ps(a, b); }
+inline b2FloatW b2SelectW(b2FloatW mask, b2FloatW a, b2FloatW b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+
+#else
+
+struct b2FloatW
+{
+	float32 x[b2_simdWidth];
+};
+
+inline b2FloatW b2LoadW(const float32* a) { b2FloatW r; for (int32 i = 0; i < b2_simdWidth; ++i) r.x[i] = a[i]; return r; }
+inline void b2StoreW(float32* a, b2FloatW b) { for (int32 i = 0; i < b2_simdWidth; ++i) a[i] = b.x[i]; }
+inline b2FloatW b2SplatW(float32 a) { b2FloatW r; for (int32 i = 0; i < b2_simdWidth; ++i) r.x[i] = a; return r; }
+inline b2FloatW b2AddW(b2FloatW a, b2FloatW b) { for (int32 i = 0; i < b2_simdWidth; ++i) a.x[i] += b.x[i]; return a; }
+inline b2FloatW b2SubW(b2FloatW a, b2FloatW b) { for (int32 i = 0; i < b2_simdWidth; ++i) a.x[i] -= b.x[i]; return a; }
+inline b2FloatW b2MulW(b2FloatW a, b2FloatW b) { for (int32 i = 0; i < b2_simdWidth; ++i) a.x[i] *= b.x[i]; return a; }
+inline b2FloatW b2MinW(b2FloatW a, b2FloatW b) { for (int32 i = 0; i < b2_simdWidth; ++i) a.x[i] = b2Min(a.x[i], b.x[i]); return a; }
+inline b2FloatW b2MaxW(b2FloatW a, b2FloatW b) { for (int32 i = 0; i < b2_simdWidth; ++i) a.x[i] = b2Max(a.x[i], b.x[i]); return a; }
+
+inline b2FloatW b2GreaterEqualW(b2FloatW a, b2FloatW b) { for (int32 i = 0; i < b2_simdWidth; ++i) a.x[i] = a.x[i] >= b.x[i] ? 1.0f : 0.0f; return a; }
+inline b2FloatW b2SelectW(b2FloatW mask, b2FloatW a, b2FloatW b) { for (int32 i = 0; i < b2_simdWidth; ++i) a.x[i] = mask.x[i] != 0.0f ? a.x[i] : b.x[i]; return a; }
+
+#endif
+
+// The velocities of the bodies of a batch, one per lane.
+struct b2BodyW
+{
+	b2FloatW vX, vY, w;
+};
+
+static void b2GatherBodies(b2BodyW* body, const b2Velocity* velocities, const int32* indices)
+{
+	float32 vX[b2_simdWidth], vY[b2_simdWidth], w[b2_simdWidth];
+	for (int32 i = 0; i < b2_simdWidth; ++i)
+	{
+		const b2Velocity& v = velocities[indices[i]];
+		vX[i] = v.v.x;
+		vY[i] = v.v.y;
+		w[i] = v.w;
+	}
+	body->vX = b2LoadW(vX);
+	body->vY = b2LoadW(vY);
+	body->w = b2LoadW(w);
+}
+
+static void b2ScatterBodies(b2Velocity* velocities, const int32* indices, const b2BodyW& body)
+{
+	float32 vX[b2_simdWidth], vY[b2_simdWidth], w[b2_simdWidth];
+	b2StoreW(vX, body.vX);
+	b2StoreW(vY, body.vY);
+	b2StoreW(w, body.w);
+	for (int32 i = 0; i < b2_simdWidth; ++i)
+	{
+		// Lanes on the still slot write back zero: static bodies have no mass
+		// to receive an impulse.
+		b2Velocity& v = velocities[indices[i]];
+		v.v.Set(vX[i], vY[i]);
+		v.w = w[i];
+	}
+}
+
+// Apply the impulse P at rA on A and -P at rB on B.
+static void b2ApplyImpulse(b2BodyW* A, b2BodyW* B, const b2SimdConstraintBatch* c, int32 j, b2FloatW PX, b2FloatW PY)
+{
+	b2FloatW rAX = b2LoadW(c->rAX[j]);
+	b2FloatW rAY = b2LoadW(c->rAY[j]);
+	b2FloatW rBX = b2LoadW(c->rBX[j]);
+	b2FloatW rBY = b2LoadW(c->rBY[j]);
+	b2FloatW invMassA = b2LoadW(c->invMassA);
+	b2FloatW invMassB = b2LoadW(c->invMassB);
+
+	A->vX = b2SubW(A->vX, b2MulW(invMassA, PX));
+	A->vY = b2SubW(A->vY, b2MulW(invMassA, PY));
+	A->w = b2SubW(A->w, b2MulW(b2LoadW(c->invIA), b2SubW(b2MulW(rAX, PY), b2MulW(rAY, PX))));
+
+	B->vX = b2AddW(B->vX, b2MulW(invMassB, PX));
+	B->vY = b2AddW(B->vY, b2MulW(invMassB, PY));
+	B->w = b2AddW(B->w, b2MulW(b2LoadW(c->invIB), b2SubW(b2MulW(rBX, PY), b2MulW(rBY, PX))));
+}
+
+// Relative velocity at the contact point j, along (dirX, dirY).
+static b2FloatW b2RelativeVelocity(const b2BodyW& A, const b2BodyW& B, const b2SimdConstraintBatch* c, int32 j,
+								   b2FloatW dirX, b2FloatW dirY)
+{
+	// dv = vB + b2Cross(wB, rB) - vA - b2Cross(wA, rA)
+	b2FloatW dvX = b2AddW(b2SubW(b2SubW(B.vX, b2MulW(B.w, b2LoadW(c->rBY[j]))), A.vX), b2MulW(A.w, b2LoadW(c->rAY[j])));
+	b2FloatW dvY = b2SubW(b2SubW(b2AddW(B.vY, b2MulW(B.w, b2LoadW(c->rBX[j]))), A.vY), b2MulW(A.w, b2LoadW(c->rAX[j])));
+	return b2AddW(b2MulW(dvX, dirX), b2MulW(dvY, dirY));
+}
+
+b2SimdContactSolver::b2SimdContactSolver(b2ContactSolver* solver, b2Body** bodies, int32 bodyCount,
+										 b2StackAllocator* allocator)
+{
+	m_solver = solver;
+	m_allocator = allocator;
+	m_bodies = bodies;
+	m_bodyCount = bodyCount;
+
+	// Slots: the island bodies are exclusive to this island, static bodies may
+	// be shared with others and all use the still slot.
+	for (int32 i = 0; i < m_bodyCount; ++i)
+	{
+		if (m_bodies[i]->GetType() != b2_staticBody)
+		{
+			m_bodies[i]->m_islandIndex = i;
+		}
+	}
+	m_velocities = (b2Velocity*)m_allocator->Allocate((m_bodyCount + 1) * sizeof(b2Velocity));
+	LoadVelocities();
+
+	// Greedy batching: each constraint goes to the first of the last few open
+	// batches where neither of its dynamic bodies is already, else to a new one.
+	const int32 k_searchWindow = 8;
+	int32 constraintCount = m_solver->m_constraintCount;
+	m_batches = (b2SimdConstraintBatch*)m_allocator->Allocate(b2Max(constraintCount, 1) * sizeof(b2SimdConstraintBatch));
+	m_batchCount = 0;
+	for (int32 i = 0; i < constraintCount; ++i)
+	{
+		const b2ContactConstraint* cc = m_solver->m_constraints + i;
+		b2Body* bodyA = cc->bodyA;
+		b2Body* bodyB = cc->bodyB;
+		int32 slotA = bodyA->GetType() == b2_staticBody ? 0 : bodyA->m_islandIndex + 1;
+		int32 slotB = bodyB->GetType() == b2_staticBody ? 0 : bodyB->m_islandIndex + 1;
+		bool dynamicA = bodyA->GetType() == b2_dynamicBody;
+		bool dynamicB = bodyB->GetType() == b2_dynamicBody;
+
+		b2SimdConstraintBatch* batch = NULL;
+		for (int32 k = b2Max(0, m_batchCount - k_searchWindow); k < m_batchCount && batch == NULL; ++k)
+		{
+			b2SimdConstraintBatch* candidate = m_batches + k;
+			if (candidate->laneCount == b2_simdWidth)
+			{
+				continue;
+			}
+
+			// Only dynamic bodies receive impulses: others may be shared by lanes.
+			bool conflict = false;
+			for (int32 l = 0; l < candidate->laneCount; ++l)
+			{
+				const b2ContactConstraint* other = m_solver->m_constraints + candidate->constraint[l];
+				bool otherA = other->bodyA->GetType() == b2_dynamicBody;
+				bool otherB = other->bodyB->GetType() == b2_dynamicBody;
+				if ((dynamicA && ((otherA && other->bodyA == bodyA) || (otherB && other->bodyB == bodyA))) ||
+					(dynamicB && ((otherA && other->bodyA == bodyB) || (otherB && other->bodyB == bodyB))))
+				{
+					conflict = true;
+					break;
+				}
+			}
+
+			if (conflict == false)
+			{
+				batch = candidate;
+			}
+		}
+
+		if (batch == NULL)
+		{
+			batch = m_batches + m_batchCount++;
+			memset(batch, 0, sizeof(b2SimdConstraintBatch));
+			for (int32 l = 0; l < b2_simdWidth; ++l)
+			{
+				batch->constraint[l] = -1;
+				batch->K11[l] = 1.0f;
+				batch->K22[l] = 1.0f;
+				batch->normalMass11[l] = 1.0f;
+				batch->normalMass22[l] = 1.0f;
+			}
+		}
+
+		int32 l = batch->laneCount++;
+		batch->constraint[l] = i;
+		batch->indexA[l] = slotA;
+		batch->indexB[l] = slotB;
+		batch->invMassA[l] = bodyA->m_invMass;
+		batch->invIA[l] = bodyA->m_invI;
+		batch->invMassB[l] = bodyB->m_invMass;
+		batch->invIB[l] = bodyB->m_invI;
+		batch->normalX[l] = cc->normal.x;
+		batch->normalY[l] = cc->normal.y;
+		batch->friction[l] = cc->friction;
+		if (cc->pointCount == 2)
+		{
+			batch->K11[l] = cc->K.col1.x;
+			batch->K12[l] = cc->K.col1.y;
+			batch->K22[l] = cc->K.col2.y;
+			batch->normalMass11[l] = cc->normalMass.col1.x;
+			batch->normalMass12[l] = cc->normalMass.col1.y;
+			batch->normalMass22[l] = cc->normalMass.col2.y;
+			batch->secondPoint[l] = 1.0f;
+		}
+		else
+		{
+			batch->K11[l] = 1.0f / cc->points[0].normalMass;
+			batch->K12[l] = 0.0f;
+			batch->K22[l] = 1.0f;
+			batch->normalMass11[l] = cc->points[0].normalMass;
+			batch->normalMass12[l] = 0.0f;
+			batch->normalMass22[l] = 1.0f;
+			batch->secondPoint[l] = 0.0f;
+		}
+		for (int32 j = 0; j < cc->pointCount; ++j)
+		{
+			const b2ContactConstraintPoint* ccp = cc->points + j;
+			batch->rAX[j][l] = ccp->rA.x;
+			batch->rAY[j][l] = ccp->rA.y;
+			batch->rBX[j][l] = ccp->rB.x;
+			batch->rBY[j][l] = ccp->rB.y;
+			batch->normalMass[j][l] = ccp->normalMass;
+			batch->tangentMass[j][l] = ccp->tangentMass;
+			batch->velocityBias[j][l] = ccp->velocityBias;
+			batch->normalImpulse[j][l] = ccp->normalImpulse;
+			batch->tangentImpulse[j][l] = ccp->tangentImpulse;
+		}
+	}
+}
+
+b2SimdContactSolver::~b2SimdContactSolver()
+{
+	m_allocator->Free(m_batches);
+	m_allocator->Free(m_velocities);
+}
+
+void b2SimdContactSolver::LoadVelocities()
+{
+	m_velocities[0].v.SetZero();
+	m_velocities[0].w = 0.0f;
+	for (int32 i = 0; i < m_bodyCount; ++i)
+	{
+		b2Body* b = m_bodies[i];
+		if (b->GetType() == b2_staticBody)
+		{
+			continue;
+		}
+		m_velocities[i + 1].v = b->m_linearVelocity;
+		m_velocities[i + 1].w = b->m_angularVelocity;
+	}
+}
+
+void b2SimdContactSolver::StoreVelocities()
+{
+	for (int32 i = 0; i < m_bodyCount; ++i)
+	{
+		b2Body* b = m_bodies[i];
+		if (b->GetType() != b2_dynamicBody)
+		{
+			continue;
+		}
+		b->m_linearVelocity = m_velocities[i + 1].v;
+		b->m_angularVelocity = m_velocities[i + 1].w;
+	}
+}
+
+void b2SimdContactSolver::WarmStart()
+{
+	for (int32 i = 0; i < m_batchCount; ++i)
+	{
+		const b2SimdConstraintBatch* c = m_batches + i;
+
+		b2BodyW A, B;
+		b2GatherBodies(&A, m_velocities, c->indexA);
+		b2GatherBodies(&B, m_velocities, c->indexB);
+
+		// tangent = b2Cross(normal, 1.0f)
+		b2FloatW normalX = b2LoadW(c->normalX);
+		b2FloatW normalY = b2LoadW(c->normalY);
+		b2FloatW tangentX = normalY;
+		b2FloatW tangentY = b2SubW(b2SplatW(0.0f), normalX);
+
+		for (int32 j = 0; j < b2_maxManifoldPoints; ++j)
+		{
+			b2FloatW normalImpulse = b2LoadW(c->normalImpulse[j]);
+			b2FloatW tangentImpulse = b2LoadW(c->tangentImpulse[j]);
+			b2FloatW PX = b2AddW(b2MulW(normalImpulse, normalX), b2MulW(tangentImpulse, tangentX));
+			b2FloatW PY = b2AddW(b2MulW(normalImpulse, normalY), b2MulW(tangentImpulse, tangentY));
+			b2ApplyImpulse(&A, &B, c, j, PX, PY);
+		}
+
+		b2ScatterBodies(m_velocities, c->indexA, A);
+		b2ScatterBodies(m_velocities, c->indexB, B);
+	}
+}
+
+void b2SimdContactSolver::SolveVelocityConstraints()
+{
+	b2FloatW zero = b2SplatW(0.0f);
+
+	for (int32 i = 0; i < m_batchCount; ++i)
+	{
+		b2SimdConstraintBatch* c = m_batches + i;
+
+		b2BodyW A, B;
+		b2GatherBodies(&A, m_velocities, c->indexA);
+		b2GatherBodies(&B, m_velocities, c->indexB);
+
+		b2FloatW normalX = b2LoadW(c->normalX);
+		b2FloatW normalY = b2LoadW(c->normalY);
+		b2FloatW tangentX = normalY;
+		b2FloatW tangentY = b2SubW(zero, normalX);
+		b2FloatW friction = b2LoadW(c->friction);
+
+		// Solve tangent constraints
+		for (int32 j = 0; j < b2_maxManifoldPoints; ++j)
+		{
+			b2FloatW vt = b2RelativeVelocity(A, B, c, j, tangentX, tangentY);
+			b2FloatW lambda = b2SubW(zero, b2MulW(b2LoadW(c->tangentMass[j]), vt));
+
+			// b2Clamp the accumulated force
+			b2FloatW oldImpulse = b2LoadW(c->tangentImpulse[j]);
+			b2FloatW maxFriction = b2MulW(friction, b2LoadW(c->normalImpulse[j]));
+			b2FloatW newImpulse = b2MaxW(b2SubW(zero, maxFriction), b2MinW(b2AddW(oldImpulse, lambda), maxFriction));
+			lambda = b2SubW(newImpulse, oldImpulse);
+			b2StoreW(c->tangentImpulse[j], newImpulse);
+
+			b2ApplyImpulse(&A, &B, c, j, b2MulW(lambda, tangentX), b2MulW(lambda, tangentY));
+		}
+
+		// Solve normal constraints with the block solver of b2ContactSolver: the
+		// four cases are tried on every lane, the first valid one is kept.
+		{
+			b2FloatW a1 = b2LoadW(c->normalImpulse[0]);
+			b2FloatW a2 = b2LoadW(c->normalImpulse[1]);
+			b2FloatW K11 = b2LoadW(c->K11);
+			b2FloatW K12 = b2LoadW(c->K12);
+			b2FloatW K22 = b2LoadW(c->K22);
+
+			// b' = vn - velocityBias - K * a
+			b2FloatW vn1 = b2RelativeVelocity(A, B, c, 0, normalX, normalY);
+			b2FloatW vn2 = b2RelativeVelocity(A, B, c, 1, normalX, normalY);
+			b2FloatW b1 = b2SubW(b2SubW(vn1, b2LoadW(c->velocityBias[0])), b2AddW(b2MulW(K11, a1), b2MulW(K12, a2)));
+			b2FloatW b2 = b2SubW(b2SubW(vn2, b2LoadW(c->velocityBias[1])), b2AddW(b2MulW(K12, a1), b2MulW(K22, a2)));
+			b2 = b2MulW(b2, b2LoadW(c->secondPoint));
+
+			// No valid case: keep the impulses.
+			b2FloatW x1 = a1;
+			b2FloatW x2 = a2;
+
+			// Case 4: x = 0, vn = b
+			b2FloatW valid = b2GreaterEqualW(b2MinW(b1, b2), zero);
+			x1 = b2SelectW(valid, zero, x1);
+			x2 = b2SelectW(valid, zero, x2);
+
+			// Case 3: x1 = 0, vn2 = 0
+			b2FloatW y2 = b2SubW(zero, b2MulW(b2LoadW(c->normalMass[1]), b2));
+			b2FloatW w1 = b2AddW(b2MulW(K12, y2), b1);
+			valid = b2GreaterEqualW(b2MinW(y2, w1), zero);
+			x1 = b2SelectW(valid, zero, x1);
+			x2 = b2SelectW(valid, y2, x2);
+
+			// Case 2: vn1 = 0, x2 = 0
+			b2FloatW y1 = b2SubW(zero, b2MulW(b2LoadW(c->normalMass[0]), b1));
+			b2FloatW w2 = b2AddW(b2MulW(K12, y1), b2);
+			valid = b2GreaterEqualW(b2MinW(y1, w2), zero);
+			x1 = b2SelectW(valid, y1, x1);
+			x2 = b2SelectW(valid, zero, x2);
+
+			// Case 1: vn = 0, x = -inv(K) * b'
+			b2FloatW normalMass12 = b2LoadW(c->normalMass12);
+			y1 = b2SubW(zero, b2AddW(b2MulW(b2LoadW(c->normalMass11), b1), b2MulW(normalMass12, b2)));
+			y2 = b2SubW(zero, b2AddW(b2MulW(normalMass12, b1), b2MulW(b2LoadW(c->normalMass22), b2)));
+			valid = b2GreaterEqualW(b2MinW(y1, y2), zero);
+			x1 = b2SelectW(valid, y1, x1);
+			x2 = b2SelectW(valid, y2, x2);
+
+			// Apply the incremental impulses.
+			b2FloatW d1 = b2SubW(x1, a1);
+			b2FloatW d2 = b2SubW(x2, a2);
+			b2ApplyImpulse(&A, &B, c, 0, b2MulW(d1, normalX), b2MulW(d1, normalY));
+			b2ApplyImpulse(&A, &B, c, 1, b2MulW(d2, normalX), b2MulW(d2, normalY));
+			b2StoreW(c->normalImpulse[0], x1);
+			b2StoreW(c->normalImpulse[1], x2);
+		}
+
+		b2ScatterBodies(m_velocities, c->indexA, A);
+		b2ScatterBodies(m_velocities, c->indexB, B);
+	}
+}
+
+void b2SimdContactSolver::StoreImpulses()
+{
+	for (int32 i = 0; i < m_batchCount; ++i)
+	{
+		const b2SimdConstraintBatch* c = m_batches + i;
+		for (int32 l = 0; l < c->laneCount; ++l)
+		{
+			b2ContactConstraint* cc = m_solver->m_constraints + c->constraint[l];
+			for (int32 j = 0; j < cc->pointCount; ++j)
+			{
+				cc->points[j].normalImpulse = c->normalImpulse[j][l];
+				cc->points[j].tangentImpulse = c->tangentImpulse[j][l];
+			}
+		}
+	}
+}
@@ -0,0 +1,106 @@
+/*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_SIMD_CONTACT_SOLVER_H
+#define B2_SIMD_CONTACT_SOLVER_H
+
+#include <Box2D/Common/b2Math.h>
+#include <Box2D/Dynamics/b2Island.h>
+
+class b2Body;
+class b2StackAllocator;
+class b2ContactSolver;
+
+/// The number of contact constraints solved together (SSE lanes).
+#define b2_simdWidth	4
+
+/// This is an internal structure. Contact constraints that touch distinct
+/// dynamic bodies, one per lane, as a structure of arrays. Empty lanes have
+/// zero masses and leave the velocities untouched.
+struct b2SimdConstraintBatch
+{
+	int32 constraint[b2_simdWidth];	// in the contact solver, -1 for an empty lane
+	int32 indexA[b2_simdWidth];		// velocity slots, 0 is the still slot of static bodies
+	int32 indexB[b2_simdWidth];
+	int32 laneCount;
+
+	float32 invMassA[b2_simdWidth];
+	float32 invIA[b2_simdWidth];
+	float32 invMassB[b2_simdWidth];
+	float32 invIB[b2_simdWidth];
+	float32 normalX[b2_simdWidth];
+	float32 normalY[b2_simdWidth];
+	float32 friction[b2_simdWidth];
+
+	// The block solver of the normal impulses, see b2ContactSolver. A lane with
+	// a single point has a diagonal K and a zero mask to ignore the second.
+	float32 K11[b2_simdWidth];
+	float32 K12[b2_simdWidth];
+	float32 K22[b2_simdWidth];
+	float32 normalMass11[b2_simdWidth];
+	float32 normalMass12[b2_simdWidth];
+	float32 normalMass22[b2_simdWidth];
+	float32 secondPoint[b2_simdWidth];
+
+	// Per manifold point. A lane with a single point has zero masses for the second.
+	float32 rAX[b2_maxManifoldPoints][b2_simdWidth];
+	float32 rAY[b2_maxManifoldPoints][b2_simdWidth];
+	float32 rBX[b2_maxManifoldPoints][b2_simdWidth];
+	float32 rBY[b2_maxManifoldPoints][b2_simdWidth];
+	float32 normalMass[b2_maxManifoldPoints][b2_simdWidth];
+	float32 tangentMass[b2_maxManifoldPoints][b2_simdWidth];
+	float32 velocityBias[b2_maxManifoldPoints][b2_simdWidth];
+	float32 normalImpulse[b2_maxManifoldPoints][b2_simdWidth];
+	float32 tangentImpulse[b2_maxManifoldPoints][b2_simdWidth];
+};
+
+/// Velocity solver for the contacts of an island, b2_simdWidth constraints at a
+/// time. It takes the constraints prepared by a b2ContactSolver and works on a
+/// copy of the body velocities. Same maths as b2ContactSolver, block solver
+/// included, in a different order: constraints sharing a dynamic body are never
+/// solved together.
+class b2SimdContactSolver
+{
+public:
+	b2SimdContactSolver(b2ContactSolver* solver, b2Body** bodies, int32 bodyCount,
+						b2StackAllocator* allocator);
+
+	~b2SimdContactSolver();
+
+	/// Copy the velocities from the bodies, and back.
+	void LoadVelocities();
+	void StoreVelocities();
+
+	void WarmStart();
+	void SolveVelocityConstraints();
+
+	/// Write the accumulated impulses back to the constraints of the contact solver.
+	void StoreImpulses();
+
+	b2ContactSolver* m_solver;
+	b2StackAllocator* m_allocator;
+
+	b2Body** m_bodies;
+	int32 m_bodyCount;
+
+	// Slot 0 stays still, then one per body of the island.
+	b2Velocity* m_velocities;
+
+	b2SimdConstraintBatch* m_batches;
+	int32 m_batchCount;
+};
+
+#endif
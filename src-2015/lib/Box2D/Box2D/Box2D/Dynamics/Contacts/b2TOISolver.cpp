@@ -60,14 +60,27 @@ void b2TOISolver::Initialize(b2Contact** contacts, int32 count, b2Body* toiBody)
 {
 	Clear();
 
-	m_count = count;
+	// One constraint per manifold.
+	m_count = 0;
+	for (int32 i = 0; i < count; ++i)
+	{
+		m_count += contacts[i]->GetManifoldCount();
+	}
 	m_toiBody = toiBody;
 
 	m_constraints = (b2TOIConstraint*) m_allocator->Allocate(m_count * sizeof(b2TOIConstraint));
 
+	int32 contactIndex = 0;
+	int32 manifoldIndex = 0;
 	for (int32 i = 0; i < m_count; ++i)
 	{
-		b2Contact* contact = contacts[i];
+		b2Contact* contact = contacts[contactIndex];
+		b2Manifold* manifold = contact->GetManifolds() + manifoldIndex;
+		if (++manifoldIndex == contact->GetManifoldCount())
+		{
+			++contactIndex;
+			manifoldIndex = 0;
+		}
 
 		b2Fixture* fixtureA = contact->GetFixtureA();
 		b2Fixture* fixtureB = contact->GetFixtureB();
@@ -77,7 +90,6 @@ void b2TOISolver::Initialize(b2Contact** contacts, int32 count, b2Body* toiBody)
 		float32 radiusB = shapeB->m_radius;
 		b2Body* bodyA = fixtureA->GetBody();
 		b2Body* bodyB = fixtureB->GetBody();
-		b2Manifold* manifold = contact->GetManifold();
 
 		b2Assert(manifold->pointCount > 0);
 
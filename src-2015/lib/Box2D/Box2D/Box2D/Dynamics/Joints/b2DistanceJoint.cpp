@@ -115,10 +115,16 @@ void b2DistanceJoint::InitVelocityConstraints(const b2TimeStep& step)
 		m_impulse *= step.dtRatio;
 
 		b2Vec2 P = m_impulse * m_u;
-		b1->m_linearVelocity -= b1->m_invMass * P;
-		b1->m_angularVelocity -= b1->m_invI * b2Cross(r1, P);
-		b2->m_linearVelocity += b2->m_invMass * P;
-		b2->m_angularVelocity += b2->m_invI * b2Cross(r2, P);
+		if (b1->GetType() == b2_dynamicBody)
+		{
+			b1->m_linearVelocity -= b1->m_invMass * P;
+			b1->m_angularVelocity -= b1->m_invI * b2Cross(r1, P);
+		}
+		if (b2->GetType() == b2_dynamicBody)
+		{
+			b2->m_linearVelocity += b2->m_invMass * P;
+			b2->m_angularVelocity += b2->m_invI * b2Cross(r2, P);
+		}
 	}
 	else
 	{
@@ -145,10 +151,16 @@ void b2DistanceJoint::SolveVelocityConstraints(const b2TimeStep& step)
 	m_impulse += impulse;
 
 	b2Vec2 P = impulse * m_u;
-	b1->m_linearVelocity -= b1->m_invMass * P;
-	b1->m_angularVelocity -= b1->m_invI * b2Cross(r1, P);
-	b2->m_linearVelocity += b2->m_invMass * P;
-	b2->m_angularVelocity += b2->m_invI * b2Cross(r2, P);
+	if (b1->GetType() == b2_dynamicBody)
+	{
+		b1->m_linearVelocity -= b1->m_invMass * P;
+		b1->m_angularVelocity -= b1->m_invI * b2Cross(r1, P);
+	}
+	if (b2->GetType() == b2_dynamicBody)
+	{
+		b2->m_linearVelocity += b2->m_invMass * P;
+		b2->m_angularVelocity += b2->m_invI * b2Cross(r2, P);
+	}
 }
 
 bool b2DistanceJoint::SolvePositionConstraints(float32 baumgarte)
@@ -177,13 +189,18 @@ bool b2DistanceJoint::SolvePositionConstraints(float32 baumgarte)
 	m_u = d;
 	b2Vec2 P = impulse * m_u;
 
-	b1->m_sweep.c -= b1->m_invMass * P;
-	b1->m_sweep.a -= b1->m_invI * b2Cross(r1, P);
-	b2->m_sweep.c += b2->m_invMass * P;
-	b2->m_sweep.a += b2->m_invI * b2Cross(r2, P);
-
-	b1->SynchronizeTransform();
-	b2->SynchronizeTransform();
+	if (b1->GetType() == b2_dynamicBody)
+	{
+		b1->m_sweep.c -= b1->m_invMass * P;
+		b1->m_sweep.a -= b1->m_invI * b2Cross(r1, P);
+		b1->SynchronizeTransform();
+	}
+	if (b2->GetType() == b2_dynamicBody)
+	{
+		b2->m_sweep.c += b2->m_invMass * P;
+		b2->m_sweep.a += b2->m_invI * b2Cross(r2, P);
+		b2->SynchronizeTransform();
+	}
 
 	return b2Abs(C) < b2_linearSlop;
 }
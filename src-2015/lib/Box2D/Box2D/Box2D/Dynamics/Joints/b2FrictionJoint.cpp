@@ -103,11 +103,17 @@ void b2FrictionJoint::InitVelocityConstraints(const b2TimeStep& step)
 
 		b2Vec2 P(m_linearImpulse.x, m_linearImpulse.y);
 
-		bA->m_linearVelocity -= mA * P;
-		bA->m_angularVelocity -= iA * (b2Cross(rA, P) + m_angularImpulse);
+		if (bA->GetType() == b2_dynamicBody)
+		{
+			bA->m_linearVelocity -= mA * P;
+			bA->m_angularVelocity -= iA * (b2Cross(rA, P) + m_angularImpulse);
+		}
 
-		bB->m_linearVelocity += mB * P;
-		bB->m_angularVelocity += iB * (b2Cross(rB, P) + m_angularImpulse);
+		if (bB->GetType() == b2_dynamicBody)
+		{
+			bB->m_linearVelocity += mB * P;
+			bB->m_angularVelocity += iB * (b2Cross(rB, P) + m_angularImpulse);
+		}
 	}
 	else
 	{
@@ -173,10 +179,16 @@ void b2FrictionJoint::SolveVelocityConstraints(const b2TimeStep& step)
 		wB += iB * b2Cross(rB, impulse);
 	}
 
-	bA->m_linearVelocity = vA;
-	bA->m_angularVelocity = wA;
-	bB->m_linearVelocity = vB;
-	bB->m_angularVelocity = wB;
+	if (bA->GetType() == b2_dynamicBody)
+	{
+		bA->m_linearVelocity = vA;
+		bA->m_angularVelocity = wA;
+	}
+	if (bB->GetType() == b2_dynamicBody)
+	{
+		bB->m_linearVelocity = vB;
+		bB->m_angularVelocity = wB;
+	}
 }
 
 bool b2FrictionJoint::SolvePositionConstraints(float32 baumgarte)
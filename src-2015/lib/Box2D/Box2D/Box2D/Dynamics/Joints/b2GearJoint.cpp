@@ -147,10 +147,16 @@ void b2GearJoint::InitVelocityConstraints(const b2TimeStep& step)
 	if (step.warmStarting)
 	{
 		// Warm starting.
-		b1->m_linearVelocity += b1->m_invMass * m_impulse * m_J.linearA;
-		b1->m_angularVelocity += b1->m_invI * m_impulse * m_J.angularA;
-		b2->m_linearVelocity += b2->m_invMass * m_impulse * m_J.linearB;
-		b2->m_angularVelocity += b2->m_invI * m_impulse * m_J.angularB;
+		if (b1->GetType() == b2_dynamicBody)
+		{
+			b1->m_linearVelocity += b1->m_invMass * m_impulse * m_J.linearA;
+			b1->m_angularVelocity += b1->m_invI * m_impulse * m_J.angularA;
+		}
+		if (b2->GetType() == b2_dynamicBody)
+		{
+			b2->m_linearVelocity += b2->m_invMass * m_impulse * m_J.linearB;
+			b2->m_angularVelocity += b2->m_invI * m_impulse * m_J.angularB;
+		}
 	}
 	else
 	{
@@ -171,10 +177,16 @@ void b2GearJoint::SolveVelocityConstraints(const b2TimeStep& step)
 	float32 impulse = m_mass * (-Cdot);
 	m_impulse += impulse;
 
-	b1->m_linearVelocity += b1->m_invMass * impulse * m_J.linearA;
-	b1->m_angularVelocity += b1->m_invI * impulse * m_J.angularA;
-	b2->m_linearVelocity += b2->m_invMass * impulse * m_J.linearB;
-	b2->m_angularVelocity += b2->m_invI * impulse * m_J.angularB;
+	if (b1->GetType() == b2_dynamicBody)
+	{
+		b1->m_linearVelocity += b1->m_invMass * impulse * m_J.linearA;
+		b1->m_angularVelocity += b1->m_invI * impulse * m_J.angularA;
+	}
+	if (b2->GetType() == b2_dynamicBody)
+	{
+		b2->m_linearVelocity += b2->m_invMass * impulse * m_J.linearB;
+		b2->m_angularVelocity += b2->m_invI * impulse * m_J.angularB;
+	}
 }
 
 bool b2GearJoint::SolvePositionConstraints(float32 baumgarte)
@@ -209,13 +221,18 @@ bool b2GearJoint::SolvePositionConstraints(float32 baumgarte)
 
 	float32 impulse = m_mass * (-C);
 
-	b1->m_sweep.c += b1->m_invMass * impulse * m_J.linearA;
-	b1->m_sweep.a += b1->m_invI * impulse * m_J.angularA;
-	b2->m_sweep.c += b2->m_invMass * impulse * m_J.linearB;
-	b2->m_sweep.a += b2->m_invI * impulse * m_J.angularB;
-
-	b1->SynchronizeTransform();
-	b2->SynchronizeTransform();
+	if (b1->GetType() == b2_dynamicBody)
+	{
+		b1->m_sweep.c += b1->m_invMass * impulse * m_J.linearA;
+		b1->m_sweep.a += b1->m_invI * impulse * m_J.angularA;
+		b1->SynchronizeTransform();
+	}
+	if (b2->GetType() == b2_dynamicBody)
+	{
+		b2->m_sweep.c += b2->m_invMass * impulse * m_J.linearB;
+		b2->m_sweep.a += b2->m_invI * impulse * m_J.angularB;
+		b2->SynchronizeTransform();
+	}
 
 	// TODO_ERIN not implemented
 	return linearError < b2_linearSlop;
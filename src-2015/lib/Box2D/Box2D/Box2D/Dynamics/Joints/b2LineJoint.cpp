@@ -219,11 +219,17 @@ void b2LineJoint::InitVelocityConstraints(const b2TimeStep& step)
 		float32 L1 = m_impulse.x * m_s1 + (m_motorImpulse + m_impulse.y) * m_a1;
 		float32 L2 = m_impulse.x * m_s2 + (m_motorImpulse + m_impulse.y) * m_a2;
 
-		b1->m_linearVelocity -= m_invMassA * P;
-		b1->m_angularVelocity -= m_invIA * L1;
+		if (b1->GetType() == b2_dynamicBody)
+		{
+			b1->m_linearVelocity -= m_invMassA * P;
+			b1->m_angularVelocity -= m_invIA * L1;
+		}
 
-		b2->m_linearVelocity += m_invMassB * P;
-		b2->m_angularVelocity += m_invIB * L2;
+		if (b2->GetType() == b2_dynamicBody)
+		{
+			b2->m_linearVelocity += m_invMassB * P;
+			b2->m_angularVelocity += m_invIB * L2;
+		}
 	}
 	else
 	{
@@ -335,10 +341,16 @@ void b2LineJoint::SolveVelocityConstraints(const b2TimeStep& step)
 		w2 += m_invIB * L2;
 	}
 
-	b1->m_linearVelocity = v1;
-	b1->m_angularVelocity = w1;
-	b2->m_linearVelocity = v2;
-	b2->m_angularVelocity = w2;
+	if (b1->GetType() == b2_dynamicBody)
+	{
+		b1->m_linearVelocity = v1;
+		b1->m_angularVelocity = w1;
+	}
+	if (b2->GetType() == b2_dynamicBody)
+	{
+		b2->m_linearVelocity = v2;
+		b2->m_angularVelocity = w2;
+	}
 }
 
 bool b2LineJoint::SolvePositionConstraints(float32 baumgarte)
@@ -457,12 +469,18 @@ bool b2LineJoint::SolvePositionConstraints(float32 baumgarte)
 	a2 += m_invIB * L2;
 
 	// TODO_ERIN remove need for this.
-	b1->m_sweep.c = c1;
-	b1->m_sweep.a = a1;
-	b2->m_sweep.c = c2;
-	b2->m_sweep.a = a2;
-	b1->SynchronizeTransform();
-	b2->SynchronizeTransform();
+	if (b1->GetType() == b2_dynamicBody)
+	{
+		b1->m_sweep.c = c1;
+		b1->m_sweep.a = a1;
+		b1->SynchronizeTransform();
+	}
+	if (b2->GetType() == b2_dynamicBody)
+	{
+		b2->m_sweep.c = c2;
+		b2->m_sweep.a = a2;
+		b2->SynchronizeTransform();
+	}
 
 	return linearError <= b2_linearSlop && angularError <= b2_angularSlop;
 }
@@ -176,10 +176,16 @@ void b2PulleyJoint::InitVelocityConstraints(const b2TimeStep& step)
 		// Warm starting.
 		b2Vec2 P1 = -(m_impulse + m_limitImpulse1) * m_u1;
 		b2Vec2 P2 = (-m_ratio * m_impulse - m_limitImpulse2) * m_u2;
-		b1->m_linearVelocity += b1->m_invMass * P1;
-		b1->m_angularVelocity += b1->m_invI * b2Cross(r1, P1);
-		b2->m_linearVelocity += b2->m_invMass * P2;
-		b2->m_angularVelocity += b2->m_invI * b2Cross(r2, P2);
+		if (b1->GetType() == b2_dynamicBody)
+		{
+			b1->m_linearVelocity += b1->m_invMass * P1;
+			b1->m_angularVelocity += b1->m_invI * b2Cross(r1, P1);
+		}
+		if (b2->GetType() == b2_dynamicBody)
+		{
+			b2->m_linearVelocity += b2->m_invMass * P2;
+			b2->m_angularVelocity += b2->m_invI * b2Cross(r2, P2);
+		}
 	}
 	else
 	{
@@ -212,10 +218,16 @@ void b2PulleyJoint::SolveVelocityConstraints(const b2TimeStep& step)
 
 		b2Vec2 P1 = -impulse * m_u1;
 		b2Vec2 P2 = -m_ratio * impulse * m_u2;
-		b1->m_linearVelocity += b1->m_invMass * P1;
-		b1->m_angularVelocity += b1->m_invI * b2Cross(r1, P1);
-		b2->m_linearVelocity += b2->m_invMass * P2;
-		b2->m_angularVelocity += b2->m_invI * b2Cross(r2, P2);
+		if (b1->GetType() == b2_dynamicBody)
+		{
+			b1->m_linearVelocity += b1->m_invMass * P1;
+			b1->m_angularVelocity += b1->m_invI * b2Cross(r1, P1);
+		}
+		if (b2->GetType() == b2_dynamicBody)
+		{
+			b2->m_linearVelocity += b2->m_invMass * P2;
+			b2->m_angularVelocity += b2->m_invI * b2Cross(r2, P2);
+		}
 	}
 
 	if (m_limitState1 == e_atUpperLimit)
@@ -229,8 +241,11 @@ void b2PulleyJoint::SolveVelocityConstraints(const b2TimeStep& step)
 		impulse = m_limitImpulse1 - oldImpulse;
 
 		b2Vec2 P1 = -impulse * m_u1;
-		b1->m_linearVelocity += b1->m_invMass * P1;
-		b1->m_angularVelocity += b1->m_invI * b2Cross(r1, P1);
+		if (b1->GetType() == b2_dynamicBody)
+		{
+			b1->m_linearVelocity += b1->m_invMass * P1;
+			b1->m_angularVelocity += b1->m_invI * b2Cross(r1, P1);
+		}
 	}
 
 	if (m_limitState2 == e_atUpperLimit)
@@ -244,8 +259,11 @@ void b2PulleyJoint::SolveVelocityConstraints(const b2TimeStep& step)
 		impulse = m_limitImpulse2 - oldImpulse;
 
 		b2Vec2 P2 = -impulse * m_u2;
-		b2->m_linearVelocity += b2->m_invMass * P2;
-		b2->m_angularVelocity += b2->m_invI * b2Cross(r2, P2);
+		if (b2->GetType() == b2_dynamicBody)
+		{
+			b2->m_linearVelocity += b2->m_invMass * P2;
+			b2->m_angularVelocity += b2->m_invI * b2Cross(r2, P2);
+		}
 	}
 }
 
@@ -303,13 +321,18 @@ bool b2PulleyJoint::SolvePositionConstraints(float32 baumgarte)
 		b2Vec2 P1 = -impulse * m_u1;
 		b2Vec2 P2 = -m_ratio * impulse * m_u2;
 
-		b1->m_sweep.c += b1->m_invMass * P1;
-		b1->m_sweep.a += b1->m_invI * b2Cross(r1, P1);
-		b2->m_sweep.c += b2->m_invMass * P2;
-		b2->m_sweep.a += b2->m_invI * b2Cross(r2, P2);
-
-		b1->SynchronizeTransform();
-		b2->SynchronizeTransform();
+		if (b1->GetType() == b2_dynamicBody)
+		{
+			b1->m_sweep.c += b1->m_invMass * P1;
+			b1->m_sweep.a += b1->m_invI * b2Cross(r1, P1);
+			b1->SynchronizeTransform();
+		}
+		if (b2->GetType() == b2_dynamicBody)
+		{
+			b2->m_sweep.c += b2->m_invMass * P2;
+			b2->m_sweep.a += b2->m_invI * b2Cross(r2, P2);
+			b2->SynchronizeTransform();
+		}
 	}
 
 	if (m_limitState1 == e_atUpperLimit)
@@ -335,10 +358,12 @@ bool b2PulleyJoint::SolvePositionConstraints(float32 baumgarte)
 		float32 impulse = -m_limitMass1 * C;
 
 		b2Vec2 P1 = -impulse * m_u1;
-		b1->m_sweep.c += b1->m_invMass * P1;
-		b1->m_sweep.a += b1->m_invI * b2Cross(r1, P1);
-
-		b1->SynchronizeTransform();
+		if (b1->GetType() == b2_dynamicBody)
+		{
+			b1->m_sweep.c += b1->m_invMass * P1;
+			b1->m_sweep.a += b1->m_invI * b2Cross(r1, P1);
+			b1->SynchronizeTransform();
+		}
 	}
 
 	if (m_limitState2 == e_atUpperLimit)
@@ -364,10 +389,12 @@ bool b2PulleyJoint::SolvePositionConstraints(float32 baumgarte)
 		float32 impulse = -m_limitMass2 * C;
 
 		b2Vec2 P2 = -impulse * m_u2;
-		b2->m_sweep.c += b2->m_invMass * P2;
-		b2->m_sweep.a += b2->m_invI * b2Cross(r2, P2);
-
-		b2->SynchronizeTransform();
+		if (b2->GetType() == b2_dynamicBody)
+		{
+			b2->m_sweep.c += b2->m_invMass * P2;
+			b2->m_sweep.a += b2->m_invI * b2Cross(r2, P2);
+			b2->SynchronizeTransform();
+		}
 	}
 
 	return linearError < b2_linearSlop;
@@ -152,11 +152,17 @@ void b2RevoluteJoint::InitVelocityConstraints(const b2TimeStep& step)
 
 		b2Vec2 P(m_impulse.x, m_impulse.y);
 
-		b1->m_linearVelocity -= m1 * P;
-		b1->m_angularVelocity -= i1 * (b2Cross(r1, P) + m_motorImpulse + m_impulse.z);
+		if (b1->GetType() == b2_dynamicBody)
+		{
+			b1->m_linearVelocity -= m1 * P;
+			b1->m_angularVelocity -= i1 * (b2Cross(r1, P) + m_motorImpulse + m_impulse.z);
+		}
 
-		b2->m_linearVelocity += m2 * P;
-		b2->m_angularVelocity += i2 * (b2Cross(r2, P) + m_motorImpulse + m_impulse.z);
+		if (b2->GetType() == b2_dynamicBody)
+		{
+			b2->m_linearVelocity += m2 * P;
+			b2->m_angularVelocity += i2 * (b2Cross(r2, P) + m_motorImpulse + m_impulse.z);
+		}
 	}
 	else
 	{
@@ -265,10 +271,16 @@ void b2RevoluteJoint::SolveVelocityConstraints(const b2TimeStep& step)
 		w2 += i2 * b2Cross(r2, impulse);
 	}
 
-	b1->m_linearVelocity = v1;
-	b1->m_angularVelocity = w1;
-	b2->m_linearVelocity = v2;
-	b2->m_angularVelocity = w2;
+	if (b1->GetType() == b2_dynamicBody)
+	{
+		b1->m_linearVelocity = v1;
+		b1->m_angularVelocity = w1;
+	}
+	if (b2->GetType() == b2_dynamicBody)
+	{
+		b2->m_linearVelocity = v2;
+		b2->m_angularVelocity = w2;
+	}
 }
 
 bool b2RevoluteJoint::SolvePositionConstraints(float32 baumgarte)
@@ -315,11 +327,16 @@ bool b2RevoluteJoint::SolvePositionConstraints(float32 baumgarte)
 			limitImpulse = -m_motorMass * C;
 		}
 
-		b1->m_sweep.a -= b1->m_invI * limitImpulse;
-		b2->m_sweep.a += b2->m_invI * limitImpulse;
-
-		b1->SynchronizeTransform();
-		b2->SynchronizeTransform();
+		if (b1->GetType() == b2_dynamicBody)
+		{
+			b1->m_sweep.a -= b1->m_invI * limitImpulse;
+			b1->SynchronizeTransform();
+		}
+		if (b2->GetType() == b2_dynamicBody)
+		{
+			b2->m_sweep.a += b2->m_invI * limitImpulse;
+			b2->SynchronizeTransform();
+		}
 	}
 
 	// Solve point-to-point constraint.
@@ -346,8 +363,14 @@ bool b2RevoluteJoint::SolvePositionConstraints(float32 baumgarte)
 			}
 			b2Vec2 impulse = m * (-C);
 			const float32 k_beta = 0.5f;
-			b1->m_sweep.c -= k_beta * invMass1 * impulse;
-			b2->m_sweep.c += k_beta * invMass2 * impulse;
+			if (b1->GetType() == b2_dynamicBody)
+			{
+				b1->m_sweep.c -= k_beta * invMass1 * impulse;
+			}
+			if (b2->GetType() == b2_dynamicBody)
+			{
+				b2->m_sweep.c += k_beta * invMass2 * impulse;
+			}
 
 			C = b2->m_sweep.c + r2 - b1->m_sweep.c - r1;
 		}
@@ -367,14 +390,19 @@ bool b2RevoluteJoint::SolvePositionConstraints(float32 baumgarte)
 		b2Mat22 K = K1 + K2 + K3;
 		b2Vec2 impulse = K.Solve(-C);
 
-		b1->m_sweep.c -= b1->m_invMass * impulse;
-		b1->m_sweep.a -= b1->m_invI * b2Cross(r1, impulse);
-
-		b2->m_sweep.c += b2->m_invMass * impulse;
-		b2->m_sweep.a += b2->m_invI * b2Cross(r2, impulse);
+		if (b1->GetType() == b2_dynamicBody)
+		{
+			b1->m_sweep.c -= b1->m_invMass * impulse;
+			b1->m_sweep.a -= b1->m_invI * b2Cross(r1, impulse);
+			b1->SynchronizeTransform();
+		}
 
-		b1->SynchronizeTransform();
-		b2->SynchronizeTransform();
+		if (b2->GetType() == b2_dynamicBody)
+		{
+			b2->m_sweep.c += b2->m_invMass * impulse;
+			b2->m_sweep.a += b2->m_invI * b2Cross(r2, impulse);
+			b2->SynchronizeTransform();
+		}
 	}
 	
 	return positionError <= b2_linearSlop && angularError <= b2_angularSlop;
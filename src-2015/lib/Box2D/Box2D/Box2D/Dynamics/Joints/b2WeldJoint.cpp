@@ -91,11 +91,17 @@ void b2WeldJoint::InitVelocityConstraints(const b2TimeStep& step)
 
 		b2Vec2 P(m_impulse.x, m_impulse.y);
 
-		bA->m_linearVelocity -= mA * P;
-		bA->m_angularVelocity -= iA * (b2Cross(rA, P) + m_impulse.z);
-
-		bB->m_linearVelocity += mB * P;
-		bB->m_angularVelocity += iB * (b2Cross(rB, P) + m_impulse.z);
+		if (bA->GetType() == b2_dynamicBody)
+		{
+			bA->m_linearVelocity -= mA * P;
+			bA->m_angularVelocity -= iA * (b2Cross(rA, P) + m_impulse.z);
+		}
+
+		if (bB->GetType() == b2_dynamicBody)
+		{
+			bB->m_linearVelocity += mB * P;
+			bB->m_angularVelocity += iB * (b2Cross(rB, P) + m_impulse.z);
+		}
 	}
 	else
 	{
@@ -137,10 +143,16 @@ void b2WeldJoint::SolveVelocityConstraints(const b2TimeStep& step)
 	vB += mB * P;
 	wB += iB * (b2Cross(rB, P) + impulse.z);
 
-	bA->m_linearVelocity = vA;
-	bA->m_angularVelocity = wA;
-	bB->m_linearVelocity = vB;
-	bB->m_angularVelocity = wB;
+	if (bA->GetType() == b2_dynamicBody)
+	{
+		bA->m_linearVelocity = vA;
+		bA->m_angularVelocity = wA;
+	}
+	if (bB->GetType() == b2_dynamicBody)
+	{
+		bB->m_linearVelocity = vB;
+		bB->m_angularVelocity = wB;
+	}
 }
 
 bool b2WeldJoint::SolvePositionConstraints(float32 baumgarte)
@@ -185,14 +197,19 @@ bool b2WeldJoint::SolvePositionConstraints(float32 baumgarte)
 
 	b2Vec2 P(impulse.x, impulse.y);
 
-	bA->m_sweep.c -= mA * P;
-	bA->m_sweep.a -= iA * (b2Cross(rA, P) + impulse.z);
-
-	bB->m_sweep.c += mB * P;
-	bB->m_sweep.a += iB * (b2Cross(rB, P) + impulse.z);
+	if (bA->GetType() == b2_dynamicBody)
+	{
+		bA->m_sweep.c -= mA * P;
+		bA->m_sweep.a -= iA * (b2Cross(rA, P) + impulse.z);
+		bA->SynchronizeTransform();
+	}
 
-	bA->SynchronizeTransform();
-	bB->SynchronizeTransform();
+	if (bB->GetType() == b2_dynamicBody)
+	{
+		bB->m_sweep.c += mB * P;
+		bB->m_sweep.a += iB * (b2Cross(rB, P) + impulse.z);
+		bB->SynchronizeTransform();
+	}
 
 	return positionError <= b2_linearSlop && angularError <= b2_angularSlop;
 }
@@ -437,11 +437,44 @@ void b2Body::SetActive(bool flag)
 	{
 		m_flags |= e_activeFlag;
 
-		// Create all proxies.
+		// Create all proxies. Many fixtures (e.g. the tiles of a level) are
+		// created in bulk, the tree is rebuilt once rather than grown one by one.
+		const int32 k_bulkProxyCount = 16;
 		b2BroadPhase* broadPhase = &m_world->m_contactManager.m_broadPhase;
-		for (b2Fixture* f = m_fixtureList; f; f = f->m_next)
+		if (m_fixtureCount >= k_bulkProxyCount)
 		{
-			f->CreateProxy(broadPhase, m_xf);
+			b2AABB* aabbs = (b2AABB*)b2Alloc(m_fixtureCount * sizeof(b2AABB));
+			void** userData = (void**)b2Alloc(m_fixtureCount * sizeof(void*));
+			int32* proxyIds = (int32*)b2Alloc(m_fixtureCount * sizeof(int32));
+
+			int32 count = 0;
+			for (b2Fixture* f = m_fixtureList; f; f = f->m_next)
+			{
+				b2Assert(f->m_proxyId == b2BroadPhase::e_nullProxy);
+				f->m_shape->ComputeAABB(&f->m_aabb, m_xf);
+				aabbs[count] = f->m_aabb;
+				userData[count] = f;
+				++count;
+			}
+
+			broadPhase->CreateProxies(aabbs, userData, count, proxyIds);
+
+			count = 0;
+			for (b2Fixture* f = m_fixtureList; f; f = f->m_next)
+			{
+				f->m_proxyId = proxyIds[count++];
+			}
+
+			b2Free(proxyIds);
+			b2Free(userData);
+			b2Free(aabbs);
+		}
+		else
+		{
+			for (b2Fixture* f = m_fixtureList; f; f = f->m_next)
+			{
+				f->CreateProxy(broadPhase, m_xf);
+			}
 		}
 
 		// Contacts are created the next time step.
@@ -368,6 +368,7 @@ private:
 	friend class b2Island;
 	friend class b2ContactManager;
 	friend class b2ContactSolver;
+	friend class b2SimdContactSolver;
 	friend class b2TOISolver;
 	
 	friend class b2DistanceJoint;
@@ -19,6 +19,7 @@
 #include <Box2D/Dynamics/b2Fixture.h>
 #include <Box2D/Dynamics/Contacts/b2Contact.h>
 #include <Box2D/Collision/Shapes/b2CircleShape.h>
+#include <Box2D/Collision/Shapes/b2GridShape.h>
 #include <Box2D/Collision/Shapes/b2PolygonShape.h>
 #include <Box2D/Collision/b2BroadPhase.h>
 #include <Box2D/Collision/b2Collision.h>
@@ -83,6 +84,14 @@ void b2Fixture::Destroy(b2BlockAllocator* allocator)
 		}
 		break;
 
+	case b2Shape::e_grid:
+		{
+			b2GridShape* s = (b2GridShape*)m_shape;
+			s->~b2GridShape();
+			allocator->Free(s, sizeof(b2GridShape));
+		}
+		break;
+
 	default:
 		b2Assert(false);
 		break;
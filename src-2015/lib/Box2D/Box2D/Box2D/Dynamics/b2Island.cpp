@@ -22,6 +22,7 @@
 #include <Box2D/Dynamics/b2World.h>
 #include <Box2D/Dynamics/Contacts/b2Contact.h>
 #include <Box2D/Dynamics/Contacts/b2ContactSolver.h>
+#include <Box2D/Dynamics/Contacts/b2SimdContactSolver.h>
 #include <Box2D/Dynamics/Joints/b2Joint.h>
 #include <Box2D/Common/b2StackAllocator.h>
 
@@ -159,6 +160,8 @@ b2Island::b2Island(
 
 	m_allocator = allocator;
 	m_listener = listener;
+	m_reports = NULL;
+	m_asleep = false;
 
 	m_bodies = (b2Body**)m_allocator->Allocate(bodyCapacity * sizeof(b2Body*));
 	m_contacts = (b2Contact**)m_allocator->Allocate(contactCapacity	 * sizeof(b2Contact*));
@@ -223,21 +226,28 @@ void b2Island::Solve(const b2TimeStep& step, const b2Vec2& gravity, bool allowSl
 
 	// Initialize velocity constraints.
 	b2ContactSolver contactSolver(m_contacts, m_contactCount, m_allocator, step.dtRatio);
-	contactSolver.WarmStart();
-	for (int32 i = 0; i < m_jointCount; ++i)
+	if (step.simdContacts)
 	{
-		m_joints[i]->InitVelocityConstraints(step);
+		SolveVelocitiesSimd(step, &contactSolver);
 	}
-
-	// Solve velocity constraints.
-	for (int32 i = 0; i < step.velocityIterations; ++i)
+	else
 	{
-		for (int32 j = 0; j < m_jointCount; ++j)
+		contactSolver.WarmStart();
+		for (int32 i = 0; i < m_jointCount; ++i)
 		{
-			m_joints[j]->SolveVelocityConstraints(step);
+			m_joints[i]->InitVelocityConstraints(step);
 		}
 
-		contactSolver.SolveVelocityConstraints();
+		// Solve velocity constraints.
+		for (int32 i = 0; i < step.velocityIterations; ++i)
+		{
+			for (int32 j = 0; j < m_jointCount; ++j)
+			{
+				m_joints[j]->SolveVelocityConstraints(step);
+			}
+
+			contactSolver.SolveVelocityConstraints();
+		}
 	}
 
 	// Post-solve (store impulses for warm starting).
@@ -338,37 +348,93 @@ void b2Island::Solve(const b2TimeStep& step, const b2Vec2& gravity, bool allowSl
 			}
 		}
 
-		if (minSleepTime >= b2_timeToSleep)
+		m_asleep = minSleepTime >= b2_timeToSleep;
+		if (m_asleep)
 		{
 			for (int32 i = 0; i < m_bodyCount; ++i)
 			{
 				b2Body* b = m_bodies[i];
+				if (m_reports != NULL && b->GetType() == b2_staticBody)
+				{
+					continue;
+				}
 				b->SetAwake(false);
 			}
 		}
 	}
 }
 
+void b2Island::SolveVelocitiesSimd(const b2TimeStep& step, b2ContactSolver* contactSolver)
+{
+	b2SimdContactSolver simdSolver(contactSolver, m_bodies, m_bodyCount, m_allocator);
+	simdSolver.WarmStart();
+	simdSolver.StoreVelocities();
+	for (int32 i = 0; i < m_jointCount; ++i)
+	{
+		m_joints[i]->InitVelocityConstraints(step);
+	}
+
+	// The joints work on the bodies, the contacts on the copy of the solver.
+	for (int32 i = 0; i < step.velocityIterations; ++i)
+	{
+		if (m_jointCount > 0)
+		{
+			for (int32 j = 0; j < m_jointCount; ++j)
+			{
+				m_joints[j]->SolveVelocityConstraints(step);
+			}
+			simdSolver.LoadVelocities();
+		}
+
+		simdSolver.SolveVelocityConstraints();
+
+		if (m_jointCount > 0)
+		{
+			simdSolver.StoreVelocities();
+		}
+	}
+
+	simdSolver.StoreVelocities();
+	simdSolver.StoreImpulses();
+}
+
 void b2Island::Report(const b2ContactConstraint* constraints)
 {
-	if (m_listener == NULL)
+	if (m_listener == NULL && m_reports == NULL)
 	{
 		return;
 	}
 
+	// The constraints of a contact follow each other, one per manifold. The
+	// impulses reported are those of the first, see b2Contact::GetManifold.
+	const b2ContactConstraint* cc = constraints;
 	for (int32 i = 0; i < m_contactCount; ++i)
 	{
 		b2Contact* c = m_contacts[i];
-
-		const b2ContactConstraint* cc = constraints + i;
 		
+		// A constraint may have dropped its second point when the block solver
+		// found it redundant, the manifold still has it with no impulse.
 		b2ContactImpulse impulse;
+		for (int32 j = 0; j < b2_maxManifoldPoints; ++j)
+		{
+			impulse.normalImpulses[j] = 0.0f;
+			impulse.tangentImpulses[j] = 0.0f;
+		}
 		for (int32 j = 0; j < cc->pointCount; ++j)
 		{
 			impulse.normalImpulses[j] = cc->points[j].normalImpulse;
 			impulse.tangentImpulses[j] = cc->points[j].tangentImpulse;
 		}
+		cc += c->GetManifoldCount();
 
-		m_listener->PostSolve(c, &impulse);
+		if (m_reports != NULL)
+		{
+			m_reports[i].contact = c;
+			m_reports[i].impulse = impulse;
+		}
+		else
+		{
+			m_listener->PostSolve(c, &impulse);
+		}
 	}
 }
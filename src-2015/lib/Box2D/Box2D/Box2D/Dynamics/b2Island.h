@@ -22,12 +22,14 @@
 #include <Box2D/Common/b2Math.h>
 #include <Box2D/Dynamics/b2Body.h>
 #include <Box2D/Dynamics/b2TimeStep.h>
+#include <Box2D/Dynamics/b2WorldCallbacks.h>
 
 class b2Contact;
 class b2Joint;
 class b2StackAllocator;
 class b2ContactListener;
 struct b2ContactConstraint;
+class b2ContactSolver;
 
 /// This is an internal structure.
 struct b2Position
@@ -43,6 +45,14 @@ struct b2Velocity
 	float32 w;
 };
 
+/// This is an internal structure. A post-solve report, stored when the
+/// islands are solved in parallel and replayed in island order.
+struct b2ContactReport
+{
+	b2Contact* contact;
+	b2ContactImpulse impulse;
+};
+
 /// This is an internal class.
 class b2Island
 {
@@ -56,6 +66,7 @@ public:
 		m_bodyCount = 0;
 		m_contactCount = 0;
 		m_jointCount = 0;
+		m_asleep = false;
 	}
 
 	void Solve(const b2TimeStep& step, const b2Vec2& gravity, bool allowSleep);
@@ -79,11 +90,22 @@ public:
 		m_joints[m_jointCount++] = joint;
 	}
 
+	/// Velocity iterations with the batched contact solver, see b2World::SetSimdContacts.
+	void SolveVelocitiesSimd(const b2TimeStep& step, b2ContactSolver* contactSolver);
+
 	void Report(const b2ContactConstraint* constraints);
 
 	b2StackAllocator* m_allocator;
 	b2ContactListener* m_listener;
 
+	// When set, the island is solved on a worker: the reports are stored here
+	// instead of calling the listener, and static bodies (shared with other
+	// islands) are not put to sleep, see m_asleep.
+	b2ContactReport* m_reports;
+
+	// Whether the last Solve put the island to sleep.
+	bool m_asleep;
+
 	b2Body** m_bodies;
 	b2Contact** m_contacts;
 	b2Joint** m_joints;
@@ -27,9 +27,13 @@
 #include <Box2D/Collision/b2Collision.h>
 #include <Box2D/Collision/b2BroadPhase.h>
 #include <Box2D/Collision/Shapes/b2CircleShape.h>
+#include <Box2D/Collision/Shapes/b2GridShape.h>
 #include <Box2D/Collision/Shapes/b2PolygonShape.h>
 #include <Box2D/Collision/b2TimeOfImpact.h>
+#include <Box2D/Common/b2WorkerPool.h>
 #include <new>
+#include <cstring>
+#include <algorithm>
 
 b2World::b2World(const b2Vec2& gravity, bool doSleep)
 {
@@ -44,6 +48,7 @@ b2World::b2World(const b2Vec2& gravity, bool doSleep)
 
 	m_warmStarting = true;
 	m_continuousPhysics = true;
+	m_simdContacts = false;
 
 	m_allowSleep = doSleep;
 	m_gravity = gravity;
@@ -52,11 +57,36 @@ b2World::b2World(const b2Vec2& gravity, bool doSleep)
 
 	m_inv_dt0 = 0.0f;
 
+	m_workerPool = NULL;
+
 	m_contactManager.m_allocator = &m_blockAllocator;
 }
 
 b2World::~b2World()
 {
+	delete m_workerPool;
+}
+
+void b2World::SetSolverThreadCount(int32 count)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return;
+	}
+
+	delete m_workerPool;
+	m_workerPool = NULL;
+	if (count > 1)
+	{
+		m_workerPool = new b2WorkerPool(count);
+	}
+	m_contactManager.m_broadPhase.SetWorkerPool(m_workerPool);
+}
+
+int32 b2World::GetSolverThreadCount() const
+{
+	return m_workerPool != NULL ? m_workerPool->GetWorkerCount() : 1;
 }
 
 void b2World::SetDestructionListener(b2DestructionListener* listener)
@@ -334,9 +364,114 @@ void b2World::DestroyJoint(b2Joint* j)
 	}
 }
 
+// Add the island of a seed body: depth first search (DFS) on the constraint graph.
+void b2World::AddIsland(b2Island* island, b2Body* seed, b2Body** stack, int32 stackSize)
+{
+	B2_NOT_USED(stackSize);
+
+	int32 stackCount = 0;
+	stack[stackCount++] = seed;
+	seed->m_flags |= b2Body::e_islandFlag;
+
+	while (stackCount > 0)
+	{
+		// Grab the next body off the stack and add it to the island.
+		b2Body* b = stack[--stackCount];
+		b2Assert(b->IsActive() == true);
+		island->Add(b);
+
+		// Make sure the body is awake.
+		b->SetAwake(true);
+
+		// To keep islands as small as possible, we don't
+		// propagate islands across static bodies.
+		if (b->GetType() == b2_staticBody)
+		{
+			continue;
+		}
+
+		// Search all contacts connected to this body.
+		for (b2ContactEdge* ce = b->m_contactList; ce; ce = ce->next)
+		{
+			b2Contact* contact = ce->contact;
+
+			// Has this contact already been added to an island?
+			if (contact->m_flags & b2Contact::e_islandFlag)
+			{
+				continue;
+			}
+
+			// Is this contact solid and touching?
+			if (contact->IsEnabled() == false ||
+				contact->IsTouching() == false)
+			{
+				continue;
+			}
+
+			// Skip sensors.
+			bool sensorA = contact->m_fixtureA->m_isSensor;
+			bool sensorB = contact->m_fixtureB->m_isSensor;
+			if (sensorA || sensorB)
+			{
+				continue;
+			}
+
+			island->Add(contact);
+			contact->m_flags |= b2Contact::e_islandFlag;
+
+			b2Body* other = ce->other;
+
+			// Was the other body already added to this island?
+			if (other->m_flags & b2Body::e_islandFlag)
+			{
+				continue;
+			}
+
+			b2Assert(stackCount < stackSize);
+			stack[stackCount++] = other;
+			other->m_flags |= b2Body::e_islandFlag;
+		}
+
+		// Search all joints connect to this body.
+		for (b2JointEdge* je = b->m_jointList; je; je = je->next)
+		{
+			if (je->joint->m_islandFlag == true)
+			{
+				continue;
+			}
+
+			b2Body* other = je->other;
+
+			// Don't simulate joints connected to inactive bodies.
+			if (other->IsActive() == false)
+			{
+				continue;
+			}
+
+			island->Add(je->joint);
+			je->joint->m_islandFlag = true;
+
+			if (other->m_flags & b2Body::e_islandFlag)
+			{
+				continue;
+			}
+
+			b2Assert(stackCount < stackSize);
+			stack[stackCount++] = other;
+			other->m_flags |= b2Body::e_islandFlag;
+		}
+	}
+}
+
 // Find islands, integrate and solve constraints, solve position constraints
 void b2World::Solve(const b2TimeStep& step)
 {
+	if (m_workerPool != NULL)
+	{
+		SolveParallel(step);
+		return;
+	}
+
 	// Size the island for the worst case.
 	b2Island island(m_bodyCount,
 					m_contactManager.m_contactCount,
@@ -379,119 +514,229 @@ void b2World::Solve(const b2TimeStep& step)
 			continue;
 		}
 
-		// Reset island and stack.
+		// Reset island and search it.
 		island.Clear();
-		int32 stackCount = 0;
-		stack[stackCount++] = seed;
-		seed->m_flags |= b2Body::e_islandFlag;
-
-		// Perform a depth first search (DFS) on the constraint graph.
-		while (stackCount > 0)
-		{
-			// Grab the next body off the stack and add it to the island.
-			b2Body* b = stack[--stackCount];
-			b2Assert(b->IsActive() == true);
-			island.Add(b);
+		AddIsland(&island, seed, stack, stackSize);
 
-			// Make sure the body is awake.
-			b->SetAwake(true);
+		island.Solve(step, m_gravity, m_allowSleep);
 
-			// To keep islands as small as possible, we don't
-			// propagate islands across static bodies.
+		// Post solve cleanup.
+		for (int32 i = 0; i < island.m_bodyCount; ++i)
+		{
+			// Allow static bodies to participate in other islands.
+			b2Body* b = island.m_bodies[i];
 			if (b->GetType() == b2_staticBody)
 			{
-				continue;
+				b->m_flags &= ~b2Body::e_islandFlag;
 			}
+		}
+	}
 
-			// Search all contacts connected to this body.
-			for (b2ContactEdge* ce = b->m_contactList; ce; ce = ce->next)
-			{
-				b2Contact* contact = ce->contact;
+	m_stackAllocator.Free(stack);
 
-				// Has this contact already been added to an island?
-				if (contact->m_flags & b2Contact::e_islandFlag)
-				{
-					continue;
-				}
+	SynchronizeFixtures();
+}
 
-				// Is this contact solid and touching?
-				if (contact->IsEnabled() == false ||
-					contact->IsTouching() == false)
-				{
-					continue;
-				}
+// This is an internal structure. The slices of an island in the
+// gathered arrays.
+struct b2IslandRange
+{
+	int32 bodyStart, bodyCount;
+	int32 contactStart, contactCount;
+	int32 jointStart, jointCount;
+	bool asleep;
+};
 
-				// Skip sensors.
-				bool sensorA = contact->m_fixtureA->m_isSensor;
-				bool sensorB = contact->m_fixtureB->m_isSensor;
-				if (sensorA || sensorB)
-				{
-					continue;
-				}
+// Solves the gathered islands, on any worker.
+class b2IslandTask : public b2WorkerTask
+{
+public:
+	void Execute(int32 item, int32 worker)
+	{
+		b2IslandRange* range = ranges + item;
+		b2Island island(range->bodyCount,
+						range->contactCount,
+						range->jointCount,
+						pool->GetAllocator(worker),
+						NULL);
+
+		// Copied rather than added: static bodies are shared between islands.
+		memcpy(island.m_bodies, all->m_bodies + range->bodyStart, range->bodyCount * sizeof(b2Body*));
+		memcpy(island.m_contacts, all->m_contacts + range->contactStart, range->contactCount * sizeof(b2Contact*));
+		memcpy(island.m_joints, all->m_joints + range->jointStart, range->jointCount * sizeof(b2Joint*));
+		island.m_bodyCount = range->bodyCount;
+		island.m_contactCount = range->contactCount;
+		island.m_jointCount = range->jointCount;
+		island.m_reports = reports + range->contactStart;
+
+		island.Solve(*step, gravity, allowSleep);
+
+		range->asleep = island.m_asleep;
+	}
+
+	const b2TimeStep* step;
+	b2Vec2 gravity;
+	bool allowSleep;
+	b2WorkerPool* pool;
+	const b2Island* all;
+	b2IslandRange* ranges;
+	b2ContactReport* reports;
+};
 
-				island.Add(contact);
-				contact->m_flags |= b2Contact::e_islandFlag;
+// Orders the islands from the most to the least expensive.
+struct b2IslandCostGreater
+{
+	bool operator()(int32 a, int32 b) const
+	{
+		int32 costA = ranges[a].bodyCount + ranges[a].contactCount + ranges[a].jointCount;
+		int32 costB = ranges[b].bodyCount + ranges[b].contactCount + ranges[b].jointCount;
+		return costA > costB || (costA == costB && a < b);
+	}
 
-				b2Body* other = ce->other;
+	const b2IslandRange* ranges;
+};
 
-				// Was the other body already added to this island?
-				if (other->m_flags & b2Body::e_islandFlag)
-				{
-					continue;
-				}
+// Same as Solve, in three passes: all the awake islands are found, then
+// solved by the workers, then the effects on shared state are applied in
+// island order, as the single threaded solver would have.
+void b2World::SolveParallel(const b2TimeStep& step)
+{
+	// Clear all the island flags.
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		b->m_flags &= ~b2Body::e_islandFlag;
+	}
+	for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
+	{
+		c->m_flags &= ~b2Contact::e_islandFlag;
+	}
+	for (b2Joint* j = m_jointList; j; j = j->m_next)
+	{
+		j->m_islandFlag = false;
+	}
 
-				b2Assert(stackCount < stackSize);
-				stack[stackCount++] = other;
-				other->m_flags |= b2Body::e_islandFlag;
-			}
+	// All the islands, one after the other. A static body appears in each
+	// island it touches, through a contact or a joint.
+	int32 contactCount = m_contactManager.m_contactCount;
+	b2Island all(m_bodyCount + contactCount + m_jointCount,
+				 contactCount,
+				 m_jointCount,
+				 &m_stackAllocator,
+				 NULL);
+	b2IslandRange* ranges = (b2IslandRange*)m_stackAllocator.Allocate(m_bodyCount * sizeof(b2IslandRange));
+	int32 rangeCount = 0;
 
-			// Search all joints connect to this body.
-			for (b2JointEdge* je = b->m_jointList; je; je = je->next)
-			{
-				if (je->joint->m_islandFlag == true)
-				{
-					continue;
-				}
+	int32 stackSize = m_bodyCount;
+	b2Body** stack = (b2Body**)m_stackAllocator.Allocate(stackSize * sizeof(b2Body*));
+	for (b2Body* seed = m_bodyList; seed; seed = seed->m_next)
+	{
+		if (seed->m_flags & b2Body::e_islandFlag)
+		{
+			continue;
+		}
 
-				b2Body* other = je->other;
+		if (seed->IsAwake() == false || seed->IsActive() == false)
+		{
+			continue;
+		}
 
-				// Don't simulate joints connected to inactive bodies.
-				if (other->IsActive() == false)
-				{
-					continue;
-				}
+		// The seed can be dynamic or kinematic.
+		if (seed->GetType() == b2_staticBody)
+		{
+			continue;
+		}
 
-				island.Add(je->joint);
-				je->joint->m_islandFlag = true;
+		b2IslandRange* range = ranges + rangeCount++;
+		range->bodyStart = all.m_bodyCount;
+		range->contactStart = all.m_contactCount;
+		range->jointStart = all.m_jointCount;
+		range->asleep = false;
 
-				if (other->m_flags & b2Body::e_islandFlag)
-				{
-					continue;
-				}
+		AddIsland(&all, seed, stack, stackSize);
 
-				b2Assert(stackCount < stackSize);
-				stack[stackCount++] = other;
-				other->m_flags |= b2Body::e_islandFlag;
+		range->bodyCount = all.m_bodyCount - range->bodyStart;
+		range->contactCount = all.m_contactCount - range->contactStart;
+		range->jointCount = all.m_jointCount - range->jointStart;
+
+		// Allow static bodies to participate in other islands.
+		for (int32 i = range->bodyStart; i < all.m_bodyCount; ++i)
+		{
+			b2Body* b = all.m_bodies[i];
+			if (b->GetType() == b2_staticBody)
+			{
+				b->m_flags &= ~b2Body::e_islandFlag;
 			}
 		}
+	}
 
-		island.Solve(step, m_gravity, m_allowSleep);
+	// Solve, the most expensive islands first.
+	b2ContactReport* reports = (b2ContactReport*)m_stackAllocator.Allocate(b2Max(all.m_contactCount, 1) * sizeof(b2ContactReport));
+	int32* order = (int32*)m_stackAllocator.Allocate(b2Max(rangeCount, 1) * sizeof(int32));
+	for (int32 i = 0; i < rangeCount; ++i)
+	{
+		order[i] = i;
+	}
+	b2IslandCostGreater greater;
+	greater.ranges = ranges;
+	std::sort(order, order + rangeCount, greater);
+
+	b2IslandTask task;
+	task.step = &step;
+	task.gravity = m_gravity;
+	task.allowSleep = m_allowSleep;
+	task.pool = m_workerPool;
+	task.all = &all;
+	task.ranges = ranges;
+	task.reports = reports;
+	if (rangeCount > 1)
+	{
+		m_workerPool->Run(&task, order, rangeCount);
+	}
+	else if (rangeCount == 1)
+	{
+		task.Execute(0, 0);
+	}
 
-		// Post solve cleanup.
-		for (int32 i = 0; i < island.m_bodyCount; ++i)
+	// Static bodies are woken up by each island touching them and put back
+	// to sleep with the islands falling asleep: the last island decides.
+	b2ContactListener* listener = m_contactManager.m_contactListener;
+	for (int32 i = 0; i < rangeCount; ++i)
+	{
+		const b2IslandRange* range = ranges + i;
+		for (int32 j = range->bodyStart; j < range->bodyStart + range->bodyCount; ++j)
 		{
-			// Allow static bodies to participate in other islands.
-			b2Body* b = island.m_bodies[i];
+			b2Body* b = all.m_bodies[j];
 			if (b->GetType() == b2_staticBody)
 			{
-				b->m_flags &= ~b2Body::e_islandFlag;
+				b->SetAwake(true);
+				if (range->asleep)
+				{
+					b->SetAwake(false);
+				}
+			}
+		}
+
+		if (listener != NULL)
+		{
+			for (int32 j = range->contactStart; j < range->contactStart + range->contactCount; ++j)
+			{
+				listener->PostSolve(reports[j].contact, &reports[j].impulse);
 			}
 		}
 	}
 
+	m_stackAllocator.Free(order);
+	m_stackAllocator.Free(reports);
 	m_stackAllocator.Free(stack);
+	m_stackAllocator.Free(ranges);
+	// The gathering island is freed last, by its destructor.
 
-	// Synchronize fixtures, check for out of range bodies.
+	SynchronizeFixtures();
+}
+
+// Synchronize fixtures, check for out of range bodies.
+void b2World::SynchronizeFixtures()
+{
 	for (b2Body* b = m_bodyList; b; b = b->GetNext())
 	{
 		// If a body was not in an island then it did not move.
@@ -590,15 +835,23 @@ void b2World::SolveTOI(b2Body* body)
 			b2Body* bodyB = fixtureB->m_body;
 
 			// Compute the time of impact in interval [0, minTOI]
-			b2TOIInput input;
-			input.proxyA.Set(fixtureA->GetShape());
-			input.proxyB.Set(fixtureB->GetShape());
-			input.sweepA = bodyA->m_sweep;
-			input.sweepB = bodyB->m_sweep;
-			input.tMax = toi;
-
 			b2TOIOutput output;
-			b2TimeOfImpact(&output, &input);
+			if (fixtureA->GetType() == b2Shape::e_grid)
+			{
+				b2GridShape* grid = (b2GridShape*)fixtureA->GetShape();
+				grid->TimeOfImpact(&output, bodyA->m_sweep, fixtureB->GetShape(), bodyB->m_sweep, toi);
+			}
+			else
+			{
+				b2TOIInput input;
+				input.proxyA.Set(fixtureA->GetShape());
+				input.proxyB.Set(fixtureB->GetShape());
+				input.sweepA = bodyA->m_sweep;
+				input.sweepB = bodyB->m_sweep;
+				input.tMax = toi;
+
+				b2TimeOfImpact(&output, &input);
+			}
 
 			if (output.state == b2TOIOutput::e_touching && output.t < toi)
 			{
@@ -802,6 +1055,7 @@ void b2World::Step(float32 dt, int32 velocityIterations, int32 positionIteration
 	step.dtRatio = m_inv_dt0 * dt;
 
 	step.warmStarting = m_warmStarting;
+	step.simdContacts = m_simdContacts;
 
 	// Update contacts. This is where some contacts are destroyed.
 	m_contactManager.Collide();
@@ -895,6 +1149,19 @@ void b2World::RayCast(b2RayCastCallback* callback, const b2Vec2& point1, const b
 	m_contactManager.m_broadPhase.RayCast(&wrapper, input);
 }
 
+// Draws the faces of a grid.
+struct b2WorldGridDrawWrapper
+{
+	void ReportFace(const b2GridFace& face)
+	{
+		debugDraw->DrawSegment(b2Mul(xf, face.vertex1), b2Mul(xf, face.vertex2), color);
+	}
+
+	b2DebugDraw* debugDraw;
+	b2Transform xf;
+	b2Color color;
+};
+
 void b2World::DrawShape(b2Fixture* fixture, const b2Transform& xf, const b2Color& color)
 {
 	switch (fixture->GetType())
@@ -926,6 +1193,22 @@ void b2World::DrawShape(b2Fixture* fixture, const b2Transform& xf, const b2Color
 			m_debugDraw->DrawSolidPolygon(vertices, vertexCount, color);
 		}
 		break;
+
+	case b2Shape::e_grid:
+		{
+			b2GridShape* grid = (b2GridShape*)fixture->GetShape();
+
+			b2AABB aabb;
+			aabb.lowerBound.SetZero();
+			aabb.upperBound.Set(grid->m_columnCount * grid->m_cellSize.x, grid->m_rowCount * grid->m_cellSize.y);
+
+			b2WorldGridDrawWrapper wrapper;
+			wrapper.debugDraw = m_debugDraw;
+			wrapper.xf = xf;
+			wrapper.color = color;
+			grid->QueryFaces(&wrapper, aabb);
+		}
+		break;
 	}
 }
 
@@ -1074,3 +1357,18 @@ int32 b2World::GetProxyCount() const
 {
 	return m_contactManager.m_broadPhase.GetProxyCount();
 }
+
+int32 b2World::GetTreeHeight() const
+{
+	return m_contactManager.m_broadPhase.ComputeHeight();
+}
+
+float32 b2World::GetTreeAreaRatio() const
+{
+	return m_contactManager.m_broadPhase.GetAreaRatio();
+}
+
+void b2World::SetTreeRebuildThreshold(float32 growth)
+{
+	m_contactManager.m_broadPhase.SetRebuildThreshold(growth);
+}
@@ -32,6 +32,8 @@ struct b2TimeStep;
 class b2Body;
 class b2Fixture;
 class b2Joint;
+class b2Island;
+class b2WorkerPool;
 
 /// The world class manages all physics entities, dynamic simulation,
 /// and asynchronous queries. The world also contains efficient memory
@@ -139,9 +141,39 @@ public:
 	/// Enable/disable continuous physics. For testing.
 	void SetContinuousPhysics(bool flag) { m_continuousPhysics = flag; }
 
+	/// Solve the islands on a pool of threads, the calling thread included.
+	/// The results do not depend on the count: the post-solve callbacks are
+	/// deferred and called in the order of the single threaded solver.
+	/// The broad-phase queries for new pairs run on the same threads.
+	/// The default, 1, solves the islands in turn on the calling thread.
+	/// @warning This function is locked during callbacks.
+	void SetSolverThreadCount(int32 count);
+
+	/// Get the number of threads solving the islands.
+	int32 GetSolverThreadCount() const;
+
+	/// Solve the contacts four at a time with SIMD instructions. The contacts
+	/// are solved in a different order, so the results differ slightly from
+	/// the default solver. Off by default.
+	void SetSimdContacts(bool flag) { m_simdContacts = flag; }
+
+	/// Are the contacts solved with SIMD instructions?
+	bool GetSimdContacts() const { return m_simdContacts; }
+
 	/// Get the number of broad-phase proxies.
 	int32 GetProxyCount() const;
 
+	/// Get the height of the broad-phase tree.
+	int32 GetTreeHeight() const;
+
+	/// Get the area ratio of the broad-phase tree, the cost of its queries.
+	float32 GetTreeAreaRatio() const;
+
+	/// Rebuild the broad-phase tree in the background when its area ratio
+	/// grows past growth times its value after the last rebuild, see
+	/// b2BroadPhase::SetRebuildThreshold. 0, the default, never rebuilds.
+	void SetTreeRebuildThreshold(float32 growth);
+
 	/// Get the number of bodies.
 	int32 GetBodyCount() const;
 
@@ -183,6 +215,9 @@ private:
 	friend class b2Controller;
 
 	void Solve(const b2TimeStep& step);
+	void SolveParallel(const b2TimeStep& step);
+	void AddIsland(b2Island* island, b2Body* seed, b2Body** stack, int32 stackSize);
+	void SynchronizeFixtures();
 	void SolveTOI();
 	void SolveTOI(b2Body* body);
 
@@ -219,6 +254,12 @@ private:
 
 	// This is for debugging the solver.
 	bool m_continuousPhysics;
+
+	// Solves the contacts with b2SimdContactSolver.
+	bool m_simdContacts;
+
+	// Solves the islands in parallel, NULL when single threaded.
+	b2WorkerPool* m_workerPool;
 };
 
 inline b2Body* b2World::GetBodyList()
@@ -4,8 +4,10 @@
 #include "drawimage.h"
 #include "script.h"
 #include "background.h"
+#include "stream.h"
 
 const time_t c_ScreenDeletionDelay=10000;
+const int    c_PrefetchUploadsPerFrame=1;
 // ------------------------------------------------------------------
 
 Background *background_init(int screenw,int screenh)
@@ -13,11 +15,29 @@ Background *background_init(int screenw,int screenh)
   Background *bkg = new Background;
   bkg->screenw = screenw;
   bkg->screenh = screenh;
+  bkg->lastViewpos = v2i(screenw / 2, 0);
+  // screens are decoded in the background
+  stream_init();
   return bkg;
 }
 
 // ------------------------------------------------------------------
 
+static string background_screen_name(v2i cell)
+{
+  return sourcePath() + "/src/spriteanim_with_background/screens/" + to_string(cell[0]) + "_" + to_string(cell[1]) + ".jpg";
+}
+
+// ------------------------------------------------------------------
+
+static bool background_in_range(v2i cell, v2i mincorner, v2i maxcorner)
+{
+  return cell[0] >= mincorner[0] && cell[0] < maxcorner[0]
+      && cell[1] >= mincorner[1] && cell[1] < maxcorner[1];
+}
+
+// ------------------------------------------------------------------
+
 void        background_draw(Background *bkg, v2i viewpos)
 {
   // find the screen image locations required to draw
@@ -29,50 +49,64 @@ void        background_draw(Background *bkg, v2i viewpos)
     ceil(
       v2f(viewpos + v2i(bkg->screenw / 2, bkg->screenh ))
     / v2f(bkg->screenw, bkg->screenh)) );
-  set<v2i> required;
-  for (int j = mincorner[1]; j < maxcorner[1]; j++) {
-    for (int i = mincorner[0]; i < maxcorner[0]; i++) {
-      required.insert(v2i(i, j));
-    }
+  // prefetch one more row / column in the direction the view moves
+  v2i motion = viewpos - bkg->lastViewpos;
+  bkg->lastViewpos = viewpos;
+  v2i premin = mincorner;
+  v2i premax = maxcorner;
+  for (int c = 0; c < 2; c++) {
+    if (motion[c] > 0) premax[c]++;
+    if (motion[c] < 0) premin[c]--;
   }
+  time_t now = milliseconds();
 
   // free screen images that are no longer required
   //map<v2i, DrawImage*>::iterator
   auto S = bkg->screens.begin();
   while ( S != bkg->screens.end() ) {
     // is this screen image required?
-    if (required.find(S->first) == required.end()) {
+    if (!background_in_range(S->first, premin, premax)) {
 		// no! delete?
-		time_t now = milliseconds();
 		if (now - S->second.tm_last_used > c_ScreenDeletionDelay){
 			// yes : delay has expired
 			cerr << "unloading screen " << S->first << endl;
 			delete (S->second.image);
 			S = bkg->screens.erase(S);
 		} else {
-			// not time of reuse
-			S-> second.tm_last_used = milliseconds();
 			// no: next
 			S++;
 		}
     } else {
+      // note time of re-use
+      S->second.tm_last_used = now;
       // yes, next
       S++;
     }
   }
-  // load if necessary
-  for (set<v2i>::iterator R = required.begin(); R != required.end(); R++) {
-    // already known?
-    if (bkg->screens.find(*R) == bkg->screens.end()) {
-      // no: load
-      string name = sourcePath() + "/src/spriteanim_with_background/screens/" + to_string((*R)[0]) + "_" + to_string((*R)[1]) + ".jpg";
-      // cerr << "attemtping to load " << name << endl;
-      if (LibSL::System::File::exists(name.c_str())) {
-        DrawImage *image = new DrawImage(name.c_str());
-		ScreenInfo si;
-		si.image = image;
-		si.tm_last_used = milliseconds();
-        bkg->screens[*R] = si;
+  // request the missing screens, upload the ones that are decoded;
+  // files known to be missing are not probed again
+  int uploads = 0;
+  for (int j = premin[1]; j < premax[1]; j++) {
+    for (int i = premin[0]; i < premax[0]; i++) {
+      v2i cell = v2i(i, j);
+      // already known?
+      if (bkg->screens.find(cell) != bkg->screens.end() || bkg->missing.find(cell) != bkg->missing.end()) {
+        continue;
+      }
+      bool visible = background_in_range(cell, mincorner, maxcorner);
+      string name = background_screen_name(cell);
+      StreamStatus status = stream_status(name);
+      if (status == stream_unknown) {
+        stream_request(name, false, visible);
+      } else if (status == stream_ready && (visible || uploads < c_PrefetchUploadsPerFrame)) {
+        // only the upload happens here; prefetched screens are spread over frames
+        ScreenInfo si;
+        si.image = stream_upload(name);
+        si.tm_last_used = now;
+        bkg->screens[cell] = si;
+        if (!visible) uploads++;
+      } else if (status == stream_missing) {
+        bkg->missing.insert(cell);
       }
     }
   }
@@ -22,6 +22,8 @@ typedef struct {
 typedef struct
 {
   map<v2i, ScreenInfo>    screens;  
+  set<v2i>                missing;      // cells without a screen file
+  v2i                     lastViewpos;  // view at the previous draw, gives the prefetch direction
   int                     screenw;
   int                     screenh;
 } Background;
@@ -11,6 +11,7 @@ LIBSL_WIN32_FIX;
 #include "tilemap.h"
 #include "entity.h"
 #include "background.h"
+#include "stream.h"
 
 // ------------------------------------------------------------------
 
@@ -153,6 +154,9 @@ int main(int argc,const char **argv)
     // enter the main loop
     SimpleUI::loop();
 
+    // stop the screen decoding threads
+    stream_terminate();
+
     drawimage_terminate();
 
     // close the window
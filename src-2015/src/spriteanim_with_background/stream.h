@@ -0,0 +1,36 @@
+#pragma once
+
+// ------------------------------------------------------------------
+// Screen streaming: images are probed and decoded by worker threads,
+// the main thread only uploads the decoded pixels. A file found
+// missing once is remembered and never probed again.
+// ------------------------------------------------------------------
+
+#include<string>
+
+using namespace std;
+
+// ------------------------------------------------------------------
+
+#include "drawimage.h"
+
+// ------------------------------------------------------------------
+
+typedef enum {
+  stream_unknown,  // never requested
+  stream_pending,  // queued or being decoded
+  stream_ready,    // decoded, waiting for upload
+  stream_missing   // no such file
+} StreamStatus;
+
+const int c_StreamWorkers = 2;
+
+// ------------------------------------------------------------------
+
+void         stream_init();
+void         stream_terminate();
+void         stream_request(string fname, bool colorKey, bool urgent); // urgent requests go first
+StreamStatus stream_status(string fname);
+DrawImage   *stream_upload(string fname);                              // main thread, once ready; NULL otherwise
+
+// ------------------------------------------------------------------
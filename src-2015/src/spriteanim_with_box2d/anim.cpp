@@ -0,0 +1,62 @@
+// ------------------------------------------------------------------
+
+#include "common.h"
+#include "anim.h"
+
+// ------------------------------------------------------------------
+
+vector<SpriteAnim> g_Clips;
+map<string, int>   g_ClipIds;    // file name -> clip
+
+// ------------------------------------------------------------------
+
+// returns the clip of the file, loading it the first time
+int anim_register(string filename, int framespacing)
+{
+  map<string, int>::iterator C = g_ClipIds.find(filename);
+  if (C != g_ClipIds.end()) {
+    return C->second;
+  }
+  SpriteAnim s;
+  s.region = atlas_add("sprites/" + filename);
+  if (s.region < 0) {
+    return -1;
+  }
+  const AtlasRegion& r = g_AtlasRegions[s.region];
+  s.framespacing = framespacing;
+  s.numframes = (int)ceil(r.w / framespacing);
+  s.h = r.h;
+  int clip = (int)g_Clips.size();
+  g_Clips.push_back(s);
+  g_ClipIds[filename] = clip;
+  return clip;
+}
+
+// ------------------------------------------------------------------
+
+// -1 if not registered
+int anim_find(string filename)
+{
+  map<string, int>::iterator C = g_ClipIds.find(filename);
+  return (C == g_ClipIds.end()) ? -1 : C->second;
+}
+
+// ------------------------------------------------------------------
+
+// frame shown 'elapsed' ms after the clip started; a clip that does
+// not loop ends one frame delay after its last frame, reported as
+// numframes
+int anim_frame_at(int clip, time_t elapsed, bool loop)
+{
+  int n = g_Clips[clip].numframes;
+  if (n <= 0) {
+    return 0;
+  }
+  int f = (int)(elapsed / c_FrameDelay);
+  if (loop) {
+    return f % n;
+  }
+  return min(f, n);
+}
+
+// ------------------------------------------------------------------
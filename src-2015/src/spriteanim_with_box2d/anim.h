@@ -0,0 +1,37 @@
+#pragma once
+
+// ------------------------------------------------------------------
+// Sprite animation clips: a clip is a strip of frames in one image,
+// registered once for all entities and referred to by its index in
+// g_Clips. The current frame is derived from the time since the clip
+// started playing. The strips are packed in the sprite atlas.
+// ------------------------------------------------------------------
+
+#include<string>
+
+using namespace std;
+
+// ------------------------------------------------------------------
+
+#include "atlas.h"
+
+// ------------------------------------------------------------------
+
+typedef struct {
+  int region;       // strip in the atlas
+  int framespacing;
+  int numframes;
+  int h;
+} SpriteAnim;
+
+extern vector<SpriteAnim> g_Clips;
+
+const int c_FrameDelay = 100; // ms between frames
+
+// ------------------------------------------------------------------
+
+int  anim_register(string filename, int framespacing);
+int  anim_find(string filename);
+int  anim_frame_at(int clip, time_t elapsed, bool loop);
+
+// ------------------------------------------------------------------
@@ -0,0 +1,166 @@
+// ------------------------------------------------------------------
+
+#include "common.h"
+#include "atlas.h"
+#ifndef HEADLESS
+#include "texcache.h"
+#endif
+
+// ------------------------------------------------------------------
+
+vector<AtlasRegion> g_AtlasRegions;
+vector<AtlasPage>   g_AtlasPages;
+map<string, int>    g_AtlasIds;    // file name -> region
+
+// ------------------------------------------------------------------
+
+static int atlas_new_page()
+{
+  AtlasPage page;
+  page.shelfY  = 0;
+  page.shelfH  = 0;
+  page.cursorX = 0;
+#ifndef HEADLESS
+  vector<uchar> blank(c_AtlasSize * c_AtlasSize * 4, 0);
+  glGenTextures(1, &page.texture);
+  glBindTexture(GL_TEXTURE_2D, page.texture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, c_AtlasSize, c_AtlasSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, &blank[0]);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  texcache_pin((long long)c_AtlasSize * c_AtlasSize * 4);
+#else
+  page.texture = 0;
+#endif
+  g_AtlasPages.push_back(page);
+  return (int)g_AtlasPages.size() - 1;
+}
+
+// ------------------------------------------------------------------
+
+// finds room for a w x h image on the last page, opening a shelf or
+// a page if needed; false if the image cannot fit a page
+static bool atlas_place(int w, int h, AtlasRegion& r)
+{
+  int pw = w + 2 * c_AtlasPadding;
+  int ph = h + 2 * c_AtlasPadding;
+  if (pw > c_AtlasSize || ph > c_AtlasSize) {
+    return false;
+  }
+  if (g_AtlasPages.empty()) {
+    atlas_new_page();
+  }
+  AtlasPage *page = &g_AtlasPages.back();
+  if (page->cursorX + pw > c_AtlasSize) {
+    // row is full, next shelf
+    page->shelfY += page->shelfH;
+    page->shelfH  = 0;
+    page->cursorX = 0;
+  }
+  if (page->shelfY + ph > c_AtlasSize) {
+    // page is full, next page
+    atlas_new_page();
+    page = &g_AtlasPages.back();
+  }
+  r.page = (int)g_AtlasPages.size() - 1;
+  r.x = page->cursorX + c_AtlasPadding;
+  r.y = page->shelfY  + c_AtlasPadding;
+  r.w = w;
+  r.h = h;
+  page->cursorX += pw;
+  page->shelfH   = max(page->shelfH, ph);
+  return true;
+}
+
+// ------------------------------------------------------------------
+
+// loads the pixels of a file; may run on any thread (no GL)
+ImageRGBA *atlas_decode(string filename)
+{
+  try {
+    return loadImageRGBA(executablePath() + "/data/" + filename);
+  }
+  catch (Fatal& f) { // error handling
+    std::cerr << Console::red << f.message() << Console::gray << std::endl;
+  }
+  return NULL;
+}
+
+// ------------------------------------------------------------------
+
+// packs decoded pixels, which are deleted; magenta is transparent
+int atlas_insert(string filename, ImageRGBA *img)
+{
+  map<string, int>::iterator R = g_AtlasIds.find(filename);
+  if (R != g_AtlasIds.end()) {
+    delete (img);
+    return R->second;
+  }
+  if (img == NULL) {
+    return -1;
+  }
+  AtlasRegion r;
+  if (!atlas_place(img->w(), img->h(), r)) {
+    std::cerr << Console::red << filename << " does not fit in an atlas page" << Console::gray << std::endl;
+    delete (img);
+    return -1;
+  }
+#ifndef HEADLESS
+  vector<uchar> texels(img->w() * img->h() * 4);
+  ForImage(img, i, j) {
+    v4b pix = img->pixel(i, j);
+    uchar *t = &texels[(i + j * img->w()) * 4];
+    t[0] = pix[0];
+    t[1] = pix[1];
+    t[2] = pix[2];
+    t[3] = (pix[0] == 255 && pix[1] == 0 && pix[2] == 255) ? 0 : pix[3];
+  }
+  glBindTexture(GL_TEXTURE_2D, g_AtlasPages[r.page].texture);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, r.x, r.y, r.w, r.h, GL_RGBA, GL_UNSIGNED_BYTE, &texels[0]);
+  glBindTexture(GL_TEXTURE_2D, 0);
+#endif
+  delete (img);
+  int id = (int)g_AtlasRegions.size();
+  g_AtlasRegions.push_back(r);
+  g_AtlasIds[filename] = id;
+  return id;
+}
+
+// ------------------------------------------------------------------
+
+// returns the region of the file, packing it the first time
+int atlas_add(string filename)
+{
+  map<string, int>::iterator R = g_AtlasIds.find(filename);
+  if (R != g_AtlasIds.end()) {
+    return R->second;
+  }
+  return atlas_insert(filename, atlas_decode(filename));
+}
+
+// ------------------------------------------------------------------
+
+int atlas_find(string filename)
+{
+  map<string, int>::iterator R = g_AtlasIds.find(filename);
+  return (R == g_AtlasIds.end()) ? -1 : R->second;
+}
+
+// ------------------------------------------------------------------
+
+void atlas_terminate()
+{
+  for (int p = 0; p < (int)g_AtlasPages.size(); p++) {
+#ifndef HEADLESS
+    glDeleteTextures(1, &g_AtlasPages[p].texture);
+    texcache_pin(-(long long)c_AtlasSize * c_AtlasSize * 4);
+#endif
+  }
+  g_AtlasPages.clear();
+  g_AtlasRegions.clear();
+  g_AtlasIds.clear();
+}
+
+// ------------------------------------------------------------------
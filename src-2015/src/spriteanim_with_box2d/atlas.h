@@ -0,0 +1,58 @@
+#pragma once
+
+// ------------------------------------------------------------------
+// Texture atlas: the sprite, tile and HUD images are packed into a few
+// large textures (pages) instead of one texture each. An image is
+// packed the first time it is requested and referred to by its index
+// in g_AtlasRegions.
+// ------------------------------------------------------------------
+
+#include<string>
+
+using namespace std;
+
+// ------------------------------------------------------------------
+
+#ifndef HEADLESS
+#include <LibSL_gl.h>
+#else
+// no GL context: the regions are laid out, nothing is uploaded
+#include <LibSL/LibSL.h>
+typedef unsigned int GLuint;
+#endif
+
+// ------------------------------------------------------------------
+
+// a packed image, in pixels within its page
+typedef struct {
+  int page;
+  int x;
+  int y;
+  int w;
+  int h;
+} AtlasRegion;
+
+// a page is filled with shelves: images are put side by side on the
+// current shelf, a new shelf is opened above when the row is full
+typedef struct {
+  GLuint texture;
+  int    shelfY;
+  int    shelfH;
+  int    cursorX;
+} AtlasPage;
+
+extern vector<AtlasRegion> g_AtlasRegions;
+extern vector<AtlasPage>   g_AtlasPages;
+
+const int c_AtlasSize    = 2048; // page width and height
+const int c_AtlasPadding = 1;    // empty texels around each image
+
+// ------------------------------------------------------------------
+
+int        atlas_add(string filename);                     // path relative to data/, -1 on failure
+ImageRGBA *atlas_decode(string filename);                  // any thread, NULL on failure
+int        atlas_insert(string filename, ImageRGBA *img);  // main thread, takes the image
+int        atlas_find(string filename);                    // -1 if not packed
+void       atlas_terminate();
+
+// ------------------------------------------------------------------
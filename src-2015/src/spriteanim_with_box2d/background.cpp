@@ -4,21 +4,42 @@
 #include "drawimage.h"
 #include "script.h"
 #include "background.h"
+#include "stream.h"
+#include "texcache.h"
+#include "profile.h"
 
-const time_t c_ScreenDeletionDelay = 10000;
+const int    c_PrefetchUploadsPerFrame = 1;
 // ------------------------------------------------------------------
 
 Background *background_init(int screenw, int screenh)
 {
 	Background *bkg = new Background;
 	bkg->viewpos = v2i(screenw / 2, 0);
+	bkg->lastViewpos = bkg->viewpos;
 	bkg->screenw = screenw;
 	bkg->screenh = screenh;
+	// screens are decoded in the background
+	stream_init();
 	return bkg;
 }
 
 // ------------------------------------------------------------------
 
+static string background_screen_name(v2i cell)
+{
+	return executablePath() + "/data/screens/" + to_string(cell[0]) + "_" + to_string(cell[1]) + ".jpg";
+}
+
+// ------------------------------------------------------------------
+
+static bool background_in_range(v2i cell, v2i mincorner, v2i maxcorner)
+{
+	return cell[0] >= mincorner[0] && cell[0] < maxcorner[0]
+		&& cell[1] >= mincorner[1] && cell[1] < maxcorner[1];
+}
+
+// ------------------------------------------------------------------
+
 void        background_draw(Background *bkg)
 {
 	// find the screen image locations required to draw
@@ -30,50 +51,57 @@ void        background_draw(Background *bkg)
 		ceil(
 		v2f(bkg->viewpos + v2i(bkg->screenw / 2, bkg->screenh))
 		/ v2f(bkg->screenw, bkg->screenh)));
-	set<v2i> required;
-	for (int j = mincorner[1]; j < maxcorner[1]; j++) {
-		for (int i = mincorner[0]; i < maxcorner[0]; i++) {
-			required.insert(v2i(i, j));
-		}
+	// prefetch one more row / column in the direction the view moves
+	v2i motion = bkg->viewpos - bkg->lastViewpos;
+	bkg->lastViewpos = bkg->viewpos;
+	v2i premin = mincorner;
+	v2i premax = maxcorner;
+	for (int c = 0; c < 2; c++) {
+		if (motion[c] > 0) premax[c]++;
+		if (motion[c] < 0) premin[c]--;
 	}
-	// free screen images that are no longer required
+	// release screen images that are no longer required; the texture
+	// cache keeps them while within its memory budget
 	auto S = bkg->screens.begin();
 	while (S != bkg->screens.end()) {
 		// is this screen image required?
-		if (required.find(S->first) == required.end()) {
-			time_t now = milliseconds();
-			if (now - S->second.tm_last_used > c_ScreenDeletionDelay)
-			{
-				// no! delete
-				cerr << "unloading screen " << S->first << endl;
-				delete (S->second.image);
-				S = bkg->screens.erase(S);
-			}
-			else{
-				// no => next
-				S++;
-			}
+		if (!background_in_range(S->first, premin, premax)) {
+			// no! release
+			texcache_release(S->second);
+			S = bkg->screens.erase(S);
 		}
 		else {
-			// note time of re-use
-			S->second.tm_last_used = milliseconds();
 			// yes, next
 			S++;
 		}
 	}
-	// load if necessary
-	for (set<v2i>::iterator R = required.begin(); R != required.end(); R++) {
-		// already known?
-		if (bkg->screens.find(*R) == bkg->screens.end()) {
-			// no: load
-			string name = executablePath() + "/data/screens/" + to_string((*R)[0]) + "_" + to_string((*R)[1]) + ".jpg";
-			// cerr << "attemtping to load " << name << endl;
-			if (LibSL::System::File::exists(name.c_str())) {
-				DrawImage *image = new DrawImage(name.c_str());
-				ScreenInfo si;
-				si.image = image;
-				si.tm_last_used = milliseconds();
-				bkg->screens[*R] = si;
+	// request the missing screens, upload the ones that are decoded;
+	// files known to be missing are not probed again
+	int uploads = 0;
+	for (int j = premin[1]; j < premax[1]; j++) {
+		for (int i = premin[0]; i < premax[0]; i++) {
+			v2i cell = v2i(i, j);
+			// already known?
+			if (bkg->screens.find(cell) != bkg->screens.end() || bkg->missing.find(cell) != bkg->missing.end()) {
+				continue;
+			}
+			bool visible = background_in_range(cell, mincorner, maxcorner);
+			string name = background_screen_name(cell);
+			// still resident?
+			int tex = texcache_find(name);
+			if (tex >= 0) {
+				bkg->screens[cell] = tex;
+				continue;
+			}
+			StreamStatus status = stream_status(name);
+			if (status == stream_unknown) {
+				stream_request(name, false, visible);
+			} else if (status == stream_ready && (visible || uploads < c_PrefetchUploadsPerFrame)) {
+				// only the upload happens here; prefetched screens are spread over frames
+				bkg->screens[cell] = texcache_insert(name, stream_upload(name));
+				if (!visible) uploads++;
+			} else if (status == stream_missing) {
+				bkg->missing.insert(cell);
 			}
 		}
 	}
@@ -84,7 +112,7 @@ void        background_draw(Background *bkg)
 			auto S = bkg->screens.find(v2i(i, j));
 			if (S != bkg->screens.end()) {
 				// yes, draw
-				S->second.image->draw(i*bkg->screenw - bkg->viewpos[0] + bkg->screenw / 2, j*bkg->screenh + bkg->viewpos[1]);
+				texcache_image(S->second)->draw(i*bkg->screenw - bkg->viewpos[0] + bkg->screenw / 2, j*bkg->screenh + bkg->viewpos[1]);
 			}
 		}
 	}
@@ -104,27 +132,53 @@ void loadBackground2(Background *bkg, int x, int y) {
 	if (bkg->screens2.find(v2i(x, y)) != bkg->screens2.end()) {
 		return;
 	}
-	bool failed = false;
-	DrawImage* puzzle;
 	string name = executablePath()  + "/data/screens/" + to_string(x) + "_" + to_string(y) + ".jpg";
-	if (LibSL::System::File::exists(name.c_str())) {
-		puzzle = new DrawImage(name.c_str(), v3b(255, 0, 255));
-	}
-
-	else {
-		failed = true;
+	int tex = texcache_load(name, true);
+	if (tex < 0) {
 		std::cerr << Console::red << "failed" << Console::gray << std::endl;
+		return;
 	}
-	if (!failed) {
-		bkg->screens2[v2i(x, y)] = puzzle;
-		std::cerr << Console::red << bkg->screens.size() << Console::gray << std::endl;
-	}
+	bkg->screens2[v2i(x, y)] = tex;
 }
 
 void background_draw2(Background *bkg, v2i pos, v2i leftCorner) {
+	PROFILE_ZONE("background draw");
+	auto S = bkg->screens2.find(pos);
+	if (S == bkg->screens2.end()) {
+		return;
+	}
 	for (int i = 0; i < 3; i++) {
-		bkg->screens2[pos]->draw(leftCorner[0], leftCorner[1]);
+		texcache_image(S->second)->draw(leftCorner[0], leftCorner[1]);
+	}
+}
+
+// ------------------------------------------------------------------
+
+// releases the screens, they stay in the texture cache while within budget
+void background_free(Background *bkg)
+{
+	if (bkg == NULL) {
+		return;
+	}
+	for (auto S = bkg->screens.begin(); S != bkg->screens.end(); S++) {
+		texcache_release(S->second);
+	}
+	for (auto S = bkg->screens2.begin(); S != bkg->screens2.end(); S++) {
+		texcache_release(S->second);
+	}
+	delete (bkg);
+}
+
+// ------------------------------------------------------------------
+
+// background showing screen (x,y): 'old' if it already does, a new one otherwise
+Background *background_replace(Background *old, int screenw, int screenh, int x, int y)
+{
+	if (old != NULL && old->pos[0] == x && old->pos[1] == y && old->screenw == screenw && old->screenh == screenh) {
+		return old;
 	}
+	background_free(old);
+	return background_init2(screenw, screenh, x, y);
 }
 
 // ------------------------------------------------------------------
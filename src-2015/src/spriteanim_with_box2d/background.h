@@ -15,16 +15,12 @@ using namespace std;
 
 typedef struct
 {
-	DrawImage* image;
-	time_t tm_last_used;
-}ScreenInfo;
-
-typedef struct
-{
-	map<v2i, ScreenInfo>    screens;
-	map<v2i, DrawImage*>    screens2;
+	map<v2i, int>           screens;     // texture cache handles
+	set<v2i>                missing;     // cells without a screen file
+	map<v2i, int>           screens2;    // texture cache handles
 
 	v2i                     viewpos;
+	v2i                     lastViewpos; // view at the previous draw, gives the prefetch direction
 	v2i                     pos;
 
 	int                     screenw;
@@ -38,5 +34,7 @@ void        background_draw(Background*);
 void loadBackground2(Background *bkg, int x, int y);
 Background * background_init2(int screenw, int screenh, int x, int y);
 void background_draw2(Background *bkg, v2i pos, v2i leftCorner);
+void        background_free(Background *bkg);
+Background *background_replace(Background *old, int screenw, int screenh, int x, int y);
 
 // ------------------------------------------------------------------
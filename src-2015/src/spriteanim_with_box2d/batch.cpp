@@ -0,0 +1,120 @@
+// ------------------------------------------------------------------
+
+#include "common.h"
+#include "batch.h"
+#include "profile.h"
+
+// ------------------------------------------------------------------
+
+extern int    c_ScreenW;
+extern int    c_ScreenH;
+extern int    separation;
+extern int    ratio_split;
+
+// ------------------------------------------------------------------
+
+typedef struct {
+  int   layer;
+  int   page;
+  float v[16];  // x,y,u,v of the four corners
+} BatchQuad;
+
+vector<BatchQuad> g_BatchQuads;
+vector<float>     g_BatchVertices;
+
+// ------------------------------------------------------------------
+
+void batch_add(int region, v2i src, v2i size, v2i dst, int layer)
+{
+  if (region < 0) {
+    return;
+  }
+  const AtlasRegion& r = g_AtlasRegions[region];
+  BatchQuad q;
+  q.layer = layer;
+  q.page  = r.page;
+  float x0 = (float)dst[0];
+  float y0 = (float)dst[1];
+  float x1 = x0 + size[0];
+  float y1 = y0 + size[1];
+  float u0 = (r.x + src[0]) / (float)c_AtlasSize;
+  float u1 = (r.x + src[0] + size[0]) / (float)c_AtlasSize;
+  float v0 = (r.y + src[1] + size[1]) / (float)c_AtlasSize; // image rows go top to bottom
+  float v1 = (r.y + src[1]) / (float)c_AtlasSize;
+  float quad[16] = {
+    x0, y0, u0, v0,
+    x1, y0, u1, v0,
+    x1, y1, u1, v1,
+    x0, y1, u0, v1 };
+  memcpy(q.v, quad, sizeof(quad));
+  g_BatchQuads.push_back(q);
+}
+
+// ------------------------------------------------------------------
+
+void batch_image(int region, v2i dst, int layer)
+{
+  if (region < 0) {
+    return;
+  }
+  const AtlasRegion& r = g_AtlasRegions[region];
+  batch_add(region, v2i(0, 0), v2i(r.w, r.h), dst, layer);
+}
+
+// ------------------------------------------------------------------
+
+static bool batch_order(const BatchQuad& a, const BatchQuad& b)
+{
+  if (a.layer != b.layer) {
+    return a.layer < b.layer;
+  }
+  return a.page < b.page;
+}
+
+// ------------------------------------------------------------------
+
+void batch_draw()
+{
+  PROFILE_ZONE("batch draw");
+  if (g_BatchQuads.empty()) {
+    return;
+  }
+  // order by layer, then page; stable so that quads of a same layer
+  // and page keep the order they were queued in
+  stable_sort(g_BatchQuads.begin(), g_BatchQuads.end(), batch_order);
+  g_BatchVertices.resize(g_BatchQuads.size() * 16);
+  for (int q = 0; q < (int)g_BatchQuads.size(); q++) {
+    memcpy(&g_BatchVertices[q * 16], g_BatchQuads[q].v, 16 * sizeof(float));
+  }
+
+  Transform::ortho2D(LIBSL_PROJECTION_MATRIX, 0, c_ScreenW*ratio_split + separation, 0, c_ScreenH);
+  Transform::identity(LIBSL_MODELVIEW_MATRIX);
+  glEnable(GL_TEXTURE_2D);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  glColor4f(1, 1, 1, 1);
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+  glVertexPointer(2, GL_FLOAT, 4 * sizeof(float), &g_BatchVertices[0]);
+  glTexCoordPointer(2, GL_FLOAT, 4 * sizeof(float), &g_BatchVertices[2]);
+  // one call per run of quads on the same page
+  int first = 0;
+  while (first < (int)g_BatchQuads.size()) {
+    int page = g_BatchQuads[first].page;
+    int last = first + 1;
+    while (last < (int)g_BatchQuads.size() && g_BatchQuads[last].page == page) {
+      last++;
+    }
+    glBindTexture(GL_TEXTURE_2D, g_AtlasPages[page].texture);
+    glDrawArrays(GL_QUADS, first * 4, (last - first) * 4);
+    first = last;
+  }
+  glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+  glDisableClientState(GL_VERTEX_ARRAY);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glDisable(GL_TEXTURE_2D);
+  g_BatchQuads.clear();
+}
+
+
+// ------------------------------------------------------------------
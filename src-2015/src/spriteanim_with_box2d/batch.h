@@ -0,0 +1,28 @@
+#pragma once
+
+// ------------------------------------------------------------------
+// Sprite batch: quads cut from atlas regions are queued during the
+// frame, then sorted by layer and atlas page and sent as one vertex
+// array, with one draw call per run of quads sharing a page.
+// ------------------------------------------------------------------
+
+#include "atlas.h"
+
+// ------------------------------------------------------------------
+
+// drawing order, back to front
+enum {
+  layer_tiles = 0,
+  layer_separation,
+  layer_sprites,
+  layer_hud,
+  num_layers
+};
+
+// ------------------------------------------------------------------
+
+void batch_add(int region, v2i src, v2i size, v2i dst, int layer); // sub-rectangle of a region, dst is the lower left corner
+void batch_image(int region, v2i dst, int layer);                  // whole region
+void batch_draw();                                                 // draws and empties the queue
+
+// ------------------------------------------------------------------
@@ -0,0 +1,207 @@
+// ------------------------------------------------------------------
+// Headless benchmark: a match is stepped without a window, driven by
+// scripted inputs or by a recording of the game (-record), and the
+// time of each simulation phase is measured. The totals and the
+// percentiles of the step times are written to a JSON file.
+//
+//   brothers_bench [-ticks N] [-seed S] [-replay file] [-json file]
+//                  [-trace file] [-threads N]
+//
+// -trace writes the profiler zones of the first N ticks to a Chrome
+// trace (with -replay, N must not exceed the length of the recording).
+// -threads sets the number of threads solving the physics islands.
+//
+// Built with HEADLESS defined: nothing is drawn, the atlas only lays
+// out the images (animations and tiles need their sizes).
+// ------------------------------------------------------------------
+
+#include "common.h"
+#include "match.h"
+#include "physics.h"
+#include "gameloop.h"
+#include "level.h"
+#include "sim.h"
+#include "profile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+
+// ------------------------------------------------------------------
+
+// the split screen of the game, for the panning of the sounds
+int    c_ScreenW = 650;
+int    c_ScreenH = 800;
+int    separation = 150;
+v2i    g_viewpos1 = v2i(0, 0);
+v2i    g_viewpos2 = v2i(0, 0);
+
+const int c_BenchTicks = 3000; // one minute of play
+
+// The World (in physics.cpp)
+extern b2World *g_World;
+
+// ------------------------------------------------------------------
+
+// scripted inputs: both players run back and forth, jump and attack,
+// out of phase with each other
+static void benchInput(int tick)
+{
+  const uchar keys[2][4] = { { 'a', 'e', 'z', 'x' }, { 'u', 'o', 'i', 'n' } }; // left, right, jump, attack
+  for (int p = 0; p < 2; p++) {
+    int  t     = tick + p * 37;
+    bool right = ((t / 100) % 2) == 0; // two seconds each way
+    g_Keys[keys[p][0]] = !right;
+    g_Keys[keys[p][1]] = right;
+    g_Keys[keys[p][2]] = (t % 35) < 3;  // a jump every 0.7 s
+    g_Keys[keys[p][3]] = (t % 150) == 0;
+  }
+}
+
+// ------------------------------------------------------------------
+
+// nearest rank percentile of sorted values
+static double benchPercentile(const vector<double>& sorted, double p)
+{
+  if (sorted.empty()) {
+    return 0.0;
+  }
+  int rank = (int)ceil(p / 100.0 * (double)sorted.size()) - 1;
+  return sorted[max(0, min(rank, (int)sorted.size() - 1))];
+}
+
+// ------------------------------------------------------------------
+
+// 'main' is the starting point of the benchmark
+int main(int argc, const char **argv)
+{
+  int      numTicks = c_BenchTicks;
+  uint32_t seed     = 1;
+  string   replay;
+  string   json     = "bench.json";
+  string   trace;
+  int      threads  = 0; // default of phy_init
+  for (int a = 1; a + 1 < argc; a += 2) {
+    string opt = argv[a];
+    if      (opt == "-ticks")  numTicks = atoi(argv[a + 1]);
+    else if (opt == "-seed")   seed     = (uint32_t)atoi(argv[a + 1]);
+    else if (opt == "-replay") replay   = argv[a + 1];
+    else if (opt == "-json")   json     = argv[a + 1];
+    else if (opt == "-trace")  trace    = argv[a + 1];
+    else if (opt == "-threads") threads = atoi(argv[a + 1]);
+    else {
+      cerr << Console::red << "unknown option '" << opt << "'" << Console::gray << endl;
+      return 1;
+    }
+  }
+
+  try { // error handling
+
+    // a replay takes the seed of its recording
+    sim_seed(seed);
+    if (!replay.empty() && !sim_replay_begin(replay)) {
+      return 1;
+    }
+
+    for (int i = 0; i < 256; i++) {
+      g_Keys[i] = false;
+    }
+
+    // the same draws as the game: field, map and song, then the spots
+    match_choose();
+    phy_init();
+    if (threads > 0) {
+      g_World->SetSolverThreadCount(threads);
+    }
+    g_Tilemap = level_switch(level, g_MatchVariant);
+    match_shuffle();
+    match_spawn();
+
+    gameloop_init(20.0f, 5);
+    gameloop_set_headless(true);
+    match_set_timing(true);
+    profile_thread_name("main");
+    if (!trace.empty()) {
+      profile_trace(trace, numTicks);
+    }
+
+    MatchPhases    total   = { 0, 0, 0, 0 };
+    vector<double> stepMs;
+    int            matches = 1;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int tick = 0; replay.empty() ? tick < numTicks : !sim_replay_done(); tick++) {
+      if (replay.empty()) {
+        benchInput(tick);
+        if (match_over()) {
+          // keep playing, as the game does after the end screen
+          match_rematch();
+          matches++;
+        }
+      }
+      chrono::steady_clock::time_point t = chrono::steady_clock::now();
+      match_tick();
+      stepMs.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - t).count());
+      profile_frame();
+      const MatchPhases& ph = match_phases();
+      total.physics  += ph.physics;
+      total.contacts += ph.contacts;
+      total.scripts  += ph.scripts;
+      total.entities += ph.entities;
+    }
+    double totalMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    int desync = replay.empty() ? -1 : sim_replay_report();
+
+    int ticks = (int)stepMs.size();
+    vector<double> sorted = stepMs;
+    sort(sorted.begin(), sorted.end());
+    double mean = 0.0;
+    for (int i = 0; i < ticks; i++) {
+      mean += stepMs[i];
+    }
+    mean = ticks > 0 ? mean / ticks : 0.0;
+
+    cerr << Console::white << ticks << " steps in " << totalMs << " ms,"
+      << " physics " << total.physics << " ms, contacts " << total.contacts << " ms,"
+      << " scripts " << total.scripts << " ms, entities " << total.entities << " ms"
+      << Console::gray << endl;
+
+    FILE *f = fopen(json.c_str(), "w");
+    if (f == NULL) {
+      cerr << Console::red << "cannot write '" << json << "'" << Console::gray << endl;
+    } else {
+      fprintf(f, "{\n");
+      fprintf(f, "  \"inputs\": \"%s\",\n", replay.empty() ? "scripted" : "replay");
+      fprintf(f, "  \"seed\": %u,\n", sim_get_seed());
+      fprintf(f, "  \"level\": \"%s\",\n", level.c_str());
+      fprintf(f, "  \"ticks\": %d,\n", ticks);
+      fprintf(f, "  \"matches\": %d,\n", matches);
+      fprintf(f, "  \"solver_threads\": %d,\n", g_World->GetSolverThreadCount());
+      fprintf(f, "  \"tree_height\": %d,\n", g_World->GetTreeHeight());
+      fprintf(f, "  \"tree_area_ratio\": %.2f,\n", g_World->GetTreeAreaRatio());
+      fprintf(f, "  \"desync_tick\": %d,\n", desync);
+      fprintf(f, "  \"total_ms\": %.3f,\n", totalMs);
+      fprintf(f, "  \"phases_ms\": { \"physics\": %.3f, \"contacts\": %.3f, \"scripts\": %.3f, \"entities\": %.3f },\n",
+        total.physics, total.contacts, total.scripts, total.entities);
+      fprintf(f, "  \"step_ms\": { \"mean\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"p999\": %.4f, \"max\": %.4f }\n",
+        mean, benchPercentile(sorted, 50.0), benchPercentile(sorted, 90.0), benchPercentile(sorted, 99.0),
+        benchPercentile(sorted, 99.9), sorted.empty() ? 0.0 : sorted.back());
+      fprintf(f, "}\n");
+      fclose(f);
+    }
+
+    pool_clear();
+    level_terminate();
+    phy_terminate();
+    atlas_terminate();
+
+    return desync < 0 ? 0 : 1;
+
+  }
+  catch (Fatal& f) { // error handling
+    std::cerr << Console::red << f.message() << Console::gray << std::endl;
+  }
+
+  return 1;
+}
+
+// ------------------------------------------------------------------
@@ -0,0 +1,334 @@
+// ------------------------------------------------------------------
+
+#include "common.h"
+#include "bridge.h"
+
+// ------------------------------------------------------------------
+
+// get access to keys table and game state from main.cpp
+extern bool g_Keys[256];
+extern int  field;
+
+int g_ScriptElapsed = 0;
+
+// ------------------------------------------------------------------
+
+// gameplay stats exposed as is
+typedef struct {
+  const char          *name;
+  int  EntityStats::*  asInt;
+  bool EntityStats::*  asBool;
+  bool                 writable;
+} ScriptMember;
+
+static ScriptMember g_Members[] = {
+  { "evolution",      &EntityStats::evolution,    NULL,                         true  },
+  { "evolution2",     &EntityStats::evolution2,   NULL,                         true  },
+  { "life",           &EntityStats::life,         NULL,                         true  },
+  { "score",          &EntityStats::score,        NULL,                         true  },
+  { "nbOfStars",      &EntityStats::nbOfStars,    NULL,                         true  },
+  { "nbOfDiamonds",   &EntityStats::nbOfDiamonds, NULL,                         true  },
+  { "killer",         &EntityStats::killer,       NULL,                         false },
+  { "movement",       &EntityStats::movement,     NULL,                         false },
+  { "killingContact", NULL,                       &EntityStats::killingContact, true  },
+  { "winningContact", NULL,                       &EntityStats::winningContact, false },
+  { "gemContact",     NULL,                       &EntityStats::gemContact,     true  },
+  { "isMoving",       NULL,                       &EntityStats::isMoving,       true  },
+  { "isFaster",       NULL,                       &EntityStats::isFaster,       true  },
+  { "isSlower",       NULL,                       &EntityStats::isSlower,       true  },
+};
+
+const int c_NumMembers = sizeof(g_Members) / sizeof(g_Members[0]);
+
+// field ids, 0 meaning 'not a field'
+enum {
+  id_pos_x = 1,
+  id_pos_y,
+  id_name,
+  id_field,
+  id_elapsed,
+  id_first_member,
+  id_first_key = id_first_member + c_NumMembers // Key_a .. Key_z
+};
+
+// ------------------------------------------------------------------
+
+// (t,k) -> field id of k, using the name table in upvalue 2
+static int field_id(lua_State *L)
+{
+  lua_pushvalue(L, 2);
+  lua_rawget(L, lua_upvalueindex(2));
+  int id = (int)lua_tointeger(L, -1);
+  lua_pop(L, 1);
+  return id;
+}
+
+// ------------------------------------------------------------------
+
+static int bridge_index(lua_State *L)
+{
+  int id = field_id(L);
+  if (id == 0) {
+    // not set by the script: look into the shared globals (upvalue 3)
+    lua_pushvalue(L, 2);
+    lua_rawget(L, lua_upvalueindex(3));
+    return 1;
+  }
+  Entity *e = (Entity*)lua_touserdata(L, lua_upvalueindex(1));
+  if (id >= id_first_key) {
+    lua_pushboolean(L, g_Keys['a' + id - id_first_key]);
+  } else if (id >= id_first_member) {
+    const ScriptMember& m = g_Members[id - id_first_member];
+    if (m.asInt) {
+      lua_pushinteger(L, stats_of(e).*m.asInt);
+    } else {
+      lua_pushboolean(L, stats_of(e).*m.asBool);
+    }
+  } else {
+    switch (id) {
+    case id_pos_x:   lua_pushnumber(L, entity_get_pos(e)[0]); break;
+    case id_pos_y:   lua_pushnumber(L, entity_get_pos(e)[1]); break;
+    case id_name:    lua_pushstring(L, e->name.c_str()); break;
+    case id_field:   lua_pushinteger(L, field); break;
+    case id_elapsed: lua_pushinteger(L, g_ScriptElapsed); break;
+    }
+  }
+  return 1;
+}
+
+// ------------------------------------------------------------------
+
+static int bridge_newindex(lua_State *L)
+{
+  int id = field_id(L);
+  if (id == 0) {
+    // a plain script variable
+    lua_rawset(L, 1);
+    return 0;
+  }
+  Entity *e = (Entity*)lua_touserdata(L, lua_upvalueindex(1));
+  if (id >= id_first_key) {
+    // read only
+  } else if (id >= id_first_member) {
+    const ScriptMember& m = g_Members[id - id_first_member];
+    if (m.writable) {
+      if (m.asInt) {
+        stats_of(e).*m.asInt = (int)lua_tointeger(L, 3);
+      } else {
+        stats_of(e).*m.asBool = lua_toboolean(L, 3) != 0;
+      }
+    }
+  } else {
+    switch (id) {
+    case id_pos_x:   transform_of(e).pos[0] = (int)lua_tonumber(L, 3); break;
+    case id_pos_y:   transform_of(e).pos[1] = (int)lua_tonumber(L, 3); break;
+    case id_field:   field = (int)lua_tointeger(L, 3); break;
+    }
+  }
+  return 0;
+}
+
+// ------------------------------------------------------------------
+
+// name -> field id, built once for the VM
+static void push_field_names(lua_State *L)
+{
+  static int ref = LUA_NOREF;
+  if (ref != LUA_NOREF) {
+    lua_rawgeti(L, LUA_REGISTRYINDEX, ref);
+    return;
+  }
+  lua_newtable(L);
+  const char *specials[] = { "pos_x", "pos_y", "name", "field", "elapsed" };
+  for (int i = 0; i < id_first_member - 1; i++) {
+    lua_pushstring(L, specials[i]);
+    lua_pushinteger(L, id_pos_x + i);
+    lua_rawset(L, -3);
+  }
+  for (int i = 0; i < c_NumMembers; i++) {
+    lua_pushstring(L, g_Members[i].name);
+    lua_pushinteger(L, id_first_member + i);
+    lua_rawset(L, -3);
+  }
+  char key[] = "Key__";
+  for (int c = 'a'; c <= 'z'; c++) {
+    key[4] = (char)c;
+    lua_pushstring(L, key);
+    lua_pushinteger(L, id_first_key + c - 'a');
+    lua_rawset(L, -3);
+  }
+  lua_pushvalue(L, -1);
+  ref = luaL_ref(L, LUA_REGISTRYINDEX);
+}
+
+// ------------------------------------------------------------------
+
+// entity fields become globals of the script, accessed in place
+void bridge_bind_entity(Script *s, Entity *e)
+{
+  lua_State *L = s->lua;
+  script_push_env(s);
+  lua_newtable(L); // metatable
+  push_field_names(L);
+  int names = lua_gettop(L);
+
+  lua_pushstring(L, "__index");
+  lua_pushlightuserdata(L, e);
+  lua_pushvalue(L, names);
+  lua_pushvalue(L, LUA_GLOBALSINDEX);
+  lua_pushcclosure(L, bridge_index, 3);
+  lua_rawset(L, names - 1);
+
+  lua_pushstring(L, "__newindex");
+  lua_pushlightuserdata(L, e);
+  lua_pushvalue(L, names);
+  lua_pushcclosure(L, bridge_newindex, 2);
+  lua_rawset(L, names - 1);
+
+  lua_pop(L, 1); // names
+  lua_setmetatable(L, -2);
+  lua_pop(L, 1); // env
+}
+
+// ------------------------------------------------------------------
+
+void bridge_set_elapsed(int elapsed)
+{
+  g_ScriptElapsed = elapsed;
+}
+
+// ------------------------------------------------------------------
+// Microbenchmark: per entity cost of a script call, with the state
+// copied to and from the globals of a VM per entity (as done before
+// the bridge) and with the bridge in the shared VM. Then the cost of
+// spawning a script instance, with a fresh VM or in the shared VM.
+
+static const char *c_BenchScript =
+  "function step()\n"
+  "  if Key_a and life > 0 then isMoving = true end\n"
+  "  evolution = evolution + 1\n"
+  "  if evolution > 100 then evolution = 0 end\n"
+  "end\n";
+
+static lua_State *bench_open_vm()
+{
+  lua_State *L = lua_open();
+  luaL_openlibs(L);
+  luabind::open(L);
+  luaL_dostring(L, c_BenchScript);
+  return L;
+}
+
+static void bench_copy_in(lua_State *L, Entity *e)
+{
+  for (int i = 'a'; i <= 'z'; i++) {
+    string name = "Key__";
+    name[4] = (char)i;
+    globals(L)[name] = g_Keys[i];
+  }
+  globals(L)["name"] = e->name;
+  globals(L)["pos_x"] = 0.0f;
+  globals(L)["pos_y"] = 0.0f;
+  globals(L)["field"] = field;
+  for (int m = 0; m < c_NumMembers; m++) {
+    if (g_Members[m].asInt) {
+      globals(L)[g_Members[m].name] = stats_of(e).*g_Members[m].asInt;
+    } else {
+      globals(L)[g_Members[m].name] = stats_of(e).*g_Members[m].asBool;
+    }
+  }
+}
+
+static void bench_copy_out(lua_State *L, Entity *e)
+{
+  transform_of(e).pos[0] = luabind::object_cast<float>(globals(L)["pos_x"]);
+  transform_of(e).pos[1] = luabind::object_cast<float>(globals(L)["pos_y"]);
+  field = luabind::object_cast<int>(globals(L)["field"]);
+  for (int m = 0; m < c_NumMembers; m++) {
+    if (!g_Members[m].writable) continue;
+    if (g_Members[m].asInt) {
+      stats_of(e).*g_Members[m].asInt = luabind::object_cast<int>(globals(L)[g_Members[m].name]);
+    } else {
+      stats_of(e).*g_Members[m].asBool = luabind::object_cast<bool>(globals(L)[g_Members[m].name]);
+    }
+  }
+}
+
+void bridge_benchmark()
+{
+  int counts[3] = { 1, 100, 1000 };
+  for (int c = 0; c < 3; c++) {
+    int n = counts[c];
+    int numFrames = max(10, 100000 / n);
+    for (int bridged = 0; bridged < 2; bridged++) {
+      vector<Entity*>    entities(n);
+      vector<lua_State*> vms(n);
+      for (int i = 0; i < n; i++) {
+        Entity *e = new Entity;
+        entity_store_add(e);
+        e->name = "bench";
+        physics_of(e).body = NULL;
+        stats_of(e).life = 1; stats_of(e).evolution = 0; stats_of(e).evolution2 = 0; stats_of(e).score = 0; stats_of(e).killer = 2; stats_of(e).movement = 0;
+        stats_of(e).nbOfStars = 0; stats_of(e).nbOfDiamonds = 0;
+        stats_of(e).killingContact = stats_of(e).winningContact = stats_of(e).gemContact = false;
+        stats_of(e).isMoving = stats_of(e).isFaster = stats_of(e).isSlower = false;
+        if (bridged) {
+          g_Store.script[e->id] = script_create();
+          bridge_bind_entity(script_of(e), e);
+          script_load_string(script_of(e), "bench", c_BenchScript);
+        } else {
+          vms[i] = bench_open_vm();
+        }
+        entities[i] = e;
+      }
+      t_time start = milliseconds();
+      for (int f = 0; f < numFrames; f++) {
+        for (int i = 0; i < n; i++) {
+          Entity *e = entities[i];
+          if (bridged) {
+            script_call(script_of(e), "step");
+          } else {
+            bench_copy_in(vms[i], e);
+            call_function<void>(vms[i], "step");
+            bench_copy_out(vms[i], e);
+          }
+        }
+      }
+      t_time stop = milliseconds();
+      cerr << Console::white << n << " entities, " << (bridged ? "bridge " : "globals")
+        << ": " << 1000.0f * (stop - start) / (float)(numFrames * n) << " us per entity call"
+        << Console::gray << endl;
+      for (int i = 0; i < n; i++) {
+        if (bridged) {
+          script_kill(script_of(entities[i]));
+          delete (script_of(entities[i]));
+        } else {
+          lua_close(vms[i]);
+        }
+        delete (entities[i]);
+      }
+      entity_store_clear();
+    }
+  }
+  // spawning
+  const int numSpawns = 1000;
+  for (int shared = 0; shared < 2; shared++) {
+    t_time start = milliseconds();
+    for (int i = 0; i < numSpawns; i++) {
+      if (shared) {
+        Script *s = script_create();
+        script_load_string(s, "bench", c_BenchScript);
+        script_kill(s);
+        delete (s);
+      } else {
+        lua_close(bench_open_vm());
+      }
+    }
+    t_time stop = milliseconds();
+    cerr << Console::white << "spawn, " << (shared ? "shared VM" : "fresh VM ")
+      << ": " << 1000.0f * (stop - start) / (float)numSpawns << " us per script"
+      << Console::gray << endl;
+  }
+}
+
+// ------------------------------------------------------------------
@@ -0,0 +1,18 @@
+#pragma once
+
+// ------------------------------------------------------------------
+// Entity state seen from the scripts: fields such as 'life' or 'Key_a'
+// are read and written in place through accessors, rather than copied
+// to and from the Lua globals around every call.
+// ------------------------------------------------------------------
+
+#include "script.h"
+#include "entity.h"
+
+// ------------------------------------------------------------------
+
+void bridge_bind_entity(Script *s, Entity *e);
+void bridge_set_elapsed(int elapsed);
+void bridge_benchmark();
+
+// ------------------------------------------------------------------
@@ -1,36 +1,45 @@
 // ------------------------------------------------------------------
 
 #include "common.h"
+#ifndef HEADLESS
 #include "drawimage.h"
+#endif
 #include "script.h"
 #include "entity.h"
+#include "gameloop.h"
+#include "bridge.h"
+#include "pool.h"
+#ifndef HEADLESS
+#include "batch.h"
+#endif
+#include "sound.h"
+#include "sim.h"
+#include "log.h"
+#include "profile.h"
+
+#include <string.h>
 
 // The World (in physics.cpp)
 extern b2World *g_World;
 
-// get access to foot contact from main.cpp
-extern int             numFootContacts1;
-extern int             numLeftContacts1;
-extern int             numRightContacts1;
-extern int             numFootContacts2;
-extern int             numLeftContacts2;
-extern int             numRightContacts2;
-
 extern int c_ScreenW;
 extern int c_ScreenH;
 extern int separation;
-extern vector<Entity*> g_Entities;
+extern Entity* g_Player1;
+extern Entity* g_Player2;
 
 
+#ifndef HEADLESS
 extern DrawImage      *i_1Heart;
 extern DrawImage      *i_2Heart;
 extern DrawImage      *i_3Heart;
 extern DrawImage      *i_4Heart;
+#endif
 
-extern DrawImage      *i_0Score;
-extern DrawImage      *i_1Score;
-extern DrawImage      *i_2Score;
-extern DrawImage      *i_3Score;
+extern int             i_0Score;
+extern int             i_1Score;
+extern int             i_2Score;
+extern int             i_3Score;
 
 extern int doubleJump1;
 extern int doubleJump2;
@@ -43,42 +52,21 @@ extern bool g_Keys[256];
 
 // ------------------------------------------------------------------
 
-const int g_FrameDelay = 100; // ms between frames
-
 Entity *g_Current = NULL;
 
-map<string, DrawImage*> g_Animations;
-
-
-// ------------------------------------------------------------------
-
-DrawImage *loadAnimation(string filename)
-{
-  try {
-    if (g_Animations.find(filename) == g_Animations.end()) {
-      DrawImage *img = new DrawImage((executablePath() + "/data/sprites/" + filename).c_str(), v3b(255, 0, 255));
-      g_Animations[filename] = img;
-      return img;
-    } else {
-      return g_Animations[filename];
-    }
-  }
-  catch (Fatal& f) { // error handling
-    std::cerr << Console::red << f.message() << Console::gray << std::endl;
-  }
-  return NULL;
-}
-
 // ------------------------------------------------------------------
 
 void lua_addanim(string filename, int framespacing)
 {
   sl_assert(g_Current != NULL);
-  SpriteAnim *s = new SpriteAnim;
-  s->animframes = loadAnimation(filename);
-  s->framespacing = framespacing;
-  s->numframes = (int)ceil(s->animframes->w() / framespacing);
-  g_Current->anims[filename] = s;
+  int clip = anim_register(filename, framespacing);
+  if (clip < 0) {
+    return;
+  }
+  if (find(g_Current->clips.begin(), g_Current->clips.end(), clip) == g_Current->clips.end()) {
+    // a recycled entity already has it
+    g_Current->clips.push_back(clip);
+  }
 }
 
 // ------------------------------------------------------------------
@@ -86,30 +74,32 @@ void lua_addanim(string filename, int framespacing)
 void lua_playanim(string filename, bool looping)
 {
   sl_assert(g_Current != NULL);
-  if (g_Current->anims.find(filename) == g_Current->anims.end()) {
+  int clip = anim_find(filename);
+  if (find(g_Current->clips.begin(), g_Current->clips.end(), clip) == g_Current->clips.end()) {
     cerr << Console::red << "cannot find anim '" << filename << "'" << Console::gray << endl;
     return;
   }
-  g_Current->currentAnim = filename;
-  g_Current->currentFrame = 0;
-  g_Current->lastAnimUpdate = milliseconds();
-  g_Current->animIsPlaying = true;
-  g_Current->animIsALoop = looping;
+  anim_of(g_Current).clip = clip;
+  anim_of(g_Current).start = sim_time();
+  anim_of(g_Current).frame = 0;
+  anim_of(g_Current).playing = true;
+  anim_of(g_Current).loop = looping;
 }
 
 // ------------------------------------------------------------------
 
+// the frame stays the one computed by the last animation pass
 void lua_stopanim()
 {
   sl_assert(g_Current != NULL);
-  g_Current->animIsPlaying = false;
+  anim_of(g_Current).playing = false;
 }
 
 // ------------------------------------------------------------------
 
 void lua_print(string str)
 {
-  cerr << Console::white << str << Console::gray << endl;
+  LOG_DEBUG(str);
 }
 
 // ------------------------------------------------------------------
@@ -117,8 +107,8 @@ void lua_print(string str)
 void lua_set_velocity_x(float v)
 {
   sl_assert(g_Current != NULL);
-  b2Vec2 vel = g_Current->body->GetLinearVelocity();
-  g_Current->body->SetLinearVelocity(b2Vec2(v, vel.y));
+  b2Vec2 vel = physics_of(g_Current).body->GetLinearVelocity();
+  physics_of(g_Current).body->SetLinearVelocity(b2Vec2(v, vel.y));
 }
 
 // ------------------------------------------------------------------
@@ -126,99 +116,95 @@ void lua_set_velocity_x(float v)
 void lua_set_velocity_y(float v)
 {
   sl_assert(g_Current != NULL);
-  b2Vec2 vel = g_Current->body->GetLinearVelocity();
-  g_Current->body->SetLinearVelocity(b2Vec2(vel.x, v));
+  b2Vec2 vel = physics_of(g_Current).body->GetLinearVelocity();
+  physics_of(g_Current).body->SetLinearVelocity(b2Vec2(vel.x, v));
 }
 
 
 void lua_set_force(float ix, float iy)
 {
 	sl_assert(g_Current != NULL);
-	g_Current->body->ApplyForce(g_Current->body->GetMass() * b2Vec2(ix, iy), g_Current->body->GetWorldCenter());
+	physics_of(g_Current).body->ApplyForce(physics_of(g_Current).body->GetMass() * b2Vec2(ix, iy), physics_of(g_Current).body->GetWorldCenter());
 }
 // ------------------------------------------------------------------
 
 void lua_set_impulse(float ix, float iy)
 {
 	sl_assert(g_Current != NULL);
-	g_Current->body->ApplyLinearImpulse(g_Current->body->GetMass()* b2Vec2(ix, iy), g_Current->body->GetWorldCenter());
+	physics_of(g_Current).body->ApplyLinearImpulse(physics_of(g_Current).body->GetMass()* b2Vec2(ix, iy), physics_of(g_Current).body->GetWorldCenter());
 }
 
 void lua_set_jump(float ix_foot, float iy_foot, float ix_left, float iy_left, float ix_right, float iy_right){
 	
-	std::cerr << Console::red << doubleJump1 << Console::gray << std::endl;
-	static t_time tmJump1 = milliseconds();
-	static t_time tmJump2 = milliseconds();
-	t_time now = milliseconds();
-	if ((g_Current->name == "player1" && (now - tmJump1) > 200) || (g_Current->name == "player2" && (now - tmJump2) > 200)) {
-		if ((g_Current->name == "player1"  && numLeftContacts1 > 0 && numFootContacts1 == 0) || (g_Current->name == "player2" && numLeftContacts2 > 0 && numFootContacts2 == 0))
+	LOG_TRACE("double jump: " << doubleJump1);
+	bool isPlayer1 = (g_Current->kind == kind_player1);
+	bool isPlayer2 = (g_Current->kind == kind_player2);
+	if (!isPlayer1 && !isPlayer2) {
+		return;
+	}
+	int  &doubleJump = isPlayer1 ? doubleJump1 : doubleJump2;
+	int  &jumpTick   = stats_of(g_Current).jumpTick;
+	int  now   = sim_ticks();
+	int  foot  = physics_of(g_Current).sensorContacts[sensor_foot];
+	int  left  = physics_of(g_Current).sensorContacts[sensor_left];
+	int  right = physics_of(g_Current).sensorContacts[sensor_right];
+	if ((now - jumpTick) * gameloop_step_ms() > 200) {
+		int jumpsBefore = doubleJump;
+		if (left > 0 && foot == 0)
 		{
 			lua_set_velocity_x(ix_left);
 			lua_set_velocity_y(iy_left);
-			if (g_Current->name == "player1") doubleJump1 = 2;
-			if (g_Current->name == "player2") doubleJump2 = 2;
-
+			doubleJump = 2;
 		}
-		else if ((g_Current->name == "player1" && numRightContacts1 > 0 && numFootContacts1 == 0) || (g_Current->name == "player2" && numRightContacts2 > 0 && numFootContacts2 == 0))
+		else if (right > 0 && foot == 0)
 		{
 			lua_set_velocity_x(ix_right);
 			lua_set_velocity_y(iy_right);
-			if (g_Current->name == "player1") doubleJump1 = 2;
-			if (g_Current->name == "player2") doubleJump2 = 2;
+			doubleJump = 2;
 		}
-
-
-		else if ((g_Current->name == "player1"  && doubleJump1 < 2) || (g_Current->name == "player2"  && doubleJump2 < 2)){
-
-			if (g_Current->name == "player1" && doubleJump1 == 0) {
-				doubleJump1++;
-				lua_set_velocity_y(iy_foot);
-			}
-			else if (g_Current->name == "player1" && doubleJump1 == 1){
-				doubleJump1++;
-				lua_set_velocity_y(iy_foot / 4.0);
-			}
-			else if (g_Current->name == "player2" && doubleJump2 == 0){
-				doubleJump2++;
-				lua_set_velocity_y(iy_foot);
-			}
-			else if (g_Current->name == "player2" && doubleJump2 == 1){
-				doubleJump2++;
-				lua_set_velocity_y(iy_foot / 4.0);
-			}
-
-
+		else if (doubleJump == 0) {
+			doubleJump++;
+			lua_set_velocity_y(iy_foot);
 		}
-		if (g_Current->name == "player1") tmJump1 = now;
-		if (g_Current->name == "player2") tmJump2 = now;
-
+		else if (doubleJump == 1) {
+			doubleJump++;
+			lua_set_velocity_y(iy_foot / 4.0);
+		}
+		if (doubleJump != jumpsBefore || (foot == 0 && (left > 0 || right > 0))) {
+			sound_play_at(snd_jump, prio_action, entity_get_pos(g_Current));
+		}
+		jumpTick = now;
 	}
 }
 
 void lua_set_walk(float ix_vel, float ix_jmp){
-	if ((g_Current->name == "player1" && numFootContacts1 > 0) || (g_Current->name == "player2" &&  numFootContacts2 > 0)){
+	bool isPlayer = (g_Current->kind == kind_player1 || g_Current->kind == kind_player2);
+	int  foot  = isPlayer ? physics_of(g_Current).sensorContacts[sensor_foot]  : 0;
+	int  left  = isPlayer ? physics_of(g_Current).sensorContacts[sensor_left]  : 0;
+	int  right = isPlayer ? physics_of(g_Current).sensorContacts[sensor_right] : 0;
+	if (foot > 0){
 		lua_set_velocity_x(ix_vel);
 	}
 
-	else if ((g_Current->name == "player1" && (numRightContacts1 > 0 && ix_jmp >= 0) && numFootContacts1 == 0) || (g_Current->name == "player2" && (numRightContacts2 > 0 && ix_jmp>=0)  && numFootContacts2 == 0)){
+	else if (right > 0 && ix_jmp >= 0){
 		lua_set_velocity_x(-0.1);
 		lua_set_velocity_y(-0.7);
 			
 	}
 
-	else if ((g_Current->name == "player1" && (numLeftContacts1 > 0  && ix_jmp <=0) && numFootContacts1 == 0) || (g_Current->name == "player2" && (numLeftContacts2 > 0 && ix_jmp<=0) && numFootContacts2 == 0)){
+	else if (left > 0 && ix_jmp <= 0){
 		lua_set_velocity_x(0.1);
 		lua_set_velocity_y(-0.7);
 	}
 
 	else{
-		b2Vec2 vel = g_Current->body->GetLinearVelocity();
-		cout << vel.x << std::endl;
-		static t_time tmJump = milliseconds();
-		t_time now = milliseconds();
-		if (now - tmJump > 300) {
+		b2Vec2 vel = physics_of(g_Current).body->GetLinearVelocity();
+		LOG_TRACE("walk: " << vel.x);
+		int &walkTick = stats_of(g_Current).walkTick;
+		int  now = sim_ticks();
+		if ((now - walkTick) * gameloop_step_ms() > 300) {
 			lua_set_impulse(ix_jmp / 50, 0);
-			tmJump = now;
+			walkTick = now;
 		}
 
 		if (vel.x > abs(ix_vel)){
@@ -234,12 +220,16 @@ void lua_set_walk(float ix_vel, float ix_jmp){
 
 
 void lua_set_correction(float ix_imp, float iy_imp){
-	if ((g_Current->name == "player1" && numRightContacts1 > 0 && numFootContacts1 == 0) || (g_Current->name == "player2" && numRightContacts2 > 0 && numFootContacts2 == 0)){
+	bool isPlayer = (g_Current->kind == kind_player1 || g_Current->kind == kind_player2);
+	if (!isPlayer || physics_of(g_Current).sensorContacts[sensor_foot] > 0) {
+		return;
+	}
+	if (physics_of(g_Current).sensorContacts[sensor_right] > 0){
 		lua_set_impulse(-ix_imp, iy_imp);
 
 	}
 
-	else if ((g_Current->name == "player1" && (numLeftContacts1 > 0) && numFootContacts1 == 0) || (g_Current->name == "player2" && numLeftContacts2 > 0 && numFootContacts2 == 0)){
+	else if (physics_of(g_Current).sensorContacts[sensor_left] > 0){
 		lua_set_impulse(ix_imp, iy_imp);
 	}
 }
@@ -258,102 +248,52 @@ void lua_set_correction(float ix_imp, float iy_imp){
 
 
 // ------------------------------------------------------------------
-extern int field;
+// the script reads and writes the entity fields in place (see bridge.cpp),
+// only the current entity needs to be known by the lua_* functions
 void begin_script_call(Entity *e)
 {
   g_Current = e;
-  for (int i = 'a'; i <= 'z'; i++) {
-    string name = "Key__";
-    name[4] = (char)i;
-    globals(e->script->lua)[name] = g_Keys[i];
-  }
-  globals(e->script->lua)["name"] = e->name;
-  v2f pos = entity_get_pos(e);
-  globals(e->script->lua)["pos_x"] = pos[0];
-  globals(e->script->lua)["pos_y"] = pos[1];
-  globals(e->script->lua)["evolution"] = e->evolution;
-  globals(e->script->lua)["pos_y"] = pos[1];
-  globals(e->script->lua)["evolution2"] = e->evolution2;
-  globals(e->script->lua)["killingContact"] = e->killingContact;
-  globals(e->script->lua)["winningContact"] = e->winningContact;
-  globals(e->script->lua)["gemContact"] = e->gemContact;
-  globals(e->script->lua)["killer"] = e->killer;
-  globals(e->script->lua)["life"] = e->life;
-  globals(e->script->lua)["movement"] = e->movement;
-  globals(e->script->lua)["score"] = e->score;
-  globals(e->script->lua)["nbOfStars"] = e->nbOfStars;
-  globals(e->script->lua)["nbOfDiamonds"] = e->nbOfDiamonds;
-  globals(e->script->lua)["field"] = field;
-  globals(e->script->lua)["isMoving"] = e->isMoving;
-  globals(e->script->lua)["isFaster"] = e->isFaster;
-  globals(e->script->lua)["isSlower"] = e->isSlower;
 }
 
 // ------------------------------------------------------------------
 
 void end_script_call(Entity *e)
 {
-  // feedback globals
-  e->pos[0] = luabind::object_cast<float>(globals(e->script->lua)["pos_x"]);
-  e->pos[1] = luabind::object_cast<float>(globals(e->script->lua)["pos_y"]);
-  e->evolution = luabind::object_cast<int>(globals(e->script->lua)["evolution"]);
-  e->evolution2 = luabind::object_cast<int>(globals(e->script->lua)["evolution2"]);
-  field = luabind::object_cast<int>(globals(e->script->lua)["field"]);
-  e->life = luabind::object_cast<int>(globals(e->script->lua)["life"]);
-  e->score = luabind::object_cast<int>(globals(e->script->lua)["score"]);
-  e->nbOfStars = luabind::object_cast<int>(globals(e->script->lua)["nbOfStars"]);
-  e->nbOfDiamonds = luabind::object_cast<int>(globals(e->script->lua)["nbOfDiamonds"]);
-  e->killingContact = luabind::object_cast<bool>(globals(e->script->lua)["killingContact"]);
-  e->gemContact = luabind::object_cast<bool>(globals(e->script->lua)["gemContact"]);
-  e->isMoving = luabind::object_cast<bool>(globals(e->script->lua)["isMoving"]);
-  e->isFaster = luabind::object_cast<bool>(globals(e->script->lua)["isFaster"]);
-  e->isSlower = luabind::object_cast<bool>(globals(e->script->lua)["isSlower"]);
   g_Current = NULL;
 }
 
-extern int whereIsBall0;
-extern int whereIsBall1;
+extern EntityHandle whereIsBall0;
+extern EntityHandle whereIsBall1;
 void lua_attack(int character, float x, float y, int direction){
 	
-	if (character == 0){
-		g_Entities[whereIsBall0]->isMoving = true;
-		if (direction == 0){
-			entity_set_pos(g_Entities[whereIsBall0], v2f(x - 45, y));
-			g_Entities[whereIsBall0]->movement = 3;
-		}
-		else{
-			entity_set_pos(g_Entities[whereIsBall0], v2f(x + 45, y));
-			g_Entities[whereIsBall0]->movement = 4;
-		}
+	Entity *ball = pool_get(character == 0 ? whereIsBall0 : whereIsBall1);
+	if (ball == NULL){
+		return;
+	}
+	stats_of(ball).isMoving = true;
+	if (direction == 0){
+		entity_set_pos(ball, v2f(x - 45, y));
+		stats_of(ball).movement = 3;
 	}
 	else{
-		g_Entities[whereIsBall1]->isMoving = true;
-		if (direction == 0){
-			entity_set_pos(g_Entities[whereIsBall1], v2f(x - 45, y));
-			g_Entities[whereIsBall1]->movement = 3;
-		}
-		else{
-			entity_set_pos(g_Entities[whereIsBall1], v2f(x + 45, y));
-			g_Entities[whereIsBall1]->movement = 4;
-		}
+		entity_set_pos(ball, v2f(x + 45, y));
+		stats_of(ball).movement = 4;
 	}
-	
 
 }
 
 void lua_throw_fire_ball(float x, float y, int direction){
 
 
-		Entity* c = entity_create("fireball", 2, "fireball.lua");
+		Entity* c = pool_spawn("fireball", 2, "fireball.lua");
 		if (direction == 0){
 			entity_set_pos(c, v2f(x - 45, y));
-			c->movement = 3;
+			stats_of(c).movement = 3;
 		}
 		else{
 			entity_set_pos(c, v2f(x + 45, y));
-			c->movement = 4;
+			stats_of(c).movement = 4;
 		}
-		g_Entities.push_back(c);
 	
 }
 
@@ -361,57 +301,16 @@ void lua_throw_fire_ball(float x, float y, int direction){
 
 // ------------------------------------------------------------------
 
-Entity *entity_create(string name, int killer, string script)
+// install our own functions into the shared VM, once
+static void entity_register_script_functions()
 {
-  Entity *e = new Entity;
-
-  e->name = name;
-  e->currentAnim = "";
-  e->currentFrame = 0;
-  e->lastAnimUpdate = 0;
-  e->killingContact = false;
-  e->winningContact = false;
-  e->gemContact = false;
-  e->isMoving = false;
-  e->isFaster = false;
-  e->isSlower = false;
-  e->killer = killer;
-  e->score = 0;
-  e->nbOfStars = 0;
-  e->nbOfDiamonds = 0;
-  
-  if (e->killer == 1)
-  {
-	  e->life = 4;
-  }
-  else if (e->killer == 3){
-	  e->life = 5;
-  }
-  else
-  {
-	  e->life = 1;
-  }
-  e->movement = 0;
-  if (script.compare("ennemy_fly.lua") == 0){
-	  e->evolution = rand() % 200;
-  }
-  else if (script.compare(0, 6, "barrel") == 0){
-	  e->evolution = rand() % 200;
-  }
-  else if (script.compare(0, 7, "monster") == 0){
-	  e->evolution = rand() % 200;
-  }
-  else{
-	  e->evolution = 0;
+  static bool registered = false;
+  if (registered) {
+    return;
   }
-  e->evolution2 = 0;
-  e->animIsPlaying = false;
-
-  /// scripting
-  e->script = script_create();
-  // install our own functions into the script
+  registered = true;
   {
-    module(e->script->lua)
+    module(script_vm())
       [
         def("addanim",  &lua_addanim),
         def("playanim", &lua_playanim),
@@ -428,18 +327,170 @@ Entity *entity_create(string name, int killer, string script)
 		def("throw_fire_ball", &lua_throw_fire_ball)
       ];
   }
-  // load the script (global space gets executed)
+}
+
+// ------------------------------------------------------------------
+
+// ------------------------------------------------------------------
+
+EntityStore g_Store;
+
+map<string, int> g_KindIds;
+
+// ------------------------------------------------------------------
+
+// interned entity name
+int entity_kind(string name)
+{
+  if (g_KindIds.empty()) {
+    g_KindIds["player1"] = kind_player1;
+    g_KindIds["player2"] = kind_player2;
+    g_KindIds["ball"]    = kind_ball;
+  }
+  map<string, int>::iterator K = g_KindIds.find(name);
+  if (K != g_KindIds.end()) {
+    return K->second;
+  }
+  int id = (int)g_KindIds.size();
+  g_KindIds[name] = id;
+  return id;
+}
+
+// ------------------------------------------------------------------
+
+// new id, with a slot in every component array
+void entity_store_add(Entity *e)
+{
+  e->id = (int)g_Store.entity.size();
+  g_Store.transform.push_back(EntityTransform());
+  g_Store.physics  .push_back(EntityPhysics());
+  g_Store.anim     .push_back(EntityAnim());
+  g_Store.stats    .push_back(EntityStats());
+  g_Store.script   .push_back(NULL);
+  g_Store.active   .push_back(0);
+  g_Store.entity   .push_back(e);
+  transform_of(e).pos  = v2i(0, 0);
+  physics_of(e).body   = NULL;
+}
+
+// ------------------------------------------------------------------
+
+// forgets all ids, the entities must have been destroyed
+void entity_store_clear()
+{
+  g_Store.transform.clear();
+  g_Store.physics  .clear();
+  g_Store.anim     .clear();
+  g_Store.stats    .clear();
+  g_Store.script   .clear();
+  g_Store.active   .clear();
+  g_Store.entity   .clear();
+}
+
+// ------------------------------------------------------------------
+
+// fields of a new or recycled entity
+static void entity_init(Entity *e, string name, int killer, string script)
+{
+  e->name = name;
+  e->kind = entity_kind(name);
+  anim_of(e).clip = -1;
+  anim_of(e).frame = 0;
+  anim_of(e).start = 0;
+  stats_of(e).killingContact = false;
+  stats_of(e).winningContact = false;
+  stats_of(e).gemContact = false;
+  stats_of(e).isMoving = false;
+  stats_of(e).isFaster = false;
+  stats_of(e).isSlower = false;
+  stats_of(e).killer = killer;
+  stats_of(e).score = 0;
+  stats_of(e).nbOfStars = 0;
+  stats_of(e).nbOfDiamonds = 0;
+  // the jump and walk cooldowns start with the entity, as in a recording
+  stats_of(e).jumpTick = sim_ticks();
+  stats_of(e).walkTick = sim_ticks();
+  
+  if (stats_of(e).killer == 1)
+  {
+	  stats_of(e).life = 4;
+  }
+  else if (stats_of(e).killer == 3){
+	  stats_of(e).life = 5;
+  }
+  else
+  {
+	  stats_of(e).life = 1;
+  }
+  stats_of(e).movement = 0;
+  if (script.compare("ennemy_fly.lua") == 0){
+	  stats_of(e).evolution = sim_rand(200);
+  }
+  else if (script.compare(0, 6, "barrel") == 0){
+	  stats_of(e).evolution = sim_rand(200);
+  }
+  else if (script.compare(0, 7, "monster") == 0){
+	  stats_of(e).evolution = sim_rand(200);
+  }
+  else{
+	  stats_of(e).evolution = 0;
+  }
+  stats_of(e).evolution2 = 0;
+  anim_of(e).playing = false;
+  transform_of(e).prevPos = v2f(0, 0);
+
+  // fixture tags
+  e->bodyTag.kind  = fixture_body;
+  e->bodyTag.owner = e;
+  e->bodyTag.slot  = 0;
+  for (int s = 0; s < num_sensors; s++) {
+    e->sensorTags[s].kind  = fixture_sensor;
+    e->sensorTags[s].owner = e;
+    e->sensorTags[s].slot  = s;
+    physics_of(e).sensorContacts[s]   = 0;
+  }
+}
+
+// ------------------------------------------------------------------
+
+// runs the script in a new environment (global space gets executed)
+static void entity_load_script(Entity *e, string script)
+{
+  entity_register_script_functions();
+  g_Store.script[e->id] = script_create();
+  // expose the entity fields to the script
+  bridge_bind_entity(script_of(e), e);
+  // the caller may be a script (e.g. throwing a fire ball)
+  Entity *caller = g_Current;
   g_Current = e;
-  script_load(e->script, executablePath()  + "/data/scripts/" + script);
-  g_Current = NULL;
+  script_load(script_of(e), executablePath()  + "/data/scripts/" + script);
+  g_Current = caller;
+}
+
+// ------------------------------------------------------------------
+
+Entity *entity_create(string name, int killer, string script)
+{
+  Entity *e = new Entity;
+
+  entity_store_add(e);
+  entity_init(e, name, killer, script);
+  e->type   = script;
+  e->slot   = -1;
+  e->active = -1;
+  e->dying  = false;
+  e->zone   = profile_zone("script " + script);
+
+  /// scripting
+  entity_load_script(e, script);
 
   // read physics properties
-  float ctrx = in_meters(luabind::object_cast<float>(globals(e->script->lua)["physics_center_x"]));
-  float ctry = in_meters(luabind::object_cast<float>(globals(e->script->lua)["physics_center_y"]));
-  float szx = in_meters(luabind::object_cast<float>(globals(e->script->lua)["physics_size_x"]));
-  float szy = in_meters(luabind::object_cast<float>(globals(e->script->lua)["physics_size_y"]));
-  bool  can_sleep  = luabind::object_cast<bool>(globals(e->script->lua)["physics_can_sleep"]);
-  bool  can_rotate = luabind::object_cast<bool>(globals(e->script->lua)["physics_rotation"]);
+  float ctrx = in_meters(script_get_number(script_of(e), "physics_center_x"));
+  float ctry = in_meters(script_get_number(script_of(e), "physics_center_y"));
+  float szx = in_meters(script_get_number(script_of(e), "physics_size_x"));
+  float szy = in_meters(script_get_number(script_of(e), "physics_size_y"));
+  bool  can_sleep  = script_get_bool(script_of(e), "physics_can_sleep");
+  bool  can_rotate = script_get_bool(script_of(e), "physics_rotation");
 
   /// physics
   // define the dynamic body
@@ -447,14 +498,14 @@ Entity *entity_create(string name, int killer, string script)
   b2BodyDef bodyDef;
   bodyDef.type = b2_dynamicBody;
   bodyDef.position.Set(0.0f, 0.0f);
-  e->body = g_World->CreateBody(&bodyDef);
-  e->body->SetSleepingAllowed(can_sleep);
-  e->body->SetFixedRotation(!can_rotate);
+  physics_of(e).body = g_World->CreateBody(&bodyDef);
+  physics_of(e).body->SetSleepingAllowed(can_sleep);
+  physics_of(e).body->SetFixedRotation(!can_rotate);
 
 
   // setup damping
-  e->body->SetLinearDamping(0.0f);
-  //e->body->SetAngularDamping(0.01f);
+  physics_of(e).body->SetLinearDamping(0.0f);
+  //physics_of(e).body->SetAngularDamping(0.01f);
 
 
   // define a box shape for our dynamic body.
@@ -466,7 +517,7 @@ Entity *entity_create(string name, int killer, string script)
   fixtureDef.shape = &box;
 
   // set the box density to be non-zero, so it will be dynamic.
-  if (e->killer == 2){
+  if (stats_of(e).killer == 2){
 	  fixtureDef.density = 0.0f;
   }
   else{
@@ -481,260 +532,236 @@ Entity *entity_create(string name, int killer, string script)
   // how bouncy?
   fixtureDef.restitution = 0.01f;
 
-  // user data (pointer to entity being created)
-  fixtureDef.userData = (void*)(e);
+  // user data (tag pointing to the entity being created)
+  fixtureDef.userData = (void*)&e->bodyTag;
 
   // add the shape to the body.
-  e->body->CreateFixture(&fixtureDef);
+  physics_of(e).body->CreateFixture(&fixtureDef);
   
-  if (e->name == "player1"){
+  if (e->kind == kind_player1 || e->kind == kind_player2){
 
 	  fixtureDef.density = 0.0f;
 	  fixtureDef.friction = 0.0f;
 	  fixtureDef.restitution = 0.0f;
-	  //add foot sensor fixture
-	  box.SetAsBox(szx - in_meters(2), in_meters(2), b2Vec2(ctrx, ctry - szy - in_meters(2)), in_meters(0));
-	  fixtureDef.isSensor = true;
-	  b2Fixture* footSensorFixture = e->body->CreateFixture(&fixtureDef);
-	  footSensorFixture->SetUserData((void*)1);
-
-
-	  box.SetAsBox(in_meters(2), szy - in_meters(3), b2Vec2(ctrx - szx - in_meters(2), ctry), in_meters(0));
-	  fixtureDef.isSensor = true;
-	  b2Fixture* leftSensorFixture = e->body->CreateFixture(&fixtureDef);
-	  leftSensorFixture->SetUserData((void*)2);
-
-
-	  box.SetAsBox(szx - in_meters(3), in_meters(2), b2Vec2(ctrx, ctry + szy + in_meters(2)), in_meters(0));
 	  fixtureDef.isSensor = true;
-	  b2Fixture* headSensorFixture = e->body->CreateFixture(&fixtureDef);
-	  headSensorFixture->SetUserData((void*)3);
-
-
-	  box.SetAsBox(in_meters(2), szy - in_meters(3), b2Vec2(ctrx + szx + in_meters(2), ctry), in_meters(0));
-	  fixtureDef.isSensor = true;
-	  b2Fixture* rightSensorFixture = e->body->CreateFixture(&fixtureDef);
-	  rightSensorFixture->SetUserData((void*)4);
+	  // sensor boxes, indexed by SensorSlot
+	  b2Vec2 half[num_sensors] = {
+		  b2Vec2(szx - in_meters(2), in_meters(2)),  // foot
+		  b2Vec2(in_meters(2), szy - in_meters(3)),  // left
+		  b2Vec2(szx - in_meters(3), in_meters(2)),  // head
+		  b2Vec2(in_meters(2), szy - in_meters(3)) }; // right
+	  b2Vec2 center[num_sensors] = {
+		  b2Vec2(ctrx, ctry - szy - in_meters(2)),
+		  b2Vec2(ctrx - szx - in_meters(2), ctry),
+		  b2Vec2(ctrx, ctry + szy + in_meters(2)),
+		  b2Vec2(ctrx + szx + in_meters(2), ctry) };
+	  for (int s = 0; s < num_sensors; s++) {
+		  box.SetAsBox(half[s].x, half[s].y, center[s], 0.0f);
+		  fixtureDef.userData = (void*)&e->sensorTags[s];
+		  physics_of(e).body->CreateFixture(&fixtureDef);
+	  }
 
   }
+  
+  return e;
+}
 
+// ------------------------------------------------------------------
 
-  if (e->name == "player2"){
-
-	  fixtureDef.density = 0.0f;
-	  fixtureDef.friction = 0.0f;
-	  fixtureDef.restitution = 0.0f;
-	  //add foot sensor fixture
-	  box.SetAsBox(szx - in_meters(2), in_meters(2), b2Vec2(ctrx, ctry - szy - in_meters(2)), in_meters(0));
-	  fixtureDef.isSensor = true;
-	  b2Fixture* footSensorFixture = e->body->CreateFixture(&fixtureDef);
-	  footSensorFixture->SetUserData((void*)5);
-
-
-	  box.SetAsBox(in_meters(2), szy - in_meters(3), b2Vec2(ctrx - szx - in_meters(2), ctry), in_meters(0));
-	  fixtureDef.isSensor = true;
-	  b2Fixture* leftSensorFixture = e->body->CreateFixture(&fixtureDef);
-	  leftSensorFixture->SetUserData((void*)6);
-
-
-	  box.SetAsBox(szx - in_meters(3), in_meters(2), b2Vec2(ctrx, ctry + szy + in_meters(2)), in_meters(0));
-	  fixtureDef.isSensor = true;
-	  b2Fixture* headSensorFixture = e->body->CreateFixture(&fixtureDef);
-	  headSensorFixture->SetUserData((void*)7);
-
+// back from the pool: same type, hence same animations and body shape
+void entity_recycle(Entity *e, string name, int killer)
+{
+  entity_init(e, name, killer, e->type);
+
+  // fresh script state
+  script_kill(script_of(e));
+  delete (script_of(e));
+  entity_load_script(e, e->type);
+
+  // back into the simulation
+  if (physics_of(e).body != NULL) {
+    physics_of(e).body->SetActive(true);
+    physics_of(e).body->SetAwake(true);
+    physics_of(e).body->SetLinearVelocity(b2Vec2(0, 0));
+    physics_of(e).body->SetAngularVelocity(0.0f);
+  }
+}
 
-	  box.SetAsBox(in_meters(2), szy - in_meters(3), b2Vec2(ctrx + szx + in_meters(2), ctry), in_meters(0));
-	  fixtureDef.isSensor = true;
-	  b2Fixture* rightSensorFixture = e->body->CreateFixture(&fixtureDef);
-	  rightSensorFixture->SetUserData((void*)8);
+// ------------------------------------------------------------------
 
+// releases the entity (the physics world must still exist)
+void entity_destroy(Entity *e)
+{
+  if (physics_of(e).body != NULL) {
+    g_World->DestroyBody(physics_of(e).body);
+    physics_of(e).body = NULL;
   }
-  
-  return e;
+  script_kill(script_of(e));
+  delete (script_of(e));
+  delete (e);
 }
 
 // ------------------------------------------------------------------
 
 v2f     entity_get_pos(Entity *e)
 {
-  b2Vec2 position = e->body->GetTransform().position;
+  b2Vec2 position = physics_of(e).body->GetTransform().position;
   return v2f(in_px(position.x), in_px(position.y));
 }
 
 // ------------------------------------------------------------------
 
+// position interpolated between the last two simulation steps
+v2f     entity_get_draw_pos(Entity *e)
+{
+  v2f cur = entity_get_pos(e);
+  return transform_of(e).prevPos + (cur - transform_of(e).prevPos) * gameloop_alpha();
+}
+
+// ------------------------------------------------------------------
+
 float   entity_get_angle(Entity *e)
 {
-  return e->body->GetTransform().R.GetAngle();
+  return physics_of(e).body->GetTransform().R.GetAngle();
 }
 
 // ------------------------------------------------------------------
 
 void    entity_set_pos(Entity *e, v2f p)
 {
-	e->body->SetTransform(b2Vec2(in_meters(p[0]), in_meters(p[1])), 0.0f);
+	physics_of(e).body->SetTransform(b2Vec2(in_meters(p[0]), in_meters(p[1])), 0.0f);
 	e->initialCoordinates = p;
+	// teleport: no interpolation from the old position
+	transform_of(e).prevPos = p;
 }
 
 // ------------------------------------------------------------------
 
 
 
-void    entity_draw(Entity *e, v2i viewpos, int decallage)
+#ifndef HEADLESS
+
+// score digit of a player, centered on column 'cx' of the separation band
+static void entity_draw_score(int score, int cx)
 {
-	if (e->killingContact == true)
+	int digits[4] = { i_0Score, i_1Score, i_2Score, i_3Score };
+	if (score < 0 || score > 3 || digits[score] < 0) {
+		return;
+	}
+	const AtlasRegion& r = g_AtlasRegions[digits[score]];
+	batch_image(digits[score], v2i(cx - r.w / 2, (int)(9.0 / 12 * c_ScreenH)), layer_hud);
+}
+
+#endif
+
+// ------------------------------------------------------------------
+
+// consequences of the contacts of the last step: respawns and gem
+// effects, part of the simulation (not of the drawing)
+void    entity_resolve(Entity *e)
+{
+	if (stats_of(e).killingContact == true)
 	{
 		
-		e->killingContact = false;
+		stats_of(e).killingContact = false;
 		entity_set_pos(e, e->initialCoordinates);
-		e->body->SetLinearVelocity(b2Vec2(0,0));
+		physics_of(e).body->SetLinearVelocity(b2Vec2(0,0));
 		
 	}
 
-	if (e->life == 0) {
+	if (stats_of(e).life == 0) {
 		return;
 	}
-	if (e->isMoving == false && e->name == "ball"){
+	if (stats_of(e).isMoving == false && e->kind == kind_ball){
 		entity_set_pos(e, v2f(-1000, -1000));
 	}
 
-	if (e->gemContact == true){
-		int effect = rand() % 100;
-		std::cerr << Console::red << effect << Console::gray << endl;
+	if (stats_of(e).gemContact == true){
+		int effect = sim_rand(100);
+		LOG_TRACE("gem effect: " << effect);
 		
 		if (effect < 25){
-			if (e->name == "player1"){
-				entity_set_pos(g_Entities[1], g_Entities[1]->initialCoordinates);
+			if (e->kind == kind_player1){
+				entity_set_pos(g_Player2, g_Player2->initialCoordinates);
 			}
 			else{
 				entity_set_pos(e, e->initialCoordinates);
 			}
 		}
 		else if (effect >= 25 && effect < 50){
-			entity_set_pos(g_Entities[0], g_Entities[0]->initialCoordinates);
+			entity_set_pos(g_Player1, g_Player1->initialCoordinates);
 		}
 		
 	    else if (effect >= 50 && effect < 75){
-			int character = rand() % 1;
-			g_Entities[character]->evolution2 = 0;
-			g_Entities[character]->isSlower = false;
-			g_Entities[character]->isFaster = true;
+			Entity *character = (sim_rand(1) == 0) ? g_Player1 : g_Player2;
+			stats_of(character).evolution2 = 0;
+			stats_of(character).isSlower = false;
+			stats_of(character).isFaster = true;
 	  }
 	  else if (effect >= 75){
-		  std::cerr << Console::red << "else " + effect << Console::gray << endl;
-		  int character = rand() % 1;
-		  g_Entities[character]->evolution2 = 0;
-		  g_Entities[character]->isFaster = false;
-		  g_Entities[character]->isSlower = true;
+		  Entity *character = (sim_rand(1) == 0) ? g_Player1 : g_Player2;
+		  stats_of(character).evolution2 = 0;
+		  stats_of(character).isFaster = false;
+		  stats_of(character).isSlower = true;
 	}
 		
-		e->gemContact = false;
+		stats_of(e).gemContact = false;
 	}
-	if (e->anims.find(e->currentAnim) == e->anims.end()) {
-		// error: the selected animation is unkown
+}
+
+// ------------------------------------------------------------------
+
+#ifndef HEADLESS
+
+void    entity_draw(Entity *e, v2i viewpos, int decallage)
+{
+	if (stats_of(e).life == 0) {
 		return;
 	}
-	// draw on screen
-	int fspc = e->anims[e->currentAnim]->framespacing;
-	v2i sz = v2i(fspc, e->anims[e->currentAnim]->animframes->h());
-	int frame = min(e->currentFrame, e->anims[e->currentAnim]->numframes - 1);
-	v2i pos = v2i(entity_get_pos(e)) - viewpos;
-
-	if ((v2i(pos) - sz / 2)[0] <= c_ScreenW && (v2i(pos) - sz / 2)[0]  > 0 && (v2i(pos) - sz / 2)[1] <= c_ScreenH && (v2i(pos) - sz / 2)[1]  > 0){
-		e->anims[e->currentAnim]->animframes->drawSub((v2i(pos) - sz / 2) - v2i(-decallage, 0) /*centered to match physics*/, sz, v2i(frame * fspc, 0), sz);
+	if (anim_of(e).clip < 0) {
+		// no animation selected
+		return;
 	}
+	// draw on screen, frame from the last animation pass
+	const SpriteAnim& clip = g_Clips[anim_of(e).clip];
+	int fspc = clip.framespacing;
+	v2i sz = v2i(fspc, clip.h);
+	int frame = min(anim_of(e).frame, clip.numframes - 1);
+	v2i pos = v2i(entity_get_draw_pos(e)) - viewpos;
 
-	// next frame
-	if (e->animIsPlaying) {
-		time_t now = milliseconds();
-		if (now - e->lastAnimUpdate > g_FrameDelay) {
-			if (e->animIsALoop) {
-				e->currentFrame = (e->currentFrame + 1) % e->anims[e->currentAnim]->numframes;
-			}
-			else {
-				if (e->currentFrame == e->anims[e->currentAnim]->numframes - 1) {
-					// call script event 
-					begin_script_call(e);
-					try {
-						call_function<void>(e->script->lua, "onAnimEnd");
-					}
-					catch (luabind::error& e) {
-						cerr << Console::red << e.what() << ' ' << Console::gray << endl;
-					}
-					end_script_call(e);
-					// increment to number of frame
-					e->currentFrame++;
-				}
-				else if (e->currentFrame < e->anims[e->currentAnim]->numframes) {
-					e->currentFrame++;
-				}
-			}
-			e->lastAnimUpdate = now;
-		}
+	if ((v2i(pos) - sz / 2)[0] <= c_ScreenW && (v2i(pos) - sz / 2)[0]  > 0 && (v2i(pos) - sz / 2)[1] <= c_ScreenH && (v2i(pos) - sz / 2)[1]  > 0){
+		batch_add(clip.region, v2i(frame * fspc, 0), sz, (v2i(pos) - sz / 2) - v2i(-decallage, 0) /*centered to match physics*/, layer_sprites);
 	}
-	if (e->name == "player1"){
 
-
-		if (e->score == 0){
-			i_0Score->draw(c_ScreenW + separation / 5 +10 - i_0Score->w() / 2, 9.0 / 12 * c_ScreenH - 0 * i_0Score->h() / 2);
-		}
-		else if (e->score == 1){
-			i_1Score->draw(c_ScreenW + separation / 5 + 10 - i_1Score->w() / 2, 9.0 / 12 * c_ScreenH - 0 * i_1Score->h() / 2);
-		}
-		else if (e->score == 2){
-			i_2Score->draw(c_ScreenW + separation / 5 + 10 - i_2Score->w() / 2, 9.0 / 12 * c_ScreenH - 0 * i_2Score->h() / 2);
-		}
-		else if (e->score == 3){
-			i_3Score->draw(c_ScreenW + separation / 5 + 10  - i_3Score->w() / 2, 9.0 / 12 * c_ScreenH - 0 * i_3Score->h() / 2);
-		}
+	if (e->kind == kind_player1){
+		entity_draw_score(stats_of(e).score, c_ScreenW + separation / 5 + 10);
 	}
 
-	if (e->name == "player2"){
-
-
-		if (e->score == 0){
-			i_0Score->draw(c_ScreenW + separation * 4 / 5 + 10 - i_0Score->w() / 2, 9.0 / 12 * c_ScreenH - 0 * i_0Score->h() / 2);
-		}
-		else if (e->score == 1){
-			i_1Score->draw(c_ScreenW + separation * 4 / 5 + 10 - i_1Score->w() / 2, 9.0 / 12 * c_ScreenH - 0 * i_1Score->h() / 2);
-		}
-		else if (e->score == 2){
-			i_2Score->draw(c_ScreenW + separation * 4 / 5 + 10 - i_2Score->w() / 2, 9.0 / 12 * c_ScreenH - 0 * i_2Score->h() / 2);
-		}
-		else if (e->score == 3){
-			i_3Score->draw(c_ScreenW + separation * 4 / 5 + 10 - i_3Score->w() / 2, 9.0 / 12 * c_ScreenH - 0 * i_3Score->h() / 2);
-		}
+	if (e->kind == kind_player2){
+		entity_draw_score(stats_of(e).score, c_ScreenW + separation * 4 / 5 + 10);
 	}
-
-	
-	
 }
 
+#endif
+
 // ------------------------------------------------------------------
 
 
 
 void    entity_step(Entity *e,time_t elapsed){
-    if (e->life == 0) {
-    // does the body still exist?
-    if (e->body != NULL) {
-      // remove from simulation!
-      g_World->DestroyBody(e->body);
-      e->body = NULL;
-    }
+    if (stats_of(e).life == 0) {
+    // leaves the simulation after the step, see pool_flush
+    pool_kill(e);
     return;
   }
   g_Current = e;
- 
+  ProfileScope scope(e->zone);
+
   // setup global variables in script
-  globals(e->script->lua)["elapsed"] = (int)elapsed;
+  bridge_set_elapsed((int)elapsed);
   // call stepping function from script
   begin_script_call(e);
-  try {
-    call_function<void>(e->script->lua, "step");
-  } catch (luabind::error& e) {
-    cerr << Console::red << e.what() << ' ' << Console::gray << endl;
-  }
+  script_call(script_of(e), "step");
   end_script_call(e);
 
 
@@ -746,20 +773,141 @@ void    entity_contact(Entity *e, Entity *with)
 {
   // call stepping function from script
   begin_script_call(e);
-  try {
-    call_function<void>(e->script->lua, "contact",with->killer);
-  } catch (luabind::error& e) {
-    cerr << Console::red << e.what() << ' ' << Console::gray << endl;
-  }
+  script_call(script_of(e), "contact", stats_of(with).killer);
   end_script_call(e);
 }
 
 // ------------------------------------------------------------------
 
+void    entity_end_contact(Entity *e, Entity *with)
+{
+  // optional in scripts
+  begin_script_call(e);
+  script_call(script_of(e), "end_contact", stats_of(with).killer);
+  end_script_call(e);
+}
+
+// ------------------------------------------------------------------
+// Systems, iterating the component arrays over the active entities
+
+// remember the state before a simulation step
+void    entity_save_state_all()
+{
+  for (int id = 0; id < (int)g_Store.physics.size(); id++) {
+    if (g_Store.active[id] && g_Store.physics[id].body != NULL) {
+      b2Vec2 position = g_Store.physics[id].body->GetTransform().position;
+      g_Store.transform[id].prevPos = v2f(in_px(position.x), in_px(position.y));
+    }
+  }
+}
+
+// ------------------------------------------------------------------
+
+// entities spawned by the scripts are stepped in the same pass
+void    entity_step_all(time_t elapsed)
+{
+  for (int id = 0; id < (int)g_Store.entity.size(); id++) {
+    if (g_Store.active[id]) {
+      entity_step(g_Store.entity[id], elapsed);
+    }
+  }
+}
+
+// ------------------------------------------------------------------
+
+void    entity_resolve_all()
+{
+  for (int id = 0; id < (int)g_Store.entity.size(); id++) {
+    if (g_Store.active[id]) {
+      entity_resolve(g_Store.entity[id]);
+    }
+  }
+}
+
+// ------------------------------------------------------------------
+
+// hash of the simulated state (bodies and stats, bit for bit), compared
+// by the replays; the cooldowns count as their age, the ticks themselves
+// depend on when the session started recording or replaying
+uint32_t entity_checksum_all()
+{
+  uint32_t h = 2166136261u; // FNV-1a
+  for (int id = 0; id < (int)g_Store.entity.size(); id++) {
+    if (!g_Store.active[id]) {
+      continue;
+    }
+    int32_t words[12];
+    memset(words, 0, sizeof(words));
+    b2Body *body = g_Store.physics[id].body;
+    if (body != NULL) {
+      float f[5] = { body->GetPosition().x, body->GetPosition().y,
+        body->GetLinearVelocity().x, body->GetLinearVelocity().y, body->GetAngle() };
+      memcpy(words, f, sizeof(f));
+    }
+    const EntityStats& st = g_Store.stats[id];
+    words[5] = id;
+    words[6] = st.life;
+    words[7] = st.score;
+    words[8] = st.nbOfStars * 256 + st.nbOfDiamonds;
+    words[9] = st.evolution;
+    words[10] = sim_ticks() - st.jumpTick;
+    words[11] = sim_ticks() - st.walkTick;
+    const uint8_t *bytes = (const uint8_t*)words;
+    for (int b = 0; b < (int)sizeof(words); b++) {
+      h = (h ^ bytes[b]) * 16777619u;
+    }
+  }
+  return h;
+}
+
+// ------------------------------------------------------------------
+
+// advances the animations to time 'now' (simulation time)
+void    entity_animate_all(time_t now)
+{
+  for (int id = 0; id < (int)g_Store.anim.size(); id++) {
+    if (!g_Store.active[id] || g_Store.stats[id].life == 0) {
+      continue;
+    }
+    EntityAnim& a = g_Store.anim[id];
+    if (!a.playing || a.clip < 0) {
+      continue;
+    }
+    int before = a.frame;
+    a.frame = anim_frame_at(a.clip, now - a.start, a.loop);
+    if (!a.loop && before < g_Clips[a.clip].numframes && a.frame == g_Clips[a.clip].numframes) {
+      // the clip is over (the script may spawn: 'a' is not used after this)
+      Entity *e = g_Store.entity[id];
+      begin_script_call(e);
+      script_call(script_of(e), "onAnimEnd");
+      end_script_call(e);
+    }
+  }
+}
+
+// ------------------------------------------------------------------
+
+#ifndef HEADLESS
+
+void    entity_draw_all(v2i viewpos, int decallage)
+{
+  PROFILE_ZONE("entity draw");
+  for (int id = 0; id < (int)g_Store.entity.size(); id++) {
+    if (g_Store.active[id]) {
+      entity_draw(g_Store.entity[id], viewpos, decallage);
+    }
+  }
+}
+
+#endif
+
+// ------------------------------------------------------------------
+
 AAB<2>  entity_bbox(Entity *e)
 {
   AAB<2> bx;
-  v2f sz = v2f(e->anims[e->currentAnim]->framespacing, e->anims[e->currentAnim]->animframes->h());
+  const SpriteAnim& clip = g_Clips[anim_of(e).clip];
+  v2f sz = v2f(clip.framespacing, clip.h);
   v2f pos = entity_get_pos(e);
   bx.addPoint(pos - sz/2.0f);
   bx.addPoint(pos + sz/2.0f);
@@ -4,79 +4,153 @@
 // ------------------------------------------------------------------
 
 #include<string>
+#include<stdint.h>
 
 using namespace std;
 
 // ------------------------------------------------------------------
 
+#ifndef HEADLESS
 #include "drawimage.h"
+#endif
 #include "script.h"
 #include "physics.h"
+#include "anim.h"
+
 
 // ------------------------------------------------------------------
 
+// what a fixture stands for, stored in its user data
+// (tile fixtures have NULL user data)
+enum FixtureKind { fixture_body = 0, fixture_sensor, num_fixture_kinds };
+enum SensorSlot  { sensor_foot = 0, sensor_left, sensor_head, sensor_right, num_sensors };
+
+struct Entity;
+
+typedef struct {
+  int     kind;
+  Entity *owner;
+  int     slot;   // SensorSlot, for sensors
+} FixtureTag;
+
+// ------------------------------------------------------------------
+
+// Entity kinds: names interned to integers (see entity_kind), the kinds
+// tested by the code come first
+enum { kind_player1 = 0, kind_player2, kind_ball, num_fixed_kinds };
+
+// ------------------------------------------------------------------
+
+// Per-frame state, split in components. Each component lives in a
+// contiguous array of g_Store, indexed by the entity id, and is
+// iterated by the systems (entity_*_all). The Entity struct keeps the
+// rest. Entities keep their id while pooled; ids are released by
+// entity_store_clear.
+
 typedef struct {
-  DrawImage *animframes;
-  int        framespacing;
-  int        numframes;
-} SpriteAnim;
+  v2i    pos;     // position written by the scripts (pos_x, pos_y)
+  v2f    prevPos; // at the previous simulation step, for interpolation
+} EntityTransform;
 
+typedef struct {
+  b2Body *body;
+  int     sensorContacts[num_sensors]; // fixtures touching each sensor
+} EntityPhysics;
+
+typedef struct {
+  int    clip;    // in g_Clips, -1 for none
+  time_t start;   // when the clip started playing
+  int    frame;   // numframes once a clip that does not loop is over
+  bool   playing;
+  bool   loop;
+} EntityAnim;
+
+typedef struct {
+  bool killingContact;
+  bool winningContact;
+  bool gemContact;
+  bool isMoving;
+  bool isFaster;
+  bool isSlower;
+  int  killer;
+  int  life;
+  int  score;
+  int  movement;
+  int  evolution;
+  int  evolution2;
+  int  nbOfStars;
+  int  nbOfDiamonds;
+  int  jumpTick;  // simulation tick of the last jump (lua_set_jump)
+  int  walkTick;  // of the last push in the air (lua_set_walk)
+} EntityStats;
+
+typedef struct {
+  vector<EntityTransform> transform;
+  vector<EntityPhysics>   physics;
+  vector<EntityAnim>      anim;
+  vector<EntityStats>     stats;
+  vector<Script*>         script;
+  vector<char>            active; // in the simulation (not pooled)
+  vector<Entity*>         entity;
+} EntityStore;
+
+extern EntityStore g_Store;
 
-struct bodyUserData {
-	int entityType;
-	b2Fixture* footSensorFixture;
-	string name;
-};
 // ------------------------------------------------------------------
 
-typedef struct
+typedef struct Entity
 {
+  int                      id;     // in g_Store
+  int                      kind;   // interned name
   string                   name;
-  map<string, SpriteAnim*> anims;
-
-  string                   currentAnim;
-  int                      currentFrame;
-  time_t                   lastAnimUpdate;
-  bool                     animIsPlaying;
-  bool                     animIsALoop;
-
-  // v2f                      pos; ==> this is now in the physics body
-  bool                     killingContact;
-  bool                     winningContact;
-  bool                     gemContact;
-  bool                     isMoving;
-  bool                     isFaster;
-  bool                     isSlower;
-  int                      killer;
-  int                      life;
-  int                      score;
-  int                      movement;
-  int                      evolution;
-  int                      evolution2;
-  int                      nbOfStars;
-  int                      nbOfDiamonds;
+  vector<int>              clips;  // added by the script
   v2f                      initialCoordinates;
-  v2i                      pos;
 
-  Script                  *script;
+  FixtureTag               bodyTag;
+  FixtureTag               sensorTags[num_sensors];
 
-  b2Body                  *body;
- 
-  b2Fixture* footSensorFixture;
-  
-  int numFootContacts;
+  // pool bookkeeping (see pool.cpp)
+  string                   type;   // script file, entities of a type are recycled together
+  int                      zone;   // profiler zone of the script steps, one per type
+  int                      slot;   // in the handle table, -1 when pooled
+  int                      active; // index in g_Entities, -1 when pooled
+  bool                     dying;  // killed, leaves the active list after the step
 
 } Entity;
 
 // ------------------------------------------------------------------
 
+// components of an entity (references are valid until the next entity
+// creation)
+inline EntityTransform& transform_of(Entity *e) { return g_Store.transform[e->id]; }
+inline EntityPhysics&   physics_of(Entity *e)   { return g_Store.physics[e->id]; }
+inline EntityAnim&      anim_of(Entity *e)      { return g_Store.anim[e->id]; }
+inline EntityStats&     stats_of(Entity *e)     { return g_Store.stats[e->id]; }
+inline Script*          script_of(Entity *e)    { return g_Store.script[e->id]; }
+
+// ------------------------------------------------------------------
+
 Entity *entity_create(string fname, int killer, string script);
+void    entity_recycle(Entity *e, string fname, int killer);
+void    entity_destroy(Entity *e);
+int     entity_kind(string name);
+void    entity_store_add(Entity *e);
+void    entity_store_clear();
+void    entity_resolve(Entity *e);
 void    entity_draw(Entity *e, v2i viewpos, int decallage);
 void    entity_step(Entity *e, time_t elapsed);
 void    entity_contact(Entity *e,Entity *with);
+void    entity_end_contact(Entity *e,Entity *with);
 AAB<2>  entity_bbox(Entity *e);
 
+void    entity_save_state_all();
+void    entity_step_all(time_t elapsed);
+void    entity_resolve_all();
+uint32_t entity_checksum_all();
+void    entity_animate_all(time_t now);
+void    entity_draw_all(v2i viewpos, int decallage);
 v2f     entity_get_pos(Entity *e);
+v2f     entity_get_draw_pos(Entity *e);
 float   entity_get_angle(Entity *e);
 void    entity_set_pos(Entity *e,v2f p);
 
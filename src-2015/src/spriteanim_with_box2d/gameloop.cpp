@@ -0,0 +1,85 @@
+// ------------------------------------------------------------------
+
+#include "gameloop.h"
+
+// ------------------------------------------------------------------
+
+float   g_StepMs      = 20.0f; // duration of a simulation step
+int     g_MaxSteps    = 5;     // cap on steps per update (spiral of death)
+float   g_Accumulator = 0.0f;  // wall time not yet simulated
+t_time  g_LastUpdate  = 0;
+bool    g_Headless    = false;
+
+// ------------------------------------------------------------------
+
+void gameloop_init(float step_ms, int max_steps)
+{
+  g_StepMs   = step_ms;
+  g_MaxSteps = max_steps;
+  gameloop_reset();
+}
+
+// ------------------------------------------------------------------
+
+// forget the time spent outside of the simulation (menus, loading)
+void gameloop_reset()
+{
+  g_Accumulator = 0.0f;
+  g_LastUpdate  = milliseconds();
+}
+
+// ------------------------------------------------------------------
+
+int gameloop_update(void (*tick)())
+{
+  if (g_Headless) {
+    // as fast as possible, wall time is ignored
+    for (int s = 0; s < g_MaxSteps; s++) {
+      tick();
+    }
+    g_Accumulator = 0.0f;
+    return g_MaxSteps;
+  }
+  t_time now = milliseconds();
+  g_Accumulator += (float)(now - g_LastUpdate);
+  g_LastUpdate = now;
+  // too far behind: drop time rather than trying to catch up forever
+  if (g_Accumulator > g_MaxSteps * g_StepMs) {
+    g_Accumulator = g_MaxSteps * g_StepMs;
+  }
+  int steps = 0;
+  while (g_Accumulator >= g_StepMs) {
+    tick();
+    g_Accumulator -= g_StepMs;
+    steps++;
+  }
+  return steps;
+}
+
+// ------------------------------------------------------------------
+
+// how far we are between the previous and the current state
+float gameloop_alpha()
+{
+  if (g_Headless) {
+    return 1.0f;
+  }
+  return g_Accumulator / g_StepMs;
+}
+
+// ------------------------------------------------------------------
+
+float gameloop_step_ms()
+{
+  return g_StepMs;
+}
+
+// ------------------------------------------------------------------
+
+void gameloop_set_headless(bool headless)
+{
+  g_Headless = headless;
+  gameloop_reset();
+}
+
+// ------------------------------------------------------------------
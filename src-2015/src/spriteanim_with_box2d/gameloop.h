@@ -0,0 +1,20 @@
+#pragma once
+
+// ------------------------------------------------------------------
+// Fixed-timestep simulation loop: wall time is accumulated and the
+// simulation advances in fixed steps, rendering interpolates between
+// the last two simulated states.
+// ------------------------------------------------------------------
+
+#include <LibSL/LibSL.h>
+
+// ------------------------------------------------------------------
+
+void   gameloop_init(float step_ms, int max_steps);
+void   gameloop_reset();
+int    gameloop_update(void (*tick)());
+float  gameloop_alpha();
+float  gameloop_step_ms();
+void   gameloop_set_headless(bool headless);
+
+// ------------------------------------------------------------------
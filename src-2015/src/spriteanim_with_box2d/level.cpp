@@ -0,0 +1,109 @@
+// ------------------------------------------------------------------
+
+#include "common.h"
+#include "level.h"
+#include "log.h"
+
+// ------------------------------------------------------------------
+
+// filled by the level scripts (see tilemap.cpp)
+extern vector<v3i> g_Ennemies;
+extern vector<v3i> g_Stars;
+extern vector<v3i> g_Gems;
+
+map<string, Level> g_Levels;         // "script#variant" -> level
+Level             *g_CurrentLevel = NULL;
+
+// ------------------------------------------------------------------
+
+// baked file of a level script and map variant
+string level_file(string fname, int variant)
+{
+  string stem = fname.substr(0, fname.rfind('.'));
+  return executablePath() + "/data/data/" + stem + "_" + to_string(variant) + ".lvl";
+}
+
+// ------------------------------------------------------------------
+
+// from its baked file if there is one, running the level script otherwise
+static Level level_load(string fname, int variant)
+{
+  g_Ennemies.clear();
+  g_Stars.clear();
+  g_Gems.clear();
+  Level lvl;
+  t_time start = milliseconds();
+  lvl.tilemap = (variant < 0) ? NULL : tilemap_load_baked(level_file(fname, variant));
+  bool baked = (lvl.tilemap != NULL);
+  if (!baked) {
+    lvl.tilemap = tilemap_load(fname, variant);
+  }
+  tilemap_bind_to_physics(lvl.tilemap);
+  LOG_INFO(fname << " #" << variant << (baked ? " baked" : " script")
+    << ": " << (milliseconds() - start) << " ms");
+  lvl.ennemies = g_Ennemies;
+  lvl.stars    = g_Stars;
+  lvl.gems     = g_Gems;
+  return lvl;
+}
+
+// ------------------------------------------------------------------
+
+Tilemap *level_switch(string fname, int variant)
+{
+  string key = fname + "#" + to_string(variant);
+  map<string, Level>::iterator L = g_Levels.find(key);
+  if (L == g_Levels.end()) {
+    // first time: run the level script and bake its collisions
+    L = g_Levels.insert(make_pair(key, level_load(fname, variant))).first;
+  }
+  Level *next = &L->second;
+  if (g_CurrentLevel != next) {
+    if (g_CurrentLevel != NULL) {
+      tilemap_set_active(g_CurrentLevel->tilemap, false);
+    }
+    tilemap_set_active(next->tilemap, true);
+    g_CurrentLevel = next;
+  }
+  g_Ennemies = next->ennemies;
+  g_Stars    = next->stars;
+  g_Gems     = next->gems;
+  return next->tilemap;
+}
+
+// ------------------------------------------------------------------
+
+// runs the level script and writes what it computed, in a world of its
+// own (the physics world must not exist)
+bool level_bake(string fname, int variant)
+{
+  g_Ennemies.clear();
+  g_Stars.clear();
+  g_Gems.clear();
+  phy_init();
+  Tilemap *tmap = tilemap_load(fname, variant);
+  tilemap_bind_to_physics(tmap);
+  bool ok = tilemap_bake(tmap, level_file(fname, variant));
+  cerr << Console::white << level_file(fname, variant) << (ok ? " baked" : " failed")
+    << " (" << tmap->rects.size() << " rectangles, "
+    << g_Ennemies.size() + g_Stars.size() + g_Gems.size() << " spawns)" << Console::gray << endl;
+  tilemap_free(tmap);
+  phy_terminate();
+  g_Ennemies.clear();
+  g_Stars.clear();
+  g_Gems.clear();
+  return ok;
+}
+
+// ------------------------------------------------------------------
+
+void level_terminate()
+{
+  for (map<string, Level>::iterator L = g_Levels.begin(); L != g_Levels.end(); L++) {
+    tilemap_free(L->second.tilemap);
+  }
+  g_Levels.clear();
+  g_CurrentLevel = NULL;
+}
+
+// ------------------------------------------------------------------
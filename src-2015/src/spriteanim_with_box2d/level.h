@@ -0,0 +1,36 @@
+#pragma once
+
+// ------------------------------------------------------------------
+// Level manager: the physics world lives for the whole session. Each
+// level (field script and map variant) is loaded, baked into static
+// collision rectangles and scanned for spawn points once. Switching
+// level only takes the previous tilemap body out of the world and puts
+// the next one in. A level baked offline is mapped from its file rather
+// than computed by its script.
+// ------------------------------------------------------------------
+
+#include<string>
+
+using namespace std;
+
+// ------------------------------------------------------------------
+
+#include "tilemap.h"
+
+// ------------------------------------------------------------------
+
+typedef struct {
+  Tilemap     *tilemap;   // bound to physics, inactive unless current
+  vector<v3i>  ennemies;  // spawn lists found by the level script
+  vector<v3i>  stars;
+  vector<v3i>  gems;
+} Level;
+
+// ------------------------------------------------------------------
+
+Tilemap *level_switch(string fname, int variant); // current level; spawn lists go to g_Ennemies, g_Stars, g_Gems
+void     level_terminate();                        // frees all levels (the physics world must still exist)
+string   level_file(string fname, int variant);    // baked file, read instead of running the script
+bool     level_bake(string fname, int variant);    // offline (-bakelevels)
+
+// ------------------------------------------------------------------
@@ -0,0 +1,109 @@
+// ------------------------------------------------------------------
+
+#include "common.h"
+#include "levelfile.h"
+
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// ------------------------------------------------------------------
+
+bool levelfile_map(string fname, MappedFile& mf)
+{
+  mf.data    = NULL;
+  mf.size    = 0;
+  mf.file    = NULL;
+  mf.mapping = NULL;
+#ifdef _WIN32
+  HANDLE file = CreateFileA(fname.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+    CloseHandle(file);
+    return false;
+  }
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (mapping == NULL) {
+    CloseHandle(file);
+    return false;
+  }
+  mf.data    = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  mf.size    = (size_t)size.QuadPart;
+  mf.file    = file;
+  mf.mapping = mapping;
+#else
+  int fd = open(fname.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    return false;
+  }
+  void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) {
+    return false;
+  }
+  mf.data = (const char*)p;
+  mf.size = (size_t)st.st_size;
+#endif
+  if (mf.data == NULL) {
+    levelfile_unmap(mf);
+    return false;
+  }
+  return true;
+}
+
+// ------------------------------------------------------------------
+
+void levelfile_unmap(MappedFile& mf)
+{
+#ifdef _WIN32
+  if (mf.data != NULL)    UnmapViewOfFile(mf.data);
+  if (mf.mapping != NULL) CloseHandle((HANDLE)mf.mapping);
+  if (mf.file != NULL)    CloseHandle((HANDLE)mf.file);
+#else
+  if (mf.data != NULL)    munmap((void*)mf.data, mf.size);
+#endif
+  mf.data    = NULL;
+  mf.size    = 0;
+  mf.file    = NULL;
+  mf.mapping = NULL;
+}
+
+// ------------------------------------------------------------------
+
+// checks the header and that every table lies within the file
+const LevelHeader *levelfile_header(const MappedFile& mf)
+{
+  if (mf.size < sizeof(LevelHeader)) {
+    return NULL;
+  }
+  const LevelHeader *hd = (const LevelHeader*)mf.data;
+  if (memcmp(hd->magic, c_LevelMagic, 4) != 0 || hd->version != c_LevelVersion || hd->fileSize != mf.size) {
+    return NULL;
+  }
+  if (hd->w <= 0 || hd->h <= 0
+    || hd->sheetsOffset + (size_t)hd->numSheets * sizeof(LevelSheet) > mf.size
+    || hd->tilesOffset  + (size_t)hd->numTiles  * sizeof(LevelTile)  > mf.size
+    || hd->rectsOffset  + (size_t)hd->numRects  * sizeof(LevelRect)  > mf.size
+    || hd->spawnsOffset + (size_t)hd->numSpawns * sizeof(LevelSpawn) > mf.size
+    || hd->gridOffset   + (size_t)hd->w * hd->h * sizeof(int16_t)    > mf.size) {
+    return NULL;
+  }
+  return hd;
+}
+
+// ------------------------------------------------------------------
@@ -0,0 +1,85 @@
+#pragma once
+
+// ------------------------------------------------------------------
+// Baked level file: what the level scripts compute, resolved once by
+// the baker (-bakelevels) and stored as fixed size records. The tilemap
+// keeps the file mapped and reads the grid and the rectangles in place;
+// only the few tile definitions and spawn points are copied out. All
+// offsets are in bytes from the start of the file. A file whose version
+// differs from c_LevelVersion is ignored, the level script is run instead.
+// ------------------------------------------------------------------
+
+#include<string>
+#include<stdint.h>
+
+using namespace std;
+
+// ------------------------------------------------------------------
+
+const char     c_LevelMagic[4] = { 'B', 'L', 'V', 'L' };
+const uint32_t c_LevelVersion  = 1;
+const int      c_LevelNameLen  = 64;
+
+enum { spawn_ennemy = 0, spawn_star, spawn_gem };
+
+typedef struct {
+  char     magic[4];
+  uint32_t version;
+  uint32_t fileSize;
+  int32_t  w;             // in tiles
+  int32_t  h;
+  int32_t  tilew;         // in pixels
+  int32_t  tileh;
+  uint32_t numSheets;     // LevelSheet[]
+  uint32_t sheetsOffset;
+  uint32_t numTiles;      // LevelTile[]
+  uint32_t tilesOffset;
+  uint32_t numRects;      // LevelRect[]
+  uint32_t rectsOffset;
+  uint32_t numSpawns;     // LevelSpawn[]
+  uint32_t spawnsOffset;
+  uint32_t gridOffset;    // int16_t[w*h]: tile index, -1 if empty
+} LevelHeader;
+
+typedef struct {
+  char    name[c_LevelNameLen]; // atlas file, relative to data/
+} LevelSheet;
+
+typedef struct {
+  int32_t sheet;
+  int32_t x;
+  int32_t y;
+  int32_t w;
+  int32_t h;
+  uint8_t color[4];             // in the map image, for tilemap_set_tileat
+} LevelTile;
+
+typedef struct {
+  int32_t x;                    // in tiles, tile (x,y) gives the tile size
+  int32_t y;
+  int32_t w;
+  int32_t h;
+} LevelRect;
+
+typedef struct {
+  int32_t kind;
+  int32_t x;                    // in pixels
+  int32_t y;
+  int32_t value;                // movement, for enemies
+} LevelSpawn;
+
+// ------------------------------------------------------------------
+
+// a read-only view of a whole file
+typedef struct {
+  const char *data;
+  size_t      size;
+  void       *file;
+  void       *mapping;
+} MappedFile;
+
+bool levelfile_map(string fname, MappedFile& mf);
+void levelfile_unmap(MappedFile& mf);
+const LevelHeader *levelfile_header(const MappedFile& mf); // NULL if not a valid level file
+
+// ------------------------------------------------------------------
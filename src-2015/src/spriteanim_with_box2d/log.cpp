@@ -0,0 +1,27 @@
+// ------------------------------------------------------------------
+
+#include "common.h"
+#include "log.h"
+
+#include <mutex>
+
+// ------------------------------------------------------------------
+
+mutex g_LogMutex; // lines of different threads do not interleave
+
+// ------------------------------------------------------------------
+
+void log_write(int level, const string& msg)
+{
+  lock_guard<mutex> lock(g_LogMutex);
+  switch (level)
+  {
+  case LOG_LEVEL_ERROR:   cerr << Console::red;    break;
+  case LOG_LEVEL_WARNING: cerr << Console::yellow; break;
+  case LOG_LEVEL_INFO:    cerr << Console::white;  break;
+  default:                cerr << Console::gray;   break;
+  }
+  cerr << msg << Console::gray << endl;
+}
+
+// ------------------------------------------------------------------
@@ -0,0 +1,66 @@
+#pragma once
+
+// ------------------------------------------------------------------
+// Leveled logger. A message below LOG_LEVEL is compiled out, its
+// arguments are not even evaluated: release builds (NDEBUG) keep the
+// warnings and errors, debug builds add the info and debug messages.
+// Per-frame values go to the trace level, only compiled in on demand
+// (-DLOG_LEVEL=0).
+//
+//   LOG_DEBUG("jumps: " << doubleJump1);
+// ------------------------------------------------------------------
+
+#include<string>
+#include<sstream>
+
+using namespace std;
+
+// ------------------------------------------------------------------
+
+#define LOG_LEVEL_TRACE   0
+#define LOG_LEVEL_DEBUG   1
+#define LOG_LEVEL_INFO    2
+#define LOG_LEVEL_WARNING 3
+#define LOG_LEVEL_ERROR   4
+
+#ifndef LOG_LEVEL
+#ifdef NDEBUG
+#define LOG_LEVEL LOG_LEVEL_WARNING
+#else
+#define LOG_LEVEL LOG_LEVEL_DEBUG
+#endif
+#endif
+
+// ------------------------------------------------------------------
+
+void log_write(int level, const string& msg); // any thread, one line
+
+#define LOG_AT(level, msg) do { ostringstream log_s_; log_s_ << msg; log_write(level, log_s_.str()); } while (0)
+
+#if LOG_LEVEL <= LOG_LEVEL_TRACE
+#define LOG_TRACE(msg)   LOG_AT(LOG_LEVEL_TRACE, msg)
+#else
+#define LOG_TRACE(msg)   do { } while (0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(msg)   LOG_AT(LOG_LEVEL_DEBUG, msg)
+#else
+#define LOG_DEBUG(msg)   do { } while (0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(msg)    LOG_AT(LOG_LEVEL_INFO, msg)
+#else
+#define LOG_INFO(msg)    do { } while (0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_WARNING
+#define LOG_WARNING(msg) LOG_AT(LOG_LEVEL_WARNING, msg)
+#else
+#define LOG_WARNING(msg) do { } while (0)
+#endif
+
+#define LOG_ERROR(msg)   LOG_AT(LOG_LEVEL_ERROR, msg)
+
+// ------------------------------------------------------------------
@@ -3,6 +3,7 @@
 //x pour commencer
 //o pour simuler la fin
 //r pour redemarrer
+//8 pour le profileur, 9 pour une trace (trace.json)
 // ------------------------------------------------------------------
 
 #include "common.h"
@@ -17,8 +18,23 @@ LIBSL_WIN32_FIX;
 #include "background.h"
 #include "physics.h"
 #include "sound.h"
+#include "music.h"
+#include "gameloop.h"
+#include "bridge.h"
+#include "pool.h"
+#include "batch.h"
+#include "stream.h"
+#include "texcache.h"
+#include "preload.h"
+#include "level.h"
+#include "sim.h"
+#include "match.h"
+#include "log.h"
+#include "profile.h"
 #include "time.h"
 
+#include <memory>
+
 
 // ------------------------------------------------------------------
 
@@ -29,14 +45,10 @@ int    c_ScreenH = 800;
 int    separation = 150;
 int    ratio_split = 2;
 
+const int c_ProfileTraceFrames = 300; // five seconds at 60 fps
+
 // ------------------------------------------------------------------
 
-time_t          g_LastFrame = 0;
-time_t          g_Music =0;
-bool            g_Keys[256];
-int i = 0;
-int r = 0;
-Tilemap        *g_Tilemap = NULL;
 Background     *g_Bkg1 = NULL;
 Background     *g_Bkg2 = NULL;
 Background     *g_HomeBkg = NULL;
@@ -44,60 +56,28 @@ Background     *g_PauseBkg = NULL;
 Background     *g_EndBkg = NULL;
 
 
-DrawImage      *g_Separation = NULL;
+int             g_Separation = -1;
 DrawImage      *i_1Heart = NULL;
 DrawImage      *i_2Heart = NULL; 
 DrawImage      *i_3Heart = NULL;
 DrawImage      *i_4Heart = NULL;
-DrawImage      *i_0Score = NULL;
-DrawImage      *i_1Score = NULL;
-DrawImage      *i_2Score = NULL;
-DrawImage      *i_3Score = NULL;
+int             i_0Score = -1;
+int             i_1Score = -1;
+int             i_2Score = -1;
+int             i_3Score = -1;
 
+bool            g_ProfileOverlay = false;
 
 
 
 
 
-enum state { waiting_to_start, playing, waiting_to_restart , end_of_the_game} g_State;
 
-vector<Entity*> g_Entities;
-vector<v2f>     g_Stars2;
-vector<v3i>     g_Ennemies;
-vector<v3i>     g_Stars;
-vector<v3i>     g_Gems;
-vector<v2f>     g_Gems2;
-Entity*         g_Player1 = NULL;
-Entity*         g_Player2 = NULL;
+enum state { waiting_to_start, playing, waiting_to_restart , end_of_the_game} g_State;
 
 v2i 			g_viewpos1 = NULL;
 v2i 			g_viewpos2 = NULL;
 
-int             numFootContacts1 = 0;
-int             numLeftContacts1 = 0;
-int             numRightContacts1 = 0;
-int             numFootContacts2 = 0;
-int             numLeftContacts2 = 0;
-int             numRightContacts2 = 0;
-int             star;
-int             five[12] = { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 };
-int             twelve[8] = { -1, -1, -1, -1, -1, -1, -1, -1};
-int             whereIsTheStar;
-int             whereIsDiamond0;
-int             whereIsDiamond1;
-int             whereIsBall0;
-int             whereIsBall1;
-bool            isInArray;
-int             field;
-int             lastField;
-int		        doubleJump1 = 0;
-int             doubleJump2 = 0;
-string			monster;
-string			barrel_r;
-string			barrel_l;
-string			spikes;
-string			level;
-string			ball;
 string          music[6] = {"629681_-FlyBoyampGabberGir.wav", "629975_Power-Play.wav", "630254_Corriamo.wav", "630325_100-Miles.wav", "630320_Roys-Our-Boy-Smash-.wav", "630701_Mega-Man-Battle-Net.wav"};
 string          theme;
 
@@ -108,14 +88,26 @@ void mainKeyPressed(uchar key)
 {
 	g_Keys[key] = true;
 
+	// profiler: the overlay, its table is printed when it closes
+	if (key == '8') {
+		g_ProfileOverlay = !g_ProfileOverlay;
+		profile_enable(g_ProfileOverlay);
+		if (!g_ProfileOverlay) {
+			profile_report();
+		}
+	}
+	// profiler: the next frames, to a Chrome trace
+	if (key == '9') {
+		profile_trace("trace.json", c_ProfileTraceFrames);
+	}
 
-	/*if (key == 'v' && (numFootContacts1 > 0 || numLeftContacts1 > 0 || numRightContacts1 > 0)) {
-		play_sound("saut.wav");
+	/*if (key == 'v' && (physics_of(g_Player1).sensorContacts[sensor_foot] > 0 || physics_of(g_Player1).sensorContacts[sensor_left] > 0 || physics_of(g_Player1).sensorContacts[sensor_right] > 0)) {
+		sound_play_at(snd_jump, prio_action, entity_get_pos(g_Player1));
 	}
 
 
-	if (key == 'n' && (numFootContacts2 > 0 || numLeftContacts2 > 0 || numRightContacts2 > 0)) {
-		play_sound("saut.wav");
+	if (key == 'n' && (physics_of(g_Player2).sensorContacts[sensor_foot] > 0 || physics_of(g_Player2).sensorContacts[sensor_left] > 0 || physics_of(g_Player2).sensorContacts[sensor_right] > 0)) {
+		sound_play_at(snd_jump, prio_action, entity_get_pos(g_Player2));
 	}*/
 
 }
@@ -133,13 +125,6 @@ void mainKeyUnpressed(uchar key)
 // 'mainRender' is called everytime the screen is drawn
 void mainRender()
 {
-	//// Compute elapsed time
-	time_t now = milliseconds();
-	time_t el = now - g_LastFrame;
-	if (el > 50) {
-		g_LastFrame = now;
-	}
-
 	if (g_State == waiting_to_start)
 	{
 		if (!g_Keys[' '])
@@ -160,21 +145,15 @@ void mainRender()
 		{
 			g_State = playing;
 			g_Keys[' '] = false;
-			play_sound(theme);
+			gameloop_reset();
+			music_play(theme, true);
 
 		}
 	}
 
 	else if (g_State == playing)
 	{
-		std::cerr << Console::red << theme << Console::gray << endl;
-		if (now - g_Music > 150000){
-			g_Music = now;
-			play_sound(theme);
-		}
-
-		if (numFootContacts1 > 0) doubleJump1 = 0;
-		if (numFootContacts2 > 0) doubleJump2 = 0;
+		PROFILE_ZONE("render");
 
 		if (g_Keys[' '])
 		{
@@ -183,37 +162,30 @@ void mainRender()
 
 		}
 
-		if (g_Player1->life == 0 || g_Player2->life == 0 || g_Player1->score == 3 || g_Player2->score == 3)
+		if (match_over())
 		{
 			g_State = end_of_the_game;
+			// a recording holds one match
+			sim_record_end();
 		}
 
-		//// Physics
-		phy_step();
+		//// Physics and logic, in fixed steps
+		gameloop_update(match_tick);
 
-		//// Logic
+		// -> update viewpos, from the interpolated positions
 
-		
-		
-
-		// -> step all entities
-		for (int a = 0; a < (int)g_Entities.size(); a++) {
-			entity_step(g_Entities[a], el);
-		}
-
-		
-
-		g_viewpos1[0] = (int)entity_get_pos(g_Player1)[0] - c_ScreenW / 2;
-		g_viewpos1[1] = (int)entity_get_pos(g_Player1)[1] - c_ScreenH / 2;
-		g_viewpos2[0] = (int)entity_get_pos(g_Player2)[0] - c_ScreenW / 2;
-		g_viewpos2[1] = (int)entity_get_pos(g_Player2)[1] - c_ScreenH / 2;
+		v2f player1 = entity_get_draw_pos(g_Player1);
+		v2f player2 = entity_get_draw_pos(g_Player2);
 
-		// -> update viewpos (x coord only in this 'game')
+		g_viewpos1[0] = (int)player1[0] - c_ScreenW / 2;
+		g_viewpos1[1] = (int)player1[1] - c_ScreenH / 2;
+		g_viewpos2[0] = (int)player2[0] - c_ScreenW / 2;
+		g_viewpos2[1] = (int)player2[1] - c_ScreenH / 2;
 
-		g_Bkg1->viewpos[0] = (int)entity_get_pos(g_Player1)[0];
-		g_Bkg1->viewpos[1] = (int)entity_get_pos(g_Player1)[1];
-		g_Bkg2->viewpos[0] = (int)entity_get_pos(g_Player2)[0];
-		g_Bkg2->viewpos[1] = (int)entity_get_pos(g_Player2)[1];
+		g_Bkg1->viewpos[0] = (int)player1[0];
+		g_Bkg1->viewpos[1] = (int)player1[1];
+		g_Bkg2->viewpos[0] = (int)player2[0];
+		g_Bkg2->viewpos[1] = (int)player2[1];
 
 
 		//// Display
@@ -232,30 +204,26 @@ void mainRender()
 		tilemap_draw(g_Tilemap, g_viewpos1, 0);
 		tilemap_draw(g_Tilemap, g_viewpos2, c_ScreenW + separation);
 
-		g_Separation->draw(c_ScreenW + separation / 2 + 10 - g_Separation->w() / 2, 0 - 0 * g_Separation->h() / 2);
+		if (g_Separation >= 0) {
+			batch_image(g_Separation, v2i(c_ScreenW + separation / 2 + 10 - g_AtlasRegions[g_Separation].w / 2, 0), layer_separation);
+		}
 
 		// -> draw all entities
-		
-			
-		entity_set_pos(g_Entities[whereIsTheStar], g_Stars2[five[g_Entities[whereIsTheStar]->nbOfStars]]);
+		entity_draw_all(g_viewpos1, 0);
+		entity_draw_all(g_viewpos2, c_ScreenW + separation);
 
-		entity_set_pos(g_Entities[whereIsDiamond0], g_Gems2[twelve[g_Entities[whereIsDiamond0]->nbOfDiamonds]]);
-		entity_set_pos(g_Entities[whereIsDiamond1], g_Gems2[twelve[g_Entities[whereIsDiamond1]->nbOfDiamonds + 4]]);
-	
-
-			
-			
-		
-		
-		for (int a = 0; a < (int)g_Entities.size(); a++) {
-				entity_draw(g_Entities[a], g_viewpos1, 0);
-				entity_draw(g_Entities[a], g_viewpos2, c_ScreenW + separation);
-		}
+		// -> tiles, separation, sprites and scores, one draw per atlas page
+		batch_draw();
 
 		
 		
 		// -> draw physics debug layer
 		//phy_debug_draw();
+
+		// -> profiler bars, in the separation band
+		if (g_ProfileOverlay) {
+			profile_draw(c_ScreenW, 0, separation, c_ScreenH);
+		}
 	}
 	else if (g_State == waiting_to_restart)
 	{
@@ -270,7 +238,8 @@ void mainRender()
 		{
 			g_State = playing;
 			g_Keys[' '] = false;
-		    play_sound(theme);
+			gameloop_reset();
+		    music_play(theme, true);
 		}
 	}
 
@@ -280,267 +249,175 @@ void mainRender()
 		if (!g_Keys[' '] || !g_Keys['q'])
 		{
 			clearScreen();
-			if (g_Player1->score == 3){
-				g_EndBkg = background_init2(400, 400, 6, 6);
+			if (stats_of(g_Player1).score == 3){
+				g_EndBkg = background_replace(g_EndBkg, 400, 400, 6, 6);
 			}
-			else if (g_Player2->score == 3){
-				g_EndBkg = background_init2(400, 400, 7, 7);
+			else if (stats_of(g_Player2).score == 3){
+				g_EndBkg = background_replace(g_EndBkg, 400, 400, 7, 7);
 			}
 			background_draw2(g_EndBkg, g_EndBkg->pos, v2i(0, 0));
-			g_Stars2.clear();
-			g_Ennemies.clear();
-			g_Stars.clear();
-	
-						
 		}
 
 		if (g_Keys[' '])
 		{
-			numFootContacts1 = 0;
-			numLeftContacts1 = 0;
-			numRightContacts1 = 0;
-			numFootContacts2 = 0;
-			numLeftContacts2 = 0;
-			numRightContacts2 = 0;
-
-			for (int i = 0; i < 8; i++){
-				twelve[i] = -1;
-			}
+			t_time rematchStart = milliseconds();
 
-			{
-				i = 0;
-				r = 0;
-				while (i < 8){
-					r = rand() % 8;
-					isInArray = std::find(std::begin(twelve), std::end(twelve), r) != std::end(twelve);
-					while (isInArray){
-						r = rand() % 8;
-						isInArray = std::find(std::begin(twelve), std::end(twelve), r) != std::end(twelve);
-					}
-					twelve[i] = r;
-					i++;
-				}
-			}
-
-			for (int i = 0; i < 12; i++){
-				five[i] = -1;
-			}
+			// new spots, field and map; entities go back to their pools and
+			// are recycled, the level is loaded on first use only and the
+			// physics world is kept
+			match_rematch();
 
-			{
-				i = 0;
-				r = 0;
-				while (i < 12){
-					r = rand() % 12;
-					isInArray = std::find(std::begin(five), std::end(five), r) != std::end(five);
-					while (isInArray){
-						r = rand() % 12;
-						isInArray = std::find(std::begin(five), std::end(five), r) != std::end(five);
-					}
-					five[i] = r;
-					i++;
-				}
-			}
+			g_Bkg1 = background_replace(g_Bkg1, c_ScreenW, c_ScreenH, field, 2);
+			g_Bkg2 = background_replace(g_Bkg2, c_ScreenW, c_ScreenH, field, 2);
+			theme = music[g_MatchTheme];
 
-			field = rand() % 4;
-			while (field == lastField){
-				field = rand() % 4;
-			}
-			lastField = field;
-			
-			g_Entities.clear();
-
-			switch (field){
-			case 0:
-				monster = "monster_ice.lua";
-				barrel_r = "barrel_ice_r.lua";
-				barrel_l = "barrel_ice_l.lua";
-				spikes = "spikes_ice.lua";
-				level = "ice_level.lua";
-				ball = "ice_ball.lua";
-				g_Bkg1 = background_init2(c_ScreenW, c_ScreenH, 0, 2);
-				g_Bkg2 = background_init2(c_ScreenW, c_ScreenH, 0, 2);
-				break;
-			case 1:
-				monster = "monster_met.lua";
-				barrel_r = "barrel_met_r.lua";
-				barrel_l = "barrel_met_l.lua";
-				spikes = "spikes_met.lua";
-				level = "met_level.lua";
-				ball = "met_ball.lua";
-				g_Bkg1 = background_init2(c_ScreenW, c_ScreenH, 1, 2);
-				g_Bkg2 = background_init2(c_ScreenW, c_ScreenH, 1, 2);
-
-				break;
-			case 2:
-				monster = "monster_nat.lua";
-				barrel_r = "barrel_nat_r.lua";
-				barrel_l = "barrel_nat_l.lua";
-				spikes = "spikes_nat.lua";
-				level = "nat_level.lua";
-				ball = "nat_ball.lua";
-				g_Bkg1 = background_init2(c_ScreenW, c_ScreenH, 2, 2);
-				g_Bkg2 = background_init2(c_ScreenW, c_ScreenH, 2, 2);
-
-				break;
-			case 3:
-				monster = "monster_wood.lua";
-				barrel_r = "barrel_wood_r.lua";
-				barrel_l = "barrel_wood_l.lua";
-				spikes = "spikes_wood.lua";
-				level = "wood_level.lua";
-				ball = "wood_ball.lua";
-				g_Bkg1 = background_init2(c_ScreenW, c_ScreenH, 3, 2);
-				g_Bkg2 = background_init2(c_ScreenW, c_ScreenH, 3, 2);
-
-				break;
-			}
+			// textures resident after the previous match
+			texcache_report();
 
+			LOG_INFO("rematch: " << (milliseconds() - rematchStart) << " ms");
 
+			g_State = playing;
+			gameloop_reset();
+			music_play(theme, true);
 
+		}
+		
+		if (g_Keys['q']){
 			
-			// terminate physics
-			phy_terminate();
-
-			// load a tilemap
-			g_Tilemap = tilemap_load(level);
+			sim_record_end();
+			sound_terminate();
+			SimpleUI::shutdown();
+			exit(0);
+		}
 
-			// init physics
-			phy_init();
 
-			// bind tilemap to physics
-			tilemap_bind_to_physics(g_Tilemap);
+	}
 
-			theme = music[rand() % 6];
+	// -> close the frame of the profiler
+	profile_frame();
 
-			{
-				Entity *c = entity_create("player1", 1, "player1.lua");
-				entity_set_pos(c, v2f(300, 1000));
-				g_Player1 = c;
-				g_Entities.push_back(c);
+}
 
+// ------------------------------------------------------------------
 
-			} {
-				Entity *c = entity_create("player2", 1, "player2.lua");
-				entity_set_pos(c, v2f(2000, 1000));
-				g_Player2 = c;
-				g_Entities.push_back(c);
-			} {
-				for (int i = 0; i < g_Ennemies.size(); i++)
-				{
-					if (g_Ennemies[i][2] == 2){
-						Entity *c = entity_create("monster", 2, monster);
-						entity_set_pos(c, v2f(g_Ennemies[i][0], g_Ennemies[i][1]));
-						g_Entities.push_back(c);
-					}
-
-					else if (g_Ennemies[i][2] == 1){
-						Entity *c = entity_create("crabs", 2, "crabs.lua");
-						entity_set_pos(c, v2f(g_Ennemies[i][0], g_Ennemies[i][1]));
-						g_Entities.push_back(c);
-					}
-
-					else if (g_Ennemies[i][2] == 0){
-						Entity *c = entity_create("fly", 2, "ennemy_fly.lua");
-						entity_set_pos(c, v2f(g_Ennemies[i][0], g_Ennemies[i][1]));
-						g_Entities.push_back(c);
-					}
-					else if (g_Ennemies[i][2] == 3){
-						Entity *c = entity_create("spikes", 2, spikes);
-						entity_set_pos(c, v2f(g_Ennemies[i][0], g_Ennemies[i][1]));
-						g_Entities.push_back(c);
-					}
-					else if (g_Ennemies[i][2] == 4){
-						
-						Entity *c = entity_create("barrel", 6, barrel_r);
-						entity_set_pos(c, v2f(g_Ennemies[i][0], g_Ennemies[i][1]));
-						g_Entities.push_back(c);
-					}
-					else if (g_Ennemies[i][2] == 5){
-						
-						Entity *c = entity_create("barrel", 6, barrel_l);
-						entity_set_pos(c, v2f(g_Ennemies[i][0], g_Ennemies[i][1]));
-						g_Entities.push_back(c);
-					}
-					else {
-						Entity *c = entity_create(to_string(i), 2, "ennemy.lua");
-						entity_set_pos(c, v2f(g_Ennemies[i][0], g_Ennemies[i][1]));
-						c->movement = g_Ennemies[i][2];
-						g_Entities.push_back(c);
-					}
-				}
-			} {
-				for (int i = 0; i < g_Stars.size(); i++){
-					v2f c = v2f(g_Stars[i][0], g_Stars[i][1]);
-					g_Stars2.push_back(c);
-				}
-			}
 
-		
 
 
-		{
-			Entity *c = entity_create("star", 3, "star.lua");
-			entity_set_pos(c, g_Stars2[five[c->nbOfStars]]);
-			g_Entities.push_back(c);
-			whereIsTheStar = g_Entities.size() - 1;
+// screen (x,y): decoded by a worker, left resident in the texture cache
+static void mainPreloadScreen(int x, int y)
+{
+	string name = executablePath() + "/data/screens/" + to_string(x) + "_" + to_string(y) + ".jpg";
+	shared_ptr<ImageRGBA*> img = make_shared<ImageRGBA*>((ImageRGBA*)NULL);
+	int decode = preload_add(name, job_image, false, [name, img] { *img = stream_decode(name, true); });
+	int upload = preload_add(name, job_upload, true, [name, img] {
+		if (*img != NULL) {
+			texcache_release(texcache_insert(name, new DrawImage(ImageRGBA_Ptr(*img))));
 		}
+	});
+	preload_depends(upload, decode);
+}
 
-		{
-			for (int i = 0; i < 2; i++){
-				Entity *c = entity_create(to_string(i), -1, "gemme.lua");
-				entity_set_pos(c, g_Gems2[twelve[c->nbOfDiamonds + 4 * i]]);
-				g_Entities.push_back(c);
+// image packed in the atlas
+static void mainPreloadAtlas(string fname)
+{
+	shared_ptr<ImageRGBA*> img = make_shared<ImageRGBA*>((ImageRGBA*)NULL);
+	int decode = preload_add(fname, job_image, false, [fname, img] { *img = atlas_decode(fname); });
+	int upload = preload_add(fname, job_upload, true, [fname, img] { atlas_insert(fname, *img); });
+	preload_depends(upload, decode);
+}
 
-			}
+// script compiled by a worker; returns the job registering it in the VM
+static int mainPreloadScript(string fname)
+{
+	string path = executablePath() + "/data/scripts/" + fname;
+	shared_ptr<string> bytecode = make_shared<string>();
+	int compile = preload_add(fname, job_script, false, [path, bytecode] {
+		if (!script_compile(path, loadFileIntoString(path.c_str()), *bytecode)) {
+			bytecode->clear();
 		}
-
-		whereIsDiamond0 = g_Entities.size() - 2;
-		whereIsDiamond1 = g_Entities.size() - 1;
-
-		{
-			for (int i = 0; i < 2; i++){
-				Entity* c = entity_create("ball", 2, ball);
-				entity_set_pos(c, v2f(-100, -100));
-				g_Entities.push_back(c);
-			}
+	});
+	int upload = preload_add(fname, job_upload, true, [path, bytecode] {
+		if (!bytecode->empty()) {
+			script_add_prototype(path, *bytecode);
 		}
+	});
+	preload_depends(upload, compile);
+	return upload;
+}
 
-		whereIsBall0 = g_Entities.size() - 2;
-		whereIsBall1 = g_Entities.size() - 1;
-
-
-
-			g_State = playing;
-			play_sound(theme);
-
-		}
-		
-		if (g_Keys['q']){
-			
-			SimpleUI::shutdown();
-			exit(0);
+// sound effect decoded by a worker
+static void mainPreloadSound(int snd)
+{
+	shared_ptr<SoundPcm> pcm = make_shared<SoundPcm>();
+	int decode = preload_add(sound_file(snd), job_sound, false, [snd, pcm] {
+		if (!sound_decode(sound_file(snd), *pcm)) {
+			pcm->samples.clear();
 		}
+	});
+	int upload = preload_add(sound_file(snd), job_upload, true, [snd, pcm] { sound_upload(snd, *pcm); });
+	preload_depends(upload, decode);
+}
 
-
+// everything the title screen and the first match need
+static void mainPreload(bool withSound)
+{
+	t_time start = milliseconds();
+	// home, pause, end and field screens
+	int screens[4][2] = { { 3, 3 }, { 4, 4 }, { 5, 5 }, { field, 2 } };
+	for (int s = 0; s < 4; s++) {
+		mainPreloadScreen(screens[s][0], screens[s][1]);
 	}
-
-	
-
-
+	mainPreloadAtlas("sprites/bandeau2.jpg");
+	mainPreloadAtlas("0.png");
+	mainPreloadAtlas("1.png");
+	mainPreloadAtlas("2.png");
+	mainPreloadAtlas("3.png");
+	string entityScripts[] = { "player1.lua", "player2.lua", "gemme.lua", "star.lua", "crabs.lua", "ennemy_fly.lua",
+		"ennemy.lua", "fireball.lua", monster, barrel_r, barrel_l, spikes, ball };
+	for (int e = 0; e < (int)(sizeof(entityScripts) / sizeof(entityScripts[0])); e++) {
+		mainPreloadScript(entityScripts[e]);
+	}
+	// the level script runs in the shared VM once compiled
+	int levelScript = mainPreloadScript(level);
+	int tilemap = preload_add(level, job_upload, true, [] { g_Tilemap = level_switch(level, g_MatchVariant); });
+	preload_depends(tilemap, levelScript);
+	if (withSound) {
+		for (int snd = 0; snd < num_sounds; snd++) {
+			mainPreloadSound(snd);
+		}
+	}
+	preload_run(0);
+	preload_report();
+	preload_clear();
+	LOG_INFO("preload: " << (milliseconds() - start) << " ms");
 }
 
 // ------------------------------------------------------------------
 
-
-
-
 // 'main' is the starting point of the application
 int main(int argc, const char **argv)
 {
-	srand(time(0));
+	// the whole session draws from the seeded generator, a replay
+	// takes the seed of its recording
+	sim_seed((uint32_t)time(0));
+	profile_thread_name("main");
 	
 	
 	try { // error handling
+
+		// script call overhead at 1, 100 and 1000 entities and spawn cost, then quit
+		if (argc > 1 && string(argv[1]) == "-scriptbench") {
+			bridge_benchmark();
+			return 0;
+		}
+
+		// songs: full decode versus streaming, time and memory, then quit
+		if (argc > 1 && string(argv[1]) == "-soundreport") {
+			for (int m = 0; m < 6; m++) {
+				music_report(music[m]);
+			}
+			return 0;
+		}
 		
 
 		// opens a window
@@ -554,236 +431,135 @@ int main(int argc, const char **argv)
 		// init drawimage library
 		drawimage_init(c_ScreenW*ratio_split + separation, c_ScreenH);
 
-
-
-		// keys
-		for (int i = 0; i < 256; i++) {
-			g_Keys[i] = false;
+		// fixture count and step time of the four fields, then quit
+		if (argc > 1 && string(argv[1]) == "-physreport") {
+			string levels[4] = { "ice_level.lua", "met_level.lua", "nat_level.lua", "wood_level.lua" };
+			for (int l = 0; l < 4; l++) {
+				tilemap_physics_report(levels[l]);
+			}
+			atlas_terminate();
+			drawimage_terminate();
+			SimpleUI::shutdown();
+			return 0;
 		}
 
-		g_State = waiting_to_start;
-
-		///// Level creation
-
-		// create background
-
 
-		g_HomeBkg = background_init2(400, 274, 3, 3);
-		g_PauseBkg = background_init2(400, 400, 4, 4);
-		g_EndBkg = background_init2(400, 400, 5, 5);
-		/*g_Bkg1 = background_init2(c_ScreenW, c_ScreenH, 0, 0);
-		g_Bkg2 = background_init2(c_ScreenW, c_ScreenH, 0, 0);*/
-
-		g_Separation = new DrawImage(executablePath()  + "/data/sprites/" + "bandeau2.jpg");
-		i_0Score = new DrawImage(executablePath()  + "/data/" + "0.png");
-		i_1Score = new DrawImage(executablePath()  + "/data/" + "1.png");
-		i_2Score = new DrawImage(executablePath()  + "/data/" + "2.png");
-		i_3Score = new DrawImage(executablePath()  + "/data/" + "3.png");
-		// load a tilemap
-		
-		field = rand() % 4;
-		lastField = field;
-		theme = music[rand() % 6];
-		
-		switch (field){
-		case 0:
-			monster = "monster_ice.lua";
-			barrel_r = "barrel_ice_r.lua";
-			barrel_l = "barrel_ice_l.lua";
-			spikes = "spikes_ice.lua";
-			level = "ice_level.lua";
-			ball = "ice_ball.lua";
-			g_Bkg1 = background_init2(c_ScreenW, c_ScreenH, 0, 2);
-			g_Bkg2 = background_init2(c_ScreenW, c_ScreenH, 0, 2);
-			break;
-		case 1:
-			monster = "monster_met.lua";
-			barrel_r = "barrel_met_r.lua";
-			barrel_l = "barrel_met_l.lua";
-			spikes = "spikes_met.lua";
-			level = "met_level.lua";
-			ball = "met_ball.lua";
-			g_Bkg1 = background_init2(c_ScreenW, c_ScreenH, 1, 2);
-			g_Bkg2 = background_init2(c_ScreenW, c_ScreenH, 1, 2);
-
-			break;
-		case 2:
-			monster = "monster_nat.lua";
-			barrel_r = "barrel_nat_r.lua";
-			barrel_l = "barrel_nat_l.lua";
-			spikes = "spikes_nat.lua";
-			level = "nat_level.lua";
-			ball = "nat_ball.lua";
-			g_Bkg1 = background_init2(c_ScreenW, c_ScreenH, 2, 2);
-			g_Bkg2 = background_init2(c_ScreenW, c_ScreenH, 2, 2);
-
-			break;
-		case 3:
-			monster = "monster_wood.lua";
-			barrel_r = "barrel_wood_r.lua";
-			barrel_l = "barrel_wood_l.lua";
-			spikes = "spikes_wood.lua";
-			level = "wood_level.lua";
-			ball = "wood_ball.lua";
-			g_Bkg1 = background_init2(c_ScreenW, c_ScreenH, 3, 2);
-			g_Bkg2 = background_init2(c_ScreenW, c_ScreenH, 3, 2);
-
-			break;
+		// bake the four fields and their map variants to level files, then quit
+		if (argc > 1 && string(argv[1]) == "-bakelevels") {
+			string levels[4] = { "ice_level.lua", "met_level.lua", "nat_level.lua", "wood_level.lua" };
+			for (int l = 0; l < 4; l++) {
+				for (int v = 0; v < 4; v++) {
+					level_bake(levels[l], v);
+				}
+			}
+			atlas_terminate();
+			drawimage_terminate();
+			SimpleUI::shutdown();
+			return 0;
 		}
 
-		g_Tilemap = tilemap_load(level);
-		// init physics
-		phy_init();
-
-		// bind tilemap to physics
-		tilemap_bind_to_physics(g_Tilemap);
-
-		// load a simple entity
-          {
-			Entity *c = entity_create("player1", 1, "player1.lua");
-			entity_set_pos(c, v2f(300, 1000));
-			g_Player1 = c;
-			g_Entities.push_back(c);
-
-
-		} {
-			Entity *c = entity_create("player2", 1, "player2.lua");
-			entity_set_pos(c, v2f(2000, 1000));
-			g_Player2 = c;
-			g_Entities.push_back(c);
-		  } {
-			for (int i = 0; i < g_Gems.size(); i++){
-				v2f c = v2f(g_Gems[i][0], g_Gems[i][1]);
-				g_Gems2.push_back(c);
-			}
+		// texture memory budget, in MB
+		if (argc > 2 && string(argv[1]) == "-texbudget") {
+			texcache_set_budget((size_t)atoi(argv[2]) * 1024 * 1024);
 		}
 
-		{
-			i = 0;
-			r = 0;
-			while (i < 8){
-				r = rand() % 8;
-				isInArray = std::find(std::begin(twelve), std::end(twelve), r) != std::end(twelve);
-				while (isInArray){
-					r = rand() % 8;
-					isInArray = std::find(std::begin(twelve), std::end(twelve), r) != std::end(twelve);
-				}
-				twelve[i] = r;
-				i++;
-			}
+		// keys
+		for (int i = 0; i < 256; i++) {
+			g_Keys[i] = false;
 		}
 
-		{
-			for (int i = 0; i < 2; i++){
-				Entity *c = entity_create(to_string(i), -1, "gemme.lua");
-				entity_set_pos(c, g_Gems2[twelve[c->nbOfDiamonds + 4 * i]]);
-				g_Entities.push_back(c);
+		g_State = waiting_to_start;
 
-			}
+		// record the first match: seed and keys of each step, replayed by
+		// the headless benchmark (brothers_bench -replay)
+		if (argc > 2 && string(argv[1]) == "-record") {
+			sim_record_begin(argv[2]);
 		}
 
-		whereIsDiamond0 = g_Entities.size() - 2;
-		whereIsDiamond1 = g_Entities.size() - 1;
-
+		///// Level creation
 
-		  {
-			for (int i = 0; i < g_Ennemies.size(); i++)
-			{
-				if (g_Ennemies[i][2]==2){
-				Entity *c = entity_create(to_string(i), 2, monster);
-				entity_set_pos(c, v2f(g_Ennemies[i][0], g_Ennemies[i][1]));
-				g_Entities.push_back(c);
-				}
+		// field, map and song; the same draws as in bench.cpp
+		match_choose();
+		theme = music[g_MatchTheme];
 
-				else if (g_Ennemies[i][2] == 1){
-					Entity *c = entity_create("crabs", 2, "crabs.lua");
-					entity_set_pos(c, v2f(g_Ennemies[i][0], g_Ennemies[i][1]));
-					g_Entities.push_back(c);
-				} 
-				
-				else if (g_Ennemies[i][2] == 0){
-					Entity *c = entity_create("fly", 2, "ennemy_fly.lua");
-					entity_set_pos(c, v2f(g_Ennemies[i][0], g_Ennemies[i][1]));
-					g_Entities.push_back(c);
-				}
-				else if (g_Ennemies[i][2] == 3){
-					Entity *c = entity_create("spikes", 2, spikes);
-					entity_set_pos(c, v2f(g_Ennemies[i][0], g_Ennemies[i][1]));
-					g_Entities.push_back(c);
-				}
-				else if (g_Ennemies[i][2] == 4){
-					
-					Entity *c = entity_create("barrel", 6, barrel_r);
-					entity_set_pos(c, v2f(g_Ennemies[i][0], g_Ennemies[i][1]));
-					g_Entities.push_back(c);
-				}
-				else if (g_Ennemies[i][2] == 5){
-				
-					Entity *c = entity_create("barrel", 6, barrel_l);
-					entity_set_pos(c, v2f(g_Ennemies[i][0], g_Ennemies[i][1]));
-					g_Entities.push_back(c);
-				}
-				else {
-					Entity *c = entity_create(to_string(i), 2, "ennemy.lua");
-					entity_set_pos(c, v2f(g_Ennemies[i][0], g_Ennemies[i][1]));
-					c->movement = g_Ennemies[i][2];
-					g_Entities.push_back(c);
-				}
-			}
-		} {
-			for (int i = 0; i < g_Stars.size(); i++){
-				v2f c = v2f(g_Stars[i][0], g_Stars[i][1]);
-				g_Stars2.push_back(c);
-			}
-		}
-	
-		{
-			i = 0;
-			r = 0;
-			while (i < 12){
-				r = rand() % 12;
-				isInArray = std::find(std::begin(five), std::end(five), r) != std::end(five);
-				while (isInArray){
-					r = rand() % 12;
-					isInArray = std::find(std::begin(five), std::end(five), r) != std::end(five);
-				}
-				five[i] = r;
-				i++;
-			}
-		}
+		// init physics, the world is kept for the whole session
+		phy_init();
 
+		// decode, compile and upload the assets in parallel, this also
+		// loads the tilemap and binds it to physics
+		bool soak = (argc > 2 && string(argv[1]) == "-soak");
+		mainPreload(!soak);
 
-		{
-			Entity *c = entity_create("star", 3, "star.lua");
-			entity_set_pos(c, g_Stars2[five[c->nbOfStars]]);
-			g_Entities.push_back(c);
-			whereIsTheStar = g_Entities.size() - 1;
-		}
+		// create background (resident, from the preload)
 
-		{
-			for (int i = 0; i < 2; i++){
-				Entity* c = entity_create("ball", 2, ball);
-				entity_set_pos(c, v2f(-1000, -1000));
-				g_Entities.push_back(c);
+		g_HomeBkg = background_init2(400, 274, 3, 3);
+		g_PauseBkg = background_init2(400, 400, 4, 4);
+		g_EndBkg = background_init2(400, 400, 5, 5);
+		g_Bkg1 = background_replace(g_Bkg1, c_ScreenW, c_ScreenH, field, 2);
+		g_Bkg2 = background_replace(g_Bkg2, c_ScreenW, c_ScreenH, field, 2);
+
+		// packed by the preload: these are lookups
+		g_Separation = atlas_add("sprites/bandeau2.jpg");
+		i_0Score = atlas_add("0.png");
+		i_1Score = atlas_add("1.png");
+		i_2Score = atlas_add("2.png");
+		i_3Score = atlas_add("3.png");
+
+		// spots of the star and the gems, then the entities
+		match_shuffle();
+		match_spawn();
+
+
+		// simulation at 50 Hz, at most 5 steps per frame
+		gameloop_init(20.0f, 5);
+
+		// headless soak test: step the match as fast as possible, then quit
+		if (soak) {
+			int numTicks = atoi(argv[2]);
+			gameloop_set_headless(true);
+			t_time start = milliseconds();
+			int ticks = 0;
+			while (ticks < numTicks) {
+				ticks += gameloop_update(match_tick);
 			}
+			t_time stop = milliseconds();
+			cerr << Console::white << ticks << " steps in " << (stop - start) << " ms" << Console::gray << endl;
+			pool_clear();
+			level_terminate();
+			phy_terminate();
+			atlas_terminate();
+			drawimage_terminate();
+			SimpleUI::shutdown();
+			return 0;
 		}
 
-		whereIsBall0 = g_Entities.size() - 2;
-		whereIsBall1 = g_Entities.size() - 1;
-
-
-		g_LastFrame = milliseconds();
-		g_Music = milliseconds();
-
 
 
 		init_sound();
 		// enter the main loop
 		SimpleUI::loop();
 
+		// close the recording if the match was not over
+		sim_record_end();
+		// stop the voices and the music thread
+		sound_terminate();
+		// delete entities and levels
+		pool_clear();
+		level_terminate();
 		// terminate physics
 		phy_terminate();
-		// terminate drawimage
+		// release the backgrounds and the texture cache
+		background_free(g_HomeBkg);
+		background_free(g_PauseBkg);
+		background_free(g_EndBkg);
+		background_free(g_Bkg1);
+		background_free(g_Bkg2);
+		texcache_report();
+		texcache_clear();
+		// stop the screen decoding threads
+		stream_terminate();
+		// release the atlas, terminate drawimage
+		atlas_terminate();
 		drawimage_terminate();
 
 		// close the window
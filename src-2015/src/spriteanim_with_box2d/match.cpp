@@ -0,0 +1,265 @@
+// ------------------------------------------------------------------
+
+#include "common.h"
+#include "match.h"
+#include "physics.h"
+#include "gameloop.h"
+#include "level.h"
+#include "sim.h"
+#include "profile.h"
+
+#include <algorithm>
+#include <chrono>
+
+// ------------------------------------------------------------------
+
+bool            g_Keys[256];
+Tilemap        *g_Tilemap = NULL;
+
+vector<v2f>     g_Stars2;
+vector<v3i>     g_Ennemies;
+vector<v3i>     g_Stars;
+vector<v3i>     g_Gems;
+vector<v2f>     g_Gems2;
+Entity*         g_Player1 = NULL;
+Entity*         g_Player2 = NULL;
+
+int             five[12] = { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 };
+int             twelve[8] = { -1, -1, -1, -1, -1, -1, -1, -1 };
+EntityHandle    whereIsTheStar;
+EntityHandle    whereIsDiamond0;
+EntityHandle    whereIsDiamond1;
+EntityHandle    whereIsBall0;
+EntityHandle    whereIsBall1;
+int             field = -1;
+int             lastField = -1;
+int             doubleJump1 = 0;
+int             doubleJump2 = 0;
+string          monster;
+string          barrel_r;
+string          barrel_l;
+string          spikes;
+string          level;
+string          ball;
+int             g_MatchVariant = 0;
+int             g_MatchTheme = 0;
+
+bool            g_MatchTiming = false;
+MatchPhases     g_MatchPhases = { 0, 0, 0, 0 };
+
+// ------------------------------------------------------------------
+
+static void match_select_field(int f)
+{
+  const char *names[4] = { "ice", "met", "nat", "wood" };
+  string n = names[f];
+  monster  = "monster_" + n + ".lua";
+  barrel_r = "barrel_" + n + "_r.lua";
+  barrel_l = "barrel_" + n + "_l.lua";
+  spikes   = "spikes_" + n + ".lua";
+  level    = n + "_level.lua";
+  ball     = n + "_ball.lua";
+}
+
+// ------------------------------------------------------------------
+
+void match_choose()
+{
+  field = sim_rand(4);
+  while (field == lastField) {
+    field = sim_rand(4);
+  }
+  lastField = field;
+  match_select_field(field);
+  g_MatchVariant = sim_rand(4);
+  g_MatchTheme   = sim_rand(c_MatchThemes);
+}
+
+// ------------------------------------------------------------------
+
+// random permutation of [0,n), drawn number by number
+static void match_permutation(int *perm, int n)
+{
+  for (int i = 0; i < n; i++) {
+    perm[i] = -1;
+  }
+  for (int i = 0; i < n; i++) {
+    int r = sim_rand(n);
+    while (std::find(perm, perm + n, r) != perm + n) {
+      r = sim_rand(n);
+    }
+    perm[i] = r;
+  }
+}
+
+// ------------------------------------------------------------------
+
+void match_shuffle()
+{
+  match_permutation(twelve, 8);
+  match_permutation(five, 12);
+}
+
+// ------------------------------------------------------------------
+
+void match_spawn()
+{
+  // no jump left over from a previous match
+  doubleJump1 = 0;
+  doubleJump2 = 0;
+  {
+    Entity *c = pool_spawn("player1", 1, "player1.lua");
+    entity_set_pos(c, v2f(300, 1000));
+    g_Player1 = c;
+  } {
+    Entity *c = pool_spawn("player2", 1, "player2.lua");
+    entity_set_pos(c, v2f(2000, 1000));
+    g_Player2 = c;
+  }
+  for (int i = 0; i < (int)g_Ennemies.size(); i++) {
+    Entity *c = NULL;
+    switch (g_Ennemies[i][2]) {
+    case 0:  c = pool_spawn("fly", 2, "ennemy_fly.lua"); break;
+    case 1:  c = pool_spawn("crabs", 2, "crabs.lua");    break;
+    case 2:  c = pool_spawn("monster", 2, monster);      break;
+    case 3:  c = pool_spawn("spikes", 2, spikes);        break;
+    case 4:  c = pool_spawn("barrel", 6, barrel_r);      break;
+    case 5:  c = pool_spawn("barrel", 6, barrel_l);      break;
+    default:
+      c = pool_spawn(to_string(i), 2, "ennemy.lua");
+      stats_of(c).movement = g_Ennemies[i][2];
+      break;
+    }
+    entity_set_pos(c, v2f(g_Ennemies[i][0], g_Ennemies[i][1]));
+  }
+  g_Stars2.clear();
+  for (int i = 0; i < (int)g_Stars.size(); i++) {
+    g_Stars2.push_back(v2f(g_Stars[i][0], g_Stars[i][1]));
+  }
+  g_Gems2.clear();
+  for (int i = 0; i < (int)g_Gems.size(); i++) {
+    g_Gems2.push_back(v2f(g_Gems[i][0], g_Gems[i][1]));
+  }
+  {
+    Entity *c = pool_spawn("star", 3, "star.lua");
+    entity_set_pos(c, g_Stars2[five[stats_of(c).nbOfStars]]);
+    whereIsTheStar = pool_handle(c);
+  }
+  for (int i = 0; i < 2; i++) {
+    Entity *c = pool_spawn(to_string(i), -1, "gemme.lua");
+    entity_set_pos(c, g_Gems2[twelve[stats_of(c).nbOfDiamonds + 4 * i]]);
+  }
+  whereIsDiamond0 = pool_handle(g_Entities[g_Entities.size() - 2]);
+  whereIsDiamond1 = pool_handle(g_Entities[g_Entities.size() - 1]);
+  for (int i = 0; i < 2; i++) {
+    Entity* c = pool_spawn("ball", 2, ball);
+    entity_set_pos(c, v2f(-1000, -1000));
+  }
+  whereIsBall0 = pool_handle(g_Entities[g_Entities.size() - 2]);
+  whereIsBall1 = pool_handle(g_Entities[g_Entities.size() - 1]);
+}
+
+// ------------------------------------------------------------------
+
+// entities go back to their pools and the spawns recycle them: same
+// bodies, fresh script state; the level is loaded on first use only
+void match_rematch()
+{
+  pool_recycle_all();
+  match_shuffle();
+  match_choose();
+  g_Tilemap = level_switch(level, g_MatchVariant);
+  match_spawn();
+}
+
+// ------------------------------------------------------------------
+
+static double match_ms_since(chrono::steady_clock::time_point& t)
+{
+  chrono::steady_clock::time_point now = chrono::steady_clock::now();
+  double ms = chrono::duration<double, milli>(now - t).count();
+  t = now;
+  return ms;
+}
+
+// ------------------------------------------------------------------
+
+void match_tick()
+{
+  PROFILE_ZONE("match tick");
+  chrono::steady_clock::time_point t;
+  if (g_MatchTiming) {
+    t = chrono::steady_clock::now();
+  }
+
+  // simulation clock, and the keys of this step when recording or replaying
+  sim_begin_step(g_Keys);
+
+  // keep the previous state for render interpolation
+  entity_save_state_all();
+
+  if (physics_of(g_Player1).sensorContacts[sensor_foot] > 0) doubleJump1 = 0;
+  if (physics_of(g_Player2).sensorContacts[sensor_foot] > 0) doubleJump2 = 0;
+
+  double entities = 0.0;
+  if (g_MatchTiming) entities += match_ms_since(t);
+
+  //// Physics
+  phy_step_world();
+  if (g_MatchTiming) g_MatchPhases.physics = match_ms_since(t);
+
+  phy_dispatch_contacts();
+  if (g_MatchTiming) g_MatchPhases.contacts = match_ms_since(t);
+
+  //// Logic
+
+  // -> step all entities
+  entity_step_all((time_t)gameloop_step_ms());
+  if (g_MatchTiming) g_MatchPhases.scripts = match_ms_since(t);
+
+  // -> respawns and gem effects
+  entity_resolve_all();
+
+  // -> star and gems at their next spot once taken
+  {
+    Entity *star = pool_get(whereIsTheStar);
+    Entity *diamond0 = pool_get(whereIsDiamond0);
+    Entity *diamond1 = pool_get(whereIsDiamond1);
+    if (star != NULL) entity_set_pos(star, g_Stars2[five[stats_of(star).nbOfStars]]);
+    if (diamond0 != NULL) entity_set_pos(diamond0, g_Gems2[twelve[stats_of(diamond0).nbOfDiamonds]]);
+    if (diamond1 != NULL) entity_set_pos(diamond1, g_Gems2[twelve[stats_of(diamond1).nbOfDiamonds + 4]]);
+  }
+
+  // -> animations, on the simulation clock (scripts may react to their end)
+  entity_animate_all(sim_time());
+
+  // -> killed entities go back to their pools
+  pool_flush();
+
+  sim_end_step(entity_checksum_all);
+  if (g_MatchTiming) g_MatchPhases.entities = entities + match_ms_since(t);
+}
+
+// ------------------------------------------------------------------
+
+bool match_over()
+{
+  return stats_of(g_Player1).life == 0 || stats_of(g_Player2).life == 0
+    || stats_of(g_Player1).score == 3 || stats_of(g_Player2).score == 3;
+}
+
+// ------------------------------------------------------------------
+
+void match_set_timing(bool timing)
+{
+  g_MatchTiming = timing;
+}
+
+// ------------------------------------------------------------------
+
+const MatchPhases& match_phases()
+{
+  return g_MatchPhases;
+}
+
+// ------------------------------------------------------------------
@@ -0,0 +1,55 @@
+#pragma once
+
+// ------------------------------------------------------------------
+// A match: the field and its scripts, the entities spawned on the
+// level and the simulation step. Shared by the game (main.cpp) and the
+// headless benchmark (bench.cpp): nothing here draws. The random draws
+// happen in the same order in both, so that a recorded match replays
+// in either.
+// ------------------------------------------------------------------
+
+#include<string>
+
+using namespace std;
+
+// ------------------------------------------------------------------
+
+#include "tilemap.h"
+#include "entity.h"
+#include "pool.h"
+
+// ------------------------------------------------------------------
+
+const int c_MatchThemes = 6; // songs a match picks from
+
+// time spent in the phases of the last step, in ms (see match_set_timing)
+typedef struct {
+  double physics;   // world step
+  double contacts;  // contact callbacks of the scripts
+  double scripts;   // step functions of the scripts
+  double entities;  // other entity passes: state, respawns, animations, pools
+} MatchPhases;
+
+extern bool     g_Keys[256];
+extern Tilemap *g_Tilemap;
+extern Entity  *g_Player1;
+extern Entity  *g_Player2;
+extern int      field;
+extern string   level;
+extern string   monster, barrel_r, barrel_l, spikes, ball;
+extern int      g_MatchVariant;   // map of the level script
+extern int      g_MatchTheme;     // in [0,c_MatchThemes)
+
+// ------------------------------------------------------------------
+
+void match_choose();              // field (not the previous one), map variant and theme
+void match_shuffle();             // spots of the star and the gems
+void match_spawn();               // players, ennemies, star, gems and balls, on g_Tilemap
+void match_rematch();             // recycles the entities: shuffle, choose, switch level, spawn
+void match_tick();                // one simulation step
+bool match_over();                // a player lost or won
+
+void match_set_timing(bool timing);
+const MatchPhases& match_phases();
+
+// ------------------------------------------------------------------
@@ -0,0 +1,286 @@
+// ------------------------------------------------------------------
+
+#include "common.h"
+#include "music.h"
+#include "profile.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#include <al.h>
+#include <alc.h>
+#include <sndfile.h>
+
+// ------------------------------------------------------------------
+
+const int c_MusicPollMs = 20; // how often the worker refills the queue
+
+typedef struct {
+  SNDFILE *file;   // NULL when nothing is playing
+  SF_INFO  info;
+  ALenum   format;
+  bool     loop;
+} MusicStream;
+
+typedef struct {
+  bool   pending;  // a command is waiting for the worker
+  bool   play;     // play 'fname', or stop
+  string fname;
+  bool   loop;
+} MusicCommand;
+
+ALuint             g_MusicSource = 0;
+ALuint             g_MusicBuffers[c_MusicBuffers];
+mutex              g_MusicMutex;
+condition_variable g_MusicWakeUp;
+MusicCommand       g_MusicCommand = { false, false, "", false };
+bool               g_MusicQuit = false;
+thread             g_MusicWorker;
+vector<ALshort>    g_MusicChunk;  // decoding scratch, owned by the worker
+
+// ------------------------------------------------------------------
+
+static void music_close(MusicStream& s)
+{
+  alSourceStop(g_MusicSource);
+  // detach all buffers, processed or not
+  alSourcei(g_MusicSource, AL_BUFFER, 0);
+  if (s.file != NULL) {
+    sf_close(s.file);
+    s.file = NULL;
+  }
+}
+
+// ------------------------------------------------------------------
+
+static bool music_open(MusicStream& s, string fname, bool loop)
+{
+  s.file = sf_open(fname.c_str(), SFM_READ, &s.info);
+  if (s.file == NULL) {
+    cerr << Console::red << "cannot open music '" << fname << "'" << Console::gray << endl;
+    return false;
+  }
+  switch (s.info.channels)
+  {
+  case 1:  s.format = AL_FORMAT_MONO16;   break;
+  case 2:  s.format = AL_FORMAT_STEREO16; break;
+  default:
+    sf_close(s.file);
+    s.file = NULL;
+    return false;
+  }
+  s.loop = loop;
+  g_MusicChunk.resize(c_MusicChunkFrames * s.info.channels);
+  return true;
+}
+
+// ------------------------------------------------------------------
+
+// decodes the next chunk into 'buffer', wrapping around at the end of
+// a looping track; false once a non looping track is over
+static bool music_fill(MusicStream& s, ALuint buffer)
+{
+  sf_count_t wanted = c_MusicChunkFrames;
+  sf_count_t got    = 0;
+  bool       rewound = false; // an empty file must not spin
+  while (got < wanted) {
+    sf_count_t n = sf_readf_short(s.file, &g_MusicChunk[got * s.info.channels], wanted - got);
+    got += n;
+    if (n > 0) {
+      rewound = false;
+    } else if (!s.loop || rewound || sf_seek(s.file, 0, SEEK_SET) < 0) {
+      break;
+    } else {
+      rewound = true;
+    }
+  }
+  if (got == 0) {
+    return false;
+  }
+  alBufferData(buffer, s.format, &g_MusicChunk[0],
+    (ALsizei)(got * s.info.channels * sizeof(ALshort)), (ALsizei)s.info.samplerate);
+  return true;
+}
+
+// ------------------------------------------------------------------
+
+static void music_start(MusicStream& s)
+{
+  int queued = 0;
+  for (int b = 0; b < c_MusicBuffers; b++) {
+    if (!music_fill(s, g_MusicBuffers[b])) {
+      break;
+    }
+    queued++;
+  }
+  if (queued > 0) {
+    alSourceQueueBuffers(g_MusicSource, queued, g_MusicBuffers);
+    alSourcePlay(g_MusicSource);
+  }
+}
+
+// ------------------------------------------------------------------
+
+// recycles the buffers the source is done with
+static void music_refill(MusicStream& s)
+{
+  PROFILE_ZONE("music refill");
+  ALint processed = 0;
+  alGetSourcei(g_MusicSource, AL_BUFFERS_PROCESSED, &processed);
+  while (processed-- > 0) {
+    ALuint buffer;
+    alSourceUnqueueBuffers(g_MusicSource, 1, &buffer);
+    if (!music_fill(s, buffer)) {
+      // end of a non looping track, let the queue drain
+      continue;
+    }
+    alSourceQueueBuffers(g_MusicSource, 1, &buffer);
+  }
+  ALint state, queued;
+  alGetSourcei(g_MusicSource, AL_SOURCE_STATE, &state);
+  alGetSourcei(g_MusicSource, AL_BUFFERS_QUEUED, &queued);
+  if (state != AL_PLAYING) {
+    if (queued > 0) {
+      // starved (e.g. the process was stalled): resume
+      alSourcePlay(g_MusicSource);
+    } else {
+      music_close(s);
+    }
+  }
+}
+
+// ------------------------------------------------------------------
+
+static void music_worker()
+{
+  profile_thread_name("music");
+  MusicStream stream;
+  stream.file = NULL;
+  while (true) {
+    MusicCommand cmd;
+    {
+      unique_lock<mutex> lock(g_MusicMutex);
+      g_MusicWakeUp.wait_for(lock, chrono::milliseconds(c_MusicPollMs),
+        [] { return g_MusicQuit || g_MusicCommand.pending; });
+      if (g_MusicQuit) {
+        break;
+      }
+      cmd = g_MusicCommand;
+      g_MusicCommand.pending = false;
+    }
+    if (cmd.pending) {
+      music_close(stream);
+      if (cmd.play && music_open(stream, cmd.fname, cmd.loop)) {
+        music_start(stream);
+      }
+    } else if (stream.file != NULL) {
+      music_refill(stream);
+    }
+  }
+  music_close(stream);
+}
+
+// ------------------------------------------------------------------
+
+void music_init()
+{
+  if (g_MusicSource != 0) {
+    return;
+  }
+  alGenSources(1, &g_MusicSource);
+  alGenBuffers(c_MusicBuffers, g_MusicBuffers);
+  g_MusicQuit = false;
+  g_MusicWorker = thread(music_worker);
+}
+
+// ------------------------------------------------------------------
+
+void music_terminate()
+{
+  if (g_MusicSource == 0) {
+    return;
+  }
+  {
+    lock_guard<mutex> lock(g_MusicMutex);
+    g_MusicQuit = true;
+  }
+  g_MusicWakeUp.notify_one();
+  g_MusicWorker.join();
+  alDeleteSources(1, &g_MusicSource);
+  alDeleteBuffers(c_MusicBuffers, g_MusicBuffers);
+  g_MusicSource = 0;
+}
+
+// ------------------------------------------------------------------
+
+void music_play(string fname, bool loop)
+{
+  {
+    lock_guard<mutex> lock(g_MusicMutex);
+    g_MusicCommand.pending = true;
+    g_MusicCommand.play    = true;
+    g_MusicCommand.fname   = executablePath() + "/data/sound/" + fname;
+    g_MusicCommand.loop    = loop;
+  }
+  g_MusicWakeUp.notify_one();
+}
+
+// ------------------------------------------------------------------
+
+void music_stop()
+{
+  {
+    lock_guard<mutex> lock(g_MusicMutex);
+    g_MusicCommand.pending = true;
+    g_MusicCommand.play    = false;
+  }
+  g_MusicWakeUp.notify_one();
+}
+
+// ------------------------------------------------------------------
+
+void music_set_gain(float gain)
+{
+  if (g_MusicSource != 0) {
+    alSourcef(g_MusicSource, AL_GAIN, gain);
+  }
+}
+
+// ------------------------------------------------------------------
+
+// time to first sound and resident PCM, decoding the whole file as
+// the sound effects do versus decoding the first chunks of a stream
+void music_report(string fname)
+{
+  string path = executablePath() + "/data/sound/" + fname;
+  SF_INFO info;
+
+  t_time start = milliseconds();
+  SNDFILE *file = sf_open(path.c_str(), SFM_READ, &info);
+  if (file == NULL) {
+    cerr << Console::red << "cannot open music '" << fname << "'" << Console::gray << endl;
+    return;
+  }
+  vector<ALshort> whole((size_t)(info.frames * info.channels));
+  sf_readf_short(file, &whole[0], info.frames);
+  sf_close(file);
+  t_time fullMs = milliseconds() - start;
+  size_t fullBytes = whole.size() * sizeof(ALshort);
+
+  start = milliseconds();
+  file = sf_open(path.c_str(), SFM_READ, &info);
+  vector<ALshort> ring((size_t)(c_MusicBuffers * c_MusicChunkFrames * info.channels));
+  sf_readf_short(file, &ring[0], c_MusicBuffers * c_MusicChunkFrames);
+  sf_close(file);
+  t_time streamMs = milliseconds() - start;
+  size_t streamBytes = ring.size() * sizeof(ALshort);
+
+  cerr << Console::white << fname
+    << " full decode: " << fullMs << " ms " << fullBytes / 1024 << " KB"
+    << " streamed: " << streamMs << " ms " << streamBytes / 1024 << " KB"
+    << Console::gray << endl;
+}
+
+// ------------------------------------------------------------------
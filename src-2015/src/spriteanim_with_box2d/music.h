@@ -0,0 +1,28 @@
+#pragma once
+
+// ------------------------------------------------------------------
+// Music streaming: a track is decoded in chunks by a worker thread,
+// which keeps a ring of OpenAL buffers queued on the music source.
+// Only a few chunks of PCM are resident at a time, and a track loops
+// when its decoder reaches the end of the file.
+// ------------------------------------------------------------------
+
+#include<string>
+
+using namespace std;
+
+// ------------------------------------------------------------------
+
+const int c_MusicBuffers     = 4;    // queued on the source
+const int c_MusicChunkFrames = 8192; // per buffer (~190 ms at 44.1 kHz)
+
+// ------------------------------------------------------------------
+
+void music_init();                     // once the OpenAL context is current
+void music_terminate();
+void music_play(string fname, bool loop); // restarts the track if already playing
+void music_stop();
+void music_set_gain(float gain);       // volume of the music bus
+void music_report(string fname);       // full decode vs streaming: time and memory
+
+// ------------------------------------------------------------------
@@ -1,7 +1,15 @@
 #include "physics.h"
 #include "entity.h"
+#include "pool.h"
 #include "sound.h"
+#include "gameloop.h"
+#include "profile.h"
+#ifndef HEADLESS
 #include <LibSL_gl.h>
+#endif
+
+#include <thread>
+#include <algorithm>
 
 //
 // see http://www.iforce2d.net/b2dtut/ for a nice tutorial
@@ -12,13 +20,8 @@
 // The World
 b2World *g_World = NULL;
 
-// get access to foot contact from main.cpp
-extern int             numFootContacts1;
-extern int             numLeftContacts1;
-extern int             numRightContacts1;
-extern int             numFootContacts2;
-extern int             numLeftContacts2;
-extern int             numRightContacts2;
+const int c_PhySolverThreads = 4; // at most; the results do not depend on it
+const float c_PhyTreeRebuildGrowth = 1.5f; // rebuild the broad-phase tree once its cost grew that much
 
 // converters
 
@@ -33,126 +36,61 @@ int in_px(float m) {
 
 // ------------------------------------------------------------------------
 
-class ContactListener : public b2ContactListener
-{
-public:
-  void BeginContact(b2Contact* contact)  {
-	  //check if player1 touch the floor
-	  void* fixtureUserData = contact->GetFixtureA()->GetUserData();
-	  if (fixtureUserData!=NULL && (int)fixtureUserData == 1)
-		  numFootContacts1++;
-	  fixtureUserData = contact->GetFixtureB()->GetUserData();
-	  if (fixtureUserData != NULL && (int)fixtureUserData == 1)
-		  numFootContacts1++;
-	  
-	  //check if player1 touch by the left
-	  fixtureUserData = contact->GetFixtureA()->GetUserData();
-	  if (fixtureUserData != NULL && (int)fixtureUserData == 2)
-		  numLeftContacts1++;
-	  fixtureUserData = contact->GetFixtureB()->GetUserData();
-	  if (fixtureUserData != NULL && (int)fixtureUserData == 2)
-		  numLeftContacts1++;
-
-	  //check if player1 touch by the right
-	  fixtureUserData = contact->GetFixtureA()->GetUserData();
-	  if (fixtureUserData != NULL && (int)fixtureUserData == 4)
-		  numRightContacts1++;
-	  fixtureUserData = contact->GetFixtureB()->GetUserData();
-	  if (fixtureUserData != NULL && (int)fixtureUserData == 4)
-		  numRightContacts1++;
-	  
-	  //check if player2 touch the floor
-	  fixtureUserData = contact->GetFixtureA()->GetUserData();
-	  if (fixtureUserData != NULL && (int)fixtureUserData == 5)
-		  numFootContacts2++;
-	  fixtureUserData = contact->GetFixtureB()->GetUserData();
-	  if (fixtureUserData != NULL && (int)fixtureUserData == 5)
-		  numFootContacts2++;
-
-	  //check if player2 touch by the left
-	  fixtureUserData = contact->GetFixtureA()->GetUserData();
-	  if (fixtureUserData != NULL && (int)fixtureUserData == 6)
-		  numLeftContacts2++;
-	  fixtureUserData = contact->GetFixtureB()->GetUserData();
-	  if (fixtureUserData != NULL && (int)fixtureUserData == 6)
-		  numLeftContacts2++;
-
-	  //check if player2 touch by the right
-	  fixtureUserData = contact->GetFixtureA()->GetUserData();
-	  if (fixtureUserData != NULL && (int)fixtureUserData == 8)
-		  numRightContacts2++;
-	  fixtureUserData = contact->GetFixtureB()->GetUserData();
-	  if (fixtureUserData != NULL && (int)fixtureUserData == 8)
-		  numRightContacts2++;
+// contacts between entity bodies, reported to the scripts after the step
+// (by handle: an entity may be pooled in the meantime)
+typedef struct {
+  EntityHandle e;
+  EntityHandle with;
+  bool         begin;
+} ContactEvent;
 
+vector<ContactEvent> g_ContactEvents;
 
+// ------------------------------------------------------------------------
+
+// dispatch table: what happens to a fixture when it starts (delta = 1)
+// or stops (delta = -1) touching another one
+typedef void (*ContactHandler)(FixtureTag *tag, FixtureTag *other, int delta);
+
+static void contact_body(FixtureTag *tag, FixtureTag *other, int delta)
+{
+  // scripts only hear about other entity bodies
+  if (other != NULL && other->kind == fixture_body) {
+    ContactEvent ev;
+    ev.e     = pool_handle(tag->owner);
+    ev.with  = pool_handle(other->owner);
+    ev.begin = (delta > 0);
+    g_ContactEvents.push_back(ev);
   }
+}
 
-  void EndContact(b2Contact* contact)    { 
-
-	  
-	  //check if player1 touch the floor
-	  void* fixtureUserData = contact->GetFixtureA()->GetUserData();
-	  if (fixtureUserData != NULL && (int)fixtureUserData == 1)
-		  numFootContacts1--;
-	  fixtureUserData = contact->GetFixtureB()->GetUserData();
-	  if (fixtureUserData != NULL && (int)fixtureUserData == 1)
-		  numFootContacts1--;
-
-	  //check if player1 touch by the left
-	  fixtureUserData = contact->GetFixtureA()->GetUserData();
-	  if (fixtureUserData != NULL && (int)fixtureUserData == 2)
-		  numLeftContacts1--;
-	  fixtureUserData = contact->GetFixtureB()->GetUserData();
-	  if (fixtureUserData != NULL && (int)fixtureUserData == 2)
-		  numLeftContacts1--;
-
-	  //check if player1 touch by the right
-	  fixtureUserData = contact->GetFixtureA()->GetUserData();
-	  if (fixtureUserData != NULL && (int)fixtureUserData == 4)
-		  numRightContacts1--;
-	  fixtureUserData = contact->GetFixtureB()->GetUserData();
-	  if (fixtureUserData != NULL && (int)fixtureUserData == 4)
-		  numRightContacts1--;
-
-	  //check if player2 touch the floor
-	  fixtureUserData = contact->GetFixtureA()->GetUserData();
-	  if (fixtureUserData != NULL && (int)fixtureUserData == 5)
-		  numFootContacts2--;
-	  fixtureUserData = contact->GetFixtureB()->GetUserData();
-	  if (fixtureUserData != NULL && (int)fixtureUserData == 5)
-		  numFootContacts2--;
-
-	  //check if player2 touch by the left
-	  fixtureUserData = contact->GetFixtureA()->GetUserData();
-	  if (fixtureUserData != NULL && (int)fixtureUserData == 6)
-		  numLeftContacts2--;
-	  fixtureUserData = contact->GetFixtureB()->GetUserData();
-	  if (fixtureUserData != NULL && (int)fixtureUserData == 6)
-		  numLeftContacts2--;
-
-	  //check if player2 touch by the right
-	  fixtureUserData = contact->GetFixtureA()->GetUserData();
-	  if (fixtureUserData != NULL && (int)fixtureUserData == 8)
-		  numRightContacts2--;
-	  fixtureUserData = contact->GetFixtureB()->GetUserData();
-	  if (fixtureUserData != NULL && (int)fixtureUserData == 8)
-		  numRightContacts2--;
+static void contact_sensor(FixtureTag *tag, FixtureTag *other, int delta)
+{
+  physics_of(tag->owner).sensorContacts[tag->slot] += delta;
+}
 
+ContactHandler g_ContactHandlers[num_fixture_kinds] = {
+  contact_body,   // fixture_body
+  contact_sensor, // fixture_sensor
+};
 
+// ------------------------------------------------------------------------
 
+class ContactListener : public b2ContactListener
+{
+public:
+  void dispatch(b2Contact* contact, int delta)
+  {
+    FixtureTag *tA = (FixtureTag*)contact->GetFixtureA()->GetUserData();
+    FixtureTag *tB = (FixtureTag*)contact->GetFixtureB()->GetUserData();
+    // tiles have no tag
+    if (tA != NULL) g_ContactHandlers[tA->kind](tA, tB, delta);
+    if (tB != NULL) g_ContactHandlers[tB->kind](tB, tA, delta);
   }
+  void BeginContact(b2Contact* contact)  { dispatch(contact,  1); }
+  void EndContact(b2Contact* contact)    { dispatch(contact, -1); }
   void PreSolve(b2Contact* contact, const b2Manifold* oldManifold)
   {
-    // get fixtures
-    b2Fixture    *fA = contact->GetFixtureA();
-    b2Fixture    *fB = contact->GetFixtureB();
-    void *dA = fA->GetUserData();
-    void *dB = fB->GetUserData();
-    if (dA != NULL && dB != NULL) {
-      entity_contact((Entity*)dA, (Entity*)dB);
-	  entity_contact((Entity*)dB, (Entity*)dA);
-    }
     // To disable contact: contact->SetEnabled(false);
   }
   void PostSolve(b2Contact* contact, const b2ContactImpulse* impulse) { }
@@ -162,6 +100,8 @@ ContactListener g_ContactListener;
 
 // ------------------------------------------------------------------------
 
+#ifndef HEADLESS
+
 class DebugDraw : public b2DebugDraw
 {
 public:
@@ -211,6 +151,8 @@ public:
 
 DebugDraw g_DebugDraw;
 
+#endif
+
 // ------------------------------------------------------------------------
 
 void phy_init()
@@ -227,9 +169,18 @@ void phy_init()
   // define contact listener, keeping track of collisions/contacts
   g_World->SetContactListener(&g_ContactListener);
 
+  // independent islands (e.g. groups of ennemies) are solved in parallel
+  int cores = (int)thread::hardware_concurrency();
+  g_World->SetSolverThreadCount(max(1, min(c_PhySolverThreads, cores)));
+
+  // moving entities slowly degrade the broad-phase tree, rebuilt in the background
+  g_World->SetTreeRebuildThreshold(c_PhyTreeRebuildGrowth);
+
+#ifndef HEADLESS
   // for debugging only
   g_World->SetDebugDraw(&g_DebugDraw);
   g_DebugDraw.SetFlags(b2DebugDraw::e_shapeBit);
+#endif
 
 }
 
@@ -237,17 +188,41 @@ void phy_init()
 
 void phy_step()
 {
-  static t_time tmLast = milliseconds();
-  t_time now = milliseconds();
-  if (now - tmLast > 20) {
-    // step the engine
-    // NOTE: here we use a fixed step
-    float timeStep = 1/50.0;
-    int velocityIterations = 3; // number of internal velocity iters.
-    int positionIterations = 1; // number of internal position iters.
-    g_World->Step(timeStep, velocityIterations, positionIterations);
-    tmLast = now;
+  phy_step_world();
+  phy_dispatch_contacts();
+}
+
+// ------------------------------------------------------------------------
+
+void phy_step_world()
+{
+  PROFILE_ZONE("physics step");
+  // step the engine, at the fixed rate of the game loop
+  float timeStep = gameloop_step_ms() / 1000.0f;
+  int velocityIterations = 3; // number of internal velocity iters.
+  int positionIterations = 1; // number of internal position iters.
+  g_World->Step(timeStep, velocityIterations, positionIterations);
+}
+
+// ------------------------------------------------------------------------
+
+// the world is unlocked: let the scripts react to the contacts
+void phy_dispatch_contacts()
+{
+  PROFILE_ZONE("physics contacts");
+  for (int c = 0; c < (int)g_ContactEvents.size(); c++) {
+    Entity *e    = pool_get(g_ContactEvents[c].e);
+    Entity *with = pool_get(g_ContactEvents[c].with);
+    if (e == NULL || with == NULL) {
+      continue;
+    }
+    if (g_ContactEvents[c].begin) {
+      entity_contact(e, with);
+    } else {
+      entity_end_contact(e, with);
+    }
   }
+  g_ContactEvents.clear();
 }
 
 // ------------------------------------------------------------------------
@@ -257,10 +232,13 @@ void phy_terminate()
   if (g_World != NULL) {
     delete (g_World);
   }
+  g_ContactEvents.clear();
 }
 
 // ------------------------------------------------------------------------
 
+#ifndef HEADLESS
+
 extern int    c_ScreenW;
 extern int    c_ScreenH;
 extern int    ratio_split;
@@ -271,4 +249,6 @@ void phy_debug_draw()
   g_World->DrawDebugData();
 }
 
+#endif
+
 // ------------------------------------------------------------------------
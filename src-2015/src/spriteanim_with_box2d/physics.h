@@ -9,7 +9,9 @@ float in_meters(int px);
 int in_px(float meters);
 
 void phy_init();
-void phy_step();
+void phy_step();              // phy_step_world, then phy_dispatch_contacts
+void phy_step_world();
+void phy_dispatch_contacts(); // contact callbacks of the scripts
 void phy_terminate();
 
 void phy_debug_draw();
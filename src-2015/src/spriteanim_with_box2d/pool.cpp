@@ -0,0 +1,166 @@
+// ------------------------------------------------------------------
+
+#include "common.h"
+#include "pool.h"
+
+// ------------------------------------------------------------------
+
+typedef struct {
+  Entity *e;          // NULL when free
+  int     generation; // incremented when the entity goes back to its pool
+} PoolSlot;
+
+vector<Entity*>                g_Entities;
+vector<PoolSlot>               g_Slots;
+vector<int>                    g_FreeSlots;
+map<string, vector<Entity*> >  g_Pools;  // type -> entities ready to be recycled
+vector<Entity*>                g_Dying;  // killed during this step
+
+// ------------------------------------------------------------------
+
+static int alloc_slot(Entity *e)
+{
+  int s;
+  if (g_FreeSlots.empty()) {
+    s = (int)g_Slots.size();
+    PoolSlot slot;
+    slot.generation = 0;
+    g_Slots.push_back(slot);
+  } else {
+    s = g_FreeSlots.back();
+    g_FreeSlots.pop_back();
+  }
+  g_Slots[s].e = e;
+  return s;
+}
+
+// ------------------------------------------------------------------
+
+Entity *pool_spawn(string name, int killer, string script)
+{
+  Entity *e;
+  vector<Entity*>& pool = g_Pools[script];
+  if (pool.empty()) {
+    e = entity_create(name, killer, script);
+  } else {
+    e = pool.back();
+    pool.pop_back();
+    entity_recycle(e, name, killer);
+  }
+  e->slot   = alloc_slot(e);
+  e->dying  = false;
+  e->active = (int)g_Entities.size();
+  g_Entities.push_back(e);
+  g_Store.active[e->id] = 1;
+  return e;
+}
+
+// ------------------------------------------------------------------
+
+// the entity stays in the active list until pool_flush
+void pool_kill(Entity *e)
+{
+  if (e->dying || e->active < 0) {
+    return;
+  }
+  e->dying = true;
+  g_Dying.push_back(e);
+}
+
+// ------------------------------------------------------------------
+
+// to be called outside of the physics step and of the entity loop
+void pool_flush()
+{
+  for (int d = 0; d < (int)g_Dying.size(); d++) {
+    Entity *e = g_Dying[d];
+    // out of the simulation (this may report ending contacts,
+    // they are dropped as the handle is about to expire)
+    if (physics_of(e).body != NULL) {
+      physics_of(e).body->SetActive(false);
+    }
+    // swap-remove from the active list
+    Entity *last = g_Entities.back();
+    g_Entities[e->active] = last;
+    last->active = e->active;
+    g_Entities.pop_back();
+    e->active = -1;
+    g_Store.active[e->id] = 0;
+    // expire handles
+    g_Slots[e->slot].e = NULL;
+    g_Slots[e->slot].generation++;
+    g_FreeSlots.push_back(e->slot);
+    e->slot = -1;
+    e->dying = false;
+    // back to its pool
+    g_Pools[e->type].push_back(e);
+  }
+  g_Dying.clear();
+}
+
+// ------------------------------------------------------------------
+
+// every active entity goes back to its pool, keeping its body and its
+// animations, to be recycled by the next spawns (e.g. a rematch)
+void pool_recycle_all()
+{
+  for (int a = 0; a < (int)g_Entities.size(); a++) {
+    pool_kill(g_Entities[a]);
+  }
+  pool_flush();
+}
+
+// ------------------------------------------------------------------
+
+// deletes all entities, active and pooled (the physics world must
+// still exist)
+void pool_clear()
+{
+  for (int a = 0; a < (int)g_Entities.size(); a++) {
+    entity_destroy(g_Entities[a]);
+  }
+  for (map<string, vector<Entity*> >::iterator P = g_Pools.begin(); P != g_Pools.end(); P++) {
+    for (int a = 0; a < (int)P->second.size(); a++) {
+      entity_destroy(P->second[a]);
+    }
+  }
+  g_Entities.clear();
+  g_Pools.clear();
+  entity_store_clear();
+  g_Dying.clear();
+  // slots are kept so that older handles remain expired
+  g_FreeSlots.clear();
+  for (int s = 0; s < (int)g_Slots.size(); s++) {
+    if (g_Slots[s].e != NULL) {
+      g_Slots[s].e = NULL;
+      g_Slots[s].generation++;
+    }
+    g_FreeSlots.push_back(s);
+  }
+}
+
+// ------------------------------------------------------------------
+
+EntityHandle pool_handle(Entity *e)
+{
+  EntityHandle h;
+  h.slot       = (e == NULL) ? -1 : e->slot;
+  h.generation = (h.slot < 0) ? 0 : g_Slots[h.slot].generation;
+  return h;
+}
+
+// ------------------------------------------------------------------
+
+// NULL if the entity was killed since the handle was taken
+Entity *pool_get(EntityHandle h)
+{
+  if (h.slot < 0 || h.slot >= (int)g_Slots.size()) {
+    return NULL;
+  }
+  if (g_Slots[h.slot].generation != h.generation) {
+    return NULL;
+  }
+  return g_Slots[h.slot].e;
+}
+
+// ------------------------------------------------------------------
@@ -0,0 +1,31 @@
+#pragma once
+
+// ------------------------------------------------------------------
+// Entities are taken from per-type pools (one type per script file)
+// and referred to by generation-checked handles. Killed entities leave
+// the active list at a safe point after the physics step, and are
+// recycled by the next spawn of the same type.
+// ------------------------------------------------------------------
+
+#include "entity.h"
+
+// ------------------------------------------------------------------
+
+typedef struct {
+  int slot;        // -1 for no entity
+  int generation;
+} EntityHandle;
+
+// ------------------------------------------------------------------
+
+extern vector<Entity*> g_Entities; // active entities, in no particular order
+
+Entity      *pool_spawn(string name, int killer, string script);
+void         pool_kill(Entity *e);
+void         pool_flush();
+void         pool_recycle_all();
+void         pool_clear();
+EntityHandle pool_handle(Entity *e);
+Entity      *pool_get(EntityHandle h);
+
+// ------------------------------------------------------------------
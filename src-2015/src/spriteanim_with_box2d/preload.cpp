@@ -0,0 +1,207 @@
+// ------------------------------------------------------------------
+
+#include "common.h"
+#include "preload.h"
+#include "profile.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <chrono>
+
+// ------------------------------------------------------------------
+
+typedef struct {
+  string       name;
+  int          kind;
+  bool         mainThread;
+  PreloadFn    run;
+  vector<int>  next;      // jobs waiting for this one
+  int          waiting;   // dependencies not done yet
+  int          thread;    // that ran it, 0 for the main thread
+  double       ready;     // ms since preload_run started
+  double       start;
+  double       stop;
+} PreloadJob;
+
+const char *c_JobKindNames[num_job_kinds] = { "image", "script", "sound", "upload" };
+
+vector<PreloadJob>  g_Jobs;
+mutex               g_PreloadMutex;
+condition_variable  g_PreloadWakeUp;
+deque<int>          g_WorkerReady;  // jobs for the workers
+deque<int>          g_MainReady;    // jobs for the main thread
+int                 g_JobsDone = 0;
+double              g_PreloadMs = 0; // wall time of the last run
+
+chrono::steady_clock::time_point g_PreloadStart;
+
+// ------------------------------------------------------------------
+
+static double preload_now()
+{
+  return chrono::duration<double, milli>(chrono::steady_clock::now() - g_PreloadStart).count();
+}
+
+// ------------------------------------------------------------------
+
+int preload_add(string name, int kind, bool mainThread, PreloadFn run)
+{
+  PreloadJob job;
+  job.name       = name;
+  job.kind       = kind;
+  job.mainThread = mainThread;
+  job.run        = run;
+  job.waiting    = 0;
+  job.thread     = -1;
+  job.ready = job.start = job.stop = 0;
+  g_Jobs.push_back(job);
+  return (int)g_Jobs.size() - 1;
+}
+
+// ------------------------------------------------------------------
+
+void preload_depends(int job, int on)
+{
+  g_Jobs[on].next.push_back(job);
+  g_Jobs[job].waiting++;
+}
+
+// ------------------------------------------------------------------
+
+// lock held
+static void preload_enqueue(int j)
+{
+  g_Jobs[j].ready = preload_now();
+  if (g_Jobs[j].mainThread) {
+    g_MainReady.push_back(j);
+  } else {
+    g_WorkerReady.push_back(j);
+  }
+}
+
+// ------------------------------------------------------------------
+
+static void preload_execute(int j, int thread)
+{
+  double start = preload_now();
+  try {
+    PROFILE_ZONE("preload job");
+    g_Jobs[j].run();
+  }
+  catch (Fatal& f) { // error handling
+    std::cerr << Console::red << g_Jobs[j].name << ": " << f.message() << Console::gray << std::endl;
+  }
+  double stop = preload_now();
+  {
+    lock_guard<mutex> lock(g_PreloadMutex);
+    PreloadJob& job = g_Jobs[j];
+    job.thread = thread;
+    job.start  = start;
+    job.stop   = stop;
+    for (int n = 0; n < (int)job.next.size(); n++) {
+      if (--g_Jobs[job.next[n]].waiting == 0) {
+        preload_enqueue(job.next[n]);
+      }
+    }
+    g_JobsDone++;
+  }
+  g_PreloadWakeUp.notify_all();
+}
+
+// ------------------------------------------------------------------
+
+static void preload_worker(int thread)
+{
+  profile_thread_name("preload " + to_string(thread));
+  while (true) {
+    int j;
+    {
+      unique_lock<mutex> lock(g_PreloadMutex);
+      g_PreloadWakeUp.wait(lock, [] { return g_JobsDone == (int)g_Jobs.size() || !g_WorkerReady.empty(); });
+      if (g_WorkerReady.empty()) {
+        // all done
+        return;
+      }
+      j = g_WorkerReady.front();
+      g_WorkerReady.pop_front();
+    }
+    preload_execute(j, thread);
+  }
+}
+
+// ------------------------------------------------------------------
+
+void preload_run(int numWorkers)
+{
+  if (numWorkers <= 0) {
+    // the main thread has its own share of the work
+    numWorkers = max(2, (int)thread::hardware_concurrency() - 1);
+  }
+  g_PreloadStart = chrono::steady_clock::now();
+  g_JobsDone = 0;
+  {
+    lock_guard<mutex> lock(g_PreloadMutex);
+    for (int j = 0; j < (int)g_Jobs.size(); j++) {
+      if (g_Jobs[j].waiting == 0) {
+        preload_enqueue(j);
+      }
+    }
+  }
+  vector<thread> workers;
+  for (int w = 0; w < numWorkers; w++) {
+    workers.push_back(thread(preload_worker, w + 1));
+  }
+  // the main thread takes the uploads as they become ready
+  while (true) {
+    int j;
+    {
+      unique_lock<mutex> lock(g_PreloadMutex);
+      g_PreloadWakeUp.wait(lock, [] { return g_JobsDone == (int)g_Jobs.size() || !g_MainReady.empty(); });
+      if (g_MainReady.empty()) {
+        break;
+      }
+      j = g_MainReady.front();
+      g_MainReady.pop_front();
+    }
+    preload_execute(j, 0);
+  }
+  for (int w = 0; w < numWorkers; w++) {
+    workers[w].join();
+  }
+  g_PreloadMs = preload_now();
+}
+
+// ------------------------------------------------------------------
+
+void preload_report()
+{
+  double total[num_job_kinds] = { 0 };
+  double work = 0;
+  for (int j = 0; j < (int)g_Jobs.size(); j++) {
+    const PreloadJob& job = g_Jobs[j];
+    double ms = job.stop - job.start;
+    total[job.kind] += ms;
+    work += ms;
+    fprintf(stderr, "  %-6s %-40s thread %d  waited %7.2f ms  ran %7.2f ms  done at %7.2f ms\n",
+      c_JobKindNames[job.kind], job.name.c_str(), job.thread, job.start - job.ready, ms, job.stop);
+  }
+  for (int k = 0; k < num_job_kinds; k++) {
+    fprintf(stderr, "  %-6s total %7.2f ms\n", c_JobKindNames[k], total[k]);
+  }
+  cerr << Console::white << g_Jobs.size() << " assets in " << g_PreloadMs << " ms ("
+    << work << " ms of work)" << Console::gray << endl;
+}
+
+// ------------------------------------------------------------------
+
+void preload_clear()
+{
+  g_Jobs.clear();
+  g_WorkerReady.clear();
+  g_MainReady.clear();
+  g_JobsDone = 0;
+}
+
+// ------------------------------------------------------------------
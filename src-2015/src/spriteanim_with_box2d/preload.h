@@ -0,0 +1,30 @@
+#pragma once
+
+// ------------------------------------------------------------------
+// Startup loader: asset loads are jobs of a dependency graph. Decoding
+// and compiling jobs run on a pool of worker threads, the jobs that
+// touch GL, OpenAL or the shared Lua VM run on the main thread. A job
+// starts once all the jobs it depends on are done.
+// ------------------------------------------------------------------
+
+#include<string>
+#include<functional>
+
+using namespace std;
+
+// ------------------------------------------------------------------
+
+// what a job does, for the timing breakdown
+enum { job_image = 0, job_script, job_sound, job_upload, num_job_kinds };
+
+typedef function<void()> PreloadFn;
+
+// ------------------------------------------------------------------
+
+int  preload_add(string name, int kind, bool mainThread, PreloadFn run);
+void preload_depends(int job, int on);  // 'job' starts after 'on'
+void preload_run(int numWorkers);       // returns once every job ran (0 workers: one per core)
+void preload_report();                  // per job timing, then totals
+void preload_clear();
+
+// ------------------------------------------------------------------
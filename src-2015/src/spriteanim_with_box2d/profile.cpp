@@ -0,0 +1,380 @@
+// ------------------------------------------------------------------
+
+#include "common.h"
+#include "profile.h"
+
+#ifndef HEADLESS
+#include <LibSL_gl.h>
+#endif
+
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <stdio.h>
+
+// ------------------------------------------------------------------
+
+const int c_ProfilePeakFrames = 60; // the peaks are kept over a second
+
+// the events of one thread: written by that thread only (head), read
+// by the main thread only (tail)
+typedef struct {
+  ProfileEvent     events[c_ProfileRingSize];
+  atomic<uint32_t> head;
+  atomic<uint32_t> tail;
+  atomic<uint32_t> dropped;  // events lost to a full ring
+  int              depth;    // owner thread only
+  int              tid;
+  string           name;
+} ProfileRing;
+
+// an event kept for the trace, with the thread it ran on
+typedef struct {
+  ProfileEvent ev;
+  int          tid;
+} ProfileTraced;
+
+// ------------------------------------------------------------------
+
+atomic<bool>                     g_ProfileOn(false);
+chrono::steady_clock::time_point g_ProfileEpoch = chrono::steady_clock::now();
+
+mutex                            g_ProfileMutex;    // zones and rings registration
+map<string, int>                 g_ProfileZoneIds;
+vector<string>                   g_ProfileZoneNames;
+vector<ProfileRing*>             g_ProfileRings;
+
+thread_local ProfileRing        *t_ProfileRing = NULL;
+
+// main thread only
+ProfileStat                      g_ProfileStats[c_ProfileMaxZones];
+float                            g_ProfileFrameMs[c_ProfileMaxZones];
+int                              g_ProfileFrameCalls[c_ProfileMaxZones];
+float                            g_ProfilePeakMs[c_ProfileMaxZones];
+int                              g_ProfileFrames = 0;
+
+string                           g_ProfileTraceFile;
+int                              g_ProfileTraceFrames = 0;
+bool                             g_ProfileTraceWasOn  = false;
+vector<ProfileTraced>            g_ProfileTrace;
+
+// ------------------------------------------------------------------
+
+static ProfileRing *profile_ring()
+{
+  if (t_ProfileRing == NULL) {
+    ProfileRing *r = new ProfileRing();
+    r->head    = 0;
+    r->tail    = 0;
+    r->dropped = 0;
+    r->depth   = 0;
+    lock_guard<mutex> lock(g_ProfileMutex);
+    r->tid  = (int)g_ProfileRings.size();
+    r->name = "thread " + to_string(r->tid);
+    g_ProfileRings.push_back(r);
+    t_ProfileRing = r;
+  }
+  return t_ProfileRing;
+}
+
+// ------------------------------------------------------------------
+
+int profile_zone(string name)
+{
+  lock_guard<mutex> lock(g_ProfileMutex);
+  if (g_ProfileZoneNames.empty()) {
+    // zone 0 gathers the zones beyond the maximum
+    g_ProfileZoneIds["(other)"] = 0;
+    g_ProfileZoneNames.push_back("(other)");
+  }
+  map<string, int>::const_iterator Z = g_ProfileZoneIds.find(name);
+  if (Z != g_ProfileZoneIds.end()) {
+    return Z->second;
+  }
+  if ((int)g_ProfileZoneNames.size() >= c_ProfileMaxZones) {
+    return 0;
+  }
+  int id = (int)g_ProfileZoneNames.size();
+  g_ProfileZoneIds[name] = id;
+  g_ProfileZoneNames.push_back(name);
+  return id;
+}
+
+// ------------------------------------------------------------------
+
+string profile_zone_name(int zone)
+{
+  lock_guard<mutex> lock(g_ProfileMutex);
+  if (zone < 0 || zone >= (int)g_ProfileZoneNames.size()) {
+    return "";
+  }
+  return g_ProfileZoneNames[zone];
+}
+
+// ------------------------------------------------------------------
+
+int profile_num_zones()
+{
+  lock_guard<mutex> lock(g_ProfileMutex);
+  return (int)g_ProfileZoneNames.size();
+}
+
+// ------------------------------------------------------------------
+
+void profile_thread_name(string name)
+{
+  ProfileRing *r = profile_ring();
+  lock_guard<mutex> lock(g_ProfileMutex);
+  r->name = name;
+}
+
+// ------------------------------------------------------------------
+
+void profile_enable(bool on)
+{
+  g_ProfileOn.store(on, memory_order_relaxed);
+}
+
+bool profile_enabled()
+{
+  return g_ProfileOn.load(memory_order_relaxed);
+}
+
+// ------------------------------------------------------------------
+
+int64_t profile_now()
+{
+  return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - g_ProfileEpoch).count();
+}
+
+// ------------------------------------------------------------------
+
+int64_t profile_enter()
+{
+  profile_ring()->depth++;
+  return profile_now();
+}
+
+// ------------------------------------------------------------------
+
+void profile_leave(int zone, int64_t start)
+{
+  int64_t      end = profile_now();
+  ProfileRing *r   = profile_ring();
+  r->depth--;
+  uint32_t head = r->head.load(memory_order_relaxed);
+  if (head - r->tail.load(memory_order_acquire) >= (uint32_t)c_ProfileRingSize) {
+    // full: the main thread did not drain it for too long
+    r->dropped.fetch_add(1, memory_order_relaxed);
+    return;
+  }
+  ProfileEvent& ev = r->events[head & (c_ProfileRingSize - 1)];
+  ev.zone  = zone;
+  ev.depth = r->depth;
+  ev.start = start;
+  ev.end   = end;
+  r->head.store(head + 1, memory_order_release);
+}
+
+// ------------------------------------------------------------------
+
+const ProfileStat& profile_stat(int zone)
+{
+  sl_assert(zone >= 0 && zone < c_ProfileMaxZones);
+  return g_ProfileStats[zone];
+}
+
+// ------------------------------------------------------------------
+
+static void profile_write_name(FILE *f, const string& name)
+{
+  fputc('"', f);
+  for (int i = 0; i < (int)name.size(); i++) {
+    char c = name[i];
+    if (c == '"' || c == '\\') {
+      fputc('\\', f);
+    }
+    fputc((unsigned char)c < 0x20 ? ' ' : c, f);
+  }
+  fputc('"', f);
+}
+
+static void profile_write_trace()
+{
+  FILE *f = fopen(g_ProfileTraceFile.c_str(), "w");
+  if (f == NULL) {
+    cerr << Console::red << "cannot write trace '" << g_ProfileTraceFile << "'" << Console::gray << endl;
+    return;
+  }
+  vector<string> zones;
+  vector<pair<int, string> > threads;
+  {
+    lock_guard<mutex> lock(g_ProfileMutex);
+    zones = g_ProfileZoneNames;
+    for (int i = 0; i < (int)g_ProfileRings.size(); i++) {
+      threads.push_back(make_pair(g_ProfileRings[i]->tid, g_ProfileRings[i]->name));
+    }
+  }
+  fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  bool first = true;
+  for (int i = 0; i < (int)threads.size(); i++) {
+    fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", first ? "" : ",\n", threads[i].first);
+    profile_write_name(f, threads[i].second);
+    fprintf(f, "}}");
+    first = false;
+  }
+  for (int i = 0; i < (int)g_ProfileTrace.size(); i++) {
+    const ProfileTraced& t = g_ProfileTrace[i];
+    fprintf(f, "%s{\"name\":", first ? "" : ",\n");
+    profile_write_name(f, zones[t.ev.zone]);
+    fprintf(f, ",\"cat\":\"zone\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":1,\"tid\":%d}",
+      (long long)t.ev.start, (long long)(t.ev.end - t.ev.start), t.tid);
+    first = false;
+  }
+  fprintf(f, "\n]}\n");
+  fclose(f);
+  cerr << Console::white << "trace: " << g_ProfileTrace.size() << " events to '" << g_ProfileTraceFile << "'" << Console::gray << endl;
+}
+
+// ------------------------------------------------------------------
+
+void profile_frame()
+{
+  bool tracing = g_ProfileTraceFrames > 0;
+  if (!profile_enabled() && !tracing) {
+    return;
+  }
+  vector<ProfileRing*> rings;
+  {
+    lock_guard<mutex> lock(g_ProfileMutex);
+    rings = g_ProfileRings;
+  }
+  for (int i = 0; i < (int)rings.size(); i++) {
+    ProfileRing *r    = rings[i];
+    uint32_t     tail = r->tail.load(memory_order_relaxed);
+    uint32_t     head = r->head.load(memory_order_acquire);
+    for (uint32_t e = tail; e != head; e++) {
+      const ProfileEvent& ev = r->events[e & (c_ProfileRingSize - 1)];
+      g_ProfileFrameMs[ev.zone]    += (float)(ev.end - ev.start) / 1000.0f;
+      g_ProfileFrameCalls[ev.zone] ++;
+      if (tracing) {
+        ProfileTraced t = { ev, r->tid };
+        g_ProfileTrace.push_back(t);
+      }
+    }
+    r->tail.store(head, memory_order_release);
+  }
+  // smoothed averages, peaks over the last second
+  int  numZones = profile_num_zones();
+  bool newPeak  = (++g_ProfileFrames % c_ProfilePeakFrames) == 0;
+  for (int z = 0; z < numZones; z++) {
+    ProfileStat& s = g_ProfileStats[z];
+    s.avgMs = 0.9f * s.avgMs + 0.1f * g_ProfileFrameMs[z];
+    s.calls = g_ProfileFrameCalls[z];
+    g_ProfilePeakMs[z] = max(g_ProfilePeakMs[z], g_ProfileFrameMs[z]);
+    if (newPeak) {
+      s.peakMs = g_ProfilePeakMs[z];
+      g_ProfilePeakMs[z] = 0.0f;
+    }
+    g_ProfileFrameMs[z]    = 0.0f;
+    g_ProfileFrameCalls[z] = 0;
+  }
+  if (tracing && --g_ProfileTraceFrames == 0) {
+    profile_write_trace();
+    g_ProfileTrace.clear();
+    profile_enable(g_ProfileTraceWasOn);
+  }
+}
+
+// ------------------------------------------------------------------
+
+void profile_trace(string fname, int frames)
+{
+  if (g_ProfileTraceFrames == 0) {
+    g_ProfileTraceWasOn = profile_enabled();
+  }
+  g_ProfileTraceFile   = fname;
+  g_ProfileTraceFrames = max(1, frames);
+  g_ProfileTrace.clear();
+  profile_enable(true);
+}
+
+// ------------------------------------------------------------------
+
+void profile_report()
+{
+  int numZones = profile_num_zones();
+  uint32_t dropped = 0;
+  {
+    lock_guard<mutex> lock(g_ProfileMutex);
+    for (int i = 0; i < (int)g_ProfileRings.size(); i++) {
+      dropped += g_ProfileRings[i]->dropped.load(memory_order_relaxed);
+    }
+  }
+  // the bars of the overlay are in zone order, the table gives their names
+  cerr << Console::white << "profile (bar: avg / peak ms, calls)" << Console::gray << endl;
+  for (int z = 0; z < numZones; z++) {
+    const ProfileStat& s = g_ProfileStats[z];
+    if (s.avgMs < 0.001f && s.peakMs < 0.001f) {
+      continue;
+    }
+    char line[256];
+    sprintf(line, "%3d: %8.3f / %8.3f %5d  ", z, s.avgMs, s.peakMs, s.calls);
+    cerr << line << profile_zone_name(z) << endl;
+  }
+  if (dropped > 0) {
+    cerr << Console::yellow << dropped << " events dropped, full rings" << Console::gray << endl;
+  }
+}
+
+// ------------------------------------------------------------------
+
+#ifndef HEADLESS
+
+void profile_draw(int x, int y, int w, int h)
+{
+  const int   barH     = 6;
+  const int   barGap   = 2;
+  const float colors[8][3] = {
+    { 0.9f, 0.3f, 0.3f }, { 0.3f, 0.9f, 0.3f }, { 0.3f, 0.5f, 1.0f }, { 0.9f, 0.9f, 0.3f },
+    { 0.9f, 0.3f, 0.9f }, { 0.3f, 0.9f, 0.9f }, { 1.0f, 0.6f, 0.2f }, { 0.8f, 0.8f, 0.8f },
+  };
+  GLint vp[4];
+  glGetIntegerv(GL_VIEWPORT, vp);
+  Transform::ortho2D(LIBSL_PROJECTION_MATRIX, 0, (float)vp[2], 0, (float)vp[3]);
+  Transform::identity(LIBSL_MODELVIEW_MATRIX);
+  glDisable(GL_TEXTURE_2D);
+  glBegin(GL_QUADS);
+  // background: its width is the budget of a frame
+  glColor3f(0.1f, 0.1f, 0.1f);
+  glVertex2i(x, y); glVertex2i(x + w, y); glVertex2i(x + w, y + h); glVertex2i(x, y + h);
+  int numZones = profile_num_zones();
+  for (int z = 0; z < numZones; z++) {
+    const ProfileStat& s = g_ProfileStats[z];
+    int y0 = y + h - (z + 1) * (barH + barGap);
+    if (y0 < y) {
+      break;
+    }
+    int wa = (int)(min(1.0f, s.avgMs  / c_ProfileBudgetMs) * (float)w);
+    int wp = (int)(min(1.0f, s.peakMs / c_ProfileBudgetMs) * (float)w);
+    const float *c = colors[z & 7];
+    glColor3f(c[0], c[1], c[2]);
+    glVertex2i(x, y0); glVertex2i(x + wa, y0); glVertex2i(x + wa, y0 + barH); glVertex2i(x, y0 + barH);
+    // the peak, as a thin mark
+    glVertex2i(x + wp - 1, y0); glVertex2i(x + wp + 1, y0); glVertex2i(x + wp + 1, y0 + barH); glVertex2i(x + wp - 1, y0 + barH);
+  }
+  glEnd();
+}
+
+#else
+
+void profile_draw(int x, int y, int w, int h)
+{
+}
+
+#endif
+
+// ------------------------------------------------------------------
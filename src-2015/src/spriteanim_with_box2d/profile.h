@@ -0,0 +1,88 @@
+#pragma once
+
+// ------------------------------------------------------------------
+// Profiler: a zone is a named scope, timed by a ProfileScope on the
+// stack (PROFILE_ZONE). Each thread writes its timings to its own ring
+// buffer, without locks; once per frame the main thread drains the
+// rings and sums the time of each zone. The averages are shown as bars
+// in the separation band (profile_draw), and a number of frames can be
+// captured to a Chrome trace (chrome://tracing, or ui.perfetto.dev).
+// When the profiler is off a zone costs a test.
+// ------------------------------------------------------------------
+
+#include<string>
+#include<stdint.h>
+
+using namespace std;
+
+// ------------------------------------------------------------------
+
+const int   c_ProfileRingSize  = 8192;  // events per thread, a power of two
+const float c_ProfileBudgetMs  = 16.7f; // a frame at 60 Hz: the width of a bar
+const int   c_ProfileMaxZones  = 256;
+
+// a timed scope, as written to the ring of its thread
+typedef struct {
+  int32_t zone;
+  int32_t depth;   // nesting, on its thread
+  int64_t start;   // in us since the start of the profiler
+  int64_t end;
+} ProfileEvent;
+
+// per zone, updated by profile_frame
+typedef struct {
+  float avgMs;     // smoothed time per frame
+  float peakMs;    // highest over the last second
+  int   calls;     // in the last frame
+} ProfileStat;
+
+// ------------------------------------------------------------------
+
+int    profile_zone(string name);        // id of a zone, registered on first use (any thread)
+string profile_zone_name(int zone);
+void   profile_thread_name(string name); // of the calling thread, in the traces
+void   profile_enable(bool on);
+bool   profile_enabled();
+int64_t profile_now();                   // us
+int64_t profile_enter();                 // start of a scope on this thread
+void   profile_leave(int zone, int64_t start);
+
+void   profile_frame();                  // main thread, once per frame: drains the rings
+const ProfileStat& profile_stat(int zone);
+int    profile_num_zones();
+void   profile_report();                 // the zones, by average time
+void   profile_trace(string fname, int frames); // the next frames, to a Chrome trace file
+void   profile_draw(int x, int y, int w, int h); // bars of the zones, GL (not HEADLESS)
+
+// ------------------------------------------------------------------
+
+class ProfileScope
+{
+public:
+  ProfileScope(int zone) : m_Zone(-1), m_Start(0)
+  {
+    if (profile_enabled()) {
+      m_Zone  = zone;
+      m_Start = profile_enter();
+    }
+  }
+  ~ProfileScope()
+  {
+    if (m_Zone >= 0) {
+      profile_leave(m_Zone, m_Start);
+    }
+  }
+private:
+  int     m_Zone;
+  int64_t m_Start;
+};
+
+#define PROFILE_CAT2(a, b) a ## b
+#define PROFILE_CAT(a, b)  PROFILE_CAT2(a, b)
+
+// times the enclosing scope; the name is registered once
+#define PROFILE_ZONE(name) \
+  static const int PROFILE_CAT(profile_zone_, __LINE__) = profile_zone(name); \
+  ProfileScope PROFILE_CAT(profile_scope_, __LINE__)(PROFILE_CAT(profile_zone_, __LINE__))
+
+// ------------------------------------------------------------------
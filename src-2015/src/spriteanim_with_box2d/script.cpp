@@ -4,6 +4,8 @@
 
 #include <LibSL/LibSL.h>
 
+#include <map>
+
 #include "script.h"
 
 // ------------------------------------------------------------------
@@ -26,13 +28,34 @@ void lua_log(string s)
 
 // ------------------------------------------------------------------
 
-Script *script_create()
+lua_State *g_VM = NULL;
+
+// script file name -> registry reference to its compiled prototype
+map<string, int> g_Prototypes;
+
+// ------------------------------------------------------------------
+
+static void script_error(lua_State *L)
 {
-  Script *s = new Script;
+  char str[4096];
+  sprintf(str, "[[LUA]exit] %s", lua_tostring(L, -1));
+  cerr << Console::yellow;
+  cerr << str << endl;
+  cerr << Console::gray;
+  lua_pop(L, 1);
+}
+
+// ------------------------------------------------------------------
+
+lua_State *script_vm()
+{
+  if (g_VM != NULL) {
+    return g_VM;
+  }
 
   // lua
   lua_State *L = lua_open();
-  s->lua = L;
+  g_VM = L;
 
   luabind::open(L);
 
@@ -63,36 +86,203 @@ Script *script_create()
       ];
   }
 
+  return L;
+}
+
+// ------------------------------------------------------------------
+
+// a new environment, reading through to the shared globals
+Script *script_create()
+{
+  Script *s = new Script;
+  lua_State *L = script_vm();
+  s->lua = L;
+
+  lua_newtable(L);
+  lua_newtable(L); // metatable
+  lua_pushstring(L, "__index");
+  lua_pushvalue(L, LUA_GLOBALSINDEX);
+  lua_rawset(L, -3);
+  lua_setmetatable(L, -2);
+  s->env = luaL_ref(L, LUA_REGISTRYINDEX);
+
   return s;
 }
 
 // ------------------------------------------------------------------
 
+void script_push_env(Script *s)
+{
+  lua_rawgeti(s->lua, LUA_REGISTRYINDEX, s->env);
+}
+
+// ------------------------------------------------------------------
+
+static string script_wrap(const string& program)
+{
+  return "return function() " + program + "\nend";
+}
+
+// ------------------------------------------------------------------
+
+static int script_writer(lua_State *L, const void *p, size_t sz, void *ud)
+{
+  ((string*)ud)->append((const char*)p, sz);
+  return 0;
+}
+
+// ------------------------------------------------------------------
+
+// Compiles a program to bytecode, in a private VM: this may run on any
+// thread. The result is handed to script_add_prototype on the main
+// thread. Returns false on a syntax error.
+bool script_compile(string name, const string& program, string& bytecode)
+{
+  lua_State *L = luaL_newstate();
+  string wrapped = script_wrap(program);
+  bool ok = (luaL_loadbuffer(L, wrapped.c_str(), wrapped.size(), ("@" + name).c_str()) == 0);
+  if (ok) {
+    bytecode.clear();
+    lua_dump(L, script_writer, &bytecode);
+  } else {
+    cerr << Console::yellow << "[[LUA]compile] " << lua_tostring(L, -1) << Console::gray << endl;
+  }
+  lua_close(L);
+  return ok;
+}
+
+// ------------------------------------------------------------------
+
+// registers a program compiled by script_compile, script_load then
+// neither reads nor parses the file
+void script_add_prototype(string name, const string& bytecode)
+{
+  if (g_Prototypes.find(name) != g_Prototypes.end()) {
+    return;
+  }
+  lua_State *L = script_vm();
+  if (luaL_loadbuffer(L, bytecode.c_str(), bytecode.size(), ("@" + name).c_str())) {
+    script_error(L);
+    return;
+  }
+  g_Prototypes[name] = luaL_ref(L, LUA_REGISTRYINDEX);
+}
+
+// ------------------------------------------------------------------
+
+// The program is compiled once as the body of a function
+//   return function() <program> end
+// Calling the compiled chunk then returns a new closure of the shared
+// prototype, which gets the environment of the script. Functions
+// defined by the program inherit this environment.
+void script_load_string(Script *s, string name, const string& program)
+{
+  lua_State *L = s->lua;
+  map<string, int>::iterator P = g_Prototypes.find(name);
+  if (P == g_Prototypes.end()) {
+    string wrapped = script_wrap(program);
+    if (luaL_loadbuffer(L, wrapped.c_str(), wrapped.size(), ("@" + name).c_str())) {
+      script_error(L);
+      return;
+    }
+    P = g_Prototypes.insert(make_pair(name, luaL_ref(L, LUA_REGISTRYINDEX))).first;
+  }
+  lua_rawgeti(L, LUA_REGISTRYINDEX, P->second);
+  if (lua_pcall(L, 0, 1, 0)) {
+    script_error(L);
+    return;
+  }
+  script_push_env(s);
+  lua_setfenv(L, -2);
+  // global space gets executed
+  if (lua_pcall(L, 0, 0, 0)) {
+    script_error(L);
+  }
+}
+
+// ------------------------------------------------------------------
+
 void script_load(Script *s, string fname)
 {
-  int ret = 0;
-  try {
-    string program = loadFileIntoString(fname.c_str());
-    ret            = luaL_dostring(s->lua, program.c_str());
-  } catch (Fatal& f) {
-    cerr << Console::yellow;
-    cerr << f.message() << endl;
-    cerr << Console::gray;
+  string program;
+  if (g_Prototypes.find(fname) == g_Prototypes.end()) {
+    try {
+      program = loadFileIntoString(fname.c_str());
+    } catch (Fatal& f) {
+      cerr << Console::yellow;
+      cerr << f.message() << endl;
+      cerr << Console::gray;
+      return;
+    }
   }
-  if (ret) {
-    char str[4096];
-    sprintf(str,"[[LUA]exit] %s", lua_tostring(s->lua, -1));
-    cerr << Console::yellow;
-    cerr << str;
-    cerr << Console::gray;
+  script_load_string(s, fname, program);
+}
+
+// ------------------------------------------------------------------
+
+// pushes the function, returns false if the script does not define it
+static bool push_function(Script *s, const char *fn)
+{
+  script_push_env(s);
+  lua_getfield(s->lua, -1, fn);
+  lua_remove(s->lua, -2);
+  if (!lua_isfunction(s->lua, -1)) {
+    lua_pop(s->lua, 1);
+    return false;
+  }
+  return true;
+}
+
+bool script_call(Script *s, const char *fn)
+{
+  if (!push_function(s, fn)) {
+    return false;
+  }
+  if (lua_pcall(s->lua, 0, 0, 0)) {
+    script_error(s->lua);
+  }
+  return true;
+}
+
+bool script_call(Script *s, const char *fn, int arg)
+{
+  if (!push_function(s, fn)) {
+    return false;
+  }
+  lua_pushinteger(s->lua, arg);
+  if (lua_pcall(s->lua, 1, 0, 0)) {
+    script_error(s->lua);
   }
+  return true;
+}
+
+// ------------------------------------------------------------------
+
+float script_get_number(Script *s, const char *name)
+{
+  script_push_env(s);
+  lua_getfield(s->lua, -1, name);
+  float v = (float)lua_tonumber(s->lua, -1);
+  lua_pop(s->lua, 2);
+  return v;
+}
+
+bool script_get_bool(Script *s, const char *name)
+{
+  script_push_env(s);
+  lua_getfield(s->lua, -1, name);
+  bool v = lua_toboolean(s->lua, -1) != 0;
+  lua_pop(s->lua, 2);
+  return v;
 }
 
 // ------------------------------------------------------------------
 
+// the environment goes away, the VM and the prototypes stay
 void script_kill(Script *s)
 {
-  lua_close(s->lua);
+  luaL_unref(s->lua, LUA_REGISTRYINDEX, s->env);
+  s->env = LUA_NOREF;
   s->lua = NULL;
 }
 
@@ -14,6 +14,7 @@ using namespace std;
 extern "C" {
 #include <lua.h>
 #include <lualib.h>
+#include <lauxlib.h>
 }
 
 #include <luabind/luabind.hpp>
@@ -27,15 +28,29 @@ using namespace luabind;
 
 // ------------------------------------------------------------------
 
+// All scripts share a single VM. Each script runs in its own
+// environment table (its globals), which falls back to the shared
+// globals for the library and the registered functions.
+
 typedef struct
 {
-  lua_State *lua;
+  lua_State *lua; // the shared VM
+  int        env; // registry reference to the environment table
 } Script;
 
 // ------------------------------------------------------------------
 
-Script *script_create();
-void    script_kill(Script *);
-void    script_load(Script *,string fname);
+lua_State *script_vm();
+Script    *script_create();
+void       script_kill(Script *);
+void       script_load(Script *,string fname);
+void       script_load_string(Script *,string name,const string& program);
+bool       script_compile(string name,const string& program,string& bytecode); // any thread
+void       script_add_prototype(string name,const string& bytecode);
+void       script_push_env(Script *);
+bool       script_call(Script *,const char *fn);
+bool       script_call(Script *,const char *fn,int arg);
+float      script_get_number(Script *,const char *name);
+bool       script_get_bool(Script *,const char *name);
 
 // ------------------------------------------------------------------
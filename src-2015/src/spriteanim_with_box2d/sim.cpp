@@ -0,0 +1,264 @@
+// ------------------------------------------------------------------
+
+#include "common.h"
+#include "sim.h"
+#include "gameloop.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// ------------------------------------------------------------------
+
+uint32_t          g_SimSeed  = 0;
+uint64_t          g_SimRng   = 0;
+int               g_SimTicks = 0;        // steps since the start of the session
+
+FILE             *g_SimRecFile  = NULL;
+SimHeader         g_SimRecHeader;
+int               g_SimRecBase  = 0;     // tick of the first recorded step
+uint32_t          g_SimRecKeys  = 0;     // last stored key mask
+bool              g_SimRecFirst = true;
+
+bool              g_SimReplaying    = false;
+SimHeader         g_SimReplayHeader;
+vector<SimRecord> g_SimReplay;
+size_t            g_SimReplayNext   = 0;
+int               g_SimReplayBase   = 0;
+int               g_SimReplayChecks = 0;
+int               g_SimDesync       = -1;
+
+// ------------------------------------------------------------------
+
+// the seed is spread over the 64 bits of state (splitmix)
+void sim_seed(uint32_t seed)
+{
+  uint64_t z = (uint64_t)seed + 0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  g_SimRng  = z ^ (z >> 31);
+  g_SimSeed = seed;
+}
+
+// ------------------------------------------------------------------
+
+uint32_t sim_get_seed()
+{
+  return g_SimSeed;
+}
+
+// ------------------------------------------------------------------
+
+// 64 bits LCG, the high bits scaled to [0,n): unlike rand(), the
+// sequence does not depend on the C library
+int sim_rand(int n)
+{
+  if (n <= 0) {
+    return 0;
+  }
+  g_SimRng = g_SimRng * 6364136223846793005ULL + 1442695040888963407ULL;
+  uint32_t r = (uint32_t)(g_SimRng >> 32);
+  return (int)(((uint64_t)r * (uint64_t)n) >> 32);
+}
+
+// ------------------------------------------------------------------
+
+t_time sim_time()
+{
+  return (t_time)((double)g_SimTicks * gameloop_step_ms());
+}
+
+// ------------------------------------------------------------------
+
+int sim_ticks()
+{
+  return g_SimTicks;
+}
+
+// ------------------------------------------------------------------
+
+static uint32_t sim_key_mask(const bool *keys)
+{
+  uint32_t mask = 0;
+  for (int k = 0; k < 26; k++) {
+    if (keys['a' + k]) {
+      mask |= (1u << k);
+    }
+  }
+  return mask;
+}
+
+// ------------------------------------------------------------------
+
+static void sim_record(uint32_t kind, uint32_t value)
+{
+  SimRecord rec;
+  rec.tick  = (uint32_t)(g_SimTicks - g_SimRecBase);
+  rec.kind  = kind;
+  rec.value = value;
+  fwrite(&rec, sizeof(rec), 1, g_SimRecFile);
+}
+
+// ------------------------------------------------------------------
+
+void sim_begin_step(bool *keys)
+{
+  g_SimTicks++;
+  if (g_SimReplaying) {
+    // the keys of the scripts (Key_a .. Key_z) come from the recording
+    uint32_t tick = (uint32_t)(g_SimTicks - g_SimReplayBase);
+    while (g_SimReplayNext < g_SimReplay.size()
+      && g_SimReplay[g_SimReplayNext].tick == tick
+      && g_SimReplay[g_SimReplayNext].kind == rec_keys) {
+      uint32_t mask = g_SimReplay[g_SimReplayNext].value;
+      for (int k = 0; k < 26; k++) {
+        keys['a' + k] = ((mask >> k) & 1) != 0;
+      }
+      g_SimReplayNext++;
+    }
+  }
+  if (g_SimRecFile != NULL) {
+    uint32_t mask = sim_key_mask(keys);
+    if (g_SimRecFirst || mask != g_SimRecKeys) {
+      sim_record(rec_keys, mask);
+      g_SimRecKeys  = mask;
+      g_SimRecFirst = false;
+    }
+  }
+}
+
+// ------------------------------------------------------------------
+
+void sim_end_step(uint32_t (*checksum)())
+{
+  if (g_SimRecFile != NULL && (g_SimTicks - g_SimRecBase) % c_SimChecksumTicks == 0) {
+    sim_record(rec_checksum, checksum());
+  }
+  if (g_SimReplaying) {
+    uint32_t tick = (uint32_t)(g_SimTicks - g_SimReplayBase);
+    if (g_SimReplayNext < g_SimReplay.size()
+      && g_SimReplay[g_SimReplayNext].tick == tick
+      && g_SimReplay[g_SimReplayNext].kind == rec_checksum) {
+      uint32_t expected = g_SimReplay[g_SimReplayNext].value;
+      uint32_t actual   = checksum();
+      if (actual != expected && g_SimDesync < 0) {
+        g_SimDesync = (int)tick;
+        cerr << Console::red << "replay: desync at tick " << tick << Console::gray << endl;
+      }
+      g_SimReplayChecks++;
+      g_SimReplayNext++;
+    }
+  }
+}
+
+// ------------------------------------------------------------------
+
+bool sim_record_begin(string fname)
+{
+  sim_record_end();
+  g_SimRecFile = fopen(fname.c_str(), "wb");
+  if (g_SimRecFile == NULL) {
+    cerr << Console::red << "cannot write recording '" << fname << "'" << Console::gray << endl;
+    return false;
+  }
+  memcpy(g_SimRecHeader.magic, c_SimMagic, sizeof(c_SimMagic));
+  g_SimRecHeader.version  = c_SimVersion;
+  g_SimRecHeader.seed     = g_SimSeed;
+  g_SimRecHeader.numTicks = 0;
+  g_SimRecHeader.stepMs   = gameloop_step_ms();
+  fwrite(&g_SimRecHeader, sizeof(g_SimRecHeader), 1, g_SimRecFile);
+  g_SimRecBase  = g_SimTicks;
+  g_SimRecFirst = true;
+  return true;
+}
+
+// ------------------------------------------------------------------
+
+// the tick count goes in the header, a recording cut short (crash)
+// still replays up to its last record
+void sim_record_end()
+{
+  if (g_SimRecFile == NULL) {
+    return;
+  }
+  g_SimRecHeader.numTicks = (uint32_t)(g_SimTicks - g_SimRecBase);
+  fseek(g_SimRecFile, 0, SEEK_SET);
+  fwrite(&g_SimRecHeader, sizeof(g_SimRecHeader), 1, g_SimRecFile);
+  fclose(g_SimRecFile);
+  g_SimRecFile = NULL;
+  cerr << Console::white << "recorded " << g_SimRecHeader.numTicks << " ticks" << Console::gray << endl;
+}
+
+// ------------------------------------------------------------------
+
+bool sim_recording()
+{
+  return g_SimRecFile != NULL;
+}
+
+// ------------------------------------------------------------------
+
+bool sim_replay_begin(string fname)
+{
+  FILE *f = fopen(fname.c_str(), "rb");
+  if (f == NULL) {
+    cerr << Console::red << "cannot open recording '" << fname << "'" << Console::gray << endl;
+    return false;
+  }
+  if (fread(&g_SimReplayHeader, sizeof(g_SimReplayHeader), 1, f) != 1
+    || memcmp(g_SimReplayHeader.magic, c_SimMagic, sizeof(c_SimMagic)) != 0
+    || g_SimReplayHeader.version != c_SimVersion) {
+    cerr << Console::red << "'" << fname << "' is not a recording" << Console::gray << endl;
+    fclose(f);
+    return false;
+  }
+  if (g_SimReplayHeader.stepMs != gameloop_step_ms()) {
+    cerr << Console::yellow << "recorded at a step of " << g_SimReplayHeader.stepMs << " ms" << Console::gray << endl;
+  }
+  g_SimReplay.clear();
+  SimRecord rec;
+  while (fread(&rec, sizeof(rec), 1, f) == 1) {
+    g_SimReplay.push_back(rec);
+  }
+  fclose(f);
+  if (g_SimReplayHeader.numTicks == 0 && !g_SimReplay.empty()) {
+    g_SimReplayHeader.numTicks = g_SimReplay.back().tick;
+  }
+  g_SimReplayNext   = 0;
+  g_SimReplayBase   = g_SimTicks;
+  g_SimReplayChecks = 0;
+  g_SimDesync       = -1;
+  g_SimReplaying    = true;
+  sim_seed(g_SimReplayHeader.seed);
+  return true;
+}
+
+// ------------------------------------------------------------------
+
+bool sim_replay_done()
+{
+  return g_SimTicks - g_SimReplayBase >= (int)g_SimReplayHeader.numTicks;
+}
+
+// ------------------------------------------------------------------
+
+bool sim_replaying()
+{
+  return g_SimReplaying;
+}
+
+// ------------------------------------------------------------------
+
+int sim_replay_report()
+{
+  cerr << Console::white << "replay: " << (g_SimTicks - g_SimReplayBase) << " ticks, seed " << g_SimReplayHeader.seed
+    << ", " << g_SimReplayChecks << " checksums, ";
+  if (g_SimDesync < 0) {
+    cerr << "no desync";
+  } else {
+    cerr << Console::red << "desync at tick " << g_SimDesync;
+  }
+  cerr << Console::gray << endl;
+  return g_SimDesync;
+}
+
+// ------------------------------------------------------------------
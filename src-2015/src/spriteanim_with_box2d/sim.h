@@ -0,0 +1,64 @@
+#pragma once
+
+// ------------------------------------------------------------------
+// Deterministic simulation: the game logic draws its random numbers
+// from a seeded generator and reads the time from a simulation clock
+// that advances by one step per tick, never from the wall clock.
+// A match is then fully given by the seed and the keys of each tick:
+// the recorder logs both to a file, the replayer steps them again
+// (headless, brothers_bench -replay) and checks the state against
+// the checksums stored along the recording.
+// ------------------------------------------------------------------
+
+#include<string>
+#include<stdint.h>
+
+#include <LibSL/LibSL.h>
+
+using namespace std;
+
+// ------------------------------------------------------------------
+
+const char     c_SimMagic[4]      = { 'B', 'R', 'E', 'C' };
+const uint32_t c_SimVersion       = 2; // 2: cooldowns in the checksums
+const int      c_SimChecksumTicks = 50; // a checksum is stored every second
+
+enum { rec_keys = 0, rec_checksum };
+
+typedef struct {
+  char     magic[4];
+  uint32_t version;
+  uint32_t seed;
+  uint32_t numTicks;      // written when the recording ends
+  float    stepMs;
+} SimHeader;
+
+// followed by the records, in tick order
+typedef struct {
+  uint32_t tick;
+  uint32_t kind;
+  uint32_t value;         // rec_keys: bit i is key 'a'+i, only stored when it changes
+} SimRecord;
+
+// ------------------------------------------------------------------
+
+void     sim_seed(uint32_t seed);
+uint32_t sim_get_seed();
+int      sim_rand(int n);                // in [0,n), same sequence on every platform
+
+t_time   sim_time();                     // simulated ms, the clock of the game logic
+int      sim_ticks();
+
+void     sim_begin_step(bool *keys);     // first thing in a tick: clock, recorded or replayed keys
+void     sim_end_step(uint32_t (*checksum)()); // last thing in a tick: stores or verifies the checksum
+
+bool     sim_record_begin(string fname); // the seed must be set
+void     sim_record_end();
+bool     sim_recording();
+
+bool     sim_replay_begin(string fname); // seeds the generator
+bool     sim_replay_done();              // all the recorded ticks were stepped
+bool     sim_replaying();
+int      sim_replay_report();            // first desynced tick, -1 if none
+
+// ------------------------------------------------------------------
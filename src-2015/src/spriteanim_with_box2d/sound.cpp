@@ -1,4 +1,6 @@
 #include "common.h"
+#include "sound.h"
+#include "music.h"
 
 
 #include <iostream>
@@ -13,29 +15,38 @@
 
 using namespace std;
 
-ALuint LoadSound(const std::string& Filename)
+// whole file into memory; may run on any thread
+bool sound_decode(const std::string& Filename, SoundPcm& pcm)
 {
 	SF_INFO FileInfos;
 	SNDFILE* File = sf_open(Filename.c_str(), SFM_READ, &FileInfos);
 	if (!File)
-		return 0;
+		return false;
 
 	ALsizei NbSamples = static_cast<ALsizei>(FileInfos.channels * FileInfos.frames);
-	ALsizei SampleRate = static_cast<ALsizei>(FileInfos.samplerate);
-	vector<ALshort> Samples(NbSamples);
-	if (sf_read_short(File, &Samples[0], NbSamples) < NbSamples)
-		return 0;
+	pcm.rate = static_cast<ALsizei>(FileInfos.samplerate);
+	pcm.samples.resize(NbSamples);
+	sf_count_t read = sf_read_short(File, &pcm.samples[0], NbSamples);
 	sf_close(File);
-	ALenum Format;
+	if (read < NbSamples)
+		return false;
 	switch (FileInfos.channels)
 	{
-	case 1:  Format = AL_FORMAT_MONO16;   break;
-	case 2:  Format = AL_FORMAT_STEREO16; break;
-	default: return 0;
+	case 1:  pcm.format = AL_FORMAT_MONO16;   break;
+	case 2:  pcm.format = AL_FORMAT_STEREO16; break;
+	default: return false;
 	}
+	return true;
+}
+
+ALuint LoadSound(const std::string& Filename)
+{
+	SoundPcm pcm;
+	if (!sound_decode(Filename, pcm))
+		return 0;
 	ALuint Buffer;
 	alGenBuffers(1, &Buffer);
-	alBufferData(Buffer, Format, &Samples[0], NbSamples * sizeof(ALushort), SampleRate);
+	alBufferData(Buffer, pcm.format, &pcm.samples[0], (ALsizei)(pcm.samples.size() * sizeof(ALushort)), pcm.rate);
 
 	if (alGetError() != AL_NO_ERROR)
 		return 0;
@@ -46,29 +57,237 @@ ALuint LoadSound(const std::string& Filename)
 
 
 
-ALuint Source;
-list <string> sounds_src = { "boing.wav", "saut.wav", "1-up.wav", "theme.wav", "629681_-FlyBoyampGabberGir.wav", "629975_Power-Play.wav", "630254_Corriamo.wav", "630325_100-Miles.wav", "630320_Roys-Our-Boy-Smash-.wav", "630701_Mega-Man-Battle-Net.wav" };
-map < string , ALuint > sounds ;
+// ------------------------------------------------------------------
+
+typedef struct {
+  ALuint source;
+  int    snd;       // playing sound, -1 if none was started
+  int    priority;
+  int    started;   // play order, the oldest voice is stolen first
+  float  gain;      // of the sound, before the bus gain
+} Voice;
+
+// names of the effects, indexed by sound id
+const char *g_SoundNames[num_sounds] = { "boing.wav", "saut.wav", "1-up.wav" };
+
+ALuint        g_SoundBuffers[num_sounds];
+vector<Voice> g_Voices;
+float         g_BusGain[num_buses] = { 1.0f, 1.0f };
+int           g_VoiceClock = 0;
+
+ALCdevice    *g_SoundDevice  = NULL;
+ALCcontext   *g_SoundContext = NULL;
+
+extern int c_ScreenW;
+extern int separation;
+extern v2i g_viewpos1;
+extern v2i g_viewpos2;
+
+// ------------------------------------------------------------------
+
+static void sound_open_device()
+{
+  if (g_SoundContext != NULL) {
+    return;
+  }
+  g_SoundDevice = alcOpenDevice(NULL);
+  g_SoundContext = alcCreateContext(g_SoundDevice, NULL);
+  alcMakeContextCurrent(g_SoundContext);
+}
 
+// ------------------------------------------------------------------
+
+string sound_file(int snd)
+{
+  return executablePath() + "/data/sound/" + g_SoundNames[snd];
+}
+
+// ------------------------------------------------------------------
+
+// buffer of an effect decoded elsewhere (e.g. by the startup loader)
+void sound_upload(int snd, const SoundPcm& pcm)
+{
+  sound_open_device();
+  if (g_SoundBuffers[snd] != 0 || pcm.samples.empty()) {
+    return;
+  }
+  alGenBuffers(1, &g_SoundBuffers[snd]);
+  alBufferData(g_SoundBuffers[snd], pcm.format, &pcm.samples[0], (ALsizei)(pcm.samples.size() * sizeof(ALshort)), pcm.rate);
+}
+
+// ------------------------------------------------------------------
 
 void init_sound() {
-  ALCdevice* Device = alcOpenDevice(NULL);
-  ALCcontext* Context = alcCreateContext(Device, NULL);
-  alcMakeContextCurrent(Context);
+  sound_open_device();
 
-  for (list<string>::iterator srcs = sounds_src.begin(); srcs != sounds_src.end(); ++srcs)
-  {
-	  sounds[*srcs] = LoadSound(executablePath() + "/data/sound/" + *srcs);
+  // short effects, fully decoded; the songs are streamed (see music.cpp)
+  for (int s = 0; s < num_sounds; s++) {
+    if (g_SoundBuffers[s] == 0) {
+      // not preloaded
+      g_SoundBuffers[s] = LoadSound(sound_file(s));
+    }
   }
 
-  alGenSources(1, &Source);
+  // voices: sources whose position gives the panning, around the listener
+  g_Voices.resize(c_SoundVoices);
+  for (int v = 0; v < c_SoundVoices; v++) {
+    alGenSources(1, &g_Voices[v].source);
+    alSourcei(g_Voices[v].source, AL_SOURCE_RELATIVE, AL_TRUE);
+    alSourcef(g_Voices[v].source, AL_ROLLOFF_FACTOR, 0.0f);
+    g_Voices[v].snd      = -1;
+    g_Voices[v].priority = 0;
+    g_Voices[v].started  = 0;
+    g_Voices[v].gain     = 1.0f;
+  }
+
+  music_init();
+  music_set_gain(g_BusGain[bus_music]);
+}
+
+// ------------------------------------------------------------------
+
+void sound_terminate()
+{
+  music_terminate();
+  for (int v = 0; v < (int)g_Voices.size(); v++) {
+    alSourceStop(g_Voices[v].source);
+    alDeleteSources(1, &g_Voices[v].source);
+  }
+  g_Voices.clear();
+  alDeleteBuffers(num_sounds, g_SoundBuffers);
+  for (int s = 0; s < num_sounds; s++) {
+    g_SoundBuffers[s] = 0;
+  }
+  alcMakeContextCurrent(NULL);
+  if (g_SoundContext != NULL) alcDestroyContext(g_SoundContext);
+  if (g_SoundDevice != NULL)  alcCloseDevice(g_SoundDevice);
+  g_SoundContext = NULL;
+  g_SoundDevice  = NULL;
 }
 
-void play_sound(string snd){
-  alSourcei(Source, AL_BUFFER, sounds[snd]);
-  alSourcePlay(Source);
+// ------------------------------------------------------------------
+
+int sound_find(string name)
+{
+  for (int s = 0; s < num_sounds; s++) {
+    if (name == g_SoundNames[s]) {
+      return s;
+    }
+  }
+  return -1;
+}
+
+// ------------------------------------------------------------------
+
+// a free voice, or else the oldest of lowest priority if it may be stolen
+static int sound_voice(int priority)
+{
+  int best = -1;
+  for (int v = 0; v < (int)g_Voices.size(); v++) {
+    ALint state;
+    alGetSourcei(g_Voices[v].source, AL_SOURCE_STATE, &state);
+    if (state != AL_PLAYING) {
+      return v;
+    }
+    if (g_Voices[v].priority > priority) {
+      continue;
+    }
+    if (best < 0
+      || g_Voices[v].priority < g_Voices[best].priority
+      || (g_Voices[v].priority == g_Voices[best].priority && g_Voices[v].started < g_Voices[best].started)) {
+      best = v;
+    }
+  }
+  return best;
+}
+
+// ------------------------------------------------------------------
+
+// pan in [-1,1], gain of the sfx bus scaled by 'gain'
+static int sound_start(int snd, int priority, float pan, float gain)
+{
+  if (snd < 0 || snd >= num_sounds || g_Voices.empty() || g_SoundBuffers[snd] == 0) {
+    return -1;
+  }
+  int v = sound_voice(priority);
+  if (v < 0) {
+    // every voice plays something more important
+    return -1;
+  }
+  Voice& voice = g_Voices[v];
+  alSourceStop(voice.source);
+  alSourcei(voice.source, AL_BUFFER, g_SoundBuffers[snd]);
+  // on the unit circle in front of the listener: constant loudness
+  alSource3f(voice.source, AL_POSITION, pan, 0.0f, -sqrt(max(0.0f, 1.0f - pan * pan)));
+  alSourcef(voice.source, AL_GAIN, gain * g_BusGain[bus_sfx]);
+  alSourcePlay(voice.source);
+  voice.snd      = snd;
+  voice.priority = priority;
+  voice.started  = g_VoiceClock++;
+  voice.gain     = gain;
+  return v;
+}
+
+// ------------------------------------------------------------------
+
+int sound_play(int snd, int priority)
+{
+  return sound_start(snd, priority, 0.0f, 1.0f);
+}
+
+// ------------------------------------------------------------------
+
+// the left half of the screen pans to the left speaker, the right half
+// to the right one; heard from both views, the pans are averaged, and
+// off screen it is quieter, from the side of the closest view
+int sound_play_at(int snd, int priority, v2f p)
+{
+  v2i   views[2] = { g_viewpos1, g_viewpos2 };
+  float side[2]  = { -1.0f, 1.0f };
+  float pan  = 0.0f;
+  int   seen = 0;
+  float closest = 0.0f, closestDist = 1e9f;
+  for (int h = 0; h < 2; h++) {
+    float x = (p[0] - views[h][0]) / (float)c_ScreenW; // 0..1 across the half when on screen
+    if (x >= 0.0f && x <= 1.0f) {
+      // left half spans [-1,0], right half [0,1]
+      pan += (h == 0) ? (x - 1.0f) : x;
+      seen++;
+    } else {
+      float d = (x < 0.0f) ? -x : x - 1.0f;
+      if (d < closestDist) {
+        closestDist = d;
+        closest     = side[h];
+      }
+    }
+  }
+  if (seen > 0) {
+    return sound_start(snd, priority, pan / seen, 1.0f);
+  }
+  return sound_start(snd, priority, closest, 0.5f);
+}
+
+// ------------------------------------------------------------------
+
+void sound_set_bus_gain(int bus, float gain)
+{
+  g_BusGain[bus] = gain;
+  if (bus == bus_music) {
+    music_set_gain(gain);
+  } else {
+    for (int v = 0; v < (int)g_Voices.size(); v++) {
+      alSourcef(g_Voices[v].source, AL_GAIN, g_Voices[v].gain * gain);
+    }
+  }
+}
+
+// ------------------------------------------------------------------
+
+void sound_stop_all()
+{
+  for (int v = 0; v < (int)g_Voices.size(); v++) {
+    alSourceStop(g_Voices[v].source);
+  }
 }
 
-void rewind_sound() {
-  alSourceRewind(Source);
-}
\ No newline at end of file
+// ------------------------------------------------------------------
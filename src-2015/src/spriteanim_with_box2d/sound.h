@@ -1,5 +1,11 @@
 #pragma once
 
+// ------------------------------------------------------------------
+// Sound effects: a pool of OpenAL sources (voices) plays the effects,
+// each on its own voice. When all voices are busy, a new sound steals
+// the oldest voice of lowest priority, if that priority is not above
+// its own. Effects and music are mixed on separate buses.
+// ------------------------------------------------------------------
 
 #include <iostream>
 #include <stdlib.h>
@@ -16,7 +22,37 @@ using namespace std;
 
 #include <sndfile.h>
 
+#include <LibSL/LibSL.h>
+
+// ------------------------------------------------------------------
+
+// sound ids: index of the effect, in the order of the name table
+enum { snd_boing = 0, snd_jump, snd_1up, num_sounds };
+
+enum { bus_music = 0, bus_sfx, num_buses };
+
+// priorities, a voice is only stolen by a sound of the same or higher
+enum { prio_ambient = 0, prio_action, prio_event };
+
+const int c_SoundVoices = 16;
+
+// decoded samples, before they go into an OpenAL buffer
+typedef struct {
+  vector<ALshort> samples;
+  ALenum          format;
+  ALsizei         rate;
+} SoundPcm;
+
+// ------------------------------------------------------------------
+
 ALuint LoadSound(const std::string& Filename);
+bool   sound_decode(const std::string& Filename, SoundPcm& pcm); // any thread
+string sound_file(int snd);
+void   sound_upload(int snd, const SoundPcm& pcm);               // opens the device if needed
 void init_sound();
-void play_sound(string source);
-void rewind_sound();
+void sound_terminate();
+int  sound_find(string name);                     // id, -1 if unknown (resolve once, not per play)
+int  sound_play(int snd, int priority);           // centered; voice index, -1 if dropped
+int  sound_play_at(int snd, int priority, v2f p); // panned from the position in the split screen
+void sound_set_bus_gain(int bus, float gain);
+void sound_stop_all();
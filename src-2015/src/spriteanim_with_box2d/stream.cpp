@@ -0,0 +1,175 @@
+// ------------------------------------------------------------------
+
+#include "common.h"
+#include "stream.h"
+#include "profile.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+// ------------------------------------------------------------------
+
+typedef struct {
+  string fname;
+  bool   colorKey;  // magenta becomes transparent
+} StreamJob;
+
+typedef struct {
+  StreamStatus status;
+  ImageRGBA   *image;   // decoded pixels, once ready
+} StreamEntry;
+
+mutex                    g_StreamMutex;
+condition_variable       g_StreamWakeUp;
+deque<StreamJob>         g_StreamQueue;
+map<string, StreamEntry> g_StreamEntries;  // every file requested so far
+vector<thread>           g_StreamWorkers;
+bool                     g_StreamQuit = false;
+
+// ------------------------------------------------------------------
+
+// probes and decodes a file, on any thread; NULL if missing
+ImageRGBA *stream_decode(string fname, bool colorKey)
+{
+  if (!LibSL::System::File::exists(fname.c_str())) {
+    return NULL;
+  }
+  try {
+    ImageRGBA *img = loadImageRGBA(fname);
+    if (colorKey) {
+      ForImage(img, i, j) {
+        v4b& pix = img->pixel(i, j);
+        if (pix[0] == 255 && pix[1] == 0 && pix[2] == 255) {
+          pix[3] = 0;
+        }
+      }
+    }
+    return img;
+  }
+  catch (Fatal& f) { // error handling
+    std::cerr << Console::red << f.message() << Console::gray << std::endl;
+  }
+  return NULL;
+}
+
+// ------------------------------------------------------------------
+
+static void stream_worker()
+{
+  profile_thread_name("stream");
+  while (true) {
+    StreamJob job;
+    {
+      unique_lock<mutex> lock(g_StreamMutex);
+      g_StreamWakeUp.wait(lock, [] { return g_StreamQuit || !g_StreamQueue.empty(); });
+      if (g_StreamQuit) {
+        return;
+      }
+      job = g_StreamQueue.front();
+      g_StreamQueue.pop_front();
+    }
+    // probe and decode outside the lock
+    ImageRGBA *img;
+    {
+      PROFILE_ZONE("stream decode");
+      img = stream_decode(job.fname, job.colorKey);
+    }
+    {
+      lock_guard<mutex> lock(g_StreamMutex);
+      StreamEntry& e = g_StreamEntries[job.fname];
+      e.image  = img;
+      e.status = (img == NULL) ? stream_missing : stream_ready;
+    }
+  }
+}
+
+// ------------------------------------------------------------------
+
+void stream_init()
+{
+  if (!g_StreamWorkers.empty()) {
+    return;
+  }
+  g_StreamQuit = false;
+  for (int w = 0; w < c_StreamWorkers; w++) {
+    g_StreamWorkers.push_back(thread(stream_worker));
+  }
+}
+
+// ------------------------------------------------------------------
+
+void stream_terminate()
+{
+  {
+    lock_guard<mutex> lock(g_StreamMutex);
+    g_StreamQuit = true;
+    g_StreamQueue.clear();
+  }
+  g_StreamWakeUp.notify_all();
+  for (int w = 0; w < (int)g_StreamWorkers.size(); w++) {
+    g_StreamWorkers[w].join();
+  }
+  g_StreamWorkers.clear();
+  for (auto E = g_StreamEntries.begin(); E != g_StreamEntries.end(); E++) {
+    delete (E->second.image);
+  }
+  g_StreamEntries.clear();
+}
+
+// ------------------------------------------------------------------
+
+void stream_request(string fname, bool colorKey, bool urgent)
+{
+  {
+    lock_guard<mutex> lock(g_StreamMutex);
+    if (g_StreamEntries.find(fname) != g_StreamEntries.end()) {
+      // already in flight, decoded or known missing
+      return;
+    }
+    StreamEntry e;
+    e.status = stream_pending;
+    e.image  = NULL;
+    g_StreamEntries[fname] = e;
+    StreamJob job;
+    job.fname    = fname;
+    job.colorKey = colorKey;
+    if (urgent) {
+      g_StreamQueue.push_front(job);
+    } else {
+      g_StreamQueue.push_back(job);
+    }
+  }
+  g_StreamWakeUp.notify_one();
+}
+
+// ------------------------------------------------------------------
+
+StreamStatus stream_status(string fname)
+{
+  lock_guard<mutex> lock(g_StreamMutex);
+  auto E = g_StreamEntries.find(fname);
+  return (E == g_StreamEntries.end()) ? stream_unknown : E->second.status;
+}
+
+// ------------------------------------------------------------------
+
+// turns decoded pixels into a texture; the entry goes back to unknown
+// so that the file can be requested again once the image is released
+DrawImage *stream_upload(string fname)
+{
+  ImageRGBA *img = NULL;
+  {
+    lock_guard<mutex> lock(g_StreamMutex);
+    auto E = g_StreamEntries.find(fname);
+    if (E == g_StreamEntries.end() || E->second.status != stream_ready) {
+      return NULL;
+    }
+    img = E->second.image;
+    g_StreamEntries.erase(E);
+  }
+  return new DrawImage(ImageRGBA_Ptr(img));
+}
+
+// ------------------------------------------------------------------
@@ -0,0 +1,175 @@
+// ------------------------------------------------------------------
+
+#include "common.h"
+#include "texcache.h"
+
+#include <list>
+
+// ------------------------------------------------------------------
+
+typedef struct {
+  string          key;
+  DrawImage      *image;  // NULL if the slot is free
+  size_t          bytes;
+  int             refs;
+  list<int>::iterator lru; // position in g_TexLru while refs == 0
+} TexEntry;
+
+vector<TexEntry> g_TexEntries;
+map<string, int> g_TexIds;       // key -> entry
+list<int>        g_TexLru;       // released entries, most recently used first
+vector<int>      g_TexFree;      // free slots in g_TexEntries
+TexCacheStats    g_TexStats = { 0, 0, 0, 0, c_TexCacheDefaultBudget };
+
+// ------------------------------------------------------------------
+
+static void texcache_evict(int id)
+{
+  TexEntry& e = g_TexEntries[id];
+  g_TexLru.erase(e.lru);
+  g_TexIds.erase(e.key);
+  g_TexStats.bytes -= e.bytes;
+  g_TexStats.evictions++;
+  delete (e.image);
+  e.image = NULL;
+  e.key.clear();
+  g_TexFree.push_back(id);
+}
+
+// ------------------------------------------------------------------
+
+// frees released images, oldest first, until within budget
+static void texcache_trim()
+{
+  while (g_TexStats.bytes > g_TexStats.budget && !g_TexLru.empty()) {
+    texcache_evict(g_TexLru.back());
+  }
+}
+
+// ------------------------------------------------------------------
+
+void texcache_set_budget(size_t bytes)
+{
+  g_TexStats.budget = bytes;
+  texcache_trim();
+}
+
+// ------------------------------------------------------------------
+
+int texcache_find(string key)
+{
+  map<string, int>::iterator T = g_TexIds.find(key);
+  if (T == g_TexIds.end()) {
+    return -1;
+  }
+  TexEntry& e = g_TexEntries[T->second];
+  if (e.refs == 0) {
+    g_TexLru.erase(e.lru);
+  }
+  e.refs++;
+  g_TexStats.hits++;
+  return T->second;
+}
+
+// ------------------------------------------------------------------
+
+int texcache_insert(string key, DrawImage *img)
+{
+  int id = texcache_find(key);
+  if (id >= 0) {
+    // already resident, keep the first copy
+    delete (img);
+    return id;
+  }
+  if (g_TexFree.empty()) {
+    id = (int)g_TexEntries.size();
+    g_TexEntries.push_back(TexEntry());
+  } else {
+    id = g_TexFree.back();
+    g_TexFree.pop_back();
+  }
+  TexEntry& e = g_TexEntries[id];
+  e.key   = key;
+  e.image = img;
+  e.bytes = (size_t)img->w() * img->h() * 4;
+  e.refs  = 1;
+  g_TexIds[key] = id;
+  g_TexStats.misses++;
+  g_TexStats.bytes += e.bytes;
+  texcache_trim();
+  return id;
+}
+
+// ------------------------------------------------------------------
+
+int texcache_load(string fname, bool colorKey)
+{
+  int id = texcache_find(fname);
+  if (id >= 0) {
+    return id;
+  }
+  if (!LibSL::System::File::exists(fname.c_str())) {
+    return -1;
+  }
+  DrawImage *img = colorKey ? new DrawImage(fname.c_str(), v3b(255, 0, 255)) : new DrawImage(fname.c_str());
+  return texcache_insert(fname, img);
+}
+
+// ------------------------------------------------------------------
+
+void texcache_release(int handle)
+{
+  if (handle < 0) {
+    return;
+  }
+  TexEntry& e = g_TexEntries[handle];
+  sl_assert(e.refs > 0);
+  if (--e.refs == 0) {
+    g_TexLru.push_front(handle);
+    e.lru = g_TexLru.begin();
+    texcache_trim();
+  }
+}
+
+// ------------------------------------------------------------------
+
+DrawImage *texcache_image(int handle)
+{
+  return g_TexEntries[handle].image;
+}
+
+// ------------------------------------------------------------------
+
+void texcache_pin(long long bytes)
+{
+  g_TexStats.bytes += bytes;
+  texcache_trim();
+}
+
+// ------------------------------------------------------------------
+
+void texcache_clear()
+{
+  while (!g_TexLru.empty()) {
+    texcache_evict(g_TexLru.back());
+  }
+}
+
+// ------------------------------------------------------------------
+
+TexCacheStats texcache_stats()
+{
+  return g_TexStats;
+}
+
+// ------------------------------------------------------------------
+
+void texcache_report()
+{
+  cerr << Console::white << "textures: " << g_TexIds.size() << " resident, "
+    << g_TexStats.bytes / 1024 << " / " << g_TexStats.budget / 1024 << " KB, "
+    << g_TexStats.hits << " hits, " << g_TexStats.misses << " misses, "
+    << g_TexStats.evictions << " evictions" << Console::gray << endl;
+}
+
+// ------------------------------------------------------------------
@@ -0,0 +1,43 @@
+#pragma once
+
+// ------------------------------------------------------------------
+// Texture residency: images are shared through reference counted
+// handles. A released image stays resident until the memory budget is
+// exceeded, then the least recently used ones are freed first. The
+// atlas pages are pinned and count in the budget.
+// ------------------------------------------------------------------
+
+#include<string>
+
+using namespace std;
+
+// ------------------------------------------------------------------
+
+#include "drawimage.h"
+
+// ------------------------------------------------------------------
+
+typedef struct {
+  int    hits;       // acquired while resident
+  int    misses;     // had to be loaded
+  int    evictions;
+  size_t bytes;      // resident, pinned included
+  size_t budget;
+} TexCacheStats;
+
+const size_t c_TexCacheDefaultBudget = 64 * 1024 * 1024;
+
+// ------------------------------------------------------------------
+
+void          texcache_set_budget(size_t bytes);
+int           texcache_find(string key);                    // acquires a resident image, -1 if not resident
+int           texcache_load(string fname, bool colorKey);   // acquires, loading on a miss; -1 if no such file
+int           texcache_insert(string key, DrawImage *img);  // acquires an image loaded elsewhere (e.g. streamed)
+void          texcache_release(int handle);
+DrawImage    *texcache_image(int handle);
+void          texcache_pin(long long bytes);                // memory held outside the cache
+void          texcache_clear();                             // frees all released images
+TexCacheStats texcache_stats();
+void          texcache_report();
+
+// ------------------------------------------------------------------
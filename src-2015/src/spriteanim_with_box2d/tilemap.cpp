@@ -1,10 +1,19 @@
 // ------------------------------------------------------------------
 
 #include "common.h"
+#ifndef HEADLESS
 #include "drawimage.h"
+#endif
 #include "script.h"
 #include "tilemap.h"
 #include "entity.h"
+#ifndef HEADLESS
+#include "batch.h"
+#else
+#include "atlas.h"
+#endif
+#include "levelfile.h"
+#include "profile.h"
 
 // ------------------------------------------------------------------
 
@@ -13,6 +22,8 @@
 extern b2World *g_World;
 extern int    c_ScreenW;
 extern int    c_ScreenH;
+extern int    separation;
+extern int    ratio_split;
 
 // ------------------------------------------------------------------
 
@@ -25,16 +36,15 @@ int              tilemapH = 77;
 void lua_tile(int color, string filename, int x, int y, int w, int h)
 {
 	try {
-		// load image if needed
-		if (g_Current->images.find(filename) == g_Current->images.end()) {
-			// load!
-			DrawImage *image = new DrawImage((executablePath() + "/data/tilemap/" + filename).c_str(), v3b(255, 0, 255));
-			// insert
-			g_Current->images[filename] = image;
+		// pack sheet if needed
+		int region = atlas_add("tilemap/" + filename);
+		if (region < 0) {
+			return;
 		}
 		// store tile definition
 		Tile *tile = new Tile;
-		tile->image = g_Current->images[filename];
+		tile->region = region;
+		tile->sheet = "tilemap/" + filename;
 		tile->x = x;
 		tile->y = y;
 		tile->w = w;
@@ -87,9 +97,7 @@ int lua_tileat(int i, int j)
 void lua_set_tileat(int i, int j, int clr)
 {
 	try {
-		g_Current->tilemap->pixel(i, j)[0] = clr & 255;
-		g_Current->tilemap->pixel(i, j)[1] = (clr >> 8) & 255;
-		g_Current->tilemap->pixel(i, j)[2] = (clr >> 16) & 255;
+		tilemap_set_tileat(g_Current, i, j, clr);
 	}
 	catch (Fatal& f) { // error handling
 		std::cerr << Console::red << f.message() << Console::gray << std::endl;
@@ -131,15 +139,16 @@ int lua_num_tiles_y()
 
 // ------------------------------------------------------------------
 
-Tilemap *tilemap_load(string fname)
+// install our own functions into the shared VM, once
+static void tilemap_register_script_functions()
 {
-	Tilemap *tilemap = new Tilemap;
-
-	Script *script = script_create();
-
-	// install our own functions into the script
+	static bool registered = false;
+	if (registered) {
+		return;
+	}
+	registered = true;
 	{
-		module(script->lua)
+		module(script_vm())
 			[
 				def("tile", &lua_tile),
 				def("tilemap", &lua_tilemap),
@@ -153,6 +162,31 @@ Tilemap *tilemap_load(string fname)
 				def("create_gems", &lua_create_gems)
 			];
 	}
+}
+
+// ------------------------------------------------------------------
+
+Tilemap *tilemap_load(string fname, int variant)
+{
+	Tilemap *tilemap = new Tilemap;
+	tilemap->tilemap = NULL;
+	tilemap->body    = NULL;
+	tilemap->w       = 0;
+	tilemap->h       = 0;
+	tilemap->baked   = false;
+	tilemap->cells   = NULL;
+	memset(&tilemap->file, 0, sizeof(MappedFile));
+
+	tilemap_register_script_functions();
+	Script *script = script_create();
+	if (variant >= 0) {
+		// the script picks this map rather than a random one
+		script_push_env(script);
+		lua_pushinteger(script->lua, variant);
+		lua_setfield(script->lua, -2, "map_variant");
+		lua_pop(script->lua, 1);
+	}
+
 	// load the script (global space gets executed)
 	g_Current = tilemap;
 	script_load(script, executablePath()  + "/data/scripts/" + fname);
@@ -161,63 +195,521 @@ Tilemap *tilemap_load(string fname)
 	script_kill(script);
 	delete (script);
 
+	// resolve tile definitions once, rather than per pixel and per frame
+	if (tilemap->tilemap != NULL) {
+		tilemap->w = tilemap->tilemap->w();
+		tilemap->h = tilemap->tilemap->h();
+		tilemap->grid.resize(tilemap->w * tilemap->h);
+		ForImage(tilemap->tilemap, i, j) {
+			auto T = tilemap->tiles.find(v3b(tilemap->tilemap->pixel(i, j)));
+			tilemap->grid[i + j * tilemap->tilemap->w()] = (T == tilemap->tiles.end()) ? NULL : T->second;
+		}
+	}
+
 	return tilemap;
 }
 
 // ------------------------------------------------------------------
 
-void tilemap_bind_to_physics(Tilemap *tmap)
+// tile definition at (i,j), NULL if the tile is empty
+static Tile *tile_at(Tilemap *tmap, int i, int j)
+{
+	if (tmap->cells != NULL) {
+		// baked, read from the mapped file
+		int t = tmap->cells[i + j * tmap->w];
+		return (t >= 0 && t < (int)tmap->tileOf.size()) ? tmap->tileOf[t] : NULL;
+	}
+	return tmap->grid[i + j * tmap->w];
+}
+
+// ------------------------------------------------------------------
+
+// can tile (i,j) join a rectangle made of tiles like 'ref'?
+static bool tile_mergeable(Tilemap *tmap, int i, int j, Tile *ref)
+{
+	if (tmap->rectAt[i + j * tmap->w] != -1) {
+		return false;
+	}
+	Tile *tile = tile_at(tmap, i, j);
+	return tile != NULL && tile->w == ref->w && tile->h == ref->h;
+}
+
+// ------------------------------------------------------------------
+
+static void tilemap_add_rect(Tilemap *tmap, int x, int y, int w, int h, Tile *ref)
 {
-	// define the dynamic body for the entire tilemap
+	// size in pixels: tiles may overlap their neighbours (e.g. 18x16 on a 16x16 grid)
+	int pw = (w - 1) * tmap->tilew + ref->w;
+	int ph = (h - 1) * tmap->tileh + ref->h;
+	// define a box shape.
+	b2PolygonShape box;
+	box.SetAsBox(
+		in_meters(pw) / 2.0f, in_meters(ph) / 2.0f,  // size
+		b2Vec2(in_meters(x*tmap->tilew) + in_meters(pw) / 2.0f, in_meters(y*tmap->tileh) + in_meters(ph) / 2.0f), // center
+		0.0f);
+	// define the fixture.
+	b2FixtureDef fixtureDef;
+	fixtureDef.shape = &box;
+	// set the box density to be zero, so it will be static.
+	fixtureDef.density = 0.0f;
+	// override the default friction.
+	fixtureDef.friction = 0.99f;
+	// how bouncy?
+	fixtureDef.restitution = 0.02f;
+	// user data; set to NULL to distinguish from entities
+	fixtureDef.userData = (void*)NULL;
+	// store the rectangle, reusing a free slot if any
+	TileRect rect;
+	rect.x = x;
+	rect.y = y;
+	rect.w = w;
+	rect.h = h;
+	rect.fixture = tmap->body->CreateFixture(&fixtureDef);
+	int r = 0;
+	while (r < (int)tmap->rects.size() && tmap->rects[r].fixture != NULL) {
+		r++;
+	}
+	if (r == (int)tmap->rects.size()) {
+		tmap->rects.push_back(rect);
+	} else {
+		tmap->rects[r] = rect;
+	}
+	for (int j = y; j < y + h; j++) {
+		for (int i = x; i < x + w; i++) {
+			tmap->rectAt[i + j * tmap->w] = r;
+		}
+	}
+}
+
+// ------------------------------------------------------------------
+
+// greedily cover the solid tiles of [x0,x1[ x [y0,y1[ that are not yet
+// bound with maximal rectangles: runs along rows first, then grown over
+// the following rows as long as the whole run is solid
+static void tilemap_merge_region(Tilemap *tmap, int x0, int y0, int x1, int y1, bool merge)
+{
+	for (int j = y0; j < y1; j++) {
+		for (int i = x0; i < x1; i++) {
+			if (tmap->rectAt[i + j * tmap->w] != -1) {
+				continue;
+			}
+			Tile *tile = tile_at(tmap, i, j);
+			if (tile == NULL) {
+				continue;
+			}
+			// boxes only form a single rectangle if they leave no gap
+			bool mergeX = merge && tile->w >= tmap->tilew;
+			bool mergeY = merge && tile->h >= tmap->tileh;
+			int w = 1;
+			while (mergeX && i + w < x1 && tile_mergeable(tmap, i + w, j, tile)) {
+				w++;
+			}
+			int h = 1;
+			while (mergeY && j + h < y1) {
+				bool full = true;
+				for (int k = i; k < i + w && full; k++) {
+					full = tile_mergeable(tmap, k, j + h, tile);
+				}
+				if (!full) break;
+				h++;
+			}
+			tilemap_add_rect(tmap, i, j, w, h, tile);
+		}
+	}
+}
+
+// ------------------------------------------------------------------
+
+// binds the tilemap as rectangles, merged or one per tile; in bulk, the
+// body is activated once all rectangles are in, so that the broad-phase
+// builds their tree in one go, otherwise each proxy is inserted as created
+static void tilemap_bind(Tilemap *tmap, bool merge, bool bulk)
+{
+	// define the static body for the entire tilemap
 	b2BodyDef bodyDef;
 	bodyDef.type = b2_staticBody;
 	bodyDef.position.Set(0.0f, 0.0f);
-	b2Body *body = g_World->CreateBody(&bodyDef);
+	bodyDef.active = !bulk;
+	tmap->body = g_World->CreateBody(&bodyDef);
+
+	tmap->rects.clear();
+	tmap->rectAt.assign(tmap->w * tmap->h, -1);
+	if (tmap->baked) {
+		// merged by the baker, read from the mapped file
+		const LevelHeader *hd = (const LevelHeader*)tmap->file.data;
+		const LevelRect   *lr = (const LevelRect*)(tmap->file.data + hd->rectsOffset);
+		for (int r = 0; r < (int)hd->numRects; r++) {
+			if (lr[r].x < 0 || lr[r].y < 0 || lr[r].w <= 0 || lr[r].h <= 0
+				|| lr[r].x + lr[r].w > tmap->w || lr[r].y + lr[r].h > tmap->h) {
+				continue;
+			}
+			Tile *tile = tile_at(tmap, lr[r].x, lr[r].y);
+			if (tile != NULL) {
+				tilemap_add_rect(tmap, lr[r].x, lr[r].y, lr[r].w, lr[r].h, tile);
+			}
+		}
+		tmap->baked = false;
+	} else {
+		tilemap_merge_region(tmap, 0, 0, tmap->w, tmap->h, merge);
+	}
+	if (bulk) {
+		tmap->body->SetActive(true);
+	}
+}
+
+// ------------------------------------------------------------------
+
+void tilemap_bind_to_physics(Tilemap *tmap)
+{
+	tilemap_bind(tmap, true, true);
+}
+
+// ------------------------------------------------------------------
+
+// takes the collision rectangles in or out of the world, keeping them
+void tilemap_set_active(Tilemap *tmap, bool active)
+{
+	if (tmap->body != NULL) {
+		tmap->body->SetActive(active);
+	}
+}
+
+// ------------------------------------------------------------------
+
+// releases the tilemap and its body (the physics world must still exist)
+void tilemap_free(Tilemap *tmap)
+{
+	if (tmap == NULL) {
+		return;
+	}
+	if (tmap->body != NULL) {
+		g_World->DestroyBody(tmap->body);
+	}
+	if (tmap->file.data != NULL) {
+		// baked: the tiles map, if any, points to the same definitions
+		for (int t = 0; t < (int)tmap->tileOf.size(); t++) {
+			delete (tmap->tileOf[t]);
+		}
+		levelfile_unmap(tmap->file);
+	} else {
+		for (auto T = tmap->tiles.begin(); T != tmap->tiles.end(); T++) {
+			delete (T->second);
+		}
+	}
+	delete (tmap->tilemap);
+	delete (tmap);
+}
+
+// ------------------------------------------------------------------
+
+void tilemap_set_tileat(Tilemap *tmap, int i, int j, int clr)
+{
+	v3b color = v3b(clr & 255, (clr >> 8) & 255, (clr >> 16) & 255);
+	if (tmap->tilemap != NULL) {
+		tmap->tilemap->pixel(i, j)[0] = color[0];
+		tmap->tilemap->pixel(i, j)[1] = color[1];
+		tmap->tilemap->pixel(i, j)[2] = color[2];
+	}
+	if (tmap->cells != NULL) {
+		// first change to a baked level: the mapped grid is read-only, so
+		// it is resolved now, along with the colors of the tile definitions
+		const LevelHeader *hd = (const LevelHeader*)tmap->file.data;
+		const LevelTile   *lt = (const LevelTile*)(tmap->file.data + hd->tilesOffset);
+		for (int t = 0; t < (int)tmap->tileOf.size(); t++) {
+			if (tmap->tileOf[t] != NULL) {
+				tmap->tiles[v3b(lt[t].color[0], lt[t].color[1], lt[t].color[2])] = tmap->tileOf[t];
+			}
+		}
+		tmap->grid.resize(tmap->w * tmap->h);
+		for (int y = 0; y < tmap->h; y++) {
+			for (int x = 0; x < tmap->w; x++) {
+				tmap->grid[x + y * tmap->w] = tile_at(tmap, x, y);
+			}
+		}
+		tmap->cells = NULL;
+	}
+	if (tmap->grid.empty()) {
+		// still loading, grid not resolved yet
+		return;
+	}
+	auto T = tmap->tiles.find(color);
+	tmap->grid[i + j * tmap->w] = (T == tmap->tiles.end()) ? NULL : T->second;
+	if (tmap->body == NULL) {
+		// not bound to physics yet
+		return;
+	}
+	// release the rectangle covering the tile, and rebuild its area
+	int x0 = i, y0 = j, x1 = i + 1, y1 = j + 1;
+	int r = tmap->rectAt[i + j * tmap->w];
+	if (r != -1) {
+		TileRect &rect = tmap->rects[r];
+		x0 = rect.x;
+		y0 = rect.y;
+		x1 = rect.x + rect.w;
+		y1 = rect.y + rect.h;
+		tmap->body->DestroyFixture(rect.fixture);
+		rect.fixture = NULL;
+		for (int y = y0; y < y1; y++) {
+			for (int x = x0; x < x1; x++) {
+				tmap->rectAt[x + y * tmap->w] = -1;
+			}
+		}
+	}
+	tilemap_merge_region(tmap, x0, y0, x1, y1, true);
+}
+
+// ------------------------------------------------------------------
 
-	ForImage(tmap->tilemap, i, j) {
-		v3b pix = v3b(tmap->tilemap->pixel(i, j));
-		Tile *tile = tmap->tiles[pix];
-		if (tile) {
-			// define a box shape.
+// steps the level with a few probe bodies dropped on the spawn points,
+// once with one fixture per tile inserted one by one in the broad-phase, as
+// levels were bound before merging, and once with merged rectangles built in
+// bulk, as they are bound now
+void tilemap_physics_report(string fname)
+{
+	g_Ennemies.clear();
+	g_Stars.clear();
+	g_Gems.clear();
+	Tilemap *tmap = tilemap_load(fname);
+
+	vector<v2i> spawns;
+	spawns.push_back(v2i(300, 1000));
+	spawns.push_back(v2i(2000, 1000));
+	for (int i = 0; i < (int)g_Ennemies.size(); i++) spawns.push_back(v2i(g_Ennemies[i][0], g_Ennemies[i][1]));
+	for (int i = 0; i < (int)g_Stars.size(); i++)    spawns.push_back(v2i(g_Stars[i][0], g_Stars[i][1]));
+	for (int i = 0; i < (int)g_Gems.size(); i++)     spawns.push_back(v2i(g_Gems[i][0], g_Gems[i][1]));
+
+	const int numSteps = 500;
+	for (int merge = 0; merge < 2; merge++) {
+		phy_init();
+		tilemap_bind(tmap, merge != 0, merge != 0);
+		for (int s = 0; s < (int)spawns.size(); s++) {
+			b2BodyDef bodyDef;
+			bodyDef.type = b2_dynamicBody;
+			bodyDef.position.Set(in_meters(spawns[s][0]), in_meters(spawns[s][1]));
+			b2Body *body = g_World->CreateBody(&bodyDef);
 			b2PolygonShape box;
-			box.SetAsBox(
-				in_meters(tile->w / 2), in_meters(tile->h / 2),  // size
-				b2Vec2(in_meters(i*tmap->tilew + tile->w / 2), in_meters(j*tmap->tileh + tile->h / 2)), // center
-				0.0f);
-			// define the dynamic body fixture.
-			b2FixtureDef fixtureDef;
-			fixtureDef.shape = &box;
-			// set the box density to be zero, so it will be static.
-			fixtureDef.density = 0.0f;
-			// override the default friction.
-			fixtureDef.friction = 0.99f;
-			// how bouncy?
-			fixtureDef.restitution = 0.02f;
-			// user data; set to NULL to distinguish from entities
-			fixtureDef.userData = (void*)NULL;
-			// add the shape to the body.
-			body->CreateFixture(&fixtureDef);
+			box.SetAsBox(in_meters(12), in_meters(16));
+			body->CreateFixture(&box, 1.0f);
+		}
+		int   numProxies  = g_World->GetProxyCount();
+		float numContacts = 0;
+		t_time start = milliseconds();
+		for (int s = 0; s < numSteps; s++) {
+			g_World->Step(1 / 50.0f, 3, 1);
+			numContacts += g_World->GetContactCount();
+		}
+		t_time stop = milliseconds();
+		cerr << Console::white << fname << (merge ? " merged  " : " per tile")
+			<< " tile fixtures: " << tmap->rects.size()
+			<< " proxies: " << numProxies
+			<< " contacts/step: " << numContacts / numSteps
+			<< " ms/step: " << (stop - start) / (float)numSteps
+			<< Console::gray << endl;
+		phy_terminate();
+		tmap->body = NULL;
+	}
+}
+
+// ------------------------------------------------------------------
 
+// writes a bound tilemap and the spawn lists of its script, as found
+// in g_Ennemies, g_Stars and g_Gems, to a level file
+bool tilemap_bake(Tilemap *tmap, string fname)
+{
+	// sheets and tiles, numbered in order of appearance
+	vector<LevelSheet>  sheets;
+	map<string, int>    sheetIds;
+	vector<LevelTile>   tiles;
+	map<Tile*, int>     tileIds;
+	for (auto T = tmap->tiles.begin(); T != tmap->tiles.end(); T++) {
+		Tile *tile = T->second;
+		if (tileIds.find(tile) != tileIds.end()) {
+			continue;
+		}
+		auto S = sheetIds.find(tile->sheet);
+		if (S == sheetIds.end()) {
+			LevelSheet sheet;
+			memset(&sheet, 0, sizeof(sheet));
+			sl_assert(tile->sheet.size() < c_LevelNameLen);
+			strncpy(sheet.name, tile->sheet.c_str(), c_LevelNameLen - 1);
+			S = sheetIds.insert(make_pair(tile->sheet, (int)sheets.size())).first;
+			sheets.push_back(sheet);
 		}
+		LevelTile lt;
+		lt.sheet = S->second;
+		lt.x = tile->x;
+		lt.y = tile->y;
+		lt.w = tile->w;
+		lt.h = tile->h;
+		lt.color[0] = T->first[0];
+		lt.color[1] = T->first[1];
+		lt.color[2] = T->first[2];
+		lt.color[3] = 0;
+		tileIds[tile] = (int)tiles.size();
+		tiles.push_back(lt);
+	}
+	// grid of tile indices
+	vector<int16_t> grid(tmap->w * tmap->h);
+	for (int c = 0; c < (int)grid.size(); c++) {
+		grid[c] = (tmap->grid[c] == NULL) ? -1 : (int16_t)tileIds[tmap->grid[c]];
+	}
+	// collision rectangles in use
+	vector<LevelRect> rects;
+	for (int r = 0; r < (int)tmap->rects.size(); r++) {
+		if (tmap->rects[r].fixture == NULL) continue;
+		LevelRect lr;
+		lr.x = tmap->rects[r].x;
+		lr.y = tmap->rects[r].y;
+		lr.w = tmap->rects[r].w;
+		lr.h = tmap->rects[r].h;
+		rects.push_back(lr);
 	}
+	// spawn points, in pixels
+	vector<LevelSpawn> spawns;
+	const vector<v3i> *lists[3] = { &g_Ennemies, &g_Stars, &g_Gems };
+	int kinds[3] = { spawn_ennemy, spawn_star, spawn_gem };
+	for (int l = 0; l < 3; l++) {
+		for (int i = 0; i < (int)lists[l]->size(); i++) {
+			LevelSpawn sp;
+			sp.kind  = kinds[l];
+			sp.x     = (*lists[l])[i][0];
+			sp.y     = (*lists[l])[i][1];
+			sp.value = (*lists[l])[i][2];
+			spawns.push_back(sp);
+		}
+	}
+	// layout: header, tables, grid last
+	LevelHeader hd;
+	memset(&hd, 0, sizeof(hd));
+	memcpy(hd.magic, c_LevelMagic, 4);
+	hd.version      = c_LevelVersion;
+	hd.w            = tmap->w;
+	hd.h            = tmap->h;
+	hd.tilew        = tmap->tilew;
+	hd.tileh        = tmap->tileh;
+	hd.numSheets    = (uint32_t)sheets.size();
+	hd.sheetsOffset = sizeof(LevelHeader);
+	hd.numTiles     = (uint32_t)tiles.size();
+	hd.tilesOffset  = hd.sheetsOffset + hd.numSheets * sizeof(LevelSheet);
+	hd.numRects     = (uint32_t)rects.size();
+	hd.rectsOffset  = hd.tilesOffset + hd.numTiles * sizeof(LevelTile);
+	hd.numSpawns    = (uint32_t)spawns.size();
+	hd.spawnsOffset = hd.rectsOffset + hd.numRects * sizeof(LevelRect);
+	hd.gridOffset   = hd.spawnsOffset + hd.numSpawns * sizeof(LevelSpawn);
+	hd.fileSize     = hd.gridOffset + (uint32_t)(grid.size() * sizeof(int16_t));
+	FILE *f = fopen(fname.c_str(), "wb");
+	if (f == NULL) {
+		cerr << Console::red << "cannot write '" << fname << "'" << Console::gray << endl;
+		return false;
+	}
+	fwrite(&hd, sizeof(hd), 1, f);
+	if (!sheets.empty()) fwrite(&sheets[0], sizeof(LevelSheet), sheets.size(), f);
+	if (!tiles.empty())  fwrite(&tiles[0],  sizeof(LevelTile),  tiles.size(),  f);
+	if (!rects.empty())  fwrite(&rects[0],  sizeof(LevelRect),  rects.size(),  f);
+	if (!spawns.empty()) fwrite(&spawns[0], sizeof(LevelSpawn), spawns.size(), f);
+	fwrite(&grid[0], sizeof(int16_t), grid.size(), f);
+	fclose(f);
+	return true;
+}
 
+// ------------------------------------------------------------------
+
+// maps a level file and keeps it mapped: the grid and the rectangles are
+// read from it, only the tile definitions are resolved to atlas regions;
+// the spawn lists go to g_Ennemies, g_Stars and g_Gems as the level script
+// would have done
+Tilemap *tilemap_load_baked(string fname)
+{
+	MappedFile mf;
+	if (!levelfile_map(fname, mf)) {
+		return NULL;
+	}
+	const LevelHeader *hd = levelfile_header(mf);
+	if (hd == NULL) {
+		cerr << Console::yellow << fname << " is not a level file of version " << c_LevelVersion << Console::gray << endl;
+		levelfile_unmap(mf);
+		return NULL;
+	}
+	const LevelSheet *sheets = (const LevelSheet*)(mf.data + hd->sheetsOffset);
+	const LevelTile  *tiles  = (const LevelTile*) (mf.data + hd->tilesOffset);
+	const LevelSpawn *spawns = (const LevelSpawn*)(mf.data + hd->spawnsOffset);
+
+	Tilemap *tmap = new Tilemap;
+	tmap->tilemap = NULL;
+	tmap->body    = NULL;
+	tmap->w       = hd->w;
+	tmap->h       = hd->h;
+	tmap->tilew   = hd->tilew;
+	tmap->tileh   = hd->tileh;
+	tmap->baked   = true;
+	tmap->file    = mf;
+	tmap->cells   = (const int16_t*)(mf.data + hd->gridOffset);
+
+	// tile definitions, their sheets packed in the atlas
+	vector<int> regions(hd->numSheets);
+	for (int s = 0; s < (int)hd->numSheets; s++) {
+		regions[s] = atlas_add(string(sheets[s].name, strnlen(sheets[s].name, c_LevelNameLen)));
+	}
+	tmap->tileOf.assign(hd->numTiles, (Tile*)NULL);
+	for (int t = 0; t < (int)hd->numTiles; t++) {
+		if (tiles[t].sheet < 0 || tiles[t].sheet >= (int)hd->numSheets || regions[tiles[t].sheet] < 0) {
+			continue;
+		}
+		Tile *tile = new Tile;
+		tile->region = regions[tiles[t].sheet];
+		tile->sheet  = string(sheets[tiles[t].sheet].name, strnlen(sheets[tiles[t].sheet].name, c_LevelNameLen));
+		tile->x = tiles[t].x;
+		tile->y = tiles[t].y;
+		tile->w = tiles[t].w;
+		tile->h = tiles[t].h;
+		tmap->tileOf[t] = tile;
+	}
+	// spawn lists
+	for (int s = 0; s < (int)hd->numSpawns; s++) {
+		v3i sp = v3i(spawns[s].x, spawns[s].y, spawns[s].value);
+		switch (spawns[s].kind) {
+		case spawn_ennemy: g_Ennemies.push_back(sp); break;
+		case spawn_star:   g_Stars.push_back(sp);    break;
+		case spawn_gem:    g_Gems.push_back(sp);     break;
+		}
+	}
+	return tmap;
 }
 
+// ------------------------------------------------------------------
 
+#ifndef HEADLESS
 
+// floor of a / b, for a possibly negative
+static int floor_div(int a, int b)
+{
+	return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
 
 // ------------------------------------------------------------------
+
 void tilemap_draw(Tilemap *tmap, v2i viewpos, int decallage)
 {
-
-	ForImage(tmap->tilemap, i, j) {
-		v3b pix = v3b(tmap->tilemap->pixel(i, j));
-		Tile *tile = tmap->tiles[pix];
-		if (tile && (i*tmap->tilew - viewpos[0] <= c_ScreenW && i*tmap->tilew - viewpos[0] > 0 && j*tmap->tileh - viewpos[1] <= c_ScreenH && j*tmap->tileh - viewpos[1] >= 0)) {
-			tile->image->drawSub(v2i(i*tmap->tilew, j*tmap->tileh) - v2i(viewpos[0] - decallage, viewpos[1]), v2i(tile->w, tile->h), v2i(tile->x, tile->y), v2i(tile->w, tile->h));
+	PROFILE_ZONE("tilemap draw");
+	// range of tiles whose corner falls on screen
+	int w = tmap->w;
+	int h = tmap->h;
+	int imin = max(0, floor_div(viewpos[0], tmap->tilew) + 1);
+	int imax = min(w - 1, floor_div(viewpos[0] + c_ScreenW, tmap->tilew));
+	int jmin = max(0, -floor_div(-viewpos[1], tmap->tileh));
+	int jmax = min(h - 1, floor_div(viewpos[1] + c_ScreenH, tmap->tileh));
+
+	// queue the visible tiles, drawn with the sprites by batch_draw
+	for (int j = jmin; j <= jmax; j++) {
+		for (int i = imin; i <= imax; i++) {
+			Tile *tile = tile_at(tmap, i, j);
+			if (tile == NULL) continue;
+			batch_add(tile->region, v2i(tile->x, tile->y), v2i(tile->w, tile->h),
+				v2i(i*tmap->tilew - viewpos[0] + decallage, j*tmap->tileh - viewpos[1]), layer_tiles);
 		}
 	}
-
 }
 
+#endif
+
 // ------------------------------------------------------------------
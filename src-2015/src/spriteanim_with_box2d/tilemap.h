@@ -9,32 +9,64 @@ using namespace std;
 
 // ------------------------------------------------------------------
 
+#ifndef HEADLESS
 #include "drawimage.h"
+#endif
+#include "physics.h"
+#include "levelfile.h"
 
 // ------------------------------------------------------------------
 
+// a tile: rectangle of a tile sheet, sheets being packed in the atlas
 typedef struct {
-	DrawImage *image;
+	int    region;
+	string sheet;  // atlas file of the region
 	int x;
 	int y;
 	int w;
 	int h;
 } Tile;
 
+// a rectangle of merged solid tiles, bound to a single fixture
+typedef struct {
+	int        x;
+	int        y;
+	int        w;       // in tiles
+	int        h;       // in tiles
+	b2Fixture *fixture; // NULL when the slot is free
+} TileRect;
+
 typedef struct
 {
-	map<string, DrawImage*> images;
 	map<v3b, Tile*>         tiles;
+	vector<Tile*>           grid;   // per tile: resolved definition, NULL if empty
 
-	ImageRGBA              *tilemap;
+	MappedFile              file;     // baked level, mapped while the tilemap lives (data NULL otherwise)
+	const int16_t          *cells;    // mapped grid of tile indices, used instead of grid until a tile changes
+	vector<Tile*>           tileOf;   // baked tile index -> definition, NULL if its sheet is unknown
+
+	ImageRGBA              *tilemap;  // map image, NULL when loaded from a baked file
+	int                     w;        // in tiles
+	int                     h;
 	int                     tilew;
 	int                     tileh;
+	bool                    baked;    // rects are read from the mapped file, not bound yet
+
+	b2Body                 *body;   // static body holding the collision rectangles
+	vector<TileRect>        rects;  // merged collision rectangles
+	vector<int>             rectAt; // per tile: index in rects, -1 if none
 } Tilemap;
 
 // ------------------------------------------------------------------
 
-Tilemap *tilemap_load(string fname);
+Tilemap *tilemap_load(string fname, int variant = -1); // variant: map picked by the script, -1 for random
 void     tilemap_draw(Tilemap *tmap, v2i viewpos, int decallage);
 void     tilemap_bind_to_physics(Tilemap *tmap);
+void     tilemap_set_active(Tilemap *tmap, bool active);
+void     tilemap_free(Tilemap *tmap);
+void     tilemap_set_tileat(Tilemap *tmap, int i, int j, int clr);
+void     tilemap_physics_report(string fname);
+bool     tilemap_bake(Tilemap *tmap, string fname);  // bound tilemap and spawn lists to a level file
+Tilemap *tilemap_load_baked(string fname);          // NULL if missing or outdated
 
 // ------------------------------------------------------------------